@@ -25,26 +25,25 @@ uniform sampler2D uSteepXH;
 uniform sampler2D uShallowZH;
 uniform sampler2D uSteepZH;
 
-uniform float uHeightScale = 0.1;
-
-uniform vec3 uLightColor;
-uniform vec3 uColorShade;
-uniform vec3 uColorSun;
-uniform vec3 uSpecColor;
-
-uniform vec3 uLightDirection;
-uniform vec3 uViewPos;
-
-uniform float uAmbientK;
-uniform float uDiffuseK;
-uniform float uOceanSpecularK;
-uniform float uOceanShininess;
-uniform float uGrainSpecularK;
-uniform float uGrainShininess;
-uniform float uGrainSize;
-
-uniform float uRimStrength;
-uniform float uRimPower;
+//ew::SandMaterial, only uploaded when it changes
+layout (std140) uniform SandMaterialBlock
+{
+    vec3 uLightColor;
+    float uAmbientK;
+    vec3 uColorShade;
+    float uDiffuseK;
+    vec3 uColorSun;
+    float uOceanSpecularK;
+    vec3 uSpecColor;
+    float uOceanShininess;
+    float uGrainSpecularK;
+    float uGrainShininess;
+    float uGrainSize;
+    float uRimStrength;
+    float uRimPower;
+    float uSteepnessStrength;
+    float uHeightScale;
+};
 
 float getDepth(vec2 texCoords);
 
@@ -3,17 +3,26 @@
 */
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 layout (location = 3) in vec3 aTangent;
+//ew::VertexDecode, set by Mesh on every draw. Identity for float vertices
+layout (location = 4) in vec4 aDecodeScale;
+layout (location = 5) in vec4 aDecodeOffset;
+layout (location = 6) in vec4 aTexCoordDecode;
 
 uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProjection;
 
-uniform vec3 uLightDirection;
-uniform vec3 uViewPos;
+//ew::FrameUniforms, the same buffer for every program
+layout (std140) uniform FrameBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+    vec3 uLightDirection;
+};
+
 uniform vec3 uUp;
 
 out Surface 
@@ -25,15 +34,46 @@ out Surface
     vec3 LightDirection;
 }vs_out;
 
+vec3 decodeOctahedral(vec2 e)
+{
+    e /= 32767.0;
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
+
+vec3 decodePosition()
+{
+    return aDecodeOffset.xyz + aPos.xyz * aDecodeScale.xyz;
+}
+
+vec3 decodeNormal()
+{
+    //compressed normals keep their length in aPos.w
+    return aDecodeOffset.w == 0.0 ? aNormal : decodeOctahedral(aNormal.xy) * (aPos.w * aDecodeScale.w);
+}
+
+vec3 decodeTangent()
+{
+    return aDecodeOffset.w == 0.0 ? aTangent : decodeOctahedral(aTangent.xy);
+}
+
+vec2 decodeTexCoord()
+{
+    return aTexCoordDecode.zw + aTexCoord * aTexCoordDecode.xy;
+}
+
 void main()
 {
-    vs_out.FragPos = vec3(uModel * vec4(aPos, 1.0));
-    vs_out.TexCoord = aTexCoord;
+    vec3 position = decodePosition();
+    vs_out.FragPos = vec3(uModel * vec4(position, 1.0));
+    vs_out.TexCoord = decodeTexCoord();
 
     //transform normals to world space
     mat3 normalMatrix = mat3(transpose(inverse(uModel)));
-    vec3 tangent = normalize(normalMatrix * aTangent);
-    vs_out.Normal = normalMatrix * aNormal;
+    vec3 tangent = normalize(normalMatrix * decodeTangent());
+    vs_out.Normal = normalMatrix * decodeNormal();
     vec3 bitangent = normalize(cross(vs_out.Normal, tangent));
 
     //make and apply TBN matric
@@ -42,5 +82,5 @@ void main()
     vs_out.ViewPos = TBN * uViewPos;
     vs_out.FragPos = TBN * vs_out.FragPos;
 
-    gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0f);
+    gl_Position = uProjection * uView * uModel * vec4(position, 1.0f);
 }
\ No newline at end of file
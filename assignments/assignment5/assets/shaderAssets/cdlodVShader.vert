@@ -0,0 +1,80 @@
+#version 330 core
+
+//CDLOD terrain. Every node draws the same grid (aPos on [0, 1] in x and y),
+//uNode places it in the height field and heights come from uHeightField
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 uModel;
+
+//ew::FrameUniforms, the same buffer for every program
+layout (std140) uniform FrameBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+    vec3 uLightDirection;
+};
+
+uniform sampler2D uHeightField;
+uniform vec2 uHeightFieldSize; //texels, including the one sample border
+uniform vec2 uHeightRange; //height = texel * x + y
+uniform vec2 uCellSize; //world size of one height field cell
+uniform vec4 uNode; //xy = node corner in cells, z = node size in cells
+uniform float uGridDim; //cells per side of the grid mesh
+uniform vec2 uMorphRange; //camera distances where morphing into the coarser level starts and ends
+uniform vec3 uCameraPos; //camera relative to the terrain
+
+out Surface
+{
+	vec3 FragPos;
+	vec2 TexCoord;
+	vec3 Normal;
+    vec3 ViewPos;
+    vec3 LightDirection;
+}vs_out;
+
+float getHeight(vec2 cell)
+{
+    return texture(uHeightField, (cell + 1.5) / uHeightFieldSize).r * uHeightRange.x + uHeightRange.y;
+}
+
+vec3 getTerrainPos(vec2 cell)
+{
+    return vec3(cell.x * uCellSize.x, getHeight(cell), -cell.y * uCellSize.y);
+}
+
+void main()
+{
+    vec2 cell = uNode.xy + aPos.xy * uNode.z;
+
+    //slide odd vertices onto the coarser level's grid as the camera moves away
+    float dist = distance(getTerrainPos(cell), uCameraPos);
+    float morphK = clamp((dist - uMorphRange.x) / (uMorphRange.y - uMorphRange.x), 0.0, 1.0);
+    vec2 morph = fract(aPos.xy * uGridDim * 0.5) * 2.0 / uGridDim;
+    cell -= morph * uNode.z * morphK;
+
+    vec3 pos = getTerrainPos(cell);
+
+    //same central differences as createTerrainFromHeightField
+    vec3 vA = vec3(uCellSize.x, (getHeight(cell + vec2(1.0, 0.0)) - getHeight(cell - vec2(1.0, 0.0))) * 0.5, 0.0);
+    vec3 vB = vec3(0.0, (getHeight(cell + vec2(0.0, 1.0)) - getHeight(cell - vec2(0.0, 1.0))) * 0.5, -uCellSize.y);
+    vec3 normal = cross(vA, vB);
+    vec3 aTangent = cross(vA, normal);
+
+    vs_out.FragPos = vec3(uModel * vec4(pos, 1.0));
+    vs_out.TexCoord = cell / (uHeightFieldSize - 3.0);
+
+    //transform normals to world space
+    mat3 normalMatrix = mat3(transpose(inverse(uModel)));
+    vec3 tangent = normalize(normalMatrix * aTangent);
+    vs_out.Normal = normalMatrix * normal;
+    vec3 bitangent = normalize(cross(vs_out.Normal, tangent));
+
+    //make and apply TBN matric
+    mat3 TBN = transpose(mat3(tangent, bitangent, vs_out.Normal));
+    vs_out.LightDirection = TBN * normalize(uLightDirection);
+    vs_out.ViewPos = TBN * uViewPos;
+    vs_out.FragPos = TBN * vs_out.FragPos;
+
+    gl_Position = uProjection * uView * uModel * vec4(pos, 1.0f);
+}
@@ -3,10 +3,14 @@
 */
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 layout (location = 3) in vec3 aTangent;
+//ew::VertexDecode, set by Mesh on every draw. Identity for float vertices
+layout (location = 4) in vec4 aDecodeScale;
+layout (location = 5) in vec4 aDecodeOffset;
+layout (location = 6) in vec4 aTexCoordDecode;
 
 uniform mat4 uModel;
 uniform mat4 uView;
@@ -18,14 +22,39 @@ out Surface
 	vec3 Normal;
 }vs_out;
 
+vec3 decodeOctahedral(vec2 e)
+{
+    e /= 32767.0;
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
+
+vec3 decodePosition()
+{
+    return aDecodeOffset.xyz + aPos.xyz * aDecodeScale.xyz;
+}
+
+vec3 decodeNormal()
+{
+    //compressed normals keep their length in aPos.w
+    return aDecodeOffset.w == 0.0 ? aNormal : decodeOctahedral(aNormal.xy) * (aPos.w * aDecodeScale.w);
+}
+
+vec2 decodeTexCoord()
+{
+    return aTexCoordDecode.zw + aTexCoord * aTexCoordDecode.xy;
+}
+
 void main()
 {
-    vs_out.TexCoord = aTexCoord;
+    vs_out.TexCoord = decodeTexCoord();
     //transform normals to world space
     mat3 normalMatrix = mat3(transpose(inverse(uModel)));
-    vs_out.Normal = normalMatrix * aNormal;
+    vs_out.Normal = normalMatrix * decodeNormal();
 
-    gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0f);
+    gl_Position = uProjection * uView * uModel * vec4(decodePosition(), 1.0f);
 }
 
 //#version 450
@@ -3,13 +3,28 @@
 */
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos;
+//ew::VertexDecode, set by Mesh on every draw. Identity for float vertices
+layout (location = 4) in vec4 aDecodeScale;
+layout (location = 5) in vec4 aDecodeOffset;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+//ew::FrameUniforms, the same buffer for every program
+layout (std140) uniform FrameBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+    vec3 uLightDirection;
+};
+
+vec3 decodePosition()
+{
+    return aDecodeOffset.xyz + aPos.xyz * aDecodeScale.xyz;
+}
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+    gl_Position = uProjection * uView * model * vec4(decodePosition(), 1.0f);
 }
\ No newline at end of file
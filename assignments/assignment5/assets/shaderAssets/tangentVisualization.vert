@@ -2,19 +2,49 @@
 	Author: Annabelle Thompson
 */
 #version 330 core
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos;
 layout (location = 3) in vec3 aTangent;
+//ew::VertexDecode, set by Mesh on every draw. Identity for float vertices
+layout (location = 4) in vec4 aDecodeScale;
+layout (location = 5) in vec4 aDecodeOffset;
 
 out VS_OUT {
     vec3 tangent;
 } vs_out;
 
-uniform mat4 view;
 uniform mat4 model;
 
+//ew::FrameUniforms, the same buffer for every program
+layout (std140) uniform FrameBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+    vec3 uLightDirection;
+};
+
+vec3 decodeOctahedral(vec2 e)
+{
+    e /= 32767.0;
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
+
+vec3 decodePosition()
+{
+    return aDecodeOffset.xyz + aPos.xyz * aDecodeScale.xyz;
+}
+
+vec3 decodeTangent()
+{
+    return aDecodeOffset.w == 0.0 ? aTangent : decodeOctahedral(aTangent.xy);
+}
+
 void main()
 {
-    mat3 normalMatrix = mat3(transpose(inverse(view * model)));
-    vs_out.tangent = vec3(vec4(normalMatrix * aTangent, 0.0));
-    gl_Position = view * model * vec4(aPos, 1.0); 
+    mat3 normalMatrix = mat3(transpose(inverse(uView * model)));
+    vs_out.tangent = vec3(vec4(normalMatrix * decodeTangent(), 0.0));
+    gl_Position = uView * model * vec4(decodePosition(), 1.0); 
 }
\ No newline at end of file
@@ -0,0 +1,69 @@
+#version 330 core
+
+//Terrain without vertex attributes. gl_VertexID is the grid vertex (row * (uSubDivisions + 1) + col),
+//heights come from uHeightField with the one sample border createHeightField adds,
+//and the vertex is rebuilt the way createTerrainFromHeightField builds it
+uniform mat4 uModel;
+
+//ew::FrameUniforms, the same buffer for every program
+layout (std140) uniform FrameBlock
+{
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+    vec3 uLightDirection;
+};
+
+uniform sampler2D uHeightField;
+uniform vec2 uHeightRange; //height = texel * x + y
+uniform int uSubDivisions;
+uniform vec2 uTerrainSize; //total width and height
+
+out Surface
+{
+	vec3 FragPos;
+	vec2 TexCoord;
+	vec3 Normal;
+    vec3 ViewPos;
+    vec3 LightDirection;
+}vs_out;
+
+float getHeight(int col, int row)
+{
+    return texelFetch(uHeightField, ivec2(col + 1, row + 1), 0).r * uHeightRange.x + uHeightRange.y;
+}
+
+void main()
+{
+    int verticesPerRow = uSubDivisions + 1;
+    int col = gl_VertexID % verticesPerRow;
+    int row = gl_VertexID / verticesPerRow;
+
+    vec2 aTexCoord = vec2(float(col) / float(uSubDivisions), float(row) / float(uSubDivisions));
+    vec3 aPos = vec3(aTexCoord.x * uTerrainSize.x, getHeight(col, row), aTexCoord.y * uTerrainSize.y * -1.0);
+
+    //central differences, like the CPU mesh
+    float dx = uTerrainSize.x / float(uSubDivisions);
+    float dz = uTerrainSize.y / float(uSubDivisions);
+    vec3 vA = vec3(dx, (getHeight(col + 1, row) - getHeight(col - 1, row)) * 0.5, 0.0);
+    vec3 vB = vec3(0.0, (getHeight(col, row + 1) - getHeight(col, row - 1)) * 0.5, -dz);
+    vec3 aNormal = cross(vA, vB);
+    vec3 aTangent = cross(vA, aNormal);
+
+    vs_out.FragPos = vec3(uModel * vec4(aPos, 1.0));
+    vs_out.TexCoord = aTexCoord;
+
+    //transform normals to world space
+    mat3 normalMatrix = mat3(transpose(inverse(uModel)));
+    vec3 tangent = normalize(normalMatrix * aTangent);
+    vs_out.Normal = normalMatrix * aNormal;
+    vec3 bitangent = normalize(cross(vs_out.Normal, tangent));
+
+    //make and apply TBN matric
+    mat3 TBN = transpose(mat3(tangent, bitangent, vs_out.Normal));
+    vs_out.LightDirection = TBN * normalize(uLightDirection);
+    vs_out.ViewPos = TBN * uViewPos;
+    vs_out.FragPos = TBN * vs_out.FragPos;
+
+    gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0f);
+}
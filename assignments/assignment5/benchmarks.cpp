@@ -0,0 +1,3092 @@
+#include "benchmarks.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+#include <ew/external/glad.h>
+#include <ew/mesh.h>
+#include <ew/gridIndices.h>
+#include <ew/vertexLayout.h>
+#include <ew/meshOptimizer.h>
+#include <ew/culling.h>
+#include <ew/procGen.h>
+#include <ew/external/stb_image.h>
+#include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Terrain/terrain.h"
+#include "Terrain/array2dOps.h"
+#include "Terrain/heightFieldFile.h"
+#include "Terrain/parallel.h"
+#include "Terrain/duneKernel.h"
+#include "Terrain/duneGenerators.h"
+#include "Terrain/terrainChunks.h"
+#include "Terrain/cdlod.h"
+#include "Terrain/terrainRebuilder.h"
+#include "Terrain/gpuTerrain.h"
+#include "Terrain/terrainCache.h"
+#include "Terrain/heightmap.h"
+#include "Terrain/duneSimulation.h"
+#include "Terrain/terrainQuery.h"
+#include "Terrain/rtinMesher.h"
+#include "Texture/rippleTextures.h"
+#include "Texture/normalBaker.h"
+#include "Shader/Shader.h"
+#include "Shader/uniformBlocks.h"
+#include "Camera/Camera.h"
+#include <string>
+#include <thread>
+#include <vector>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	double nowMs()
+	{
+		using namespace std::chrono;
+		return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+	}
+
+	int argInt(int argc, char** argv, int index, int fallback)
+	{
+		return index < argc ? atoi(argv[index]) : fallback;
+	}
+
+	//Invisible window for benchmarks that need a GL context. Returns NULL if GL is unavailable
+	GLFWwindow* createHiddenContext()
+	{
+		if (!glfwInit()) {
+			printf("GLFW failed to init!\n");
+			return NULL;
+		}
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		GLFWwindow* window = glfwCreateWindow(64, 64, "bench", NULL, NULL);
+		if (window == NULL) {
+			printf("GLFW failed to create window\n");
+			return NULL;
+		}
+		glfwMakeContextCurrent(window);
+		if (!gladLoadGL(glfwGetProcAddress)) {
+			printf("GLAD Failed to load GL headers\n");
+			return NULL;
+		}
+		return window;
+	}
+
+	//Color and depth render target, hidden windows do not always come with a usable default framebuffer
+	struct OffscreenTarget
+	{
+		unsigned int fbo = 0;
+		unsigned int renderbuffers[2] = { 0, 0 };
+		int size = 0;
+
+		OffscreenTarget(int size) : size(size)
+		{
+			glGenFramebuffers(1, &fbo);
+			glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+			glGenRenderbuffers(2, renderbuffers);
+			glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+			glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+			glViewport(0, 0, size, size);
+			glEnable(GL_DEPTH_TEST);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+
+		~OffscreenTarget()
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glDeleteRenderbuffers(2, renderbuffers);
+			glDeleteFramebuffers(1, &fbo);
+		}
+
+		std::vector<float> readDepth() const
+		{
+			std::vector<float> depth(size * size);
+			glReadPixels(0, 0, size, size, GL_DEPTH_COMPONENT, GL_FLOAT, depth.data());
+			return depth;
+		}
+	};
+
+	//the uniform blocks main fills, for benchmarks that draw with the app's shaders
+	struct SandBlocks
+	{
+		ew::UniformBlock<ew::FrameUniforms> frame;
+		ew::UniformBlock<ew::SandMaterial> material;
+
+		SandBlocks()
+		{
+			frame.create(ew::FRAME_BINDING);
+			material.create(ew::SAND_MATERIAL_BINDING);
+			material.upload();
+		}
+
+		void setFrame(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDirection = glm::vec3(0.0f))
+		{
+			ew::FrameUniforms uniforms;
+			uniforms.view = view;
+			uniforms.projection = projection;
+			uniforms.lightDirection = lightDirection;
+			frame.set(uniforms);
+			frame.upload();
+		}
+	};
+
+	void destroyHiddenContext(GLFWwindow* window)
+	{
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+
+	//edgeSmoother as it was before the height field cache: makeDune(col, row) is always evaluated first
+	float legacyEdgeSmoother(int col, int row, int subDivisions, int type)
+	{
+		float x = col, y = row;
+		float lowerBound = (float)subDivisions / 5.0;
+		float upperBound = (float)subDivisions - ((float)subDivisions / 10.0);
+		float H = ew::makeDune(col, row, type);
+		double K = (3.0 * ew::PI) / 2.0;
+		if (x < lowerBound) {
+			if (y > lowerBound) {
+				float J = ew::makeDune(lowerBound, y, type);
+				H = cos(x / K) * J - fabsf(J);
+			}
+			else if (y < lowerBound) {
+				float J = ew::makeDune(lowerBound, lowerBound, type);
+				H = (cos(y / K) * J - fabsf(J) > cos(x / K) * J - fabsf(J)) ? cos(x / K) * J - fabsf(J) : cos(y / K) * J - fabsf(J);
+			}
+		}
+		else if (y < lowerBound) {
+			H = sin(y / K) * ew::makeDune(x, lowerBound, type);
+		}
+		else if (x > upperBound) {
+			if (y < upperBound) {
+				H = sin(x / K) * ew::makeDune(upperBound, y, type);
+			}
+			else if (y > upperBound) {
+				float J = ew::makeDune(upperBound, upperBound, type);
+				H = cos(x / K) * J - fabsf(J);
+			}
+		}
+		else if (y > upperBound) {
+			H = sin(y / K) * ew::makeDune(x, upperBound, type);
+		}
+		return H;
+	}
+
+	//createTerrain as it was before the height field cache, kept as the baseline.
+	//Every vertex evaluates the height at (col, row) three times and its +x/+z neighbours twice and once
+	void createTerrainLegacy(float width, float height, int subDivisions, ew::MeshData* mesh, int type)
+	{
+		mesh->vertices.clear();
+		mesh->vertices.reserve((subDivisions + 1) * (subDivisions + 1));
+		float dx = width / subDivisions;
+		float dz = height / subDivisions;
+		for (int row = 0; row <= subDivisions; row++)
+		{
+			for (int col = 0; col <= subDivisions; col++)
+			{
+				glm::vec2 uv = glm::vec2((float)col / subDivisions, (float)row / subDivisions);
+				glm::vec3 pos = glm::vec3(uv.x * width, legacyEdgeSmoother(col, row, subDivisions, type), uv.y * height * -1);
+
+				//getNormal
+				float hA = legacyEdgeSmoother(col, row, subDivisions, type);
+				glm::vec3 vA = glm::vec3(dx, legacyEdgeSmoother(col + 1, row, subDivisions, type) - hA, 0.0f);
+				glm::vec3 vB = glm::vec3(0.0f, legacyEdgeSmoother(col, row + 1, subDivisions, type) - hA, -dz);
+				glm::vec3 normal = glm::cross(vA, vB);
+
+				//getTangent
+				hA = legacyEdgeSmoother(col, row, subDivisions, type);
+				vA = glm::vec3(dx, legacyEdgeSmoother(col + 1, row, subDivisions, type) - hA, 0.0f);
+				glm::vec3 tangent = glm::cross(vA, normal);
+
+				mesh->vertices.emplace_back(pos, normal, uv, tangent);
+			}
+		}
+	}
+
+	//terrain [subDivisions] [type]
+	int benchTerrain(int argc, char** argv)
+	{
+		int subDivisions = argInt(argc, argv, 0, 2048);
+		int type = argInt(argc, argv, 1, 0);
+		ew::MeshData legacy, cached;
+
+		double start = nowMs();
+		createTerrainLegacy(72.0f, 72.0f, subDivisions, &legacy, type);
+		double legacyMs = nowMs() - start;
+
+		start = nowMs();
+		ew::createTerrain(72.0f, 72.0f, subDivisions, &cached, type);
+		double cachedMs = nowMs() - start;
+
+		//a NaN never beats maxHeightError, so count them on their own
+		float maxHeightError = 0.0f;
+		int nonFinite = 0;
+		for (size_t i = 0; i < cached.vertices.size(); i++)
+		{
+			const ew::Vertex& v = cached.vertices[i];
+			float error = fabsf(v.pos.y - legacy.vertices[i].pos.y);
+			maxHeightError = error > maxHeightError ? error : maxHeightError;
+			nonFinite += !isfinite(v.pos.y) || !isfinite(v.normal.x) || !isfinite(v.normal.y) || !isfinite(v.normal.z);
+		}
+
+		printf("terrain %dx%d type %d\n", subDivisions, subDivisions, type);
+		printf("  before (per vertex recompute): %9.1f ms\n", legacyMs);
+		printf("  after  (height field cache):   %9.1f ms\n", cachedMs);
+		printf("  speedup: %.2fx, max height difference: %g, non-finite vertices: %d\n", legacyMs / cachedMs, maxHeightError, nonFinite);
+		return maxHeightError == 0.0f && nonFinite == 0 ? 0 : 1;
+	}
+
+	//terrain-mt [subDivisions] [threads] [type]
+	int benchTerrainThreads(int argc, char** argv)
+	{
+		int subDivisions = argInt(argc, argv, 0, 2048);
+		int numThreads = argInt(argc, argv, 1, ew::defaultThreadCount());
+		int type = argInt(argc, argv, 2, 0);
+		ew::MeshData single, multi;
+
+		double start = nowMs();
+		ew::createTerrain(72.0f, 72.0f, subDivisions, &single, type, 1);
+		double singleMs = nowMs() - start;
+
+		start = nowMs();
+		ew::createTerrain(72.0f, 72.0f, subDivisions, &multi, type, numThreads);
+		double multiMs = nowMs() - start;
+
+		//bit for bit, not within a tolerance
+		bool match = single.vertices.size() == multi.vertices.size() && single.indices == multi.indices
+			&& memcmp(single.vertices.data(), multi.vertices.data(), single.vertices.size() * sizeof(ew::Vertex)) == 0;
+
+		printf("terrain %dx%d type %d\n", subDivisions, subDivisions, type);
+		printf("  1 thread:   %9.1f ms\n", singleMs);
+		printf("  %d threads: %9.1f ms\n", numThreads, multiMs);
+		printf("  speedup: %.2fx, output identical: %s\n", singleMs / multiMs, match ? "yes" : "NO");
+		return match ? 0 : 1;
+	}
+
+	//dune-simd [subDivisions]
+	int benchDuneSimd(int argc, char** argv)
+	{
+		int subDivisions = argInt(argc, argv, 0, 2048);
+		int size = subDivisions + 3;
+		const ew::DuneKernel kernels[] = { ew::DuneKernel::SCALAR, ew::DuneKernel::SIMD4, ew::DuneKernel::AVX2 };
+		std::vector<float> reference(size), row(size);
+		bool ok = true;
+
+		printf("dune kernels on %dx%d, best: %s\n", subDivisions, subDivisions, ew::getDuneKernelName(ew::DuneKernel::AUTO));
+		printf("  max |error| against makeDune / edgeSmoother\n");
+		printf("  type %-8s %12s %12s\n", "kernel", "makeDune", "edgeSmoother");
+		for (int type = 0; type <= 5; type++)
+		{
+			for (ew::DuneKernel kernel : kernels)
+			{
+				if (!ew::isDuneKernelSupported(kernel)) {
+					continue;
+				}
+				float duneError = 0.0f, edgeError = 0.0f;
+				for (int y = -1; y <= subDivisions + 1; y++)
+				{
+					//makeDune takes square roots, so only non-negative columns/rows are valid there
+					if (y >= 0) {
+						ew::makeDuneRow(0, y, size - 1, type, row.data(), kernel);
+						for (int x = 0; x < size - 1; x++)
+						{
+							duneError = fmaxf(duneError, fabsf(row[x] - ew::makeDune(x, y, type)));
+						}
+					}
+					ew::edgeSmootherRow(-1, y, size, subDivisions, type, row.data(), kernel);
+					for (int x = 0; x < size; x++)
+					{
+						edgeError = fmaxf(edgeError, fabsf(row[x] - ew::edgeSmoother(x - 1, y, subDivisions, type)));
+					}
+				}
+				printf("  %4d %-8s %12.3g %12.3g\n", type, ew::getDuneKernelName(kernel), duneError, edgeError);
+				ok = ok && (kernel != ew::DuneKernel::SCALAR || (duneError == 0.0f && edgeError == 0.0f));
+			}
+		}
+
+		printf("  throughput, million samples/s (type 0)\n");
+		printf("  %-8s %12s %12s\n", "kernel", "makeDune", "edgeSmoother");
+		for (ew::DuneKernel kernel : kernels)
+		{
+			if (!ew::isDuneKernelSupported(kernel)) {
+				continue;
+			}
+			double start = nowMs();
+			for (int y = 0; y < subDivisions; y++)
+			{
+				ew::makeDuneRow(0, y, size, 0, row.data(), kernel);
+			}
+			double duneMs = nowMs() - start;
+			start = nowMs();
+			for (int y = -1; y <= subDivisions + 1; y++)
+			{
+				ew::edgeSmootherRow(-1, y, size, subDivisions, 0, row.data(), kernel);
+			}
+			double edgeMs = nowMs() - start;
+			double samples = (double)size * size;
+			printf("  %-8s %12.1f %12.1f\n", ew::getDuneKernelName(kernel), samples / duneMs / 1000.0, samples / edgeMs / 1000.0);
+		}
+		return ok ? 0 : 1;
+	}
+
+	//dune-dispatch [subDivisions] [runs]
+	int benchDuneDispatch(int argc, char** argv)
+	{
+		int subDivisions = argInt(argc, argv, 0, 1024);
+		int runs = std::max(1, argInt(argc, argv, 1, 3));
+		int size = subDivisions + 3;
+		std::vector<float> perSample(size * size), perRow(size * size);
+		Array2D<float> heights;
+		bool ok = true;
+
+		//before: every sample went through makeDune/edgeSmoother and picked its dune type again.
+		//after: the generator is picked once and the loops are instantiated for it. Best of runs
+		printf("dune dispatch on %dx%d, scalar kernel, 1 thread, million samples/s, best of %d\n", subDivisions, subDivisions, runs);
+		printf("  %4s %-16s %12s %12s %8s %12s %12s %8s %s\n", "type", "generator", "makeDune", "row", "gain", "edgeSmoother", "heightField", "gain", "same");
+		for (int type = -1; type < ew::getDuneTypeCount(); type++)
+		{
+			double duneSampleMs = 1e30, duneRowMs = 1e30, edgeSampleMs = 1e30, heightFieldMs = 1e30;
+			for (int run = 0; run < runs; run++)
+			{
+				double start = nowMs();
+				for (int y = 0; y < size; y++)
+				{
+					for (int x = 0; x < size; x++)
+					{
+						perSample[y * size + x] = ew::makeDune(x, y, type);
+					}
+				}
+				duneSampleMs = std::min(duneSampleMs, nowMs() - start);
+
+				start = nowMs();
+				ew::DuneRowFunction duneRow = ew::getDuneRowFunction(type, ew::DuneKernel::SCALAR);
+				for (int y = 0; y < size; y++)
+				{
+					duneRow(0, y, size, &perRow[y * size]);
+				}
+				duneRowMs = std::min(duneRowMs, nowMs() - start);
+			}
+			bool same = perSample == perRow;
+
+			for (int run = 0; run < runs; run++)
+			{
+				double start = nowMs();
+				for (int y = -1; y <= subDivisions + 1; y++)
+				{
+					for (int x = -1; x <= subDivisions + 1; x++)
+					{
+						perSample[(y + 1) * size + x + 1] = ew::edgeSmoother(x, y, subDivisions, type);
+					}
+				}
+				edgeSampleMs = std::min(edgeSampleMs, nowMs() - start);
+
+				start = nowMs();
+				ew::createHeightField(subDivisions, type, &heights, 1, ew::DuneKernel::SCALAR);
+				heightFieldMs = std::min(heightFieldMs, nowMs() - start);
+			}
+			for (int row = 0; row < size; row++)
+			{
+				same = same && memcmp(heights.GetAddr(0, row), &perSample[row * size], sizeof(float) * size) == 0;
+			}
+
+			double samples = (double)size * size;
+			printf("  %4d %-16s %12.1f %12.1f %7.2fx %12.1f %12.1f %7.2fx %s\n", type, ew::getDuneName(type),
+				samples / duneSampleMs / 1000.0, samples / duneRowMs / 1000.0, duneSampleMs / duneRowMs,
+				samples / edgeSampleMs / 1000.0, samples / heightFieldMs / 1000.0, edgeSampleMs / heightFieldMs, same ? "yes" : "NO");
+			ok = ok && same;
+		}
+		return ok ? 0 : 1;
+	}
+
+	//chunks [frames] [speed]
+	int benchChunks(int argc, char** argv)
+	{
+		int frames = argInt(argc, argv, 0, 600);
+		float speed = (float)argInt(argc, argv, 1, 8);
+		ew::TerrainChunkSettings settings;
+
+		//neighbouring chunks must agree on their shared edge
+		int resolution = settings.resolution;
+		ew::MeshData center, right, up;
+		ew::createTerrainChunk(ew::ChunkCoord(-1, -1), settings, &center);
+		ew::createTerrainChunk(ew::ChunkCoord(0, -1), settings, &right);
+		ew::createTerrainChunk(ew::ChunkCoord(-1, 0), settings, &up);
+		bool seamsMatch = true;
+		for (int i = 0; i <= resolution; i++)
+		{
+			const ew::Vertex& a = center.vertices[i * (resolution + 1) + resolution];
+			const ew::Vertex& b = right.vertices[i * (resolution + 1)];
+			const ew::Vertex& c = center.vertices[resolution * (resolution + 1) + i];
+			const ew::Vertex& d = up.vertices[i];
+			seamsMatch = seamsMatch && a.pos.y == b.pos.y && a.normal == b.normal && a.pos.z == b.pos.z;
+			seamsMatch = seamsMatch && c.pos.y == d.pos.y && c.normal == d.normal && c.pos.x == d.pos.x;
+		}
+		printf("chunk seams across the mirrored origin match: %s\n", seamsMatch ? "yes" : "NO");
+
+		GLFWwindow* window = createHiddenContext();
+		if (window == NULL) {
+			return 1;
+		}
+		int maxResident = 0, maxAllocated = 0;
+		size_t maxUpload = 0, totalUpload = 0;
+		double start = nowMs();
+		{
+			ew::TerrainChunkManager chunks(settings);
+			glm::vec3 cameraPos(0.0f, 10.0f, 0.0f);
+			for (int frame = 0; frame < frames; frame++)
+			{
+				cameraPos += glm::vec3(speed, 0.0f, -speed * 0.5f);
+				chunks.update(cameraPos);
+				const ew::TerrainChunkStats& stats = chunks.getStats();
+				maxResident = stats.resident > maxResident ? stats.resident : maxResident;
+				maxAllocated = stats.allocated > maxAllocated ? stats.allocated : maxAllocated;
+				maxUpload = stats.uploadBytesThisFrame > maxUpload ? stats.uploadBytesThisFrame : maxUpload;
+				totalUpload += stats.uploadBytesThisFrame;
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			}
+		}
+		double elapsedMs = nowMs() - start;
+		destroyHiddenContext(window);
+
+		int keep = 2 * (settings.loadRadius + 1) + 1;
+		printf("flew %.0f units over %d frames in %.0f ms\n", frames * speed, frames, elapsedMs);
+		printf("  max resident chunks %d, chunk objects allocated %d (bound %d)\n", maxResident, maxAllocated, keep * keep);
+		printf("  upload per frame: max %.1f KB (budget %.1f KB), average %.1f KB\n", maxUpload / 1024.0f, settings.uploadBudgetBytes / 1024.0f, totalUpload / 1024.0f / frames);
+		return seamsMatch && maxAllocated <= keep * keep ? 0 : 1;
+	}
+
+	//cdlod [subDivisions] [frames]
+	int benchCdlod(int argc, char** argv)
+	{
+		int subDivisions = argInt(argc, argv, 0, 2048);
+		int frames = argInt(argc, argv, 1, 200);
+		float size = 512.0f;
+
+		Array2D<float> heights;
+		ew::createHeightField(subDivisions, 0, &heights, ew::defaultThreadCount());
+		float minHeight, maxHeight;
+		heights.GetMinMax(minHeight, maxHeight);
+
+		ew::CDLODQuadtree quadtree;
+		double start = nowMs();
+		quadtree.init(size, size, subDivisions, heights);
+		double initMs = nowMs() - start;
+
+		//fly corner to corner just above the dunes, checking every selection covers the terrain exactly once
+		//and that neighbouring areas are never more than one level apart
+		//levels are tracked per half leaf node, the smallest area a quadrant draw covers
+		int grid = quadtree.getSettings().gridResolution;
+		int quarter = grid / 2;
+		int leaves = (subDivisions + quarter - 1) / quarter;
+		std::vector<int> levelMap(leaves * leaves);
+		std::vector<ew::CDLODNode> nodes;
+		double selectMs = 0.0;
+		long long totalTriangles = 0;
+		int maxTriangles = 0;
+		bool valid = true;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			float t = frames > 1 ? (float)frame / (frames - 1) : 0.0f;
+			glm::vec3 cameraPos(t * size, maxHeight + 5.0f, -t * size * 0.8f);
+			start = nowMs();
+			quadtree.select(cameraPos, &nodes);
+			selectMs += nowMs() - start;
+
+			std::fill(levelMap.begin(), levelMap.end(), -1);
+			int triangles = 0;
+			for (const ew::CDLODNode& node : nodes)
+			{
+				int quadrantLeaves = node.sizeCells / 2 / quarter;
+				for (int quadrant = 0; quadrant < 4; quadrant++)
+				{
+					if (!(node.quadrantMask & (1 << quadrant))) {
+						continue;
+					}
+					triangles += grid * grid / 2;
+					int leafX = node.cellX / quarter + (quadrant & 1) * quadrantLeaves;
+					int leafZ = node.cellZ / quarter + (quadrant >> 1) * quadrantLeaves;
+					for (int z = leafZ; z < leafZ + quadrantLeaves && z < leaves; z++)
+					{
+						for (int x = leafX; x < leafX + quadrantLeaves && x < leaves; x++)
+						{
+							valid = valid && levelMap[z * leaves + x] == -1;
+							levelMap[z * leaves + x] = node.level;
+						}
+					}
+				}
+			}
+			for (int z = 0; z < leaves; z++)
+			{
+				for (int x = 0; x < leaves; x++)
+				{
+					int level = levelMap[z * leaves + x];
+					valid = valid && level >= 0;
+					if (x + 1 < leaves) {
+						valid = valid && abs(level - levelMap[z * leaves + x + 1]) <= 1;
+					}
+					if (z + 1 < leaves) {
+						valid = valid && abs(level - levelMap[(z + 1) * leaves + x]) <= 1;
+					}
+				}
+			}
+			totalTriangles += triangles;
+			maxTriangles = triangles > maxTriangles ? triangles : maxTriangles;
+		}
+
+		int fullTriangles = subDivisions * subDivisions * 2;
+		double averageTriangles = (double)totalTriangles / frames;
+		printf("CDLOD %dx%d, %d levels, grid %d, quadtree built in %.2f ms\n", subDivisions, subDivisions, quadtree.getLevels(), grid, initMs);
+		printf("  triangles per frame: average %.0f, max %d, full grid %d (%.1fx fewer)\n", averageTriangles, maxTriangles, fullTriangles, fullTriangles / averageTriangles);
+		printf("  selection: %.3f ms per frame\n", selectMs / frames);
+		printf("  full coverage, no overlaps, neighbours within one level: %s\n", valid ? "yes" : "NO");
+
+		//draw once through the real shader and let GL count what it rasterized
+		GLFWwindow* window = createHiddenContext();
+		if (window == NULL) {
+			return 1;
+		}
+		bool drawn = false;
+		{
+			Shader shader("assets/shaderAssets/cdlodVShader.vert", "assets/shaderAssets/basicLightingFShader.frag");
+			int linked = 0;
+			glGetProgramiv(shader.mId, GL_LINK_STATUS, &linked);
+
+			ew::CDLODTerrain terrain;
+			terrain.init(size, size, subDivisions, heights);
+			glm::vec3 cameraPos(size * 0.5f, maxHeight + 5.0f, -size * 0.5f);
+			shader.use();
+			shader.setMat4("uModel", glm::mat4(1.0f));
+			SandBlocks blocks;
+			ew::bindUniformBlocks(shader);
+			blocks.setFrame(glm::lookAt(cameraPos, cameraPos + glm::vec3(1.0f, -0.3f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)), glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 1000.0f));
+
+			OffscreenTarget target(256);
+
+			unsigned int query;
+			glGenQueries(1, &query);
+			glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+			terrain.draw(shader, cameraPos, 0);
+			glEndQuery(GL_PRIMITIVES_GENERATED);
+			unsigned int primitives = 0;
+			glGetQueryObjectuiv(query, GL_QUERY_RESULT, &primitives);
+			glDeleteQueries(1, &query);
+
+			const ew::CDLODStats& stats = terrain.getStats();
+			drawn = linked && glGetError() == GL_NO_ERROR && primitives == (unsigned int)stats.triangles;
+			printf("  GL draw: shader linked %s, %d nodes, %d triangles counted, %u generated\n", linked ? "yes" : "NO", stats.nodes, stats.triangles, primitives);
+		}
+		destroyHiddenContext(window);
+		return valid && drawn ? 0 : 1;
+	}
+
+	//indices [subDivisions] [chunks]
+	int benchIndices(int argc, char** argv)
+	{
+		int subDivisions = argInt(argc, argv, 0, 64);
+		int chunks = argInt(argc, argv, 1, 81);
+
+		GLFWwindow* window = createHiddenContext();
+		if (window == NULL) {
+			return 1;
+		}
+		bool ok = true;
+		{
+			Array2D<float> heights;
+			ew::createHeightField(subDivisions, 0, &heights);
+			ew::MeshData meshData;
+			float size = 64.0f;
+			ew::createTerrainFromHeightField(size, size, subDivisions, heights, &meshData);
+
+			//what every mesh used to upload for itself
+			ew::IndexBuffer legacy;
+			legacy.numIndices = (int)meshData.indices.size();
+			glBindVertexArray(0);
+			glGenBuffers(1, &legacy.ebo);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, legacy.ebo);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+			struct Layout
+			{
+				const char* name;
+				ew::IndexBuffer indexBuffer;
+			};
+			Layout layouts[] = {
+				{ "uint list", legacy },
+				{ "shared list", ew::getGridIndexBuffer(subDivisions, false) },
+				{ "shared strip", ew::getGridIndexBuffer(subDivisions, true) },
+			};
+
+			Shader shader("assets/shaderAssets/basicLightingVShader.vert", "assets/shaderAssets/basicLightingFShader.frag");
+			shader.use();
+			shader.setMat4("uModel", glm::mat4(1.0f));
+			SandBlocks blocks;
+			ew::bindUniformBlocks(shader);
+			blocks.setFrame(glm::lookAt(glm::vec3(size * 0.5f, 40.0f, 10.0f), glm::vec3(size * 0.5f, 0.0f, -size * 0.5f), glm::vec3(0.0f, 1.0f, 0.0f)), glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 1000.0f));
+
+			//culling on, so a strip with the wrong winding would lose coverage
+			OffscreenTarget target(256);
+			glEnable(GL_CULL_FACE);
+			ew::Mesh mesh;
+			std::vector<float> reference;
+			printf("%dx%d grid, %d vertices, %d chunks resident\n", subDivisions, subDivisions, (int)meshData.vertices.size(), chunks);
+			printf("  %-14s %6s %9s %12s %14s %12s %s\n", "layout", "type", "indices", "bytes/mesh", "bytes/chunks", "primitives", "depth");
+			for (const Layout& layout : layouts)
+			{
+				const ew::IndexBuffer& indexBuffer = layout.indexBuffer;
+				bool shortIndices = indexBuffer.indexType == ew::IndexType::UNSIGNED_SHORT;
+				size_t bytes = (size_t)indexBuffer.numIndices * (shortIndices ? sizeof(unsigned short) : sizeof(unsigned int));
+				//the old path stores one copy per chunk, the shared buffers one in total
+				size_t sceneBytes = indexBuffer.ebo == legacy.ebo ? bytes * chunks : bytes;
+
+				mesh.load(meshData, indexBuffer);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				unsigned int query, primitives = 0;
+				glGenQueries(1, &query);
+				glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+				mesh.draw();
+				glEndQuery(GL_PRIMITIVES_GENERATED);
+				glGetQueryObjectuiv(query, GL_QUERY_RESULT, &primitives);
+				glDeleteQueries(1, &query);
+
+				std::vector<float> depth = target.readDepth();
+				if (reference.empty()) {
+					reference = depth;
+				}
+				//strips start their triangles on a different vertex, which may round depth by an ulp
+				bool same = primitives == (unsigned int)subDivisions * subDivisions * 2;
+				for (size_t i = 0; i < depth.size(); i++)
+				{
+					same = same && (depth[i] < 1.0f) == (reference[i] < 1.0f) && fabs(depth[i] - reference[i]) <= 1e-6f;
+				}
+				ok = ok && same && glGetError() == GL_NO_ERROR;
+				printf("  %-14s %6s %9d %12zu %14zu %12u %s\n", layout.name, shortIndices ? "ushort" : "uint", indexBuffer.numIndices, bytes, sceneBytes, primitives, same ? "same" : "DIFFERENT");
+			}
+			glDeleteBuffers(1, &legacy.ebo);
+			ew::clearGridIndexCache();
+		}
+		destroyHiddenContext(window);
+		return ok ? 0 : 1;
+	}
+
+	//the indices a mesh draws with, read back from its element buffer
+	std::vector<unsigned int> readIndices(const ew::Mesh& mesh)
+	{
+		const ew::IndexBuffer& indexBuffer = mesh.getIndexBuffer();
+		std::vector<unsigned int> indices(indexBuffer.numIndices);
+		glBindBuffer(GL_COPY_READ_BUFFER, indexBuffer.ebo);
+		if (indexBuffer.indexType == ew::IndexType::UNSIGNED_SHORT) {
+			std::vector<unsigned short> shorts(indexBuffer.numIndices);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(unsigned short) * shorts.size(), shorts.data());
+			indices.assign(shorts.begin(), shorts.end());
+		}
+		else {
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(unsigned int) * indices.size(), indices.data());
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		return indices;
+	}
+
+	//rebuild [frames] [subDivisions]
+	int benchRebuild(int argc, char** argv)
+	{
+		int frames = argInt(argc, argv, 0, 120);
+		int subDivisions = argInt(argc, argv, 1, 1024);
+		//the most a background frame may spend on terrain, a whole 60 Hz frame
+		const double MAX_FRAME_MS = 16.0;
+
+		GLFWwindow* window = createHiddenContext();
+		if (window == NULL) {
+			return 1;
+		}
+
+		//a slider dragged every frame: what the render thread spends per frame on terrain, synchronous vs in the background
+		ew::TerrainParams params;
+		params.subDivisions = subDivisions;
+		std::vector<double> syncMs, asyncMs;
+		{
+			ew::Mesh mesh;
+			ew::MeshData meshData;
+			for (int frame = 0; frame < frames; frame++)
+			{
+				params.width = 36.0f + frame * 0.1f;
+				double start = nowMs();
+				ew::createTerrain(params.width, params.height, params.subDivisions, &meshData, params.type, ew::defaultThreadCount());
+				mesh.load(meshData);
+				glFinish();
+				syncMs.push_back(nowMs() - start);
+			}
+		}
+
+		bool shown;
+		ew::TerrainRebuildStats stats;
+		double allocatingMs = 0.0;
+		{
+			ew::TerrainRebuilder rebuilder;
+			//shown once and rebuilt once first, like the app at startup. Those builds allocate both meshes and the shared grid
+			//indices, a frame each that cannot be split further, so they are timed apart from the drag
+			for (int build = 0; build < 2; build++)
+			{
+				params.width = 35.0f + build * 0.5f;
+				rebuilder.request(params);
+				while (rebuilder.isBusy())
+				{
+					double start = nowMs();
+					rebuilder.update();
+					glFinish();
+					allocatingMs = std::max(allocatingMs, nowMs() - start);
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			}
+			for (int frame = 0; frame < frames; frame++)
+			{
+				params.width = 36.0f + frame * 0.1f;
+				double start = nowMs();
+				rebuilder.request(params);
+				rebuilder.update();
+				glFinish();
+				asyncMs.push_back(nowMs() - start);
+				//rest of a 60 Hz frame
+				std::this_thread::sleep_for(std::chrono::milliseconds(16));
+			}
+			//after the drag stops the last request must end up on screen
+			while (rebuilder.isBusy())
+			{
+				rebuilder.update();
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			shown = rebuilder.hasMesh() && rebuilder.getParams() == params && glGetError() == GL_NO_ERROR;
+			stats = rebuilder.getStats();
+		}
+
+		//an adaptive build has to be drawn with its own indices, not the shared grid's
+		ew::TerrainParams adaptive;
+		adaptive.subDivisions = 256;
+		adaptive.maxError = 0.05f;
+		bool adaptiveOk = false, optimizedOk = false;
+		int adaptiveIndices = 0, adaptiveVertices = 0;
+		unsigned int highestIndex = 0;
+		float drawnAcmr = 0.0f, shownAcmr = 0.0f;
+		{
+			//the same build on this thread, the worker's optimized index order has to be what reaches the GPU
+			ew::MeshData reference;
+			Array2D<float> heights;
+			ew::createHeightField(adaptive.subDivisions, adaptive.type, &heights, ew::defaultThreadCount());
+			ew::createAdaptiveTerrain(adaptive.width, adaptive.height, adaptive.subDivisions, heights, adaptive.maxError, &reference);
+			ew::optimizeMesh(&reference);
+
+			ew::TerrainRebuilder rebuilder;
+			rebuilder.request(adaptive);
+			while (rebuilder.isBusy())
+			{
+				rebuilder.update();
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			const ew::Mesh& mesh = rebuilder.getMesh();
+			adaptiveIndices = mesh.getNumIndices();
+			adaptiveVertices = mesh.getNumVertices();
+			std::vector<unsigned int> indices = readIndices(mesh);
+			for (unsigned int index : indices)
+			{
+				highestIndex = std::max(highestIndex, index);
+			}
+			adaptiveOk = rebuilder.hasMesh() && adaptiveIndices == rebuilder.getStats().lastTriangles * 3 && (int)indices.size() == adaptiveIndices
+				&& adaptiveVertices < (adaptive.subDivisions + 1) * (adaptive.subDivisions + 1) && (int)highestIndex < adaptiveVertices && glGetError() == GL_NO_ERROR;
+			//the UI's vertex cache numbers must describe the drawn order
+			drawnAcmr = ew::analyzeVertexCache(indices.data(), (int)indices.size(), adaptiveVertices).acmr;
+			shownAcmr = rebuilder.getStats().lastVertexCache.after.acmr;
+			optimizedOk = indices == reference.indices && adaptiveVertices == (int)reference.vertices.size() && drawnAcmr == shownAcmr;
+		}
+		ew::clearGridIndexCache();
+		destroyHiddenContext(window);
+
+		printf("%d frames dragging a %dx%d terrain\n", frames, subDivisions, subDivisions);
+		const char* names[] = { "synchronous", "background" };
+		std::vector<double>* times[] = { &syncMs, &asyncMs };
+		for (int i = 0; i < 2; i++)
+		{
+			std::vector<double>& ms = *times[i];
+			std::sort(ms.begin(), ms.end());
+			double total = 0.0;
+			for (double t : ms)
+			{
+				total += t;
+			}
+			printf("  %-12s %.2f ms average, %.2f ms p50, %.2f ms p95, %.2f ms max per frame\n", names[i], total / ms.size(), ms[ms.size() / 2], ms[ms.size() * 95 / 100], ms.back());
+		}
+		bool smooth = asyncMs.back() <= MAX_FRAME_MS;
+		printf("  background max %s the %.0f ms frame budget, %.2f ms max while the meshes were first allocated\n", smooth ? "within" : "OVER", MAX_FRAME_MS,
+			allocatingMs);
+		printf("  %d requests, %d built, %d dropped, last build %.1f ms on the worker, last upload %.1f ms over %d frames\n", stats.requested, stats.built, stats.dropped,
+			stats.lastBuildMs, stats.lastUploadMs, stats.lastUploadFrames);
+		printf("  final parameters shown: %s\n", shown ? "yes" : "NO");
+		printf("  adaptive build, max error %.2f: %d indices over %d vertices, highest index %u, drawn with its own indices: %s\n",
+			adaptive.maxError, adaptiveIndices, adaptiveVertices, highestIndex, adaptiveOk ? "yes" : "NO");
+		printf("  optimized index order drawn: %s, ACMR drawn %.3f, shown %.3f\n", optimizedOk ? "yes" : "NO", drawnAcmr, shownAcmr);
+		return shown && smooth && adaptiveOk && optimizedOk ? 0 : 1;
+	}
+
+	//gpu-terrain [subDivisions] [type]
+	int benchGpuTerrain(int argc, char** argv)
+	{
+		int subDivisions = argInt(argc, argv, 0, 512);
+		int type = argInt(argc, argv, 1, 0);
+		float size = 64.0f;
+
+		ew::MeshData reference;
+		ew::createTerrain(size, size, subDivisions, &reference, type, ew::defaultThreadCount());
+		Array2D<float> heights;
+		ew::createHeightField(subDivisions, type, &heights, ew::defaultThreadCount());
+		float minHeight, maxHeight;
+		heights.GetMinMax(minHeight, maxHeight);
+		size_t vertexBytes = reference.vertices.size() * sizeof(ew::Vertex);
+
+		GLFWwindow* window = createHiddenContext();
+		if (window == NULL) {
+			return 1;
+		}
+		bool ok = true;
+		{
+			//same light for both paths, so LightDirection checks the tangent frame
+			glm::vec3 lightDirection = glm::normalize(glm::vec3(0.3f, -1.0f, 0.2f));
+			glm::mat4 view = glm::lookAt(glm::vec3(size * 0.5f, 40.0f, 10.0f), glm::vec3(size * 0.5f, 0.0f, -size * 0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+			glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 1000.0f);
+
+			//CPU mesh depth, to compare the indexed GPU draw against
+			OffscreenTarget target(256);
+			SandBlocks blocks;
+			std::vector<float> referenceDepth;
+			{
+				Shader shader("assets/shaderAssets/basicLightingVShader.vert", "assets/shaderAssets/basicLightingFShader.frag");
+				shader.use();
+				shader.setMat4("uModel", glm::mat4(1.0f));
+				ew::bindUniformBlocks(shader);
+				blocks.setFrame(view, projection);
+				ew::Mesh mesh(reference);
+				mesh.draw();
+				referenceDepth = target.readDepth();
+			}
+
+			printf("%dx%d terrain, type %d, %d vertices, heights %.2f to %.2f\n", subDivisions, subDivisions, type, (int)reference.vertices.size(), minHeight, maxHeight);
+			printf("  CPU mesh vertices: %zu bytes\n", vertexBytes);
+			printf("  %-6s %12s %9s %11s %11s %11s %11s %s\n", "format", "bytes", "smaller", "position", "normal", "tangent", "uv", "depth");
+			ew::HeightTextureFormat formats[] = { ew::HeightTextureFormat::R32F, ew::HeightTextureFormat::R16 };
+			for (ew::HeightTextureFormat format : formats)
+			{
+				ew::GpuTerrain terrain;
+				terrain.init(size, size, subDivisions, heights, format);
+				bool r16 = format == ew::HeightTextureFormat::R16;
+
+				//capture what the vertex shader rebuilt, once per vertex in grid order
+				Shader shader("assets/shaderAssets/terrainPullVShader.vert", "assets/shaderAssets/basicLightingFShader.frag");
+				const char* varyings[] = { "gl_Position", "Surface.Normal", "Surface.TexCoord", "Surface.LightDirection" };
+				const int FLOATS_PER_VERTEX = 4 + 3 + 2 + 3;
+				glTransformFeedbackVaryings(shader.mId, 4, varyings, GL_INTERLEAVED_ATTRIBS);
+				shader.relink();
+				int linked = 0;
+				glGetProgramiv(shader.mId, GL_LINK_STATUS, &linked);
+				shader.use();
+				shader.setMat4("uModel", glm::mat4(1.0f));
+				ew::bindUniformBlocks(shader);
+				blocks.setFrame(glm::mat4(1.0f), glm::mat4(1.0f), lightDirection);
+
+				unsigned int feedback;
+				glGenBuffers(1, &feedback);
+				glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, feedback);
+				glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, sizeof(float) * FLOATS_PER_VERTEX * terrain.getNumVertices(), NULL, GL_STATIC_READ);
+				glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedback);
+				glEnable(GL_RASTERIZER_DISCARD);
+				glBeginTransformFeedback(GL_POINTS);
+				terrain.draw(shader, 0, ew::DrawMode::POINTS);
+				glEndTransformFeedback();
+				glDisable(GL_RASTERIZER_DISCARD);
+				std::vector<float> captured(FLOATS_PER_VERTEX * terrain.getNumVertices());
+				glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, sizeof(float) * captured.size(), captured.data());
+				glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+				glDeleteBuffers(1, &feedback);
+
+				float positionError = 0.0f, normalError = 0.0f, tangentError = 0.0f, uvError = 0.0f;
+				for (size_t i = 0; i < reference.vertices.size(); i++)
+				{
+					const ew::Vertex& vertex = reference.vertices[i];
+					const float* v = &captured[i * FLOATS_PER_VERTEX];
+					glm::vec3 position(v[0], v[1], v[2]);
+					glm::vec3 normal(v[4], v[5], v[6]);
+					glm::vec2 uv(v[7], v[8]);
+					//tangent and bitangent rows of the TBN, as light direction in tangent space
+					glm::vec3 light(v[9], v[10], v[11]);
+
+					//the TBN basicLightingVShader builds from the CPU vertex
+					glm::vec3 t = glm::normalize(vertex.tangent);
+					glm::vec3 b = glm::normalize(glm::cross(vertex.normal, t));
+					glm::vec2 expectedLight(glm::dot(t, lightDirection), glm::dot(b, lightDirection));
+
+					positionError = std::max(positionError, glm::length(position - vertex.pos));
+					normalError = std::max(normalError, glm::length(glm::normalize(normal) - glm::normalize(vertex.normal)));
+					tangentError = std::max(tangentError, glm::length(glm::vec2(light.x, light.y) - expectedLight));
+					uvError = std::max(uvError, glm::length(uv - vertex.uv));
+				}
+
+				//R32F holds the heights exactly, R16 rounds them to half a step of the range
+				float positionTolerance = r16 ? (maxHeight - minHeight) / 65535.0f : 1e-4f;
+				float normalTolerance = r16 ? 1e-2f : 1e-4f;
+				float tangentTolerance = r16 ? 1e-2f : 1e-4f;
+				bool same = linked && positionError <= positionTolerance && normalError <= normalTolerance && tangentError <= tangentTolerance && uvError <= 1e-6f;
+
+				//and the indexed draw covers the same pixels at the same depth as the CPU mesh
+				blocks.setFrame(view, projection, lightDirection);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				terrain.draw(shader, 0);
+				std::vector<float> depth = target.readDepth();
+				bool sameDepth = true;
+				for (size_t i = 0; i < depth.size(); i++)
+				{
+					sameDepth = sameDepth && (depth[i] < 1.0f) == (referenceDepth[i] < 1.0f) && fabs(depth[i] - referenceDepth[i]) <= (r16 ? 1e-4f : 1e-6f);
+				}
+				ok = ok && same && sameDepth && glGetError() == GL_NO_ERROR;
+				printf("  %-6s %12zu %8.1fx %11.2e %11.2e %11.2e %11.2e %s\n", r16 ? "R16" : "R32F", terrain.getGpuBytes(), (double)vertexBytes / terrain.getGpuBytes(),
+					positionError, normalError, tangentError, uvError, sameDepth ? "same" : "DIFFERENT");
+				if (!same) {
+					printf("  %s readback does not match createTerrain\n", r16 ? "R16" : "R32F");
+				}
+			}
+			ew::clearGridIndexCache();
+		}
+		destroyHiddenContext(window);
+		return ok ? 0 : 1;
+	}
+
+	//mesh-cache [subDivisions] [type] [layout], layout 0 float, 1 half, 2 quantized
+	int benchMeshCache(int argc, char** argv)
+	{
+		int subDivisions = argInt(argc, argv, 0, 2048);
+		int type = argInt(argc, argv, 1, 0);
+		ew::VertexLayout layout = (ew::VertexLayout)argInt(argc, argv, 2, (int)ew::VertexLayout::QUANTIZED);
+		const char* layoutNames[] = { "float", "half", "quant" };
+		float size = 64.0f;
+		std::string directory = "terrainCache";
+		uint64_t key = ew::getTerrainCacheKey(size, size, subDivisions, type, layout);
+		std::string path = ew::getTerrainCachePath(directory, key);
+		remove(path.c_str());
+
+		GLFWwindow* window = createHiddenContext();
+		if (window == NULL) {
+			return 1;
+		}
+		bool ok = true;
+		{
+			ew::Mesh mesh;
+			ew::IndexBuffer indexBuffer = ew::getGridIndexBuffer(subDivisions);
+			int vertexSize = ew::getVertexSize(layout);
+
+			//cold: nothing cached, build, pack, write and upload
+			ew::TerrainVertices cold;
+			double start = nowMs();
+			bool coldHit = ew::loadTerrainVertices(directory, size, size, subDivisions, type, layout, &cold, ew::defaultThreadCount());
+			double coldLoadMs = nowMs() - start;
+			start = nowMs();
+			mesh.load(cold.vertices, indexBuffer);
+			glFinish();
+			double coldUploadMs = nowMs() - start;
+
+			//warm: map and upload straight from the mapping into a new mesh, like a fresh start with the file in the page cache.
+			//The file is stored packed, so nothing is computed between the two
+			ew::TerrainVertices warm;
+			ew::Mesh warmMesh;
+			start = nowMs();
+			bool warmHit = ew::loadTerrainVertices(directory, size, size, subDivisions, type, layout, &warm, ew::defaultThreadCount());
+			double warmMapMs = nowMs() - start;
+			double warmUploadMs = 0.0;
+			size_t fileBytes = 0;
+			if (warmHit) {
+				fileBytes = warm.cached.getBytes();
+				start = nowMs();
+				warmMesh.load(warm.vertices, indexBuffer);
+				glFinish();
+				warmUploadMs = nowMs() - start;
+			}
+
+			//what the GPU got from the mapping is exactly what was built and packed, decoded the same way
+			bool same = warmHit && warm.vertices.numVertices == cold.vertices.numVertices && warm.vertices.layout == layout
+				&& memcmp(&warm.vertices.decode, &cold.vertices.decode, sizeof(ew::VertexDecode)) == 0
+				&& memcmp(&warmMesh.getBounds(), &mesh.getBounds(), sizeof(ew::Bounds)) == 0;
+			if (same) {
+				std::vector<char> uploaded((size_t)vertexSize * warm.vertices.numVertices);
+				//the VBO is not VAO state, find it through the position attribute
+				warmMesh.bind();
+				int vbo = 0;
+				glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &vbo);
+				glBindVertexArray(0);
+				glBindBuffer(GL_ARRAY_BUFFER, vbo);
+				glGetBufferSubData(GL_ARRAY_BUFFER, 0, uploaded.size(), uploaded.data());
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				same = memcmp(uploaded.data(), cold.vertices.data, uploaded.size()) == 0;
+			}
+
+			//files for other parameters or layouts, cut short or from an older generator are never used
+			ew::MeshCacheFile other;
+			bool rejectsKey = !other.open(path, ew::getTerrainCacheKey(size, size, subDivisions, type + 1, layout));
+			ew::VertexLayout otherLayout = layout == ew::VertexLayout::FLOAT ? ew::VertexLayout::QUANTIZED : ew::VertexLayout::FLOAT;
+			bool rejectsLayout = !other.open(path, ew::getTerrainCacheKey(size, size, subDivisions, type, otherLayout));
+			std::string truncatedPath = path + ".truncated";
+			FILE* truncated = fopen(truncatedPath.c_str(), "wb");
+			bool rejectsTruncated = false;
+			if (truncated != NULL) {
+				fwrite(warm.cached.getVertices().data, 1, fileBytes / 2, truncated);
+				fclose(truncated);
+				rejectsTruncated = !other.open(truncatedPath, key);
+				remove(truncatedPath.c_str());
+			}
+			warm.cached.close();
+
+			ok = !coldHit && warmHit && same && rejectsKey && rejectsLayout && rejectsTruncated && glGetError() == GL_NO_ERROR;
+			printf("%dx%d terrain, type %d, %d vertices, %s layout (%d bytes each), cache file %.1f MB\n", subDivisions, subDivisions, type, cold.vertices.numVertices,
+				layoutNames[(int)layout], vertexSize, fileBytes / (1024.0 * 1024.0));
+			printf("  cold start: build + pack + write %8.1f ms, upload %6.1f ms, total %8.1f ms\n", coldLoadMs, coldUploadMs, coldLoadMs + coldUploadMs);
+			printf("  warm start: map                  %8.2f ms, upload %6.1f ms, total %8.1f ms (%.1fx faster)\n", warmMapMs, warmUploadMs, warmMapMs + warmUploadMs,
+				(coldLoadMs + coldUploadMs) / (warmMapMs + warmUploadMs));
+			printf("  uploaded from the mapping matches the build: %s\n", same ? "yes" : "NO");
+			printf("  rejects other key: %s, other layout: %s, truncated file: %s\n", rejectsKey ? "yes" : "NO", rejectsLayout ? "yes" : "NO", rejectsTruncated ? "yes" : "NO");
+			ew::clearGridIndexCache();
+		}
+		destroyHiddenContext(window);
+		return ok ? 0 : 1;
+	}
+
+	//Binary PGM, the first row written is the last height row (the far edge)
+	bool writeTestPgm(const char* path, const Array2D<float>& heights, float minHeight, float maxHeight, int bits)
+	{
+		FILE* file = fopen(path, "wb");
+		if (file == NULL) {
+			return false;
+		}
+		int maxValue = bits == 16 ? 65535 : 255;
+		fprintf(file, "P5\n%d %d\n%d\n", heights.GetWidth(), heights.GetHeight(), maxValue);
+		std::vector<unsigned char> row(heights.GetWidth() * (bits / 8));
+		for (int y = heights.GetHeight() - 1; y >= 0; y--)
+		{
+			for (int x = 0; x < heights.GetWidth(); x++)
+			{
+				int value = (int)lrintf((heights.Get(x, y) - minHeight) / (maxHeight - minHeight) * maxValue);
+				if (bits == 16) {
+					row[x * 2] = (unsigned char)(value >> 8);
+					row[x * 2 + 1] = (unsigned char)(value & 0xFF);
+				}
+				else {
+					row[x] = (unsigned char)value;
+				}
+			}
+			fwrite(row.data(), 1, row.size(), file);
+		}
+		fclose(file);
+		return true;
+	}
+
+	//heightmap [size] [threads]
+	int benchHeightmap(int argc, char** argv)
+	{
+		int size = argInt(argc, argv, 0, 1025);
+		int threads = argInt(argc, argv, 1, ew::defaultThreadCount());
+		bool ok = true;
+
+		//dunes standing in for a surveyed tile
+		Array2D<float> source;
+		ew::createHeightField(size - 3, 0, &source, ew::defaultThreadCount());
+		float minHeight, maxHeight;
+		source.GetMinMax(minHeight, maxHeight);
+
+		Array2D<float> heights;
+		printf("%dx%d heightmap, heights %.2f to %.2f\n", size, size, minHeight, maxHeight);
+		for (int bits : { 8, 16 })
+		{
+			const char* path = bits == 16 ? "heightmap_bench16.pgm" : "heightmap_bench8.pgm";
+			writeTestPgm(path, source, minHeight, maxHeight, bits);
+			int bitDepth = 0;
+			double start = nowMs();
+			bool loaded = ew::loadHeightmap(path, &heights, minHeight, maxHeight, &bitDepth);
+			double loadMs = nowMs() - start;
+			remove(path);
+			float error = 0.0f;
+			for (int i = 0; loaded && i < heights.GetSize(); i++)
+			{
+				error = std::max(error, fabsf(heights.Get(i) - source.Get(i)));
+			}
+			//half a step of the quantization, plus float rounding
+			float tolerance = (maxHeight - minHeight) / (bits == 16 ? 65535.0f : 255.0f) * 0.5f + 1e-5f;
+			bool same = loaded && bitDepth == bits && heights.GetWidth() == size && heights.GetHeight() == size && error <= tolerance;
+			ok = ok && same;
+			printf("  %2d bit: decoded in %6.1f ms, max error %.2e (step %.2e) %s\n", bits, loadMs, error, tolerance * 2.0f, same ? "ok" : "WRONG");
+		}
+
+		ew::HeightPyramid pyramid;
+		double start = nowMs();
+		pyramid.build(heights, 1);
+		double singleMs = nowMs() - start;
+		start = nowMs();
+		pyramid.build(heights, threads);
+		double parallelMs = nowMs() - start;
+		printf("  pyramid: %d levels, %.1f ms on 1 thread, %.1f ms on %d\n", pyramid.getLevels(), singleMs, parallelMs, threads);
+
+		//min and max must bound exactly the level 0 samples each cell covers, the average must sit between them
+		bool bounded = true;
+		srand(1);
+		for (int level = 1; level < pyramid.getLevels(); level++)
+		{
+			const Array2D<float>& average = pyramid.getAverage(level);
+			for (int sample = 0; sample < 64; sample++)
+			{
+				int x = rand() % average.GetWidth();
+				int y = rand() % average.GetHeight();
+				float lo = 1e30f, hi = -1e30f;
+				for (int row = y << level; row < std::min((y + 1) << level, size); row++)
+				{
+					for (int col = x << level; col < std::min((x + 1) << level, size); col++)
+					{
+						lo = std::min(lo, heights.Get(col, row));
+						hi = std::max(hi, heights.Get(col, row));
+					}
+				}
+				float value = average.Get(x, y);
+				bounded = bounded && pyramid.getMin(level).Get(x, y) == lo && pyramid.getMax(level).Get(x, y) == hi && value >= lo - 1e-5f && value <= hi + 1e-5f;
+			}
+		}
+		ok = ok && bounded;
+		printf("  min/max bound their level 0 blocks: %s\n", bounded ? "yes" : "NO");
+
+		printf("  %5s %11s %10s %10s\n", "level", "samples", "vertices", "mesh ms");
+		for (int level = 0; level < pyramid.getLevels(); level++)
+		{
+			const Array2D<float>& average = pyramid.getAverage(level);
+			if (average.GetWidth() < 2) {
+				break;
+			}
+			ew::MeshData mesh;
+			start = nowMs();
+			bool built = ew::createTerrainFromHeightmap(256.0f, 256.0f, average, &mesh, threads);
+			double meshMs = nowMs() - start;
+			ok = ok && built && (int)mesh.vertices.size() == average.GetSize();
+			printf("  %5d %5dx%-5d %10zu %10.1f\n", level, average.GetWidth(), average.GetHeight(), mesh.vertices.size(), meshMs);
+		}
+		return ok ? 0 : 1;
+	}
+
+	double sumHeights(const Array2D<float>& heights)
+	{
+		double sum = 0.0;
+		for (int row = 0; row < heights.GetHeight(); row++)
+		{
+			const float* samples = heights.GetAddr(0, row);
+			for (int col = 0; col < heights.GetWidth(); col++)
+			{
+				sum += samples[col];
+			}
+		}
+		return sum;
+	}
+
+	//bit for bit, ignoring the row padding
+	bool sameHeights(const Array2D<float>& a, const Array2D<float>& b)
+	{
+		if (a.GetWidth() != b.GetWidth() || a.GetHeight() != b.GetHeight()) {
+			return false;
+		}
+		for (int row = 0; row < a.GetHeight(); row++)
+		{
+			if (memcmp(a.GetAddr(0, row), b.GetAddr(0, row), sizeof(float) * a.GetWidth()) != 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//largest height step between neighbours
+	float steepestStep(const Array2D<float>& heights)
+	{
+		float steepest = 0.0f;
+		for (int row = 0; row + 1 < heights.GetHeight(); row++)
+		{
+			for (int col = 0; col + 1 < heights.GetWidth(); col++)
+			{
+				float h = heights.Get(col, row);
+				steepest = std::max(steepest, std::max(fabsf(heights.Get(col + 1, row) - h), fabsf(heights.Get(col, row + 1) - h)));
+			}
+		}
+		return steepest;
+	}
+
+	//dune-sim [size] [ticks] [threads] [type]
+	int benchDuneSim(int argc, char** argv)
+	{
+		int size = argInt(argc, argv, 0, 1024);
+		int ticks = std::max(1, argInt(argc, argv, 1, 40));
+		int threads = argInt(argc, argv, 2, ew::defaultThreadCount());
+		int type = argInt(argc, argv, 3, 1);
+		bool ok = true;
+
+		Array2D<float> heights;
+		ew::createHeightField(size - 3, type, &heights, ew::defaultThreadCount());
+		ew::DuneSimulationSettings settings;
+		printf("%dx%d %s, %d threads\n", size, size, ew::getDuneName(type), threads);
+
+		//the same ticks split differently must give the same sand
+		const int checkTicks = 5;
+		ew::DuneSimulation single, split;
+		single.init(heights, settings, 1);
+		split.init(heights, settings, std::max(threads, 4));
+		single.step(checkTicks);
+		split.step(checkTicks);
+		bool same = sameHeights(single.getHeights(), split.getHeights());
+		ok = ok && same;
+		printf("  %d ticks on 1 and %d threads: %s\n", checkTicks, std::max(threads, 4), same ? "identical" : "DIFFERENT");
+
+		ew::DuneSimulation simulation;
+		simulation.init(heights, settings, threads);
+		double mass = sumHeights(heights);
+		long long slabs = 0;
+		double start = nowMs();
+		for (int tick = 0; tick < ticks; tick++)
+		{
+			simulation.step();
+			slabs += simulation.getLastSlabsMoved();
+		}
+		double totalMs = nowMs() - start;
+		const Array2D<float>& result = simulation.getHeights();
+
+		double drift = fabs(sumHeights(result) - mass) / heights.GetSize();
+		//float rounding of slab moves and sweeps only
+		bool conserved = drift < settings.slabHeight * 1e-2;
+		ok = ok && conserved;
+		double ticksPerSecond = ticks * 1000.0 / totalMs;
+		printf("  %d ticks in %.0f ms: %.1f ticks/s, %.1f Mcells/s, %.1f ms/tick\n", ticks, totalMs, ticksPerSecond, ticksPerSecond * heights.GetSize() / 1e6, totalMs / ticks);
+		printf("  slabs moved per tick: %.0f, mean height drift per cell %.2e %s\n", (double)slabs / ticks, drift, conserved ? "ok" : "NOT CONSERVED");
+		printf("  steepest slope %.2f before, %.2f after (repose %.2f)\n", steepestStep(heights) / settings.cellSize, steepestStep(result) / settings.cellSize, settings.reposeSlope);
+		return ok ? 0 : 1;
+	}
+
+	//largest step between neighbours inside the map, and across the wrapped edges
+	void tileSteps(const ew::SandTexture& texture, int* inside, int* seam)
+	{
+		int size = texture.size;
+		*inside = *seam = 0;
+		for (int row = 0; row < size; row++)
+		{
+			for (int col = 0; col < size; col++)
+			{
+				int h = texture.heights[row * size + col];
+				int right = texture.heights[row * size + (col + 1) % size];
+				int up = texture.heights[((row + 1) % size) * size + col];
+				int step = std::max(abs(right - h), abs(up - h));
+				int* target = (col == size - 1 || row == size - 1) ? seam : inside;
+				*target = std::max(*target, step);
+			}
+		}
+	}
+
+	//ripple-textures [runs] [threads]
+	int benchRippleTextures(int argc, char** argv)
+	{
+		int runs = std::max(1, argInt(argc, argv, 0, 3));
+		int threads = argInt(argc, argv, 1, ew::defaultThreadCount());
+		const char* names[5] = { "sandShallowX", "sandSteepX", "sandShallowZ", "sandSteepZ", "grain" };
+		bool ok = true;
+
+		//what startup used to do
+		double decodeMs = 1e30;
+		for (int run = 0; run < runs; run++)
+		{
+			double start = nowMs();
+			for (int i = 0; i < 5; i++)
+			{
+				for (const char* folder : { "assets/HeightMaps/", "assets/NormalMaps/" })
+				{
+					int width, height, channels;
+					std::string path = std::string(folder) + names[i] + ".jpg";
+					stbi_set_flip_vertically_on_load(true);
+					unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+					ok = ok && data != NULL;
+					stbi_image_free(data);
+				}
+			}
+			decodeMs = std::min(decodeMs, nowMs() - start);
+		}
+
+		ew::SandTexture maps[5];
+		double generateMs[2] = { 1e30, 1e30 };
+		int threadCounts[2] = { 1, threads };
+		for (int t = 0; t < 2; t++)
+		{
+			for (int run = 0; run < runs; run++)
+			{
+				double start = nowMs();
+				for (int i = 0; i < 4; i++)
+				{
+					ew::generateRipples(ew::getRippleSettings(i % 2 == 1, i < 2 ? ew::RippleAxis::X : ew::RippleAxis::Z), &maps[i], threadCounts[t]);
+				}
+				ew::generateGrain(ew::GrainSettings(), &maps[4], threadCounts[t]);
+				generateMs[t] = std::min(generateMs[t], nowMs() - start);
+			}
+		}
+		printf("10 maps: JPEG decode %.1f ms, generated in %.1f ms on 1 thread, %.1f ms on %d\n", decodeMs, generateMs[0], generateMs[1], threads);
+
+		printf("  %-13s %5s %12s %12s %10s\n", "map", "size", "inside step", "seam step", "round trip");
+		for (int i = 0; i < 5; i++)
+		{
+			int inside, seam;
+			tileSteps(maps[i], &inside, &seam);
+			//a seam no rougher than the inside means the map tiles
+			bool tiles = seam <= inside;
+
+			//written maps must read back exactly the way the app loads textures
+			bool same = ew::writeSandTexture(maps[i], "ripple_bench.pgm", "ripple_bench.ppm");
+			int width, height, channels;
+			stbi_set_flip_vertically_on_load(true);
+			unsigned char* heights = stbi_load("ripple_bench.pgm", &width, &height, &channels, 1);
+			unsigned char* normals = stbi_load("ripple_bench.ppm", &width, &height, &channels, 3);
+			same = same && heights && normals && memcmp(heights, maps[i].heights.data(), maps[i].heights.size()) == 0 && memcmp(normals, maps[i].normals.data(), maps[i].normals.size()) == 0;
+			stbi_image_free(heights);
+			stbi_image_free(normals);
+			remove("ripple_bench.pgm");
+			remove("ripple_bench.ppm");
+
+			ok = ok && tiles && same;
+			printf("  %-13s %5d %12d %12d %10s%s\n", names[i], maps[i].size, inside, seam, same ? "exact" : "DIFFERENT", tiles ? "" : "  SEAM");
+		}
+		return ok ? 0 : 1;
+	}
+
+	//plain per texel Sobel/Scharr with wrapping, what bakeNormalMap's lanes must agree with
+	void bakeNormalsReference(const Array2D<float>& heights, float side, float center, float scale, float strength, std::vector<unsigned char>* normals)
+	{
+		int width = heights.GetWidth();
+		int height = heights.GetHeight();
+		normals->resize((size_t)width * height * 3);
+		for (int row = 0; row < height; row++)
+		{
+			for (int col = 0; col < width; col++)
+			{
+				int left = (col + width - 1) % width, right = (col + 1) % width;
+				int up = (row + 1) % height, down = (row + height - 1) % height;
+				float dx = side * (heights.Get(right, up) - heights.Get(left, up) + heights.Get(right, down) - heights.Get(left, down)) + center * (heights.Get(right, row) - heights.Get(left, row));
+				float dy = side * (heights.Get(left, up) - heights.Get(left, down) + heights.Get(right, up) - heights.Get(right, down)) + center * (heights.Get(col, up) - heights.Get(col, down));
+				glm::vec3 n = glm::normalize(glm::vec3(-strength * scale * dx, -strength * scale * dy, 1.0f));
+				unsigned char* out = normals->data() + ((size_t)row * width + col) * 3;
+				for (int i = 0; i < 3; i++)
+				{
+					out[i] = (unsigned char)std::min(std::max(lrintf(n[i] * 127.5f + 127.5f), 0L), 255L);
+				}
+			}
+		}
+	}
+
+	int maxByteDifference(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+	{
+		int difference = a.size() == b.size() ? 0 : 255;
+		for (size_t i = 0; i < a.size() && i < b.size(); i++)
+		{
+			difference = std::max(difference, abs(a[i] - b[i]));
+		}
+		return difference;
+	}
+
+	//normal-bake [runs] [threads]
+	int benchNormalBake(int argc, char** argv)
+	{
+		int runs = std::max(1, argInt(argc, argv, 0, 3));
+		int threads = argInt(argc, argv, 1, ew::defaultThreadCount());
+		const char* names[5] = { "sandShallowX", "sandSteepX", "sandShallowZ", "sandSteepZ", "grain" };
+		bool ok = true;
+
+		//the height maps are decoded either way, the question is whether the normal maps have to be
+		Array2D<float> heights[5];
+		for (int i = 0; i < 5; i++)
+		{
+			int width, height, channels;
+			std::string path = std::string("assets/HeightMaps/") + names[i] + ".jpg";
+			stbi_set_flip_vertically_on_load(true);
+			unsigned char* gray = stbi_load(path.c_str(), &width, &height, &channels, 1);
+			if (!gray) {
+				printf("Failed to load %s\n", path.c_str());
+				return 1;
+			}
+			ew::heightsFromGray(gray, width, height, &heights[i]);
+			stbi_image_free(gray);
+		}
+
+		double decodeMs = 1e30;
+		for (int run = 0; run < runs; run++)
+		{
+			double start = nowMs();
+			for (int i = 0; i < 5; i++)
+			{
+				int width, height, channels;
+				std::string path = std::string("assets/NormalMaps/") + names[i] + ".jpg";
+				stbi_set_flip_vertically_on_load(true);
+				unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 3);
+				ok = ok && data != NULL;
+				stbi_image_free(data);
+			}
+			decodeMs = std::min(decodeMs, nowMs() - start);
+		}
+		printf("5 normal maps: JPEG decode %.1f ms\n", decodeMs);
+
+		struct FilterCase { const char* name; ew::NormalFilter filter; float side, center, scale; };
+		const FilterCase filters[2] = {
+			{ "sobel", ew::NormalFilter::SOBEL, 1.0f, 2.0f, 1.0f / 8.0f },
+			{ "scharr", ew::NormalFilter::SCHARR, 3.0f, 10.0f, 1.0f / 32.0f },
+		};
+		std::vector<unsigned char> baked[5];
+		for (const FilterCase& filter : filters)
+		{
+			ew::NormalBakeSettings settings;
+			settings.filter = filter.filter;
+			int threadCounts[2] = { 1, threads };
+			double bakeMs[2] = { 1e30, 1e30 };
+			for (int t = 0; t < 2; t++)
+			{
+				for (int run = 0; run < runs; run++)
+				{
+					double start = nowMs();
+					for (int i = 0; i < 5; i++)
+					{
+						ew::bakeNormalMap(heights[i], settings, &baked[i], threadCounts[t]);
+					}
+					bakeMs[t] = std::min(bakeMs[t], nowMs() - start);
+				}
+			}
+
+			//lanes round the same math differently in the last bit at most
+			int difference = 0;
+			std::vector<unsigned char> reference;
+			for (int i = 0; i < 5; i++)
+			{
+				bakeNormalsReference(heights[i], filter.side, filter.center, filter.scale, settings.strength, &reference);
+				difference = std::max(difference, maxByteDifference(baked[i], reference));
+			}
+			ok = ok && difference <= 1;
+			printf("  %-7s baked in %.1f ms on 1 thread, %.1f ms on %d (%.1fx faster than decoding), max diff to scalar %d %s\n",
+				filter.name, bakeMs[0], bakeMs[1], threads, decodeMs / bakeMs[1], difference, difference <= 1 ? "ok" : "MISMATCH");
+		}
+
+		//a wrapped bake of a tile is the same as the corner of the bake of 2 x 2 tiles, which has no edge there
+		ew::NormalBakeSettings settings;
+		bool wraps = true;
+		for (int i = 0; i < 5; i++)
+		{
+			const Array2D<float>& tile = heights[i];
+			int width = tile.GetWidth(), height = tile.GetHeight();
+			Array2D<float> tiled(width * 2, height * 2);
+			for (int row = 0; row < height * 2; row++)
+			{
+				for (int col = 0; col < width * 2; col++)
+				{
+					tiled.At(col, row) = tile.Get(col % width, row % height);
+				}
+			}
+			std::vector<unsigned char> tileNormals, tiledNormals;
+			ew::bakeNormalMap(tile, settings, &tileNormals, threads);
+			ew::bakeNormalMap(tiled, settings, &tiledNormals, threads);
+			//the quadrant's edge texels see the neighbouring tiles, the same texels wrapping reads
+			for (int row = 0; row < height && wraps; row++)
+			{
+				wraps = memcmp(tileNormals.data() + (size_t)row * width * 3, tiledNormals.data() + (size_t)row * width * 6, (size_t)width * 3) == 0;
+			}
+		}
+		ok = ok && wraps;
+		printf("  wrapped edges match a 2x2 tiling: %s\n", wraps ? "yes" : "NO");
+
+		//BC5 keeps x and y, z comes back from the unit length
+		std::vector<unsigned char> blocks, decoded;
+		ew::bakeNormalMap(heights[1], settings, &baked[1], threads);
+		int width = heights[1].GetWidth(), height = heights[1].GetHeight();
+		ew::encodeBC5(baked[1].data(), width, height, &blocks);
+		ew::decodeBC5(blocks.data(), width, height, &decoded);
+		int bc5Error = maxByteDifference(baked[1], decoded);
+		bool written = ew::writeNormalMapDds("normal_bench.dds", baked[1].data(), width, height);
+		FILE* file = fopen("normal_bench.dds", "rb");
+		long fileSize = 0;
+		if (file) {
+			fseek(file, 0, SEEK_END);
+			fileSize = ftell(file);
+			fclose(file);
+		}
+		remove("normal_bench.dds");
+		ok = ok && written && fileSize == (long)blocks.size() + 148;
+		printf("  BC5 %s %dx%d: %ld bytes on disk (%.0f%% of rgb8), max round trip error %d\n", names[1], width, height, fileSize, 100.0 * blocks.size() / baked[1].size(), bc5Error);
+		return ok ? 0 : 1;
+	}
+
+	//first sign change of ground minus ray height, marched in steps of a fraction of a cell
+	bool marchRay(const ew::TerrainQuery& query, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float step, float* distance)
+	{
+		for (float t = 0.0f; t <= maxDistance; t += step)
+		{
+			glm::vec3 p = origin + direction * t;
+			if (query.contains(p.x, p.z) && query.getHeight(p.x, p.z) >= p.y) {
+				*distance = t;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	float randomFloat(float low, float high)
+	{
+		return low + (high - low) * (rand() / (float)RAND_MAX);
+	}
+
+	//terrain-query [subDivisions] [rays] [threads] [type]
+	int benchTerrainQuery(int argc, char** argv)
+	{
+		int subDivisions = argInt(argc, argv, 0, 2048);
+		int numRays = argInt(argc, argv, 1, 1 << 20);
+		int threads = argInt(argc, argv, 2, ew::defaultThreadCount());
+		int type = argInt(argc, argv, 3, 0);
+		//the same cell size as the CDLOD terrain in the app
+		float size = subDivisions * 0.25f;
+		bool ok = true;
+		//rays cast one at a time on one core, on terrains at least 2048^2
+		const double TARGET_MRAYS = 1.0;
+		const int TARGET_SUBDIVISIONS = 2048;
+		bool onTarget = true;
+
+		Array2D<float> heights;
+		ew::createHeightField(subDivisions, type, &heights, ew::defaultThreadCount());
+		ew::TerrainQuery query;
+		double start = nowMs();
+		query.init(size, size, subDivisions, heights);
+		double initMs = nowMs() - start;
+		float minHeight, maxHeight;
+		heights.GetMinMax(minHeight, maxHeight);
+		printf("%d^2 terrain, heights %.2f to %.2f: %d pyramid levels built in %.1f ms\n", subDivisions, minHeight, maxHeight, query.getLevels(), initMs);
+
+		//looking down from above the dunes, from just above the sand towards the horizon, and through every pixel of a camera standing on a dune
+		srand(1);
+		const int SETS = 3;
+		const char* setNames[SETS] = { "downward", "grazing", "camera" };
+		std::vector<glm::vec3> origins[SETS], directions[SETS];
+		for (int set = 0; set < 2; set++)
+		{
+			origins[set].resize(numRays);
+			directions[set].resize(numRays);
+			for (int i = 0; i < numRays; i++)
+			{
+				float x = randomFloat(0.0f, size), z = -randomFloat(0.0f, size);
+				float ground = query.getHeight(x, z);
+				float y = set == 0 ? maxHeight + randomFloat(1.0f, 20.0f) : ground + 2.0f;
+				float azimuth = randomFloat(0.0f, 2.0f * ew::PI);
+				float elevation = set == 0 ? randomFloat(-1.0f, -0.1f) : randomFloat(-0.1f, 0.02f);
+				origins[set][i] = glm::vec3(x, y, z);
+				directions[set][i] = glm::vec3(cosf(azimuth) * cosf(elevation), sinf(elevation), sinf(azimuth) * cosf(elevation));
+			}
+		}
+		glm::vec3 eye(size * 0.5f, query.getHeight(size * 0.5f, -size * 0.5f) + 2.0f, -size * 0.5f);
+		glm::vec3 forward = glm::normalize(glm::vec3(1.0f, -0.25f, -1.0f));
+		glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0, 1, 0)));
+		glm::vec3 up = glm::cross(right, forward);
+		//60 degrees across
+		float halfWidth = tanf(glm::radians(30.0f));
+		int pixels = (int)sqrtf((float)numRays);
+		for (int i = 0; i < numRays; i++)
+		{
+			int pixel = i % (pixels * pixels);
+			float px = ((pixel % pixels + 0.5f) / pixels * 2.0f - 1.0f) * halfWidth;
+			float py = ((pixel / pixels + 0.5f) / pixels * 2.0f - 1.0f) * halfWidth;
+			origins[2].push_back(eye);
+			directions[2].push_back(glm::normalize(forward + right * px + up * py));
+		}
+
+		const float maxDistance = size * 2.0f;
+		std::vector<ew::TerrainHit> hits(numRays);
+		for (int set = 0; set < SETS; set++)
+		{
+			start = nowMs();
+			int scalarHits = 0;
+			for (int i = 0; i < numRays; i++)
+			{
+				scalarHits += query.rayCast(origins[set][i], directions[set][i], maxDistance, &hits[i]);
+			}
+			double scalarMs = nowMs() - start;
+
+			std::vector<ew::TerrainHit> batchHits(numRays);
+			start = nowMs();
+			int batchCount = query.rayCast(numRays, origins[set].data(), directions[set].data(), maxDistance, batchHits.data());
+			double batchMs = nowMs() - start;
+			start = nowMs();
+			query.rayCast(numRays, origins[set].data(), directions[set].data(), maxDistance, batchHits.data(), threads);
+			double threadedMs = nowMs() - start;
+
+			bool same = batchCount == scalarHits;
+			for (int i = 0; i < numRays && same; i++)
+			{
+				same = batchHits[i].hit == hits[i].hit && (!hits[i].hit || fabsf(batchHits[i].distance - hits[i].distance) <= 1e-3f * (1.0f + hits[i].distance));
+			}
+			ok = ok && same;
+			double scalarRate = numRays / scalarMs / 1000.0;
+			bool setOnTarget = subDivisions < TARGET_SUBDIVISIONS || scalarRate >= TARGET_MRAYS;
+			onTarget = onTarget && setOnTarget;
+			printf("  %-8s %5.1f%% hit: %.2f Mrays/s one by one%s, %.2f Mrays/s batched, %.2f Mrays/s on %d threads, batch %s\n", setNames[set], 100.0 * scalarHits / numRays,
+				scalarRate, setOnTarget ? "" : " (UNDER target)", numRays / batchMs / 1000.0, numRays / threadedMs / 1000.0, threads, same ? "matches" : "DIFFERS");
+
+			//against marching every eighth of a cell: the pyramid may not miss a crossing the march finds earlier,
+			//and every hit has to lie on the surface getHeight describes
+			int checked = std::min(numRays, 2000), missed = 0, offSurface = 0, grazed = 0;
+			float step = 0.125f * size / subDivisions;
+			for (int i = 0; i < checked; i++)
+			{
+				float marched;
+				bool marchHit = marchRay(query, origins[set][i], directions[set][i], maxDistance, step, &marched);
+				if (marchHit && (!hits[i].hit || hits[i].distance > marched + 1e-3f)) {
+					missed++;
+				}
+				else if (hits[i].hit && (!marchHit || hits[i].distance < marched - step)) {
+					//touched a crest between two march steps
+					grazed++;
+				}
+				if (hits[i].hit && fabsf(query.getHeight(hits[i].position.x, hits[i].position.z) - hits[i].position.y) > 1e-3f) {
+					offSurface++;
+				}
+			}
+			ok = ok && missed == 0 && offSurface == 0;
+			printf("           vs march over %d rays: %d missed, %d off the surface, %d crests the march stepped over\n", checked, missed, offSurface, grazed);
+		}
+
+		//heights for many points at once
+		std::vector<float> xs(numRays), zs(numRays), batchHeights(numRays), scalarHeights(numRays);
+		for (int i = 0; i < numRays; i++)
+		{
+			xs[i] = origins[0][i].x;
+			zs[i] = origins[0][i].z;
+		}
+		start = nowMs();
+		for (int i = 0; i < numRays; i++)
+		{
+			scalarHeights[i] = query.getHeight(xs[i], zs[i]);
+		}
+		double scalarMs = nowMs() - start;
+		start = nowMs();
+		query.getHeights(numRays, xs.data(), zs.data(), batchHeights.data());
+		double batchMs = nowMs() - start;
+		float heightDifference = 0.0f;
+		for (int i = 0; i < numRays; i++)
+		{
+			heightDifference = std::max(heightDifference, fabsf(batchHeights[i] - scalarHeights[i]));
+		}
+		ok = ok && heightDifference <= 1e-4f;
+		printf("  heights: %.1f M/s one by one, %.1f M/s batched, max difference %.1e\n", numRays / scalarMs / 1000.0, numRays / batchMs / 1000.0, heightDifference);
+		if (subDivisions >= TARGET_SUBDIVISIONS) {
+			printf("one by one rays %s the %.1f Mrays/s target\n", onTarget ? "meet" : "are UNDER", TARGET_MRAYS);
+		}
+		return ok && onTarget ? 0 : 1;
+	}
+
+	/// <summary>
+	/// Checks an adaptive mesh over a (subDivisions + 1)^2 grid: the largest vertical distance between a grid point and the triangle
+	/// above or below it, whether the triangles cover the grid exactly, and how many grid vertices sit inside another triangle's edge (cracks)
+	/// </summary>
+	void checkAdaptiveMesh(const ew::MeshData& mesh, float cellSize, int subDivisions, const Array2D<float>& heights,
+		float* maxError, bool* covered, int* tJunctions)
+	{
+		int size = subDivisions + 1;
+		std::vector<char> used(size * size, 0);
+		std::vector<int> cols(mesh.vertices.size()), rows(mesh.vertices.size());
+		for (size_t i = 0; i < mesh.vertices.size(); i++)
+		{
+			cols[i] = (int)lroundf(mesh.vertices[i].pos.x / cellSize);
+			rows[i] = (int)lroundf(-mesh.vertices[i].pos.z / cellSize);
+			used[rows[i] * size + cols[i]] = 1;
+		}
+
+		long long area = 0;
+		*maxError = 0.0f;
+		*tJunctions = 0;
+		for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+		{
+			int x[3], y[3];
+			float h[3];
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int v = mesh.indices[t + k];
+				x[k] = cols[v];
+				y[k] = rows[v];
+				h[k] = mesh.vertices[v].pos.y;
+			}
+			long long twiceArea = (long long)(x[1] - x[0]) * (y[2] - y[0]) - (long long)(y[1] - y[0]) * (x[2] - x[0]);
+			area += twiceArea;
+
+			//every grid point inside, by barycentric coordinates
+			int xMin = std::min(x[0], std::min(x[1], x[2])), xMax = std::max(x[0], std::max(x[1], x[2]));
+			int yMin = std::min(y[0], std::min(y[1], y[2])), yMax = std::max(y[0], std::max(y[1], y[2]));
+			for (int py = yMin; py <= yMax; py++)
+			{
+				for (int px = xMin; px <= xMax; px++)
+				{
+					long long w0 = (long long)(x[1] - px) * (y[2] - py) - (long long)(y[1] - py) * (x[2] - px);
+					long long w1 = (long long)(x[2] - px) * (y[0] - py) - (long long)(y[2] - py) * (x[0] - px);
+					long long w2 = twiceArea - w0 - w1;
+					if ((w0 | w1 | w2) < 0) {
+						continue;
+					}
+					float surface = (h[0] * w0 + h[1] * w1 + h[2] * w2) / (float)twiceArea;
+					*maxError = std::max(*maxError, fabsf(heights.Get(px + 1, py + 1) - surface));
+				}
+			}
+
+			//a vertex strictly inside an edge leaves a crack next to it
+			for (int k = 0; k < 3; k++)
+			{
+				int x0 = x[k], y0 = y[k], x1 = x[(k + 1) % 3], y1 = y[(k + 1) % 3];
+				int steps = std::max(abs(x1 - x0), abs(y1 - y0));
+				for (int s = 1; s < steps; s++)
+				{
+					*tJunctions += used[(y0 + (y1 - y0) / steps * s) * size + x0 + (x1 - x0) / steps * s];
+				}
+			}
+		}
+		*covered = area == (long long)subDivisions * subDivisions * 2;
+	}
+
+	//rtin [subDivisions] [type] [runs]
+	int benchRtin(int argc, char** argv)
+	{
+		int subDivisions = argInt(argc, argv, 0, 256);
+		int type = argInt(argc, argv, 1, 0);
+		int runs = argInt(argc, argv, 2, 20);
+		const float size = 36.0f;
+		const float TARGET_MS = 5.0f;
+		bool ok = true;
+
+		Array2D<float> heights;
+		ew::createHeightField(subDivisions, type, &heights, ew::defaultThreadCount());
+		float minHeight, maxHeight;
+		heights.GetMinMax(minHeight, maxHeight);
+
+		ew::MeshData mesh;
+		double gridMs = 1e9;
+		for (int run = 0; run < runs; run++)
+		{
+			double start = nowMs();
+			ew::createTerrainFromHeightField(size, size, subDivisions, heights, &mesh);
+			gridMs = std::min(gridMs, nowMs() - start);
+		}
+		size_t gridTriangles = mesh.indices.size() / 3;
+
+		ew::RtinMesher mesher;
+		double initMs = 1e9;
+		for (int run = 0; run < runs; run++)
+		{
+			double start = nowMs();
+			if (!mesher.init(subDivisions, heights)) {
+				printf("rtin needs a power of two subDivisions, got %d\n", subDivisions);
+				return 1;
+			}
+			initMs = std::min(initMs, nowMs() - start);
+		}
+		printf("%d^2 grid, heights %.2f to %.2f: full grid %zu triangles in %.2f ms, error map %.2f ms, coarsest error %.3f\n",
+			subDivisions + 1, minHeight, maxHeight, gridTriangles, gridMs, initMs, mesher.getMaxError());
+
+		const float thresholds[] = { 0.0f, 0.005f, 0.01f, 0.02f, 0.05f, 0.1f, 0.2f, 0.5f, 1.0f };
+		const float CHUNK_THRESHOLD = 0.05f;
+		double chunkMs = 0.0;
+		for (float threshold : thresholds)
+		{
+			double meshMs = 1e9;
+			for (int run = 0; run < runs; run++)
+			{
+				double start = nowMs();
+				mesher.createMesh(size, size, threshold, &mesh);
+				meshMs = std::min(meshMs, nowMs() - start);
+			}
+			float maxError;
+			bool covered;
+			int tJunctions;
+			checkAdaptiveMesh(mesh, size / subDivisions, subDivisions, heights, &maxError, &covered, &tJunctions);
+			size_t triangles = mesh.indices.size() / 3;
+			if (threshold == CHUNK_THRESHOLD) {
+				chunkMs = initMs + meshMs;
+			}
+			bool within = maxError <= threshold + 1e-4f * (1.0f + maxHeight - minHeight);
+			ok = ok && within && covered && tJunctions == 0;
+			printf("  max error %5.3f: %7zu triangles (%5.1f%% of the grid, %6zu vertices) in %.2f ms, %.2f ms with the error map, measured error %.4f%s%s\n",
+				threshold, triangles, 100.0 * triangles / gridTriangles, mesh.vertices.size(), meshMs, initMs + meshMs, maxError,
+				within ? "" : " OVER", covered && tJunctions == 0 ? "" : " CRACKED");
+		}
+
+		printf("per chunk: error map plus a %.2f mesh in %.2f ms, %s the %.0f ms budget\n", CHUNK_THRESHOLD, chunkMs, chunkMs < TARGET_MS ? "within" : "OVER", TARGET_MS);
+		return ok && chunkMs < TARGET_MS ? 0 : 1;
+	}
+
+	struct LayoutErrors
+	{
+		float position = 0.0f;
+		float normal = 0.0f; //direction, as the length of the difference of unit vectors
+		float normalLength = 0.0f; //relative
+		float tangent = 0.0f;
+		float uv = 0.0f;
+	};
+
+	void addLayoutErrors(const ew::Vertex& decoded, const ew::Vertex& original, LayoutErrors* errors)
+	{
+		auto direction = [](const glm::vec3& v) { return glm::length(v) > 0.0f ? glm::normalize(v) : glm::vec3(0, 0, 1); };
+		float length = glm::length(original.normal);
+		errors->position = std::max(errors->position, glm::length(decoded.pos - original.pos));
+		errors->normal = std::max(errors->normal, glm::length(direction(decoded.normal) - direction(original.normal)));
+		errors->normalLength = std::max(errors->normalLength, length > 0.0f ? fabsf(glm::length(decoded.normal) - length) / length : glm::length(decoded.normal));
+		errors->tangent = std::max(errors->tangent, glm::length(direction(decoded.tangent) - direction(original.tangent)));
+		errors->uv = std::max(errors->uv, glm::length(decoded.uv - original.uv));
+	}
+
+	/// <summary>
+	/// What basicLightingVShader makes of every vertex of a mesh, captured with transform feedback: position, normal, uv and the light
+	/// direction in tangent space, which goes through the tangent. Identity matrices, so the values stay in model space
+	/// </summary>
+	std::vector<float> captureSandVertices(const ew::Mesh& mesh, const glm::vec3& lightDirection)
+	{
+		Shader shader("assets/shaderAssets/basicLightingVShader.vert", "assets/shaderAssets/basicLightingFShader.frag");
+		const char* varyings[] = { "gl_Position", "Surface.Normal", "Surface.TexCoord", "Surface.LightDirection" };
+		const int FLOATS_PER_VERTEX = 4 + 3 + 2 + 3;
+		glTransformFeedbackVaryings(shader.mId, 4, varyings, GL_INTERLEAVED_ATTRIBS);
+		shader.relink();
+		shader.use();
+		shader.setMat4("uModel", glm::mat4(1.0f));
+		SandBlocks blocks;
+		ew::bindUniformBlocks(shader);
+		blocks.setFrame(glm::mat4(1.0f), glm::mat4(1.0f), lightDirection);
+
+		unsigned int feedback;
+		glGenBuffers(1, &feedback);
+		glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, feedback);
+		glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, sizeof(float) * FLOATS_PER_VERTEX * mesh.getNumVertices(), NULL, GL_STATIC_READ);
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedback);
+		glEnable(GL_RASTERIZER_DISCARD);
+		glBeginTransformFeedback(GL_POINTS);
+		mesh.draw(ew::DrawMode::POINTS);
+		glEndTransformFeedback();
+		glDisable(GL_RASTERIZER_DISCARD);
+		std::vector<float> captured(FLOATS_PER_VERTEX * mesh.getNumVertices());
+		glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, sizeof(float) * captured.size(), captured.data());
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+		glDeleteBuffers(1, &feedback);
+		return captured;
+	}
+
+	//vertex-layouts [subDivisions] [runs]
+	int benchVertexLayouts(int argc, char** argv)
+	{
+		int subDivisions = argInt(argc, argv, 0, 256);
+		int runs = argInt(argc, argv, 1, 20);
+		const float size = 36.0f;
+
+		const int MESHES = 3;
+		const char* meshNames[MESHES] = { "terrain", "adaptive", "sphere" };
+		ew::MeshData meshes[MESHES];
+		ew::createTerrain(size, size, subDivisions, &meshes[0], 0, ew::defaultThreadCount());
+		Array2D<float> heights;
+		ew::createHeightField(subDivisions, 0, &heights, ew::defaultThreadCount());
+		ew::createAdaptiveTerrain(size, size, subDivisions, heights, 0.05f, &meshes[1]);
+		ew::createSphere(2.0f, 32, &meshes[2]);
+
+		GLFWwindow* window = createHiddenContext();
+		if (window == NULL) {
+			return 1;
+		}
+		bool ok = true;
+		{
+			//nothing is drawn, but draws need a complete framebuffer
+			OffscreenTarget target(64);
+			const glm::vec3 lightDirection = glm::normalize(glm::vec3(0.3f, -1.0f, 0.2f));
+			const ew::VertexLayout layouts[] = { ew::VertexLayout::FLOAT, ew::VertexLayout::HALF, ew::VertexLayout::QUANTIZED };
+			const char* layoutNames[] = { "float", "half", "quant" };
+			printf("%-8s %-6s %5s %9s %9s %9s %9s %9s %9s | %9s %9s %9s %s\n", "mesh", "layout", "bytes", "pack ms", "position", "normal", "length", "tangent", "uv",
+				"gpu pos", "gpu light", "gpu norm", "");
+			for (int m = 0; m < MESHES; m++)
+			{
+				const ew::MeshData& mesh = meshes[m];
+				int numVertices = (int)mesh.vertices.size();
+				glm::vec3 low = mesh.vertices[0].pos, high = low;
+				for (const ew::Vertex& v : mesh.vertices)
+				{
+					low = glm::vec3(std::min(low.x, v.pos.x), std::min(low.y, v.pos.y), std::min(low.z, v.pos.z));
+					high = glm::vec3(std::max(high.x, v.pos.x), std::max(high.y, v.pos.y), std::max(high.z, v.pos.z));
+				}
+				glm::vec3 extent = high - low;
+				float largest = std::max(extent.x, std::max(extent.y, extent.z));
+
+				ew::Mesh reference;
+				reference.load(mesh);
+				std::vector<float> expected = captureSandVertices(reference, lightDirection);
+				for (ew::VertexLayout layout : layouts)
+				{
+					//CPU decode, the same math as the shaders
+					std::vector<ew::PackedVertex> packed(numVertices);
+					double packMs = 0.0;
+					LayoutErrors cpu;
+					if (layout != ew::VertexLayout::FLOAT) {
+						packMs = 1e9;
+						ew::VertexDecode decode;
+						for (int run = 0; run < runs; run++)
+						{
+							double start = nowMs();
+							decode = ew::packVertices(mesh.vertices.data(), numVertices, layout, packed.data());
+							packMs = std::min(packMs, nowMs() - start);
+						}
+						for (int i = 0; i < numVertices; i++)
+						{
+							addLayoutErrors(ew::unpackVertex(packed[i], layout, decode), mesh.vertices[i], &cpu);
+						}
+					}
+
+					//what the sand shader sees, against the float mesh
+					ew::Mesh gpuMesh;
+					gpuMesh.setVertexLayout(layout);
+					gpuMesh.load(mesh);
+					std::vector<float> captured = captureSandVertices(gpuMesh, lightDirection);
+					float gpuPosition = 0.0f, gpuLight = 0.0f, gpuNormal = 0.0f;
+					for (int i = 0; i < numVertices; i++)
+					{
+						const float* a = &captured[i * 12];
+						const float* b = &expected[i * 12];
+						gpuPosition = std::max(gpuPosition, glm::length(glm::vec3(a[0], a[1], a[2]) - glm::vec3(b[0], b[1], b[2])));
+						glm::vec3 normal(a[4], a[5], a[6]), expectedNormal(b[4], b[5], b[6]);
+						gpuNormal = std::max(gpuNormal, glm::length(normal - expectedNormal) / std::max(glm::length(expectedNormal), 1e-20f));
+						gpuLight = std::max(gpuLight, glm::length(glm::vec3(a[9], a[10], a[11]) - glm::vec3(b[9], b[10], b[11])));
+					}
+
+					//half floats round to 11 bits around the center, quantized positions to 16 bits across the bounds.
+					//Directions and relative lengths within about a thousandth are well below what the lighting shows
+					float positionTolerance = layout == ew::VertexLayout::HALF ? largest * 0.5f / 2048.0f : layout == ew::VertexLayout::QUANTIZED ? largest / 65535.0f : 1e-6f;
+					float directionTolerance = layout == ew::VertexLayout::FLOAT ? 1e-6f : 1e-3f;
+					bool within = cpu.position <= positionTolerance && cpu.normal <= directionTolerance && cpu.normalLength <= directionTolerance
+						&& cpu.tangent <= directionTolerance && cpu.uv <= 1.0f / 65535.0f
+						&& gpuPosition <= positionTolerance && gpuNormal <= directionTolerance && gpuLight <= directionTolerance;
+					ok = ok && within;
+					printf("%-8s %-6s %5d %9.3f %9.2e %9.2e %9.2e %9.2e %9.2e | %9.2e %9.2e %9.2e %s\n", meshNames[m], layoutNames[(int)layout], ew::getVertexSize(layout), packMs,
+						cpu.position, cpu.normal, cpu.normalLength, cpu.tangent, cpu.uv, gpuPosition, gpuLight, gpuNormal, within ? "" : "OVER");
+				}
+			}
+
+			//upload of the full terrain, which is what streaming pays per chunk
+			const ew::MeshData& terrain = meshes[0];
+			for (ew::VertexLayout layout : layouts)
+			{
+				ew::Mesh mesh;
+				mesh.setVertexLayout(layout);
+				double best = 1e9;
+				for (int run = 0; run < runs; run++)
+				{
+					double start = nowMs();
+					mesh.load(terrain);
+					glFinish();
+					best = std::min(best, nowMs() - start);
+				}
+				printf("  load %-6s %6.2f MB in %.2f ms\n", layoutNames[(int)layout], terrain.vertices.size() * ew::getVertexSize(layout) / (1024.0 * 1024.0), best);
+			}
+			ok = ok && glGetError() == GL_NO_ERROR;
+		}
+		destroyHiddenContext(window);
+		return ok ? 0 : 1;
+	}
+
+	//Triangles as their corner positions, each rotated to start at its smallest corner so winding is kept, then sorted.
+	//Two meshes that draw the same triangles give the same list, whatever their vertex and triangle order
+	std::vector<std::vector<float>> canonicalTriangles(const ew::MeshData& mesh)
+	{
+		std::vector<std::vector<float>> triangles(mesh.indices.size() / 3);
+		for (size_t t = 0; t < triangles.size(); t++)
+		{
+			std::vector<float> corners[3];
+			for (int c = 0; c < 3; c++)
+			{
+				const ew::Vertex& v = mesh.vertices[mesh.indices[t * 3 + c]];
+				corners[c] = { v.pos.x, v.pos.y, v.pos.z, v.uv.x, v.uv.y };
+			}
+			int first = 0;
+			for (int c = 1; c < 3; c++)
+			{
+				if (corners[c] < corners[first]) {
+					first = c;
+				}
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				const std::vector<float>& corner = corners[(first + c) % 3];
+				triangles[t].insert(triangles[t].end(), corner.begin(), corner.end());
+			}
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	/// <summary>
+	/// Fragments that pass the depth test per covered pixel, with back faces culled like the app does.
+	/// Averaged over views from all around and above the mesh, since the overdraw pass does not know the camera
+	/// </summary>
+	float measureOverdraw(const ew::MeshData& meshData, Shader& shader, const OffscreenTarget& target)
+	{
+		glm::vec3 low = meshData.vertices[0].pos, high = low;
+		for (const ew::Vertex& v : meshData.vertices)
+		{
+			low = glm::vec3(std::min(low.x, v.pos.x), std::min(low.y, v.pos.y), std::min(low.z, v.pos.z));
+			high = glm::vec3(std::max(high.x, v.pos.x), std::max(high.y, v.pos.y), std::max(high.z, v.pos.z));
+		}
+		glm::vec3 center = (low + high) * 0.5f;
+		float radius = glm::length(high - low) * 0.5f;
+
+		ew::Mesh mesh(meshData);
+		shader.use();
+		shader.setMat4("uModel", glm::mat4(1.0f));
+		shader.setMat4("uProjection", glm::perspective(glm::radians(60.0f), 1.0f, radius * 0.1f, radius * 10.0f));
+		unsigned int query;
+		glGenQueries(1, &query);
+		glEnable(GL_CULL_FACE);
+		double passed = 0.0, covered = 0.0;
+		const float elevations[] = { 20.0f, 45.0f, 70.0f };
+		for (float elevation : elevations)
+		{
+			for (int i = 0; i < 8; i++)
+			{
+				float azimuth = glm::radians(45.0f * i + 10.0f);
+				float e = glm::radians(elevation);
+				glm::vec3 eye = center + glm::vec3(cosf(azimuth) * cosf(e), sinf(e), sinf(azimuth) * cosf(e)) * radius * 2.0f;
+				shader.setMat4("uView", glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f)));
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glBeginQuery(GL_SAMPLES_PASSED, query);
+				mesh.draw();
+				glEndQuery(GL_SAMPLES_PASSED);
+				unsigned int samples = 0;
+				glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samples);
+				passed += samples;
+				for (float depth : target.readDepth())
+				{
+					covered += depth < 1.0f;
+				}
+			}
+		}
+		glDisable(GL_CULL_FACE);
+		glDeleteQueries(1, &query);
+		return covered > 0.0 ? (float)(passed / covered) : 0.0f;
+	}
+
+	//mesh-optimizer [subDivisions] [cacheSize]
+	int benchMeshOptimizer(int argc, char** argv)
+	{
+		int subDivisions = argInt(argc, argv, 0, 256);
+		int cacheSize = argInt(argc, argv, 1, 16);
+		const float size = 36.0f;
+
+		const int MESHES = 4;
+		const char* meshNames[MESHES] = { "terrain", "adaptive", "sphere", "cube" };
+		ew::MeshData meshes[MESHES];
+		ew::createTerrain(size, size, subDivisions, &meshes[0], 0, ew::defaultThreadCount());
+		Array2D<float> heights;
+		ew::createHeightField(subDivisions, 0, &heights, ew::defaultThreadCount());
+		ew::createAdaptiveTerrain(size, size, subDivisions, heights, 0.05f, &meshes[1]);
+		ew::createSphere(2.0f, 64, &meshes[2]);
+		ew::createCube(6.0f, &meshes[3]);
+
+		GLFWwindow* window = createHiddenContext();
+		if (window == NULL) {
+			return 1;
+		}
+		bool ok = true;
+		{
+			OffscreenTarget target(256);
+			Shader shader("assets/shaderAssets/depth.vert", "assets/shaderAssets/depth.frag");
+			printf("cache size %d, overdraw is fragments shaded per covered pixel\n", cacheSize);
+			printf("%-8s %9s | %-17s | %-17s | %-17s | %9s %9s\n", "", "", "      before", "   vertex cache", "  cache+overdraw", "", "");
+			printf("%-8s %9s | %5s %5s %5s | %5s %5s %5s | %5s %5s %5s | %9s %9s\n", "mesh", "triangles",
+				"ACMR", "ATVR", "over", "ACMR", "ATVR", "over", "ACMR", "ATVR", "over", "cache ms", "total ms");
+			for (int m = 0; m < MESHES; m++)
+			{
+				const ew::MeshData& original = meshes[m];
+				ew::MeshData cacheOnly = original;
+				double start = nowMs();
+				ew::MeshOptimizeStats cacheStats = ew::optimizeMesh(&cacheOnly, false, cacheSize);
+				double cacheMs = nowMs() - start;
+				ew::MeshData optimized = original;
+				start = nowMs();
+				ew::MeshOptimizeStats stats = ew::optimizeMesh(&optimized, true, cacheSize);
+				double totalMs = nowMs() - start;
+
+				std::vector<std::vector<float>> expected = canonicalTriangles(original);
+				bool same = canonicalTriangles(cacheOnly) == expected && canonicalTriangles(optimized) == expected
+					&& cacheOnly.vertices.size() == original.vertices.size() && optimized.vertices.size() == original.vertices.size();
+				//a FIFO cache cannot miss less than once per vertex
+				same = same && stats.after.atvr >= 1.0f && cacheStats.after.acmr <= stats.before.acmr;
+				ok = ok && same;
+
+				float overdraw[3] = { measureOverdraw(original, shader, target), measureOverdraw(cacheOnly, shader, target), measureOverdraw(optimized, shader, target) };
+				printf("%-8s %9d | %5.3f %5.3f %5.3f | %5.3f %5.3f %5.3f | %5.3f %5.3f %5.3f | %9.2f %9.2f %s\n", meshNames[m], (int)original.indices.size() / 3,
+					stats.before.acmr, stats.before.atvr, overdraw[0], cacheStats.after.acmr, cacheStats.after.atvr, overdraw[1],
+					stats.after.acmr, stats.after.atvr, overdraw[2], cacheMs, totalMs, same ? "" : "CHANGED");
+			}
+
+			//what getGridIndexBuffer now does to the triangle list every grid terrain draws with
+			std::vector<unsigned int> grid;
+			ew::createGridIndices(subDivisions, &grid);
+			int gridVertices = (subDivisions + 1) * (subDivisions + 1);
+			ew::VertexCacheStats gridBefore = ew::analyzeVertexCache(grid.data(), (int)grid.size(), gridVertices, cacheSize);
+			double start = nowMs();
+			ew::optimizeVertexCache(grid.data(), (int)grid.size(), gridVertices, cacheSize);
+			double gridMs = nowMs() - start;
+			ew::VertexCacheStats gridAfter = ew::analyzeVertexCache(grid.data(), (int)grid.size(), gridVertices, cacheSize);
+			printf("  shared grid list: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, reordered in %.2f ms\n", gridBefore.acmr, gridAfter.acmr, gridBefore.atvr, gridAfter.atvr, gridMs);
+			ok = ok && glGetError() == GL_NO_ERROR;
+		}
+		destroyHiddenContext(window);
+		return ok ? 0 : 1;
+	}
+
+	//culling [boxes] [runs]
+	int benchCulling(int argc, char** argv)
+	{
+		int numBoxes = argInt(argc, argv, 0, 100000);
+		int runs = argInt(argc, argv, 1, 200);
+
+		//props and chunks scattered through a 2 km cube around the camera
+		srand(19);
+		auto random = [](float low, float high) { return low + (high - low) * (rand() / (float)RAND_MAX); };
+		ew::CullList list;
+		std::vector<ew::Bounds> boxes(numBoxes);
+		for (ew::Bounds& box : boxes)
+		{
+			glm::vec3 center(random(-1000.0f, 1000.0f), random(-100.0f, 100.0f), random(-1000.0f, 1000.0f));
+			glm::vec3 extent(random(0.5f, 20.0f), random(0.5f, 20.0f), random(0.5f, 20.0f));
+			box.min = center - extent;
+			box.max = center + extent;
+			list.add(box);
+		}
+
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+		bool ok = true;
+
+		//planes against the projection itself: a point is inside all six exactly when it lands inside the clip volume
+		ew::Frustum check = ew::extractFrustum(projection * glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, -0.2f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+		glm::mat4 checkMatrix = projection * glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, -0.2f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		int disagreements = 0;
+		for (int i = 0; i < 100000; i++)
+		{
+			glm::vec3 point(random(-500.0f, 500.0f), random(-500.0f, 500.0f), random(-500.0f, 500.0f));
+			glm::vec4 clip = checkMatrix * glm::vec4(point, 1.0f);
+			//skip points too close to a plane for float rounding to agree
+			glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			float margin = std::min(1.0f - fabsf(ndc.x), std::min(1.0f - fabsf(ndc.y), 1.0f - fabsf(ndc.z)));
+			if (fabsf(margin) < 1e-3f || fabsf(clip.w) < 1e-3f) {
+				continue;
+			}
+			bool inClip = clip.w > 0.0f && margin > 0.0f;
+			ew::Bounds pointBox;
+			pointBox.min = pointBox.max = point;
+			disagreements += inClip != ew::isBoxVisible(check, pointBox);
+		}
+		printf("frustum planes: %d of 100000 points disagree with the projection\n", disagreements);
+		ok = ok && disagreements == 0;
+
+		printf("%d boxes, best of %d runs per view\n", numBoxes, runs);
+		printf("  %-6s %8s %8s | %10s %8s | %10s %8s | %7s %s\n", "view", "visible", "culled", "scalar ms", "ns/box", "simd ms", "ns/box", "speedup", "");
+		const float yaws[] = { 0.0f, 90.0f, 200.0f, 315.0f };
+		for (float yaw : yaws)
+		{
+			Camera camera(glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), yaw, 10.0f);
+			ew::Frustum frustum = camera.getFrustum(projection);
+			std::vector<unsigned char> scalarVisible, simdVisible;
+			ew::CullStats scalarStats, simdStats;
+			double scalarMs = 1e9, simdMs = 1e9;
+			for (int run = 0; run < runs; run++)
+			{
+				double start = nowMs();
+				scalarStats = list.cullScalar(frustum, &scalarVisible);
+				scalarMs = std::min(scalarMs, nowMs() - start);
+				start = nowMs();
+				simdStats = list.cull(frustum, &simdVisible);
+				simdMs = std::min(simdMs, nowMs() - start);
+			}
+			int mismatches = 0;
+			for (int i = 0; i < numBoxes; i++)
+			{
+				mismatches += simdVisible[i] != scalarVisible[i] || (simdVisible[i] != 0) != ew::isBoxVisible(frustum, boxes[i]);
+			}
+			ok = ok && mismatches == 0 && simdStats.visible == scalarStats.visible;
+			printf("  %6.0f %8d %8d | %10.3f %8.2f | %10.3f %8.2f | %6.1fx %s\n", yaw, simdStats.visible, simdStats.culled,
+				scalarMs, scalarMs * 1e6 / numBoxes, simdMs, simdMs * 1e6 / numBoxes, scalarMs / simdMs, mismatches == 0 ? "" : "MISMATCH");
+		}
+		return ok ? 0 : 1;
+	}
+
+	//box filter of (2 * radius + 1)^2 cells over the interior, through Get/At only so every layout runs the same code
+	template<typename Layout>
+	void boxStencil(const Array2D<float, Layout>& src, Array2D<float, Layout>* dst, int radius, bool byColumns)
+	{
+		int width = src.GetWidth();
+		int height = src.GetHeight();
+		float weight = 1.0f / ((2 * radius + 1) * (2 * radius + 1));
+		int outer = byColumns ? width : height;
+		int inner = byColumns ? height : width;
+		for (int a = radius; a < outer - radius; a++)
+		{
+			for (int b = radius; b < inner - radius; b++)
+			{
+				int col = byColumns ? a : b;
+				int row = byColumns ? b : a;
+				float sum = 0.0f;
+				for (int dy = -radius; dy <= radius; dy++)
+				{
+					for (int dx = -radius; dx <= radius; dx++)
+					{
+						sum += src.Get(col + dx, row + dy);
+					}
+				}
+				dst->At(col, row) = sum * weight;
+			}
+		}
+	}
+
+	template<typename Layout>
+	bool sameInterior(const Array2D<float, Layout>& a, const Array2D<float>& reference, int radius)
+	{
+		for (int row = radius; row < a.GetHeight() - radius; row++)
+		{
+			for (int col = radius; col < a.GetWidth() - radius; col++)
+			{
+				if (a.Get(col, row) != reference.Get(col, row)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	//runs the stencils in one layout and checks them against the row major results
+	template<typename Layout>
+	bool benchLayout(const char* name, const Array2D<float>& source, const Array2D<float>* reference, const int* radii, int numRadii, int runs)
+	{
+		int size = source.GetWidth();
+		Array2D<float, Layout> src(size, size), dst(size, size);
+		for (int row = 0; row < size; row++)
+		{
+			for (int col = 0; col < size; col++)
+			{
+				src.At(col, row) = source.Get(col, row);
+			}
+		}
+		bool ok = true;
+		printf("  %-14s", name);
+		for (int r = 0; r < numRadii; r++)
+		{
+			for (int byColumns = 0; byColumns < 2; byColumns++)
+			{
+				double best = 1e30;
+				for (int run = 0; run < runs; run++)
+				{
+					double start = nowMs();
+					boxStencil(src, &dst, radii[r], byColumns != 0);
+					best = std::min(best, nowMs() - start);
+				}
+				bool same = sameInterior(dst, reference[r * 2 + byColumns], radii[r]);
+				ok = ok && same;
+				printf(" %10.1f%s", best, same ? " " : "!");
+			}
+		}
+		printf("\n");
+		return ok;
+	}
+
+	//Row major against Morton tiled Array2D on box stencils, walking the grid by rows and by columns
+	int benchArray2DLayouts(int argc, char** argv)
+	{
+		int size = argInt(argc, argv, 0, 4096);
+		int runs = argInt(argc, argv, 1, 3);
+		const int radii[] = { 1, 4 };
+		const int numRadii = 2;
+
+		Array2D<float> source(size, size);
+		for (int row = 0; row < size; row++)
+		{
+			float* heights = source.GetAddr(0, row);
+			for (int col = 0; col < size; col++)
+			{
+				heights[col] = rand() / (float)RAND_MAX;
+			}
+		}
+		printf("%dx%d floats, pitch %d, base %s 64 byte aligned, best of %d ms (! = differs from row major)\n", size, size,
+			source.GetPitch(), ((size_t)source.GetBaseAddr() & 63) == 0 ? "is" : "NOT", runs);
+		printf("  %-14s %10s %10s %10s %10s\n", "layout", "3x3 rows", "3x3 cols", "9x9 rows", "9x9 cols");
+
+		//reference results, and the row pointer loop that Get/At have to keep up with
+		Array2D<float> reference[numRadii * 2];
+		for (int r = 0; r < numRadii; r++)
+		{
+			for (int byColumns = 0; byColumns < 2; byColumns++)
+			{
+				reference[r * 2 + byColumns].InitArray2D(size, size, 0.0f);
+				boxStencil(source, &reference[r * 2 + byColumns], radii[r], byColumns != 0);
+			}
+		}
+		double pointerMs = 1e30;
+		Array2D<float> pointerResult(size, size);
+		for (int run = 0; run < runs; run++)
+		{
+			double start = nowMs();
+			for (int row = 1; row < size - 1; row++)
+			{
+				const float* up = source.GetAddr(0, row - 1);
+				const float* center = source.GetAddr(0, row);
+				const float* down = source.GetAddr(0, row + 1);
+				float* out = pointerResult.GetAddr(0, row);
+				for (int col = 1; col < size - 1; col++)
+				{
+					float sum = 0.0f;
+					sum += up[col - 1]; sum += up[col]; sum += up[col + 1];
+					sum += center[col - 1]; sum += center[col]; sum += center[col + 1];
+					sum += down[col - 1]; sum += down[col]; sum += down[col + 1];
+					out[col] = sum * (1.0f / 9.0f);
+				}
+			}
+			pointerMs = std::min(pointerMs, nowMs() - start);
+		}
+		bool ok = sameInterior(pointerResult, reference[0], 1);
+		printf("  %-14s %10.1f%s\n", "row pointers", pointerMs, ok ? " " : "!");
+
+		ok = benchLayout<RowMajorLayout>("row major", source, reference, radii, numRadii, runs) && ok;
+		ok = benchLayout<MortonLayout<3>>("morton 8x8", source, reference, radii, numRadii, runs) && ok;
+		ok = benchLayout<MortonLayout<4>>("morton 16x16", source, reference, radii, numRadii, runs) && ok;
+		return ok ? 0 : 1;
+	}
+
+	float maxDifference(const Array2D<float>& a, const Array2D<float>& b)
+	{
+		if (a.GetWidth() != b.GetWidth() || a.GetHeight() != b.GetHeight()) {
+			return INFINITY;
+		}
+		float difference = 0.0f;
+		for (int row = 0; row < a.GetHeight(); row++)
+		{
+			for (int col = 0; col < a.GetWidth(); col++)
+			{
+				difference = std::max(difference, fabsf(a.Get(col, row) - b.Get(col, row)));
+			}
+		}
+		return difference;
+	}
+
+	//Vectorized Array2D operations on 1 and many threads against their scalar references
+	int benchArray2DOps(int argc, char** argv)
+	{
+		int size = argInt(argc, argv, 0, 4096);
+		int threads = argInt(argc, argv, 1, ew::defaultThreadCount());
+		int runs = argInt(argc, argv, 2, 3);
+		Array2D<float> source;
+		ew::createHeightField(size - 3, 0, &source, threads);
+		printf("%dx%d heights, best of %d ms\n", size, size, runs);
+		printf("  %-16s %10s %10s %10s %8s %10s\n", "operation", "scalar", "1 thread", "threads", "speedup", "max diff");
+
+		Array2D<float> expected, result;
+		ew::Stencil3x3 sharpen;
+		for (int dy = 0; dy < 3; dy++)
+		{
+			for (int dx = 0; dx < 3; dx++)
+			{
+				sharpen.weights[dy][dx] = dx == 1 && dy == 1 ? 9.0f : -1.0f;
+			}
+		}
+		int resampled = size * 3 / 2;
+		std::vector<float> box = ew::boxWeights(4);
+		std::vector<float> gaussian = ew::gaussianWeights(2.0f);
+
+		//op 0 min/max, 1 normalize, 2 scale/offset, 3 resample, 4 box blur, 5 gaussian blur, 6 stencil
+		const char* names[] = { "min/max", "normalize", "scale/offset", "resample 1.5x", "box blur r4", "gaussian s2", "3x3 stencil" };
+		const float tolerances[] = { 0.0f, 1e-5f, 0.0f, 0.0f, 1e-5f, 1e-5f, 1e-4f };
+		bool ok = true;
+		for (int op = 0; op < 7; op++)
+		{
+			float low = 0.0f, high = 0.0f;
+			auto reference = [&]() {
+				switch (op)
+				{
+				case 0: source.GetMinMax(low, high); break;
+				case 1: expected.Normalize(0.0f, 1.0f); break;
+				case 2: ew::scaleOffsetScalar(&expected, 0.25f, 3.0f); break;
+				case 3: ew::resampleBilinearScalar(source, resampled, resampled, &expected); break;
+				case 4: ew::convolveSeparableScalar(source, box, &expected); break;
+				case 5: ew::convolveSeparableScalar(source, gaussian, &expected); break;
+				case 6: ew::applyStencilScalar(source, sharpen, &expected); break;
+				}
+			};
+			float simdLow = 0.0f, simdHigh = 0.0f;
+			auto vectorized = [&](int numThreads) {
+				if (op == 1 || op == 2) {
+					result.CopyFrom(source);
+				}
+				double start = nowMs();
+				switch (op)
+				{
+				case 0: ew::getMinMax(source, &simdLow, &simdHigh, numThreads); break;
+				case 1: ew::normalize(&result, 0.0f, 1.0f, numThreads); break;
+				case 2: ew::scaleOffset(&result, 0.25f, 3.0f, numThreads); break;
+				case 3: ew::resampleBilinear(source, resampled, resampled, &result, numThreads); break;
+				case 4: ew::boxBlur(source, 4, &result, numThreads); break;
+				case 5: ew::gaussianBlur(source, 2.0f, &result, numThreads); break;
+				case 6: ew::applyStencil(source, sharpen, &result, numThreads); break;
+				}
+				return nowMs() - start;
+			};
+
+			double scalarMs = 1e30, singleMs = 1e30, threadedMs = 1e30;
+			for (int run = 0; run < runs; run++)
+			{
+				//normalize and scale/offset work in place, from a fresh copy that is not timed
+				if (op == 1 || op == 2) {
+					expected.CopyFrom(source);
+				}
+				double start = nowMs();
+				reference();
+				scalarMs = std::min(scalarMs, nowMs() - start);
+				singleMs = std::min(singleMs, vectorized(1));
+				threadedMs = std::min(threadedMs, vectorized(threads));
+			}
+			float difference = op == 0 ? std::max(fabsf(low - simdLow), fabsf(high - simdHigh)) : maxDifference(expected, result);
+			bool same = difference <= tolerances[op];
+			ok = ok && same;
+			printf("  %-16s %10.2f %10.2f %10.2f %7.1fx %10.2e %s\n", names[op], scalarMs, singleMs, threadedMs,
+				scalarMs / threadedMs, difference, same ? "ok" : "MISMATCH");
+		}
+		return ok ? 0 : 1;
+	}
+
+	//resident set of the process in MB, now and at its peak. Zero where the platform has no cheap way to ask
+	void getResidentMb(double* current, double* peak)
+	{
+		*current = *peak = 0.0;
+#if !defined(_WIN32)
+		long pages = 0, resident = 0;
+		FILE* statm = fopen("/proc/self/statm", "r");
+		if (statm != NULL) {
+			if (fscanf(statm, "%ld %ld", &pages, &resident) == 2) {
+				*current = resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+			}
+			fclose(statm);
+		}
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+			*peak = usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+			*peak = usage.ru_maxrss / 1024.0;
+#endif
+		}
+#endif
+	}
+
+	//so the next read of the file comes from disk. Only clean pages go, which they are after the writer's fsync
+	bool dropFromPageCache(const char* path)
+	{
+#if defined(__linux__)
+		int fd = open(path, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		bool dropped = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+		close(fd);
+		return dropped;
+#else
+		return false;
+#endif
+	}
+
+	//Writes a dune field larger than memory to a tiled file, then meshes a window of it through a read only mapping
+	int benchHeightFieldFile(int argc, char** argv)
+	{
+		int size = argInt(argc, argv, 0, 32768);
+		int windowSize = std::min(argInt(argc, argv, 1, 2048), size);
+		const char* path = argc > 2 ? argv[2] : "heightfield.ewhf";
+		int threads = ew::defaultThreadCount();
+		ew::DuneRowFunction duneRow = ew::getDuneRowFunction(0);
+		double residentMb, peakMb;
+
+		double start = nowMs();
+		ew::HeightFieldWriter writer;
+		std::vector<float> row(size);
+		bool ok = writer.open(path, size, size);
+		for (int r = 0; ok && r < size; r++)
+		{
+			duneRow(0, r, size, row.data());
+			ok = writer.writeRow(row.data());
+		}
+		ok = writer.close() && ok;
+		double writeMs = nowMs() - start;
+		if (!ok) {
+			printf("Could not write %s\n", path);
+			return 1;
+		}
+		ew::HeightFieldFile probe;
+		double fileGb = probe.open(path) ? probe.getBytes() / (1024.0 * 1024.0 * 1024.0) : 0.0;
+		probe.close();
+		getResidentMb(&residentMb, &peakMb);
+		printf("%dx%d dunes: %.2f GB written in %.1f s, peak RSS %.0f MB so far\n", size, size, fileGb, writeMs / 1000.0, peakMb);
+
+		int col0 = (size - windowSize) / 2;
+		int row0 = (size - windowSize) / 2;
+		Array2D<float> window;
+		for (int prefetch = 0; prefetch < 2; prefetch++)
+		{
+			bool cold = dropFromPageCache(path);
+			ew::HeightFieldFile file;
+			ok = ok && file.open(path);
+			start = nowMs();
+			ok = ok && file.copyWindow(col0, row0, windowSize, windowSize, &window, prefetch != 0);
+			double copyMs = nowMs() - start;
+			getResidentMb(&residentMb, &peakMb);
+			file.release(col0, row0, windowSize, windowSize);
+			double releasedMb;
+			getResidentMb(&releasedMb, &peakMb);
+			printf("  %dx%d window, %s, %s: %8.1f ms, RSS %.0f MB, %.0f MB after release\n", windowSize, windowSize,
+				cold ? "from disk" : "page cache", prefetch ? "prefetching ahead" : "no prefetch", copyMs, residentMb, releasedMb);
+		}
+
+		//the window holds what the generator wrote there
+		bool same = ok;
+		for (int r = 0; same && r < windowSize; r++)
+		{
+			duneRow(col0, row0 + r, windowSize, row.data());
+			same = memcmp(window.GetAddr(0, r), row.data(), sizeof(float) * windowSize) == 0;
+		}
+		ok = ok && same;
+
+		ew::MeshData mesh;
+		start = nowMs();
+		ok = ok && ew::createTerrainFromHeightmap((float)windowSize, (float)windowSize, window, &mesh, threads);
+		double meshMs = nowMs() - start;
+		getResidentMb(&residentMb, &peakMb);
+		printf("  meshed in %.1f ms, %zu vertices, matches the generator: %s\n", meshMs, mesh.vertices.size(), same ? "yes" : "NO");
+		printf("  peak RSS %.0f MB, %.1f%% of the %.2f GB field\n", peakMb, 100.0 * peakMb / (fileGb * 1024.0), fileGb);
+
+		//writes to a copy on write mapping stay private
+		ew::HeightFieldFile file;
+		float original = 0.0f, edited = 0.0f, reopened = 0.0f;
+		if (ok && file.open(path, ew::HeightFieldAccess::COPY_ON_WRITE)) {
+			original = file.getHeights().Get(col0, row0);
+			file.getWritableHeights()->At(col0, row0) = original + 100.0f;
+			edited = file.getHeights().Get(col0, row0);
+			file.close();
+		}
+		ok = ok && file.open(path) && file.getWritableHeights() == nullptr;
+		if (ok) {
+			reopened = file.getHeights().Get(col0, row0);
+		}
+		bool cow = ok && edited == original + 100.0f && reopened == original;
+		ok = ok && cow;
+		printf("  copy on write edit visible: %s, file unchanged: %s\n", edited == original + 100.0f ? "yes" : "NO", reopened == original ? "yes" : "NO");
+		file.close();
+		remove(path);
+		return ok ? 0 : 1;
+	}
+
+	//dunes moving under the wind, for rewriting a whole mesh every frame
+	void animateTerrain(const std::vector<ew::Vertex>& base, int frame, std::vector<ew::Vertex>* animated)
+	{
+		animated->resize(base.size());
+		for (size_t i = 0; i < base.size(); i++)
+		{
+			ew::Vertex v = base[i];
+			v.pos.y += 0.5f * sinf(v.pos.x * 0.3f + frame * 0.1f) * cosf(v.pos.z * 0.2f);
+			(*animated)[i] = v;
+		}
+	}
+
+	//mesh-streaming [subDivisions] [frames]
+	int benchMeshStreaming(int argc, char** argv)
+	{
+		int subDivisions = argInt(argc, argv, 0, 256);
+		int frames = argInt(argc, argv, 1, 200);
+		const float size = 36.0f;
+
+		ew::MeshData base;
+		ew::createTerrain(size, size, subDivisions, &base, 0, ew::defaultThreadCount());
+		int numVertices = (int)base.vertices.size();
+		int numIndices = (int)base.indices.size();
+
+		GLFWwindow* window = createHiddenContext();
+		if (window == NULL) {
+			return 1;
+		}
+		bool ok = true;
+		{
+			OffscreenTarget target(256);
+			Shader shader("assets/shaderAssets/depth.vert", "assets/shaderAssets/depth.frag");
+			shader.use();
+			shader.setMat4("uModel", glm::mat4(1.0f));
+			shader.setMat4("uView", glm::lookAt(glm::vec3(size * 0.5f, 40.0f, 10.0f), glm::vec3(size * 0.5f, 0.0f, -size * 0.5f), glm::vec3(0.0f, 1.0f, 0.0f)));
+			shader.setMat4("uProjection", glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 1000.0f));
+			printf("%d vertices, %.1f MB a frame, persistent mapping %s\n", numVertices,
+				(numVertices * sizeof(ew::Vertex) + numIndices * sizeof(unsigned int)) / (1024.0 * 1024.0), GLAD_GL_VERSION_4_4 ? "yes" : "no");
+
+			//every frame rewrites every vertex, then draws
+			const ew::BufferUsage usages[] = { ew::BufferUsage::STATIC, ew::BufferUsage::DYNAMIC, ew::BufferUsage::STREAM, ew::BufferUsage::STREAM_RING };
+			const char* usageNames[] = { "static", "dynamic", "stream", "ring" };
+			printf("%-8s %9s %9s %9s %7s %7s %s\n", "usage", "load ms", "MB/s", "frame ms", "reallocs", "waits", "");
+			std::vector<ew::Vertex> animated;
+			std::vector<float> reference;
+			for (int u = 0; u < 4; u++)
+			{
+				ew::Mesh mesh;
+				mesh.setBufferUsage(usages[u]);
+				double loadMs = 0.0;
+				double start = nowMs();
+				for (int frame = 0; frame < frames; frame++)
+				{
+					animateTerrain(base.vertices, frame, &animated);
+					double loadStart = nowMs();
+					mesh.load(animated.data(), numVertices, base.indices.data(), numIndices, ew::IndexType::UNSIGNED_INT);
+					loadMs += nowMs() - loadStart;
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					mesh.draw();
+				}
+				glFinish();
+				double frameMs = (nowMs() - start) / frames;
+				std::vector<float> depth = target.readDepth();
+				if (u == 0) {
+					reference = depth;
+				}
+				bool same = depth == reference;
+				ok = ok && same;
+				const ew::MeshBufferStats& stats = mesh.getBufferStats();
+				printf("%-8s %9.3f %9.0f %9.2f %7d %7d %s\n", usageNames[u], loadMs / frames, stats.uploadedBytes / (1024.0 * 1024.0) / (loadMs / 1000.0),
+					frameMs, stats.reallocations, stats.fenceWaits, same ? "" : "CHANGED");
+			}
+			printf("ring loads include the flush of the last frame's draws that placing its fence causes\n");
+
+			//loads that wander a few percent around one size, like chunks or rebuilds at a similar detail
+			srand(23);
+			printf("100 loads of %d +-5%% vertices:", numVertices);
+			for (int u = 0; u < 2; u++)
+			{
+				ew::Mesh mesh;
+				mesh.setBufferUsage(usages[u]);
+				for (int load = 0; load < 100; load++)
+				{
+					int count = (int)(numVertices * (0.95f + 0.05f * (rand() / (float)RAND_MAX)));
+					int indices = (int)((long long)numIndices / 3 * count / numVertices) * 3;
+					mesh.load(base.vertices.data(), count, base.indices.data(), indices, ew::IndexType::UNSIGNED_INT);
+				}
+				printf(" %s %d reallocations", usageNames[u], mesh.getBufferStats().reallocations);
+				//vertices and indices, each allocated once and grown at most once
+				ok = ok && (u == 0 || mesh.getBufferStats().reallocations <= 4);
+			}
+			printf("\n");
+
+			//a strip of rows edited in place against a full reload, and rebuilding a whole frame out of strips
+			int stripRows = std::max(1, subDivisions / 16);
+			int stripVertices = stripRows * (subDivisions + 1);
+			animateTerrain(base.vertices, frames, &animated);
+			for (int u = 1; u < 4; u += 2)
+			{
+				ew::Mesh mesh;
+				mesh.setBufferUsage(usages[u]);
+				mesh.load(base.vertices.data(), numVertices, base.indices.data(), numIndices, ew::IndexType::UNSIGNED_INT);
+				double updateMs = 1e9, loadMs = 1e9;
+				for (int run = 0; run < 10; run++)
+				{
+					glFinish();
+					double start = nowMs();
+					mesh.updateVertices(0, animated.data(), stripVertices);
+					glFinish();
+					updateMs = std::min(updateMs, nowMs() - start);
+					start = nowMs();
+					mesh.load(base.vertices.data(), numVertices, base.indices.data(), numIndices, ew::IndexType::UNSIGNED_INT);
+					glFinish();
+					loadMs = std::min(loadMs, nowMs() - start);
+				}
+				for (int first = 0; first < numVertices; first += stripVertices)
+				{
+					mesh.updateVertices(first, animated.data() + first, std::min(stripVertices, numVertices - first));
+				}
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				mesh.draw();
+				std::vector<float> patched = target.readDepth();
+
+				ew::Mesh loaded;
+				loaded.load(animated.data(), numVertices, base.indices.data(), numIndices, ew::IndexType::UNSIGNED_INT);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				loaded.draw();
+				bool same = patched == target.readDepth();
+				ok = ok && same;
+				printf("%s: %d row update %.3f ms, full load %.3f ms, frame rebuilt from updates matches a load: %s\n",
+					usageNames[u], stripRows, updateMs, loadMs, same ? "yes" : "NO");
+			}
+
+			//a moved ring mesh keeps drawing, and the names of a mesh are gone once it is replaced or out of scope
+			unsigned int ringEbo = 0, replacedEbo = 0;
+			bool moved = false, replacedGone = false;
+			{
+				ew::Mesh ring;
+				ring.setBufferUsage(ew::BufferUsage::STREAM_RING);
+				for (int load = 0; load < 4; load++)
+				{
+					ring.load(base.vertices.data(), numVertices, base.indices.data(), numIndices, ew::IndexType::UNSIGNED_INT);
+					ring.draw();
+				}
+				ringEbo = ring.getIndexBuffer().ebo;
+				ew::Mesh kept(std::move(ring));
+				kept.load(base.vertices.data(), numVertices, base.indices.data(), numIndices, ew::IndexType::UNSIGNED_INT);
+				kept.draw();
+				moved = ring.getNumVertices() == 0 && kept.getNumVertices() == numVertices && kept.getIndexBuffer().ebo == ringEbo;
+
+				ew::Mesh replaced(base);
+				replacedEbo = replaced.getIndexBuffer().ebo;
+				replaced = std::move(kept);
+				replacedGone = !glIsBuffer(replacedEbo) && replaced.getIndexBuffer().ebo == ringEbo;
+				glFinish();
+			}
+			bool released = moved && replacedGone && !glIsBuffer(ringEbo) && glGetError() == GL_NO_ERROR;
+			ok = ok && released;
+			printf("ring mesh moved and still drawing: %s, buffers deleted with the mesh: %s\n", moved ? "yes" : "NO", released ? "yes" : "NO");
+			ok = ok && glGetError() == GL_NO_ERROR;
+		}
+		destroyHiddenContext(window);
+		return ok ? 0 : 1;
+	}
+
+	//one active uniform of a program, as GL lists it
+	struct ActiveUniform
+	{
+		std::string name;
+		GLenum type;
+	};
+
+	std::vector<ActiveUniform> listUniforms(unsigned int program)
+	{
+		int count = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+		std::vector<ActiveUniform> uniforms;
+		for (int i = 0; i < count; i++)
+		{
+			char name[256];
+			int length = 0, size = 0;
+			GLenum type;
+			glGetActiveUniform(program, i, sizeof(name), &length, &size, &type, name);
+			uniforms.push_back({ std::string(name, length), type });
+		}
+		return uniforms;
+	}
+
+	//uniform-cache [frames]
+	int benchUniformCache(int argc, char** argv)
+	{
+		int frames = argInt(argc, argv, 0, 2000);
+
+		GLFWwindow* window = createHiddenContext();
+		if (window == NULL) {
+			return 1;
+		}
+		bool ok = true;
+		{
+			const char* paths[][3] = {
+				{ "basicLightingVShader.vert", "basicLightingFShader.frag", NULL },
+				{ "cdlodVShader.vert", "basicLightingFShader.frag", NULL },
+				{ "terrainPullVShader.vert", "basicLightingFShader.frag", NULL },
+				{ "lampVShader.vert", "lampFShader.frag", NULL },
+				{ "normalVisualization.vert", "normalVisualization.frag", "normalVisualization.geom" },
+				{ "tangentVisualization.vert", "tangentVisualization.frag", "tangentVisualization.geom" },
+				{ "depth.vert", "depth.frag", NULL },
+			};
+			std::vector<Shader> shaders;
+			for (const auto& shaderPaths : paths)
+			{
+				std::string vertex = std::string("assets/shaderAssets/") + shaderPaths[0];
+				std::string fragment = std::string("assets/shaderAssets/") + shaderPaths[1];
+				std::string geometry = shaderPaths[2] ? std::string("assets/shaderAssets/") + shaderPaths[2] : "";
+				shaders.emplace_back(vertex.c_str(), fragment.c_str(), shaderPaths[2] ? geometry.c_str() : nullptr);
+			}
+
+			//the cache against GL, for every uniform of every program the app links
+			for (size_t i = 0; i < shaders.size(); i++)
+			{
+				int mismatches = 0;
+				std::vector<ActiveUniform> uniforms = listUniforms(shaders[i].mId);
+				for (const ActiveUniform& uniform : uniforms)
+				{
+					mismatches += shaders[i].getUniform(uniform.name).location != glGetUniformLocation(shaders[i].mId, uniform.name.c_str());
+				}
+				mismatches += shaders[i].getUniform("uNotAUniform").location != -1;
+				ok = ok && mismatches == 0;
+				printf("%-26s %2zu active uniforms, %2d cached names %s\n", paths[i][0], uniforms.size(), shaders[i].getNumUniforms(), mismatches == 0 ? "" : "MISMATCH");
+			}
+
+			//every uniform the sand program has outside its blocks, set once a frame
+			Shader& sand = shaders[0];
+			sand.use();
+			std::vector<ActiveUniform> uniforms = listUniforms(sand.mId);
+			std::vector<UniformHandle> handles;
+			for (const ActiveUniform& uniform : uniforms)
+			{
+				handles.push_back(sand.getUniform(uniform.name));
+			}
+			const glm::mat4 matrix = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+			const glm::vec4 vector = glm::vec4(0.25f, 0.5f, 0.75f, 1.0f);
+			auto setUniform = [&](size_t i, auto uniform) {
+				switch (uniforms[i].type)
+				{
+				case GL_FLOAT: sand.setFloat(uniform, vector.x); break;
+				case GL_FLOAT_VEC2: sand.setVec2(uniform, glm::vec2(vector.x, vector.y)); break;
+				case GL_FLOAT_VEC3: sand.setVec3(uniform, glm::vec3(vector)); break;
+				case GL_FLOAT_VEC4: sand.setVec4(uniform, vector); break;
+				case GL_FLOAT_MAT4: sand.setMat4(uniform, matrix); break;
+				default: sand.setInt(uniform, 0); break;
+				}
+			};
+			auto setRaw = [&](size_t i) {
+				//what every set did before the cache
+				int location = glGetUniformLocation(sand.mId, uniforms[i].name.c_str());
+				switch (uniforms[i].type)
+				{
+				case GL_FLOAT: glUniform1f(location, vector.x); break;
+				case GL_FLOAT_VEC2: glUniform2fv(location, 1, &vector.x); break;
+				case GL_FLOAT_VEC3: glUniform3fv(location, 1, &vector.x); break;
+				case GL_FLOAT_VEC4: glUniform4fv(location, 1, &vector.x); break;
+				case GL_FLOAT_MAT4: glUniformMatrix4fv(location, 1, GL_FALSE, &matrix[0][0]); break;
+				default: glUniform1i(location, 0); break;
+				}
+			};
+
+			unsigned int callsBefore = Shader::getUniformLocationCalls();
+			double rawMs = 1e9, nameMs = 1e9, handleMs = 1e9;
+			for (int run = 0; run < 3; run++)
+			{
+				double start = nowMs();
+				for (int frame = 0; frame < frames; frame++)
+				{
+					for (size_t i = 0; i < uniforms.size(); i++)
+					{
+						setRaw(i);
+					}
+				}
+				rawMs = std::min(rawMs, nowMs() - start);
+				start = nowMs();
+				for (int frame = 0; frame < frames; frame++)
+				{
+					for (size_t i = 0; i < uniforms.size(); i++)
+					{
+						setUniform(i, uniforms[i].name);
+					}
+				}
+				nameMs = std::min(nameMs, nowMs() - start);
+				start = nowMs();
+				for (int frame = 0; frame < frames; frame++)
+				{
+					for (size_t i = 0; i < uniforms.size(); i++)
+					{
+						setUniform(i, handles[i]);
+					}
+				}
+				handleMs = std::min(handleMs, nowMs() - start);
+			}
+			unsigned int calls = Shader::getUniformLocationCalls() - callsBefore;
+			double sets = (double)frames * uniforms.size();
+			printf("%zu sand uniforms a frame, %d frames, ns per set:\n", uniforms.size(), frames);
+			printf("  glGetUniformLocation + glUniform %7.1f\n", rawMs * 1e6 / sets);
+			printf("  by name, cached                 %7.1f\n", nameMs * 1e6 / sets);
+			printf("  by handle                       %7.1f\n", handleMs * 1e6 / sets);
+			printf("  glGetUniformLocation calls by Shader per frame: %.2f\n", calls / (double)(frames * 3));
+			ok = ok && calls == 0 && glGetError() == GL_NO_ERROR;
+		}
+		destroyHiddenContext(window);
+		return ok ? 0 : 1;
+	}
+
+	//a block member as the shaders name it, and where the C++ struct keeps it
+	struct BlockMember
+	{
+		const char* name;
+		size_t offset;
+	};
+
+	/// <returns>Members whose std140 offset in the program differs from the struct's, -1 if the block is missing or too big</returns>
+	int checkBlockLayout(const Shader& shader, const char* blockName, const BlockMember* members, int numMembers, size_t structSize)
+	{
+		unsigned int block = glGetUniformBlockIndex(shader.mId, blockName);
+		if (block == GL_INVALID_INDEX) {
+			return -1;
+		}
+		int dataSize = 0;
+		glGetActiveUniformBlockiv(shader.mId, block, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+		if ((size_t)dataSize > structSize) {
+			return -1;
+		}
+		int mismatches = 0;
+		for (int i = 0; i < numMembers; i++)
+		{
+			unsigned int index = GL_INVALID_INDEX;
+			glGetUniformIndices(shader.mId, 1, &members[i].name, &index);
+			int offset = -1;
+			if (index != GL_INVALID_INDEX) {
+				glGetActiveUniformsiv(shader.mId, 1, &index, GL_UNIFORM_OFFSET, &offset);
+			}
+			mismatches += offset != (int)members[i].offset;
+		}
+		return mismatches;
+	}
+
+	//uniform-blocks [frames]
+	int benchUniformBlocks(int argc, char** argv)
+	{
+		int frames = argInt(argc, argv, 0, 600);
+
+		GLFWwindow* window = createHiddenContext();
+		if (window == NULL) {
+			return 1;
+		}
+		bool ok = true;
+		{
+			const BlockMember frameMembers[] = {
+				{ "uView", offsetof(ew::FrameUniforms, view) },
+				{ "uProjection", offsetof(ew::FrameUniforms, projection) },
+				{ "uViewPos", offsetof(ew::FrameUniforms, viewPos) },
+				{ "uLightDirection", offsetof(ew::FrameUniforms, lightDirection) },
+			};
+			const BlockMember materialMembers[] = {
+				{ "uLightColor", offsetof(ew::SandMaterial, lightColor) },
+				{ "uAmbientK", offsetof(ew::SandMaterial, ambientK) },
+				{ "uColorShade", offsetof(ew::SandMaterial, colorShade) },
+				{ "uDiffuseK", offsetof(ew::SandMaterial, diffuseK) },
+				{ "uColorSun", offsetof(ew::SandMaterial, colorSun) },
+				{ "uOceanSpecularK", offsetof(ew::SandMaterial, oceanSpecularK) },
+				{ "uSpecColor", offsetof(ew::SandMaterial, specColor) },
+				{ "uOceanShininess", offsetof(ew::SandMaterial, oceanShininess) },
+				{ "uGrainSpecularK", offsetof(ew::SandMaterial, grainSpecularK) },
+				{ "uGrainShininess", offsetof(ew::SandMaterial, grainShininess) },
+				{ "uGrainSize", offsetof(ew::SandMaterial, grainSize) },
+				{ "uRimStrength", offsetof(ew::SandMaterial, rimStrength) },
+				{ "uRimPower", offsetof(ew::SandMaterial, rimPower) },
+				{ "uSteepnessStrength", offsetof(ew::SandMaterial, steepnessStrength) },
+				{ "uHeightScale", offsetof(ew::SandMaterial, heightScale) },
+			};
+			const char* paths[][3] = {
+				{ "basicLightingVShader.vert", "basicLightingFShader.frag", NULL },
+				{ "cdlodVShader.vert", "basicLightingFShader.frag", NULL },
+				{ "terrainPullVShader.vert", "basicLightingFShader.frag", NULL },
+				{ "lampVShader.vert", "lampFShader.frag", NULL },
+				{ "normalVisualization.vert", "normalVisualization.frag", "normalVisualization.geom" },
+				{ "tangentVisualization.vert", "tangentVisualization.frag", "tangentVisualization.geom" },
+			};
+			//the lamp and the debug lines only read the frame block
+			const bool usesMaterial[] = { true, true, true, false, false, false };
+			std::vector<Shader> shaders;
+			printf("%-26s %-12s %-12s\n", "program", "FrameBlock", "SandMaterial");
+			for (int i = 0; i < 6; i++)
+			{
+				std::string vertex = std::string("assets/shaderAssets/") + paths[i][0];
+				std::string fragment = std::string("assets/shaderAssets/") + paths[i][1];
+				std::string geometry = paths[i][2] ? std::string("assets/shaderAssets/") + paths[i][2] : "";
+				shaders.emplace_back(vertex.c_str(), fragment.c_str(), paths[i][2] ? geometry.c_str() : nullptr);
+				int frameMismatches = checkBlockLayout(shaders.back(), "FrameBlock", frameMembers, 4, sizeof(ew::FrameUniforms));
+				int materialMismatches = usesMaterial[i] ? checkBlockLayout(shaders.back(), "SandMaterialBlock", materialMembers, 15, sizeof(ew::SandMaterial)) : 0;
+				bool same = frameMismatches == 0 && materialMismatches == 0;
+				ok = ok && same;
+				printf("%-26s %-12s %-12s\n", paths[i][0], frameMismatches == 0 ? "matches" : "WRONG",
+					!usesMaterial[i] ? "-" : materialMismatches == 0 ? "matches" : "WRONG");
+			}
+
+			//a camera that moves every frame and a material edited twice, the way main sets them
+			SandBlocks blocks;
+			for (Shader& shader : shaders)
+			{
+				ew::bindUniformBlocks(shader);
+			}
+			int frameUploadsBefore = blocks.frame.getUploads();
+			int materialUploadsBefore = blocks.material.getUploads();
+			ew::SandMaterial material;
+			double start = nowMs();
+			for (int frame = 0; frame < frames; frame++)
+			{
+				glm::vec3 eye(cosf(frame * 0.01f) * 20.0f, 10.0f, sinf(frame * 0.01f) * 20.0f);
+				blocks.setFrame(glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)), glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 1000.0f));
+				if (frame == frames / 3 || frame == frames * 2 / 3) {
+					material.ambientK += 0.1f;
+				}
+				blocks.material.set(material);
+				blocks.material.upload();
+			}
+			double ms = nowMs() - start;
+			int frameUploads = blocks.frame.getUploads() - frameUploadsBefore;
+			int materialUploads = blocks.material.getUploads() - materialUploadsBefore;
+			ok = ok && frameUploads == frames && materialUploads == 2;
+			printf("%d frames: %d frame block uploads, %d material uploads, %.4f ms a frame\n", frames, frameUploads, materialUploads, ms / frames);
+			//setSandUniforms set 17 values and 10 samplers per program, plus uView and uProjection
+			printf("glUniform calls a frame for camera, light, material and samplers: 3 programs x 29 before, 0 now\n");
+
+			//every program sees the same buffers
+			int bound = 0;
+			glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, ew::FRAME_BINDING, &bound);
+			ok = ok && bound != 0 && glGetError() == GL_NO_ERROR;
+		}
+		destroyHiddenContext(window);
+		return ok ? 0 : 1;
+	}
+
+	struct Benchmark
+	{
+		const char* name;
+		int (*run)(int argc, char** argv);
+		const char* usage;
+	};
+
+	const Benchmark BENCHMARKS[] = {
+		{ "terrain", benchTerrain, "[subDivisions=2048] [type=0]" },
+		{ "terrain-mt", benchTerrainThreads, "[subDivisions=2048] [threads=hardware] [type=0]" },
+		{ "dune-simd", benchDuneSimd, "[subDivisions=2048]" },
+		{ "dune-dispatch", benchDuneDispatch, "[subDivisions=1024] [runs=3]" },
+		{ "chunks", benchChunks, "[frames=600] [speed=8]" },
+		{ "cdlod", benchCdlod, "[subDivisions=2048] [frames=200]" },
+		{ "indices", benchIndices, "[subDivisions=64] [chunks=81]" },
+		{ "rebuild", benchRebuild, "[frames=120] [subDivisions=1024]" },
+		{ "gpu-terrain", benchGpuTerrain, "[subDivisions=512] [type=0]" },
+		{ "mesh-cache", benchMeshCache, "[subDivisions=2048] [type=0] [layout=2]" },
+		{ "heightmap", benchHeightmap, "[size=1025] [threads=hardware]" },
+		{ "dune-sim", benchDuneSim, "[size=1024] [ticks=40] [threads=hardware] [type=1]" },
+		{ "ripple-textures", benchRippleTextures, "[runs=3] [threads=hardware]" },
+		{ "normal-bake", benchNormalBake, "[runs=3] [threads=hardware]" },
+		{ "terrain-query", benchTerrainQuery, "[subDivisions=2048] [rays=1048576] [threads=hardware] [type=0]" },
+		{ "rtin", benchRtin, "[subDivisions=256] [type=0] [runs=20]" },
+		{ "vertex-layouts", benchVertexLayouts, "[subDivisions=256] [runs=20]" },
+		{ "mesh-optimizer", benchMeshOptimizer, "[subDivisions=256] [cacheSize=16]" },
+		{ "culling", benchCulling, "[boxes=100000] [runs=200]" },
+		{ "array2d-layouts", benchArray2DLayouts, "[size=4096] [runs=3]" },
+		{ "array2d-ops", benchArray2DOps, "[size=4096] [threads=hardware] [runs=3]" },
+		{ "heightfield-mmap", benchHeightFieldFile, "[size=32768] [window=2048] [path=heightfield.ewhf]" },
+		{ "mesh-streaming", benchMeshStreaming, "[subDivisions=256] [frames=200]" },
+		{ "uniform-cache", benchUniformCache, "[frames=2000]" },
+		{ "uniform-blocks", benchUniformBlocks, "[frames=600]" },
+	};
+}
+
+int runBenchmark(int argc, char** argv)
+{
+	if (argc > 0)
+	{
+		for (const Benchmark& benchmark : BENCHMARKS)
+		{
+			if (strcmp(argv[0], benchmark.name) == 0)
+			{
+				return benchmark.run(argc - 1, argv + 1);
+			}
+		}
+	}
+
+	printf("Usage: assignment5 --bench <name> [args]\n");
+	for (const Benchmark& benchmark : BENCHMARKS)
+	{
+		printf("  %-12s %s\n", benchmark.name, benchmark.usage);
+	}
+	return 1;
+}
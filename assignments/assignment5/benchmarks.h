@@ -0,0 +1,4 @@
+#pragma once
+
+//Headless benchmarks, run with: assignment5 --bench <name> [args]
+int runBenchmark(int argc, char** argv);
@@ -4,11 +4,13 @@
 
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 
 #include <ew/external/glad.h>
 #include <ew/ewMath/ewMath.h>
 #include <ew/mesh.h>
 #include <ew/procGen.h>
+#include <ew/meshOptimizer.h>
 #include <ew/external/stb_image.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -20,10 +22,20 @@
 #include <imgui_impl_opengl3.h>
 
 #include "Shader/Shader.h"
+#include "Shader/uniformBlocks.h"
 #include "Texture/Texture.h"
+#include "Texture/rippleTextures.h"
 #include "Camera/Camera.h"
 #include "Terrain/terrain.h"
+#include "Terrain/terrainChunks.h"
+#include "Terrain/cdlod.h"
+#include "Terrain/gpuTerrain.h"
+#include "Terrain/terrainRebuilder.h"
+#include "Terrain/duneSimulation.h"
+#include "Terrain/terrainQuery.h"
+#include "Terrain/parallel.h"
 #include "Framebuffer.h"
+#include "benchmarks.h"
 
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
@@ -34,6 +46,8 @@ float lastX = 400, lastY = 300;
 
 const int SCREEN_WIDTH = 1080;
 const int SCREEN_HEIGHT = 720; 
+//how far above the sand the camera is kept
+const float CAMERA_CLEARANCE = 1.5f;
 
 glm::vec3 lightDirection(-0.3f, -1.0f, 2.0f);
 float ambientK = 0.6f;
@@ -70,9 +84,26 @@ float z = 0.0;
 bool day = false;
 bool night = false;
 bool tangent = false;
+bool infiniteDesert = false;
+bool cdlodTerrain = false;
+float lodDistanceScale = 3.0f;
+bool gpuTerrain = false;
+bool migratingDunes = false;
+bool stayAboveGround = true;
+float rippleScale = 1.0f;
+float rippleWander = 1.0f;
+bool editableTerrain = false;
+ew::TerrainParams terrainParams;
+bool frustumCulling = true;
+
+const int FRAME_TIME_COUNT = 120;
+float frameTimes[FRAME_TIME_COUNT] = {};
+int frameTimeOffset = 0;
 
 
 void processInput(GLFWwindow* window);
+void setSandSamplers(Shader& shader);
+ew::SandMaterial getSandMaterial();
 void mouseCallback(GLFWwindow* window, double xpos, double ypos);
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
@@ -114,7 +145,11 @@ int binarySearch(int low, int high, float target)
 //const int size = 10;
 
 
-int main() {
+int main(int argc, char** argv) {
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+		return runBenchmark(argc - 2, argv + 2);
+	}
+
 	printf("Initializing...\n");
 	if (!glfwInit()) {
 		printf("GLFW failed to init!");
@@ -130,6 +165,8 @@ int main() {
 		printf("GLAD Failed to load GL headers");
 		return 1;
 	}
+	//meshes delete their buffers when they go out of scope, so the context has to outlive every local declared after this
+	struct ContextGuard { ~ContextGuard() { glfwTerminate(); } } contextGuard;
 	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
 
@@ -154,6 +191,35 @@ int main() {
 	Shader normalShader("assets/shaderAssets/normalVisualization.vert", "assets/shaderAssets/normalVisualization.frag", "assets/shaderAssets/normalVisualization.geom");
 	Shader tangentShader("assets/shaderAssets/tangentVisualization.vert", "assets/shaderAssets/tangentVisualization.frag", "assets/shaderAssets/tangentVisualization.geom");
 	Shader lampShader("assets/shaderAssets/lampVShader.vert", "assets/shaderAssets/lampFShader.frag");
+	Shader cdlodShader("assets/shaderAssets/cdlodVShader.vert", "assets/shaderAssets/basicLightingFShader.frag");
+	Shader terrainPullShader("assets/shaderAssets/terrainPullVShader.vert", "assets/shaderAssets/basicLightingFShader.frag");
+
+	//set once per draw, so looked up here
+	UniformHandle sandModel = sandShader.getUniform("uModel");
+	UniformHandle cdlodModel = cdlodShader.getUniform("uModel");
+	UniformHandle pullModel = terrainPullShader.getUniform("uModel");
+	UniformHandle normalModel = normalShader.getUniform("model");
+	UniformHandle tangentModel = tangentShader.getUniform("model");
+	UniformHandle lampModel = lampShader.getUniform("model");
+	UniformHandle lampLightColor = lampShader.getUniform("uLightColor");
+
+	//camera and light in one buffer, the sand material in another, read by every program through their binding points
+	ew::UniformBlock<ew::FrameUniforms> frameBlock;
+	frameBlock.create(ew::FRAME_BINDING);
+	ew::UniformBlock<ew::SandMaterial> sandMaterialBlock;
+	sandMaterialBlock.create(ew::SAND_MATERIAL_BINDING);
+	Shader* blockShaders[] = { &sandShader, &normalShader, &tangentShader, &lampShader, &cdlodShader, &terrainPullShader };
+	for (Shader* shader : blockShaders)
+	{
+		ew::bindUniformBlocks(*shader);
+	}
+
+	//the texture units never change
+	Shader* sandShaders[] = { &sandShader, &cdlodShader, &terrainPullShader };
+	for (Shader* shader : sandShaders)
+	{
+		setSandSamplers(*shader);
+	}
 
 	//-----------------------------------------------------------------------------------------------
 
@@ -167,25 +233,92 @@ int main() {
 	ew::createPlaneXY(6.0f, 6.0f, 4.0f, &planeMeshData);
 	ew::createCube(6.0f, &cubeMeshData);
 	ew::createSphere(2.0f, 32, &sphereMeshData);
+	ew::optimizeMesh(&cubeMeshData);
+	ew::optimizeMesh(&sphereMeshData);
 
 	ew::Mesh planeMesh = ew::Mesh(planeMeshData);
 	ew::Mesh cubeMesh = ew::Mesh(cubeMeshData);
 	ew::Mesh sphereMesh = ew::Mesh(sphereMeshData);
 
-	Texture2D grainNormals("assets/NormalMaps/grain.jpg", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT, GL_RGB);
-	Texture2D shallowRipplesX("assets/NormalMaps/sandShallowX.jpg", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT, GL_RGB);
-	Texture2D steepRipplesX("assets/NormalMaps/sandSteepX.jpg", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT, GL_RGB);
-	Texture2D shallowRipplesZ("assets/NormalMaps/sandShallowZ.jpg", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT, GL_RGB);
-	Texture2D steepRipplesZ("assets/NormalMaps/sandSteepZ.jpg", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT, GL_RGB);
-
-	Texture2D grainHeight("assets/HeightMaps/grain.jpg", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT, GL_RGB);
-	Texture2D shallowRipplesXH("assets/HeightMaps/sandShallowX.jpg", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT, GL_RGB);
-	Texture2D steepRipplesXH("assets/HeightMaps/sandSteepX.jpg", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT, GL_RGB);
-	Texture2D shallowRipplesZH("assets/HeightMaps/sandShallowZ.jpg", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT, GL_RGB);
-	Texture2D steepRipplesZH("assets/HeightMaps/sandSteepZ.jpg", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT, GL_RGB);
+	ew::TerrainChunkManager desertChunks;
+
+	//large terrain drawn with CDLOD, one shared grid mesh for every node
+	const int lodSubDivisions = 1024;
+	const float lodTerrainSize = 256.0f;
+	glm::vec3 lodTerrainOrigin(-lodTerrainSize * 0.5f, -10.0f, lodTerrainSize * 0.5f);
+	Array2D<float> lodHeights;
+	ew::createHeightField(lodSubDivisions, 0, &lodHeights, ew::defaultThreadCount());
+	ew::CDLODTerrain lodTerrain;
+	lodTerrain.init(lodTerrainSize, lodTerrainSize, lodSubDivisions, lodHeights);
+
+	//terrain with no vertex buffer, rebuilt from an R16 height texture in the vertex shader
+	const int pullSubDivisions = 512;
+	const float pullTerrainSize = 64.0f;
+	glm::vec3 pullTerrainOrigin(-pullTerrainSize * 0.5f, -12.0f, -20.0f);
+	Array2D<float> pullHeights;
+	ew::createHeightField(pullSubDivisions, 1, &pullHeights, ew::defaultThreadCount());
+	ew::GpuTerrain pullTerrain;
+	pullTerrain.init(pullTerrainSize, pullTerrainSize, pullSubDivisions, pullHeights);
+
+	//height and ray queries over the CDLOD and GPU terrains
+	ew::TerrainQuery lodQuery;
+	lodQuery.init(lodTerrainSize, lodTerrainSize, lodSubDivisions, lodHeights, ew::defaultThreadCount());
+	ew::TerrainQuery pullQuery;
+	pullQuery.init(pullTerrainSize, pullTerrainSize, pullSubDivisions, pullHeights, ew::defaultThreadCount());
+
+	//sand transport over the GPU terrain's heights, ticking at a fixed rate on its own thread
+	const float duneTicksPerSecond = 20.0f;
+	ew::DuneSimulationSettings duneSettings;
+	ew::DuneSimulationRunner duneSimulation;
+	Array2D<float> simulatedHeights;
+
+	//terrain rebuilt in the background whenever its sliders change. The first terrain is cached on disk, later runs map it
+	ew::TerrainRebuilder terrainRebuilder;
+	terrainRebuilder.setCacheDirectory("terrainCache");
+	ew::TerrainParams requestedTerrain;
+	bool terrainRequested = false;
+
+	//ripple and grain maps are generated rather than decoded from JPGs, and regenerated when their sliders move
+	const char* rippleNames[4] = { "sandShallowX", "sandSteepX", "sandShallowZ", "sandSteepZ" };
+	ew::SandTexture rippleMaps[4];
+	ew::SandTexture grainMap;
+	auto generateRippleMaps = [&]() {
+		for (int i = 0; i < 4; i++)
+		{
+			ew::RippleSettings settings = ew::getRippleSettings(i % 2 == 1, i < 2 ? ew::RippleAxis::X : ew::RippleAxis::Z);
+			settings.wavelength *= rippleScale;
+			settings.noise *= rippleWander;
+			ew::generateRipples(settings, &rippleMaps[i], ew::defaultThreadCount());
+		}
+	};
+	generateRippleMaps();
+	ew::generateGrain(ew::GrainSettings(), &grainMap, ew::defaultThreadCount());
+
+	Texture2D grainNormals(grainMap.size, grainMap.size, GL_RGB, grainMap.normals.data(), GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT);
+	Texture2D shallowRipplesX(rippleMaps[0].size, rippleMaps[0].size, GL_RGB, rippleMaps[0].normals.data(), GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT);
+	Texture2D steepRipplesX(rippleMaps[1].size, rippleMaps[1].size, GL_RGB, rippleMaps[1].normals.data(), GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT);
+	Texture2D shallowRipplesZ(rippleMaps[2].size, rippleMaps[2].size, GL_RGB, rippleMaps[2].normals.data(), GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT);
+	Texture2D steepRipplesZ(rippleMaps[3].size, rippleMaps[3].size, GL_RGB, rippleMaps[3].normals.data(), GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT);
+
+	Texture2D grainHeight(grainMap.size, grainMap.size, GL_RED, grainMap.heights.data(), GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT);
+	Texture2D shallowRipplesXH(rippleMaps[0].size, rippleMaps[0].size, GL_RED, rippleMaps[0].heights.data(), GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT);
+	Texture2D steepRipplesXH(rippleMaps[1].size, rippleMaps[1].size, GL_RED, rippleMaps[1].heights.data(), GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT);
+	Texture2D shallowRipplesZH(rippleMaps[2].size, rippleMaps[2].size, GL_RED, rippleMaps[2].heights.data(), GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT);
+	Texture2D steepRipplesZH(rippleMaps[3].size, rippleMaps[3].size, GL_RED, rippleMaps[3].heights.data(), GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT);
+	Texture2D* rippleNormalTextures[4] = { &shallowRipplesX, &steepRipplesX, &shallowRipplesZ, &steepRipplesZ };
+	Texture2D* rippleHeightTextures[4] = { &shallowRipplesXH, &steepRipplesXH, &shallowRipplesZH, &steepRipplesZH };
 
 	float rotationTime = 0;
 
+	//world space boxes of this frame's meshes, culled in one pass before drawing
+	ew::CullList cullList;
+	std::vector<unsigned char> visibleBoxes;
+	ew::CullStats cullStats;
+
+	//should stay 0 once every program is linked
+	unsigned int uniformLocationCalls = Shader::getUniformLocationCalls();
+	unsigned int uniformLocationCallsLastFrame = 0;
+
 	/*Framebuffer depth;
 	depth.init(256, 256, false, 1);
 	depth.checkStatus();*/
@@ -197,9 +330,62 @@ int main() {
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
+		frameTimes[frameTimeOffset] = deltaTime * 1000.0f;
+		frameTimeOffset = (frameTimeOffset + 1) % FRAME_TIME_COUNT;
+		uniformLocationCallsLastFrame = Shader::getUniformLocationCalls() - uniformLocationCalls;
+		uniformLocationCalls = Shader::getUniformLocationCalls();
+
 		//input
 		processInput(window);
 
+		//keep the camera out of the terrains being drawn, and find what it looks at
+		const ew::TerrainQuery* shownQueries[2] = { cdlodTerrain ? &lodQuery : nullptr, gpuTerrain ? &pullQuery : nullptr };
+		const glm::vec3 shownOrigins[2] = { lodTerrainOrigin, pullTerrainOrigin };
+		ew::TerrainHit lookHit;
+		for (int i = 0; i < 2; i++)
+		{
+			if (!shownQueries[i]) {
+				continue;
+			}
+			glm::vec3 local = cam.mPosition - shownOrigins[i];
+			if (stayAboveGround && shownQueries[i]->contains(local.x, local.z)) {
+				float ground = shownQueries[i]->getHeight(local.x, local.z) + CAMERA_CLEARANCE;
+				if (local.y < ground) {
+					cam.mPosition.y += ground - local.y;
+					local.y = ground;
+				}
+			}
+			ew::TerrainHit hit;
+			if (shownQueries[i]->rayCast(local, cam.mFront, 1000.0f, &hit) && (!lookHit.hit || hit.distance < lookHit.distance)) {
+				lookHit = hit;
+				lookHit.position += shownOrigins[i];
+			}
+		}
+
+		//swap in a finished terrain build before anything is drawn
+		if (editableTerrain && (!terrainRequested || terrainParams != requestedTerrain))
+		{
+			terrainRebuilder.request(terrainParams, !terrainRequested);
+			requestedTerrain = terrainParams;
+			terrainRequested = true;
+		}
+		terrainRebuilder.update();
+		if (migratingDunes != duneSimulation.isRunning())
+		{
+			//restarts from the generated dunes
+			if (migratingDunes) {
+				duneSimulation.start(pullHeights, duneSettings, duneTicksPerSecond);
+			}
+			else {
+				duneSimulation.stop();
+			}
+		}
+		if (duneSimulation.takeHeights(&simulatedHeights))
+		{
+			pullTerrain.updateHeights(simulatedHeights);
+			pullQuery.updateHeights(simulatedHeights);
+		}
+
 		//glBindFramebuffer(GL_FRAMEBUFFER, depth.getFbo());
 
 		//Clear framebuffer
@@ -267,37 +453,6 @@ int main() {
 			specularColor = nightSpecularColor;
 		}
 
-		//update uniforms
-		sandShader.setVec3("uLightDirection", lightDirection);
-		sandShader.setVec3("uViewPos", cam.getPos());
-		sandShader.setVec3("uLightColor", lightColor);
-		sandShader.setVec3("uColorSun", litColor);
-		sandShader.setVec3("uColorShade", shadeColor);
-		sandShader.setVec3("uSpecColor", specularColor);
-		sandShader.setFloat("uAmbientK", ambientK);
-		sandShader.setFloat("uDiffuseK", diffuseK);
-		sandShader.setFloat("uOceanSpecularK", oceanSpecularK);
-		sandShader.setFloat ("uOceanShininess", oceanShininess);
-		sandShader.setFloat("uGrainSpecularK", grainSpecularK);
-		sandShader.setFloat("uGrainShininess", grainShininess);
-		sandShader.setFloat("uGrainSize", grainSize);
-		sandShader.setFloat("uRimStrength", rimStrength);
-		sandShader.setFloat("uRimPower", rimPower);
-		sandShader.setFloat("uSteepnessStrength", rippleStrength);
-		sandShader.setFloat("uHeightScale", heightScale);
-
-		sandShader.setInt("uNormalMap", 0);
-		sandShader.setInt("uShallowX", 1);
-		sandShader.setInt("uSteepX", 2);
-		sandShader.setInt("uShallowZ", 3);
-		sandShader.setInt("uSteepZ", 4);
-
-		sandShader.setInt("uHeightMap", 5);
-		sandShader.setInt("uShallowXH", 6);
-		sandShader.setInt("uSteepXH", 7);
-		sandShader.setInt("uShallowZH", 8);
-		sandShader.setInt("uSteepZH", 9);
-
 		grainNormals.Texture2D::bind(0);
 		shallowRipplesX.Texture2D::bind(1);
 		steepRipplesX.Texture2D::bind(2);
@@ -316,9 +471,18 @@ int main() {
 		int width, height;
 		glfwGetWindowSize(window, &width, &height);
 		glm::mat4 projection = glm::perspective(glm::radians(cam.mZoom), (float)width / (float)height, 0.1f, 1000.0f);
-		sandShader.setMat4("uProjection", projection);
 		glm::mat4 view = cam.getViewMatrix();
-		sandShader.setMat4("uView", view);
+
+		//uploaded only when something changed: the material only when the settings are edited
+		ew::FrameUniforms frameUniforms;
+		frameUniforms.view = view;
+		frameUniforms.projection = projection;
+		frameUniforms.viewPos = cam.getPos();
+		frameUniforms.lightDirection = lightDirection;
+		frameBlock.set(frameUniforms);
+		frameBlock.upload();
+		sandMaterialBlock.set(getSandMaterial());
+		sandMaterialBlock.upload();
 
 		//draw plane and sphere
 		glm::mat4 planeTransform = glm::mat4(1);
@@ -331,40 +495,111 @@ int main() {
 
 		sphereTransform = glm::translate(sphereTransform, glm::vec3(5.0, 0.0, 0.0));
 
-		sandShader.setMat4("uModel", planeTransform);
-		planeMesh.draw(drawMode);
+		const ew::TerrainParams& shownTerrain = terrainRebuilder.getParams();
+		glm::mat4 terrainTransform = glm::translate(glm::mat4(1), glm::vec3(-shownTerrain.width * 0.5f, -8.0f, shownTerrain.height * 0.5f));
+
+		glm::mat4 lampTransform = glm::mat4(1.0f);
+		lampTransform = glm::translate(lampTransform, lightDirection);
+		lampTransform = glm::scale(lampTransform, glm::vec3(0.2f));
+
+		//endless desert streamed in around the camera
+		if (infiniteDesert)
+		{
+			desertChunks.update(cam.getPos());
+		}
+
+		//one box per draw below, in draw order
+		cullList.clear();
+		int planeBox = cullList.add(ew::transformBounds(planeMesh.getBounds(), planeTransform));
+		int terrainBox = -1;
+		if (editableTerrain && terrainRebuilder.hasMesh())
+		{
+			terrainBox = cullList.add(ew::transformBounds(terrainRebuilder.getBounds(), terrainTransform));
+		}
+		int lampBox = cullList.add(ew::transformBounds(cubeMesh.getBounds(), lampTransform));
+		int firstChunkBox = cullList.size();
+		if (infiniteDesert)
+		{
+			for (const ew::TerrainChunk* chunk : desertChunks.getResidentChunks())
+			{
+				cullList.add(ew::transformBounds(chunk->mesh.getBounds(), glm::translate(glm::mat4(1), chunk->origin)));
+			}
+		}
+		if (frustumCulling)
+		{
+			cullStats = cullList.cull(cam.getFrustum(projection), &visibleBoxes);
+		}
+		else
+		{
+			visibleBoxes.assign(cullList.size(), 1);
+			cullStats.visible = cullList.size();
+			cullStats.culled = 0;
+		}
 
-		sandShader.setMat4("uModel", sphereTransform);
+		if (visibleBoxes[planeBox])
+		{
+			sandShader.setMat4(sandModel, planeTransform);
+			planeMesh.draw(drawMode);
+		}
+
+		sandShader.setMat4(sandModel, sphereTransform);
 		//sphereMesh.draw(drawMode);
 
-		if (tangent)
+		if (terrainBox >= 0 && visibleBoxes[terrainBox])
+		{
+			sandShader.setMat4(sandModel, terrainTransform);
+			terrainRebuilder.draw(drawMode);
+		}
+
+		if (infiniteDesert)
+		{
+			int chunkBox = firstChunkBox;
+			for (const ew::TerrainChunk* chunk : desertChunks.getResidentChunks())
+			{
+				if (visibleBoxes[chunkBox++])
+				{
+					sandShader.setMat4(sandModel, glm::translate(glm::mat4(1), chunk->origin));
+					chunk->mesh.draw(drawMode);
+				}
+			}
+		}
+
+		if (cdlodTerrain)
+		{
+			cdlodShader.Shader::use();
+			cdlodShader.setMat4(cdlodModel, glm::translate(glm::mat4(1), lodTerrainOrigin));
+			lodTerrain.getQuadtree().setLodDistanceScale(lodDistanceScale);
+			lodTerrain.draw(cdlodShader, cam.getPos() - lodTerrainOrigin, 10);
+		}
+
+		if (gpuTerrain)
+		{
+			terrainPullShader.Shader::use();
+			terrainPullShader.setMat4(pullModel, glm::translate(glm::mat4(1), pullTerrainOrigin));
+			pullTerrain.draw(terrainPullShader, 10, drawMode);
+		}
+
+		if (tangent && visibleBoxes[planeBox])
 		{
 			normalShader.Shader::use();
-			normalShader.setMat4("projection", projection);
-			normalShader.setMat4("view", view);
-			normalShader.setMat4("model", planeTransform);
+			normalShader.setMat4(normalModel, planeTransform);
 			planeMesh.draw(drawMode);
 
 			tangentShader.Shader::use();
-			tangentShader.setMat4("projection", projection);
-			tangentShader.setMat4("view", view);
-			tangentShader.setMat4("model", planeTransform);
+			tangentShader.setMat4(tangentModel, planeTransform);
 			planeMesh.draw(drawMode);
 		}
 
 
 		//light cube
 		lampShader.Shader::use();
-		lampShader.setVec3("uLightColor", lightColor);
-		lampShader.setMat4("projection", projection);
-		lampShader.setMat4("view", view);
+		lampShader.setVec3(lampLightColor, lightColor);
 
-		glm::mat4 model = glm::mat4(1.0f);
-		model = glm::translate(model, lightDirection);
-		model = glm::scale(model, glm::vec3(0.2f));
-		lampShader.setMat4("model", model);
-
-		cubeMesh.draw(drawMode);	
+		if (visibleBoxes[lampBox])
+		{
+			lampShader.setMat4(lampModel, lampTransform);
+			cubeMesh.draw(drawMode);
+		}
 
 		//draw imgui
 		ImGui_ImplGlfw_NewFrame();
@@ -373,6 +608,11 @@ int main() {
 
 		//imgui window
 		ImGui::Begin("Settings");
+		ImGui::PlotLines("Frame Time", frameTimes, FRAME_TIME_COUNT, frameTimeOffset, "ms", 0.0f, 50.0f, ImVec2(0, 60));
+		ImGui::Checkbox("Frustum Culling", &frustumCulling);
+		ImGui::Text("Meshes: %d visible, %d culled", cullStats.visible, cullStats.culled);
+		ImGui::Text("glGetUniformLocation calls: %u last frame", uniformLocationCallsLastFrame);
+		ImGui::Text("Uniform block uploads: %d frame, %d material", frameBlock.getUploads(), sandMaterialBlock.getUploads());
 		ImGui::DragFloat3("Light Position", &lightDirection.x, 0.1f);
 		ImGui::ColorEdit3("Light Color", &lightColor.r);
 		ImGui::ColorEdit3("Spec Color", &specularColor.r);
@@ -383,6 +623,27 @@ int main() {
 		ImGui::SliderFloat("Grain Specular K", &grainSpecularK, 0.0f, 1.0f);
 		ImGui::SliderFloat("Grain Shininess", &grainShininess, 2, 1024);
 		ImGui::SliderFloat("Grain Size", &grainSize, 1.0f, 10.0f);
+		bool ripplesChanged = ImGui::SliderFloat("Ripple Scale", &rippleScale, 0.5f, 2.0f);
+		ripplesChanged |= ImGui::SliderFloat("Ripple Wander", &rippleWander, 0.0f, 2.0f);
+		if (ripplesChanged)
+		{
+			generateRippleMaps();
+			for (int i = 0; i < 4; i++)
+			{
+				rippleNormalTextures[i]->update(rippleMaps[i].normals.data());
+				rippleHeightTextures[i]->update(rippleMaps[i].heights.data());
+			}
+		}
+		if (ImGui::Button("Write Ripple Maps"))
+		{
+			//next to the JPGs they replace, as PGM heights and PPM normals
+			for (int i = 0; i < 4; i++)
+			{
+				std::string name = rippleNames[i];
+				ew::writeSandTexture(rippleMaps[i], "assets/HeightMaps/" + name + ".pgm", "assets/NormalMaps/" + name + ".ppm");
+			}
+			ew::writeSandTexture(grainMap, "assets/HeightMaps/grain.pgm", "assets/NormalMaps/grain.ppm");
+		}
 		ImGui::SliderFloat("X", &x, -90.0f, 90.0f);
 		ImGui::SliderFloat("Y", &y, -90.0f, 90.0f);
 		ImGui::SliderFloat("Z", &z, -90.0f, 90.0f);
@@ -390,6 +651,67 @@ int main() {
 		ImGui::Checkbox("Day", &day);
 		ImGui::Checkbox("Night", &night);
 		ImGui::Checkbox("Tangent Space", &tangent);
+		ImGui::Checkbox("Infinite Desert", &infiniteDesert);
+		if (infiniteDesert)
+		{
+			const ew::TerrainChunkStats& chunkStats = desertChunks.getStats();
+			ImGui::Text("Resident chunks: %d (%.1f MB)", chunkStats.resident, chunkStats.residentBytes / (1024.0f * 1024.0f));
+			ImGui::Text("Pending: %d, ready: %d", chunkStats.pending, chunkStats.ready);
+			ImGui::Text("Uploaded: %d chunks, %.1f KB this frame", chunkStats.uploadedThisFrame, chunkStats.uploadBytesThisFrame / 1024.0f);
+		}
+		ImGui::Checkbox("Editable Terrain", &editableTerrain);
+		if (editableTerrain)
+		{
+			ew::TerrainRebuildStats rebuildStats = terrainRebuilder.getStats();
+			ImGui::SliderInt("Subdivisions", &terrainParams.subDivisions, 16, 512);
+			ImGui::SliderInt("Dune Type", &terrainParams.type, 0, 4);
+			ImGui::SliderFloat("Terrain Width", &terrainParams.width, 4.0f, 128.0f);
+			ImGui::SliderFloat("Terrain Height", &terrainParams.height, 4.0f, 128.0f);
+			//0 keeps the full grid
+			ImGui::SliderFloat("Max Error", &terrainParams.maxError, 0.0f, 1.0f);
+			const char* vertexLayouts[] = { "Float (44 bytes)", "Half (20 bytes)", "Quantized (20 bytes)" };
+			int vertexLayout = (int)terrainParams.vertexLayout;
+			if (ImGui::Combo("Vertex Layout", &vertexLayout, vertexLayouts, 3))
+			{
+				terrainParams.vertexLayout = (ew::VertexLayout)vertexLayout;
+			}
+			ImGui::Text("Built %d of %d requests, %d dropped%s", rebuildStats.built, rebuildStats.requested, rebuildStats.dropped, terrainRebuilder.isBusy() ? ", building" : "");
+			ImGui::Text("Build %.1f ms (worker), upload %.1f ms over %d frames, %d from cache", rebuildStats.lastBuildMs, rebuildStats.lastUploadMs, rebuildStats.lastUploadFrames,
+				rebuildStats.cacheHits);
+			ImGui::Text("%d triangles", rebuildStats.lastTriangles);
+			if (terrainParams.maxError > 0.0f)
+			{
+				const ew::MeshOptimizeStats& vertexCache = rebuildStats.lastVertexCache;
+				ImGui::Text("ACMR %.2f -> %.2f, ATVR %.2f -> %.2f", vertexCache.before.acmr, vertexCache.after.acmr, vertexCache.before.atvr, vertexCache.after.atvr);
+			}
+		}
+		ImGui::Checkbox("CDLOD Terrain", &cdlodTerrain);
+		if (cdlodTerrain)
+		{
+			const ew::CDLODStats& lodStats = lodTerrain.getStats();
+			ImGui::SliderFloat("LOD Distance", &lodDistanceScale, 1.5f, 8.0f);
+			ImGui::Text("Triangles: %d (full grid %d)", lodStats.triangles, lodStats.fullGridTriangles);
+			ImGui::Text("Nodes: %d, levels: %d", lodStats.nodes, lodStats.levels);
+		}
+		ImGui::Checkbox("GPU Terrain", &gpuTerrain);
+		if (gpuTerrain)
+		{
+			ImGui::Text("Height texture: %.2f MB (vertices would be %.2f MB)", pullTerrain.getGpuBytes() / (1024.0f * 1024.0f), pullTerrain.getNumVertices() * sizeof(ew::Vertex) / (1024.0f * 1024.0f));
+			ImGui::Checkbox("Migrating Dunes", &migratingDunes);
+			if (migratingDunes)
+			{
+				ew::DuneSimulationStats duneStats = duneSimulation.getStats();
+				ImGui::Text("Tick %llu at %.0f/s, %.1f ms, %d slabs moved", (unsigned long long)duneStats.ticks, duneTicksPerSecond, duneStats.lastTickMs, duneStats.lastSlabsMoved);
+				ImGui::Text("Ticks dropped: %d", duneStats.droppedTicks);
+			}
+		}
+		if (cdlodTerrain || gpuTerrain)
+		{
+			ImGui::Checkbox("Stay Above Ground", &stayAboveGround);
+			if (lookHit.hit) {
+				ImGui::Text("Looking at (%.1f, %.1f, %.1f), %.1f away", lookHit.position.x, lookHit.position.y, lookHit.position.z, lookHit.distance);
+			}
+		}
 		ImGui::End();
 
 		//render imgui
@@ -401,11 +723,46 @@ int main() {
 		glfwSwapBuffers(window);
 	}
 
-	glfwTerminate();
-
 	printf("Shutting down...");
 }
 
+ew::SandMaterial getSandMaterial()
+{
+	ew::SandMaterial material;
+	material.lightColor = lightColor;
+	material.colorSun = litColor;
+	material.colorShade = shadeColor;
+	material.specColor = specularColor;
+	material.ambientK = ambientK;
+	material.diffuseK = diffuseK;
+	material.oceanSpecularK = oceanSpecularK;
+	material.oceanShininess = oceanShininess;
+	material.grainSpecularK = grainSpecularK;
+	material.grainShininess = grainShininess;
+	material.grainSize = grainSize;
+	material.rimStrength = rimStrength;
+	material.rimPower = rimPower;
+	material.steepnessStrength = rippleStrength;
+	material.heightScale = heightScale;
+	return material;
+}
+
+void setSandSamplers(Shader& shader)
+{
+	shader.use();
+	shader.setInt("uNormalMap", 0);
+	shader.setInt("uShallowX", 1);
+	shader.setInt("uSteepX", 2);
+	shader.setInt("uShallowZ", 3);
+	shader.setInt("uSteepZ", 4);
+
+	shader.setInt("uHeightMap", 5);
+	shader.setInt("uShallowXH", 6);
+	shader.setInt("uSteepXH", 7);
+	shader.setInt("uShallowZH", 8);
+	shader.setInt("uSteepZH", 9);
+}
+
 void processInput(GLFWwindow* window)
 {
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
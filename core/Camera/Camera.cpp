@@ -41,6 +41,12 @@ glm::mat4 Camera::getViewMatrix()
 	return lookAt(mPosition, mPosition + mFront, mUp);
 }
 
+//world space frustum of this camera's view with the given projection
+ew::Frustum Camera::getFrustum(const glm::mat4& projection)
+{
+	return ew::extractFrustum(projection * getViewMatrix());
+}
+
 void Camera::keyboardInput(CameraMovement direction, float deltaTime, bool sprit)
 {
 	float velocity = mMovementSpeed * deltaTime;
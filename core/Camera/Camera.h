@@ -5,6 +5,7 @@
 #define CAMERA_H
 
 #include "..\ew\external\glad.h"
+#include "../ew/culling.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -45,6 +46,7 @@ public:
 
 	glm::vec3 getPos();
 	glm::mat4 getViewMatrix();
+	ew::Frustum getFrustum(const glm::mat4& projection);
 	void keyboardInput(CameraMovement direction, float deltaTime, bool sprint = false);
 	void mouseMoveInput(float xOffset, float yOffset, GLboolean constrainPitch = true);
 	void mouseWheelInput(float yOffset);
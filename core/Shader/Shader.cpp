@@ -3,6 +3,29 @@
 */
 #include "Shader.h"
 
+namespace
+{
+	//every glGetUniformLocation a Shader has made, which should stop growing once the programs are linked
+	unsigned int uniformLocationCalls = 0;
+
+	int queryUniformLocation(unsigned int program, const std::string& name)
+	{
+		uniformLocationCalls++;
+		return glGetUniformLocation(program, name.c_str());
+	}
+
+	//FNV-1a
+	unsigned int hashName(const std::string& name)
+	{
+		unsigned int hash = 2166136261u;
+		for (char c : name)
+		{
+			hash = (hash ^ (unsigned char)c) * 16777619u;
+		}
+		return hash;
+	}
+}
+
 Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath)
 {
 	//get shader code from file path
@@ -115,6 +138,126 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geo
 	{
 		glDeleteShader(geometry);
 	}	
+
+	cacheUniforms();
+}
+
+/// <summary>
+/// Looks up every active uniform once, so the set functions never have to ask GL
+/// </summary>
+void Shader::cacheUniforms()
+{
+	int count = 0, maxLength = 0;
+	glGetProgramiv(mId, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(mId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::vector<std::pair<std::string, int>> uniforms;
+	std::vector<char> buffer(maxLength + 1);
+	for (int i = 0; i < count; i++)
+	{
+		int length = 0, size = 0;
+		GLenum type;
+		glGetActiveUniform(mId, i, (int)buffer.size(), &length, &size, &type, buffer.data());
+		std::string name(buffer.data(), length);
+		//members of uniform blocks have no location
+		int location = queryUniformLocation(mId, name);
+		if (location < 0)
+		{
+			continue;
+		}
+		uniforms.push_back({ name, location });
+
+		//arrays are listed once, as name[0]. GL also takes the bare name, and every element has its own location
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+		{
+			std::string base = name.substr(0, name.size() - 3);
+			uniforms.push_back({ base, location });
+			for (int element = 1; element < size; element++)
+			{
+				std::string elementName = base + "[" + std::to_string(element) + "]";
+				uniforms.push_back({ elementName, queryUniformLocation(mId, elementName) });
+			}
+		}
+	}
+
+	//at most half full, so probes stay short
+	size_t capacity = 16;
+	while (capacity < uniforms.size() * 2)
+	{
+		capacity *= 2;
+	}
+	mUniformSlots.assign(capacity, UniformSlot());
+	mNumUniforms = 0;
+	for (const std::pair<std::string, int>& uniform : uniforms)
+	{
+		addUniform(uniform.first, uniform.second);
+	}
+}
+
+void Shader::addUniform(const std::string& name, int location)
+{
+	unsigned int hash = hashName(name);
+	size_t mask = mUniformSlots.size() - 1;
+	for (size_t i = hash & mask; ; i = (i + 1) & mask)
+	{
+		UniformSlot& slot = mUniformSlots[i];
+		if (slot.name.empty())
+		{
+			slot.hash = hash;
+			slot.location = location;
+			slot.name = name;
+			mNumUniforms++;
+			return;
+		}
+		if (slot.hash == hash && slot.name == name)
+		{
+			return;
+		}
+	}
+}
+
+/// <summary>
+/// Handle for a uniform, to look up once and pass to the set functions. Unused names give location -1
+/// </summary>
+UniformHandle Shader::getUniform(const std::string& name) const
+{
+	UniformHandle uniform;
+	if (mUniformSlots.empty())
+	{
+		return uniform;
+	}
+	unsigned int hash = hashName(name);
+	size_t mask = mUniformSlots.size() - 1;
+	for (size_t i = hash & mask; !mUniformSlots[i].name.empty(); i = (i + 1) & mask)
+	{
+		const UniformSlot& slot = mUniformSlots[i];
+		if (slot.hash == hash && slot.name == name)
+		{
+			uniform.location = slot.location;
+			break;
+		}
+	}
+	return uniform;
+}
+
+unsigned int Shader::getUniformLocationCalls()
+{
+	return uniformLocationCalls;
+}
+
+/// <summary>
+/// Makes a uniform block of this program read the buffer at bindingPoint. GLSL 330 cannot say so in the shader
+/// </summary>
+/// <returns>False if the program has no active block of that name</returns>
+bool Shader::bindUniformBlock(const std::string& blockName, unsigned int bindingPoint) const
+{
+	unsigned int index = glGetUniformBlockIndex(mId, blockName.c_str());
+	if (index == GL_INVALID_INDEX)
+	{
+		return false;
+	}
+	glUniformBlockBinding(mId, index, bindingPoint);
+	return true;
 }
 
 void Shader::use()
@@ -127,33 +270,81 @@ unsigned int Shader::getProgram()
 	return mId;
 }
 
+/// <summary>
+/// Links again after changing how the program links, e.g. glTransformFeedbackVaryings. Locations and block bindings start over
+/// </summary>
+void Shader::relink()
+{
+	glLinkProgram(mId);
+	cacheUniforms();
+}
+
 void Shader::setBool(const std::string& name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(mId, name.c_str()), (int)value);
+	setBool(getUniform(name), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const
 {
-	glUniform1f(glGetUniformLocation(mId, name.c_str()), value);
+	setFloat(getUniform(name), value);
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
-	glUniform1i(glGetUniformLocation(mId, name.c_str()), value);
+	setInt(getUniform(name), value);
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(mId, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	setMat4(getUniform(name), mat);
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& vec) const
 {
-	glUniform3fv(glGetUniformLocation(mId, name.c_str()), 1, &vec[0]);
+	setVec3(getUniform(name), vec);
 }
 
+void Shader::setVec2(const std::string& name, const glm::vec2& vec) const
+{
+	setVec2(getUniform(name), vec);
+}
 
+void Shader::setVec4(const std::string& name, const glm::vec4& vec) const
+{
+	setVec4(getUniform(name), vec);
+}
 
+void Shader::setBool(UniformHandle uniform, bool value) const
+{
+	glUniform1i(uniform.location, (int)value);
+}
 
+void Shader::setFloat(UniformHandle uniform, float value) const
+{
+	glUniform1f(uniform.location, value);
+}
 
+void Shader::setInt(UniformHandle uniform, int value) const
+{
+	glUniform1i(uniform.location, value);
+}
 
+void Shader::setMat4(UniformHandle uniform, const glm::mat4& mat) const
+{
+	glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::setVec3(UniformHandle uniform, const glm::vec3& vec) const
+{
+	glUniform3fv(uniform.location, 1, &vec[0]);
+}
+
+void Shader::setVec2(UniformHandle uniform, const glm::vec2& vec) const
+{
+	glUniform2fv(uniform.location, 1, &vec[0]);
+}
+
+void Shader::setVec4(UniformHandle uniform, const glm::vec4& vec) const
+{
+	glUniform4fv(uniform.location, 1, &vec[0]);
+}
\ No newline at end of file
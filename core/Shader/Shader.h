@@ -11,6 +11,15 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+
+	/// <summary>
+	/// A uniform looked up ahead of time. Location -1 is a name the program does not use, which the set functions ignore like GL does
+	/// </summary>
+	struct UniformHandle
+	{
+		int location = -1;
+	};
 
 	class Shader
 	{
@@ -21,14 +30,43 @@
 
 		void use();
 		unsigned int getProgram();
+		void relink();
+
+		UniformHandle getUniform(const std::string& name) const;
+		inline int getNumUniforms() const { return mNumUniforms; }
+		static unsigned int getUniformLocationCalls();
+		bool bindUniformBlock(const std::string& blockName, unsigned int bindingPoint) const;
 
 		void setBool(const std::string &name, bool value) const;
 		void setFloat(const std::string &name, float value) const;
 		void setInt(const std::string &name, int value) const;
 		void setMat4(const std::string& name, const glm::mat4& mat) const;
 		void setVec3(const std::string& name, const glm::vec3& vec) const; 
-		
+		void setVec2(const std::string& name, const glm::vec2& vec) const;
+		void setVec4(const std::string& name, const glm::vec4& vec) const;
+
+		//for hot paths: no string is hashed
+		void setBool(UniformHandle uniform, bool value) const;
+		void setFloat(UniformHandle uniform, float value) const;
+		void setInt(UniformHandle uniform, int value) const;
+		void setMat4(UniformHandle uniform, const glm::mat4& mat) const;
+		void setVec3(UniformHandle uniform, const glm::vec3& vec) const;
+		void setVec2(UniformHandle uniform, const glm::vec2& vec) const;
+		void setVec4(UniformHandle uniform, const glm::vec4& vec) const;
+
+	private:
+		struct UniformSlot
+		{
+			unsigned int hash = 0;
+			int location = -1;
+			std::string name; //empty for free slots
+		};
+
+		void cacheUniforms();
+		void addUniform(const std::string& name, int location);
 
+		std::vector<UniformSlot> mUniformSlots; //open addressing, a power of two long
+		int mNumUniforms = 0;
 	};
 
 #endif
\ No newline at end of file
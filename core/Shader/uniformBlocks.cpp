@@ -0,0 +1,27 @@
+#include "uniformBlocks.h"
+#include "../ew/external/glad.h"
+
+namespace ew {
+	void UniformBuffer::create(unsigned int bindingPoint, size_t size) {
+		m_bindingPoint = bindingPoint;
+		glGenBuffers(1, &m_ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+		glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, m_ubo);
+	}
+
+	void UniformBuffer::upload(const void* data, size_t size) {
+		glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	/// <summary>
+	/// Points the program's FrameBlock and SandMaterialBlock at their binding points. Blocks the program does not declare are skipped
+	/// </summary>
+	void bindUniformBlocks(const Shader& shader) {
+		shader.bindUniformBlock("FrameBlock", FRAME_BINDING);
+		shader.bindUniformBlock("SandMaterialBlock", SAND_MATERIAL_BINDING);
+	}
+}
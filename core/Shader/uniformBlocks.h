@@ -0,0 +1,109 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+#pragma once
+#include "Shader.h"
+#include <glm/glm.hpp>
+#include <string.h>
+
+namespace ew {
+	//Fixed binding points, so every program that declares a block reads the same buffer
+	enum UniformBinding : unsigned int {
+		FRAME_BINDING = 0,
+		SAND_MATERIAL_BINDING = 1
+	};
+
+	/// <summary>
+	/// FrameBlock in the shaders, std140. Changes every frame the camera moves
+	/// </summary>
+	struct FrameUniforms {
+		glm::mat4 view = glm::mat4(1.0f);
+		glm::mat4 projection = glm::mat4(1.0f);
+		glm::vec3 viewPos = glm::vec3(0.0f);
+		float pad0 = 0.0f;
+		glm::vec3 lightDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+		float pad1 = 0.0f;
+	};
+
+	/// <summary>
+	/// SandMaterialBlock in basicLightingFShader.frag, std140: each float fills the fourth component of the vec3 before it
+	/// </summary>
+	struct SandMaterial {
+		glm::vec3 lightColor = glm::vec3(1.0f);
+		float ambientK = 0.0f;
+		glm::vec3 colorShade = glm::vec3(0.0f);
+		float diffuseK = 0.0f;
+		glm::vec3 colorSun = glm::vec3(0.0f);
+		float oceanSpecularK = 0.0f;
+		glm::vec3 specColor = glm::vec3(0.0f);
+		float oceanShininess = 1.0f;
+		float grainSpecularK = 0.0f;
+		float grainShininess = 1.0f;
+		float grainSize = 1.0f;
+		float rimStrength = 0.0f;
+		float rimPower = 1.0f;
+		float steepnessStrength = 0.0f;
+		float heightScale = 0.1f;
+		float pad0 = 0.0f;
+	};
+
+	static_assert(sizeof(FrameUniforms) == 160, "FrameUniforms must match the std140 layout of FrameBlock");
+	static_assert(sizeof(SandMaterial) == 96, "SandMaterial must match the std140 layout of SandMaterialBlock");
+
+	/// <summary>
+	/// A uniform buffer bound to one binding point for good
+	/// </summary>
+	class UniformBuffer {
+	public:
+		void create(unsigned int bindingPoint, size_t size);
+		void upload(const void* data, size_t size);
+		inline unsigned int getBuffer() const { return m_ubo; }
+		inline unsigned int getBindingPoint() const { return m_bindingPoint; }
+	private:
+		unsigned int m_ubo = 0;
+		unsigned int m_bindingPoint = 0;
+	};
+
+	/// <summary>
+	/// CPU copy of a uniform block that reaches the GPU only when it has changed. Set it every frame and call upload before drawing
+	/// </summary>
+	template<typename Block>
+	class UniformBlock {
+	public:
+		inline void create(unsigned int bindingPoint) {
+			m_buffer.create(bindingPoint, sizeof(Block));
+			m_dirty = true;
+		}
+		/// <summary>
+		/// Marks the block dirty only if block differs from what it holds
+		/// </summary>
+		inline void set(const Block& block) {
+			if (memcmp(&block, &m_block, sizeof(Block)) != 0) {
+				m_block = block;
+				m_dirty = true;
+			}
+		}
+		/// <returns>Whether anything was uploaded</returns>
+		inline bool upload() {
+			if (!m_dirty) {
+				return false;
+			}
+			m_buffer.upload(&m_block, sizeof(Block));
+			m_dirty = false;
+			m_uploads++;
+			return true;
+		}
+		inline const Block& get() const { return m_block; }
+		inline bool isDirty() const { return m_dirty; }
+		inline int getUploads() const { return m_uploads; }
+		inline unsigned int getBindingPoint() const { return m_buffer.getBindingPoint(); }
+	private:
+		Block m_block;
+		UniformBuffer m_buffer;
+		bool m_dirty = true;
+		int m_uploads = 0;
+	};
+
+	void bindUniformBlocks(const Shader& shader);
+}
+
+#endif // UNIFORM_BLOCKS_H
@@ -22,11 +22,80 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <new>
+#include <utility>
 #ifndef _WIN32
 #include <unistd.h>
+#else
+#include <malloc.h>
 #endif
 
-template<typename Type>
+// Rows stored one after another, each padded to a whole number of cache lines so every row starts 64 byte aligned.
+// GetAddr(0, Row) is a plain pointer to the row
+struct RowMajorLayout {
+    static const bool CONTIGUOUS_ROWS = true;
+
+    static int Pitch(int Cols, size_t TypeSize)
+    {
+        if (64 % TypeSize != 0) {
+            return Cols;
+        }
+        int PerLine = (int)(64 / TypeSize);
+        return (Cols + PerLine - 1) / PerLine * PerLine;
+    }
+
+    static size_t StorageSize(int Pitch, int Rows)
+    {
+        return (size_t)Pitch * Rows;
+    }
+
+    static size_t Index(int Col, int Row, int Pitch)
+    {
+        return (size_t)Row * Pitch + Col;
+    }
+};
+
+// Square tiles of 2^TileBits elements a side stored one after another, with the elements inside a tile in Morton (Z) order.
+// Neighbours above and below are usually in the same tile, which helps stencils that walk columns or large footprints.
+// Rows are not contiguous, so only the Get/At/Set accessors work
+template<int TileBits = 3>
+struct MortonLayout {
+    static_assert(TileBits >= 1 && TileBits <= 8, "tiles are 2 to 256 elements a side");
+
+    static const bool CONTIGUOUS_ROWS = false;
+    static const int TILE_BITS = TileBits;
+    static const int TILE = 1 << TileBits;
+
+    static int Pitch(int Cols, size_t)
+    {
+        return (Cols + TILE - 1) / TILE * TILE;
+    }
+
+    static size_t StorageSize(int Pitch, int Rows)
+    {
+        return (size_t)Pitch * ((Rows + TILE - 1) / TILE * TILE);
+    }
+
+    static size_t Index(int Col, int Row, int Pitch)
+    {
+        size_t Tile = (size_t)(Row >> TileBits) * (Pitch >> TileBits) + (Col >> TileBits);
+        return (Tile << (2 * TileBits)) | Spread(Col & (TILE - 1)) | (Spread(Row & (TILE - 1)) << 1);
+    }
+
+private:
+    // 0b abcdefgh -> 0b 0a0b0c0d0e0f0g0h
+    static size_t Spread(int Bits)
+    {
+        size_t x = (size_t)Bits;
+        x = (x | (x << 4)) & 0x0F0F;
+        x = (x | (x << 2)) & 0x3333;
+        x = (x | (x << 1)) & 0x5555;
+        return x;
+    }
+};
+
+template<typename Type, typename Layout = RowMajorLayout>
 class Array2D {
 public:
     Array2D() {}
@@ -36,17 +105,41 @@ public:
         InitArray2D(Cols, Rows);
     }
 
+    // Deep copies have to be asked for with CopyFrom, so a grid can never end up freed twice
+    Array2D(const Array2D&) = delete;
+    Array2D& operator=(const Array2D&) = delete;
 
-    void InitArray2D(int Cols, int Rows)
+    Array2D(Array2D&& Other) noexcept
     {
-        m_cols = Cols;
-        m_rows = Rows;
+        Swap(Other);
+    }
 
-        if (m_p) {
-            free(m_p);
+    Array2D& operator=(Array2D&& Other) noexcept
+    {
+        if (this != &Other) {
+            Destroy();
+            Swap(Other);
+        }
+        return *this;
+    }
+
+
+    // Keeps the old allocation if it is already big enough
+    void InitArray2D(int Cols, int Rows)
+    {
+        int Pitch = Layout::Pitch(Cols, sizeof(Type));
+        size_t Storage = Layout::StorageSize(Pitch, Rows);
+
+        if (!m_p || m_mode != ALIGNED || Storage > m_storage) {
+            Destroy();
+            m_p = (Type*)AlignedAlloc(Storage * sizeof(Type));
+            m_storage = Storage;
+            m_mode = ALIGNED;
         }
 
-        m_p = (Type*)malloc(Cols * Rows * sizeof(Type));
+        m_cols = Cols;
+        m_rows = Rows;
+        m_pitch = Pitch;
     }
 
 
@@ -54,25 +147,53 @@ public:
     {
         InitArray2D(Cols, Rows);
 
-        for (int i = 0; i < Cols * Rows; i++) {
+        size_t Storage = GetStorageSize();
+        for (size_t i = 0; i < Storage; i++) {
             m_p[i] = InitVal;
         }
     }
 
 
+    // Takes ownership of Cols * Rows * sizeof(Type) bytes from malloc, rows packed one after another without padding
+    // (what stb_image returns). Freed with free(). Tiled layouts need their padded pitch, so they cannot adopt such a buffer
     void InitArray2D(int Cols, int Rows, void* pData)
     {
+        static_assert(Layout::CONTIGUOUS_ROWS, "only the row major layout can adopt an unpadded buffer, copy into a tiled grid instead");
+
+        Destroy();
+
         m_cols = Cols;
         m_rows = Rows;
-
-        if (m_p) {
-            free(m_p);
-        }
+        m_pitch = Cols;
+        m_storage = Layout::StorageSize(Cols, Rows);
+        m_mode = MALLOC;
 
         m_p = (Type*)pData;
     }
 
 
+    // Uses memory someone else owns, e.g. a mapped file, laid out the way InitArray2D(Cols, Rows) would lay it out.
+    // It is never written to unless At or Set are called, and never freed
+    void InitArray2DView(int Cols, int Rows, Type* pData)
+    {
+        Destroy();
+
+        m_cols = Cols;
+        m_rows = Rows;
+        m_pitch = Layout::Pitch(Cols, sizeof(Type));
+        m_storage = Layout::StorageSize(m_pitch, Rows);
+        m_mode = VIEW;
+
+        m_p = pData;
+    }
+
+
+    bool IsView() const
+    {
+        return m_mode == VIEW;
+    }
+
+
     ~Array2D()
     {
         Destroy();
@@ -82,25 +203,66 @@ public:
     void Destroy()
     {
         if (m_p) {
-            free(m_p);
+            if (m_mode == ALIGNED) {
+                AlignedFree(m_p);
+            }
+            else if (m_mode == MALLOC) {
+                free(m_p);
+            }
             m_p = NULL;
         }
+        m_cols = m_rows = m_pitch = 0;
+        m_storage = 0;
+    }
+
+
+    // Same size and contents as Source
+    void CopyFrom(const Array2D& Source)
+    {
+        if (this == &Source) {
+            return;
+        }
+
+        InitArray2D(Source.m_cols, Source.m_rows);
+
+        if (m_pitch == Source.m_pitch) {
+            memcpy(m_p, Source.m_p, Layout::StorageSize(m_pitch, m_rows) * sizeof(Type));
+        }
+        else {
+            for (int Row = 0; Row < m_rows; Row++) {
+                for (int Col = 0; Col < m_cols; Col++) {
+                    At(Col, Row) = Source.Get(Col, Row);
+                }
+            }
+        }
     }
 
+
+    // Row pointers only exist in the row major layout. The next row starts GetPitch() elements further on
     Type* GetAddr(int Col, int Row) const
     {
+        static_assert(Layout::CONTIGUOUS_ROWS, "GetAddr needs contiguous rows, use Get/At with this layout");
+
         size_t Index = CalcIndex(Col, Row);
 
         return &m_p[Index];
     }
 
 
+    // Start of the storage, 64 byte aligned. Rows are GetPitch() elements apart, not GetWidth()
     Type* GetBaseAddr() const
     {
         return m_p;
     }
 
 
+    // Elements from the start of one row to the next, at least GetWidth()
+    int GetPitch() const
+    {
+        return m_pitch;
+    }
+
+
     int GetSize() const
     {
         return m_rows * m_cols;
@@ -113,12 +275,20 @@ public:
     }
 
 
+    // Elements allocated, including the padding
+    size_t GetStorageSize() const
+    {
+        return Layout::StorageSize(m_pitch, m_rows);
+    }
+
+
     const Type& Get(int Col, int Row) const
     {
-        return *GetAddr(Col, Row);
+        return m_p[CalcIndex(Col, Row)];
     }
 
 
+    // Index counts Cols per row, without the padding
     const Type& Get(int Index) const
     {
 #ifndef NDEBUG
@@ -128,7 +298,7 @@ public:
         }
 #endif
 
-        return m_p[Index];
+        return Get(Index % m_cols, Index / m_cols);
     }
 
 
@@ -141,7 +311,7 @@ public:
 
     void Set(int Col, int Row, const Type& Val)
     {
-        *GetAddr(Col, Row) = Val;
+        m_p[CalcIndex(Col, Row)] = Val;
     }
 
 
@@ -154,21 +324,26 @@ public:
         }
 #endif
 
-        m_p[Index] = Val;
+        Set(Index % m_cols, Index / m_cols, Val);
     }
 
 
-    void GetMinMax(Type& Min, Type& Max)
+    // Scalar. ew::getMinMax and ew::normalize in array2dOps.h are the vectorized versions for float grids
+    void GetMinMax(Type& Min, Type& Max) const
     {
-        Max = Min = m_p[0];
+        Max = Min = Get(0, 0);
 
-        for (int i = 1; i < m_rows * m_cols; i++) {
-            if (m_p[i] < Min) {
-                Min = m_p[i];
-            }
+        for (int Row = 0; Row < m_rows; Row++) {
+            for (int Col = 0; Col < m_cols; Col++) {
+                const Type& Val = Get(Col, Row);
+
+                if (Val < Min) {
+                    Min = Val;
+                }
 
-            if (m_p[i] > Max) {
-                Max = m_p[i];
+                if (Val > Max) {
+                    Max = Val;
+                }
             }
         }
     }
@@ -187,8 +362,11 @@ public:
         Type MinMaxDelta = Max - Min;
         Type MinMaxRange = MaxRange - MinRange;
 
-        for (int i = 0; i < m_rows * m_cols; i++) {
-            m_p[i] = ((m_p[i] - Min) / MinMaxDelta) * MinMaxRange + MinRange;
+        for (int Row = 0; Row < m_rows; Row++) {
+            for (int Col = 0; Col < m_cols; Col++) {
+                Type& Val = At(Col, Row);
+                Val = ((Val - Min) / MinMaxDelta) * MinMaxRange + MinRange;
+            }
         }
     }
 
@@ -198,7 +376,7 @@ public:
         for (int y = 0; y < m_rows; y++) {
             printf("%d: ", y);
             for (int x = 0; x < m_cols; x++) {
-                float f = (float)m_p[y * m_cols + x];
+                float f = (float)Get(x, y);
                 printf("%.6f ", f);
             }
             printf("\n");
@@ -211,6 +389,12 @@ public:
 
 private:
 
+    enum StorageMode {
+        ALIGNED,    // AlignedAlloc, the usual case
+        MALLOC,     // handed over to InitArray2D from malloc
+        VIEW        // not ours, see InitArray2DView
+    };
+
     size_t CalcIndex(int Col, int Row) const
     {
 #ifndef NDEBUG
@@ -232,15 +416,54 @@ private:
             exit(0);
         }
 #endif
-        size_t Index = Row * m_cols + Col;
+        return Layout::Index(Col, Row, m_pitch);
+    }
 
-        return Index;
+    void Swap(Array2D& Other)
+    {
+        std::swap(m_p, Other.m_p);
+        std::swap(m_cols, Other.m_cols);
+        std::swap(m_rows, Other.m_rows);
+        std::swap(m_pitch, Other.m_pitch);
+        std::swap(m_storage, Other.m_storage);
+        std::swap(m_mode, Other.m_mode);
+    }
+
+    static void* AlignedAlloc(size_t Bytes)
+    {
+        if (Bytes == 0) {
+            Bytes = 64;
+        }
+#ifdef _WIN32
+        void* p = _aligned_malloc(Bytes, 64);
+#else
+        void* p = NULL;
+        if (posix_memalign(&p, 64, Bytes) != 0) {
+            p = NULL;
+        }
+#endif
+        if (!p) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    static void AlignedFree(void* p)
+    {
+#ifdef _WIN32
+        _aligned_free(p);
+#else
+        free(p);
+#endif
     }
 
     Type* m_p = NULL;
     int m_cols = 0;
     int m_rows = 0;
+    int m_pitch = 0;
+    size_t m_storage = 0;   // elements allocated, which can be more than this size needs after a smaller InitArray2D
+    StorageMode m_mode = ALIGNED;
 };
 
 
-#endif
\ No newline at end of file
+#endif
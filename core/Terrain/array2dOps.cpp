@@ -0,0 +1,441 @@
+#include "array2dOps.h"
+#include "parallel.h"
+#include "duneKernelSimd.h"
+#include <algorithm>
+#include <math.h>
+
+namespace ew {
+	namespace {
+		using duneSimd::Lanes4;
+
+		inline int clampIndex(int i, int size) {
+			return std::min(std::max(i, 0), size - 1);
+		}
+
+		//where dst sample i falls between two src samples, with the first and last samples of both lined up
+		inline void axisSample(int i, int srcSize, float step, int* i0, int* i1, float* t) {
+			float x = i * step;
+			*i0 = std::min((int)x, std::max(srcSize - 2, 0));
+			*i1 = std::min(*i0 + 1, srcSize - 1);
+			*t = x - *i0;
+		}
+
+		inline float axisStep(int srcSize, int dstSize) {
+			return dstSize > 1 ? (float)(srcSize - 1) / (dstSize - 1) : 0.0f;
+		}
+
+		struct AxisTable {
+			std::vector<int> i0, i1;
+			std::vector<float> t;
+
+			AxisTable(int srcSize, int dstSize) : i0(dstSize), i1(dstSize), t(dstSize) {
+				float step = axisStep(srcSize, dstSize);
+				for (int i = 0; i < dstSize; i++)
+				{
+					axisSample(i, srcSize, step, &i0[i], &i1[i], &t[i]);
+				}
+			}
+		};
+
+		inline float horizontalTaps(const float* in, int col, int width, const float* weights, int radius) {
+			float sum = 0.0f;
+			for (int k = 0; k <= 2 * radius; k++)
+			{
+				sum += weights[k] * in[clampIndex(col - radius + k, width)];
+			}
+			return sum;
+		}
+
+		inline float stencilTaps(const float* const* rows, int col, int width, const Stencil3x3& stencil) {
+			float sum = 0.0f;
+			for (int dy = 0; dy < 3; dy++)
+			{
+				for (int dx = 0; dx < 3; dx++)
+				{
+					sum += stencil.weights[dy][dx] * rows[dy][clampIndex(col + dx - 1, width)];
+				}
+			}
+			return sum;
+		}
+
+		void convolveRowsHorizontal(const Array2D<float>& src, const std::vector<float>& weights, Array2D<float>* dst, int rowBegin, int rowEnd) {
+			int width = src.GetWidth();
+			int radius = (int)weights.size() / 2;
+			for (int row = rowBegin; row < rowEnd; row++)
+			{
+				const float* in = src.GetAddr(0, row);
+				float* out = dst->GetAddr(0, row);
+				int col = 0;
+				for (; col < std::min(radius, width); col++)
+				{
+					out[col] = horizontalTaps(in, col, width, weights.data(), radius);
+				}
+				for (; col + Lanes4::WIDTH <= width - radius; col += Lanes4::WIDTH)
+				{
+					Lanes4 sum = Lanes4(0.0f);
+					for (int k = 0; k <= 2 * radius; k++)
+					{
+						sum = sum + Lanes4(weights[k]) * Lanes4::load(in + col - radius + k);
+					}
+					sum.store(out + col);
+				}
+				for (; col < width; col++)
+				{
+					out[col] = horizontalTaps(in, col, width, weights.data(), radius);
+				}
+			}
+		}
+
+		void convolveRowsVertical(const Array2D<float>& src, const std::vector<float>& weights, Array2D<float>* dst, int rowBegin, int rowEnd) {
+			int width = src.GetWidth();
+			int height = src.GetHeight();
+			int taps = (int)weights.size();
+			int radius = taps / 2;
+			std::vector<const float*> rows(taps);
+			for (int row = rowBegin; row < rowEnd; row++)
+			{
+				for (int k = 0; k < taps; k++)
+				{
+					rows[k] = src.GetAddr(0, clampIndex(row - radius + k, height));
+				}
+				float* out = dst->GetAddr(0, row);
+				int col = 0;
+				for (; col + Lanes4::WIDTH <= width; col += Lanes4::WIDTH)
+				{
+					Lanes4 sum = Lanes4(0.0f);
+					for (int k = 0; k < taps; k++)
+					{
+						sum = sum + Lanes4(weights[k]) * Lanes4::load(rows[k] + col);
+					}
+					sum.store(out + col);
+				}
+				for (; col < width; col++)
+				{
+					float sum = 0.0f;
+					for (int k = 0; k < taps; k++)
+					{
+						sum += weights[k] * rows[k][col];
+					}
+					out[col] = sum;
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Smallest and largest sample. Same result as Array2D::GetMinMax
+	/// </summary>
+	void getMinMax(const Array2D<float>& grid, float* low, float* high, int numThreads) {
+		int width = grid.GetWidth();
+		int height = grid.GetHeight();
+		if (width == 0 || height == 0) {
+			*low = *high = 0.0f;
+			return;
+		}
+		std::vector<float> rowLow(height), rowHigh(height);
+		parallelFor(0, height, numThreads, [&](int rowBegin, int rowEnd) {
+			for (int row = rowBegin; row < rowEnd; row++)
+			{
+				const float* in = grid.GetAddr(0, row);
+				float lanes[Lanes4::WIDTH];
+				float smallest = in[0], largest = in[0];
+				int col = 0;
+				if (width >= Lanes4::WIDTH) {
+					Lanes4 lanesLow = Lanes4::load(in), lanesHigh = lanesLow;
+					for (col = Lanes4::WIDTH; col + Lanes4::WIDTH <= width; col += Lanes4::WIDTH)
+					{
+						Lanes4 v = Lanes4::load(in + col);
+						lanesLow = lanesMin(lanesLow, v);
+						lanesHigh = lanesMax(lanesHigh, v);
+					}
+					lanesLow.store(lanes);
+					smallest = *std::min_element(lanes, lanes + Lanes4::WIDTH);
+					lanesHigh.store(lanes);
+					largest = *std::max_element(lanes, lanes + Lanes4::WIDTH);
+				}
+				for (; col < width; col++)
+				{
+					smallest = std::min(smallest, in[col]);
+					largest = std::max(largest, in[col]);
+				}
+				rowLow[row] = smallest;
+				rowHigh[row] = largest;
+			}
+		});
+		*low = *std::min_element(rowLow.begin(), rowLow.end());
+		*high = *std::max_element(rowHigh.begin(), rowHigh.end());
+	}
+
+	/// <summary>
+	/// Stretches the samples to [low, high]. Array2D::Normalize is the scalar reference, which divides where this
+	/// multiplies, so the two can differ in the last bit
+	/// </summary>
+	void normalize(Array2D<float>* grid, float low, float high, int numThreads) {
+		float smallest, largest;
+		getMinMax(*grid, &smallest, &largest, numThreads);
+		if (largest <= smallest) {
+			return;
+		}
+		float scale = (high - low) / (largest - smallest);
+		scaleOffset(grid, scale, low - smallest * scale, numThreads);
+	}
+
+	/// <summary>
+	/// Every sample becomes sample * scale + offset
+	/// </summary>
+	void scaleOffset(Array2D<float>* grid, float scale, float offset, int numThreads) {
+		int width = grid->GetWidth();
+		parallelFor(0, grid->GetHeight(), numThreads, [&](int rowBegin, int rowEnd) {
+			Lanes4 lanesScale = Lanes4(scale), lanesOffset = Lanes4(offset);
+			for (int row = rowBegin; row < rowEnd; row++)
+			{
+				float* samples = grid->GetAddr(0, row);
+				int col = 0;
+				for (; col + Lanes4::WIDTH <= width; col += Lanes4::WIDTH)
+				{
+					(Lanes4::load(samples + col) * lanesScale + lanesOffset).store(samples + col);
+				}
+				for (; col < width; col++)
+				{
+					samples[col] = samples[col] * scale + offset;
+				}
+			}
+		});
+	}
+
+	/// <summary>
+	/// Bilinear resize with the corner samples kept in place. Every source row is interpolated across once,
+	/// then rows are blended four columns at a time
+	/// </summary>
+	/// <param name="dst">Resized to width x height. Not src</param>
+	void resampleBilinear(const Array2D<float>& src, int width, int height, Array2D<float>* dst, int numThreads) {
+		dst->InitArray2D(width, height);
+		AxisTable columns(src.GetWidth(), width);
+		AxisTable rows(src.GetHeight(), height);
+		parallelFor(0, height, numThreads, [&](int rowBegin, int rowEnd) {
+			std::vector<float> top(width), bottom(width);
+			int topRow = -1, bottomRow = -1;
+			auto across = [&](int srcRow, float* out) {
+				const float* in = src.GetAddr(0, srcRow);
+				for (int col = 0; col < width; col++)
+				{
+					float a = in[columns.i0[col]];
+					float b = in[columns.i1[col]];
+					out[col] = a + (b - a) * columns.t[col];
+				}
+			};
+			for (int row = rowBegin; row < rowEnd; row++)
+			{
+				//going down, the old bottom row is usually the new top row
+				if (topRow != rows.i0[row]) {
+					if (bottomRow == rows.i0[row]) {
+						top.swap(bottom);
+						std::swap(topRow, bottomRow);
+					}
+					else {
+						topRow = rows.i0[row];
+						across(topRow, top.data());
+					}
+				}
+				if (bottomRow != rows.i1[row]) {
+					bottomRow = rows.i1[row];
+					across(bottomRow, bottom.data());
+				}
+
+				float* out = dst->GetAddr(0, row);
+				float t = rows.t[row];
+				Lanes4 lanesT = Lanes4(t);
+				int col = 0;
+				for (; col + Lanes4::WIDTH <= width; col += Lanes4::WIDTH)
+				{
+					Lanes4 a = Lanes4::load(&top[col]);
+					Lanes4 b = Lanes4::load(&bottom[col]);
+					(a + (b - a) * lanesT).store(out + col);
+				}
+				for (; col < width; col++)
+				{
+					out[col] = top[col] + (bottom[col] - top[col]) * t;
+				}
+			}
+		});
+	}
+
+	/// <summary>
+	/// Filters rows, then columns, with the same weights
+	/// </summary>
+	/// <param name="weights">An odd number of taps, centered on the sample</param>
+	/// <param name="dst">Same size as src afterwards. Not src</param>
+	void convolveSeparable(const Array2D<float>& src, const std::vector<float>& weights, Array2D<float>* dst, int numThreads) {
+		int width = src.GetWidth();
+		int height = src.GetHeight();
+		Array2D<float> across(width, height);
+		dst->InitArray2D(width, height);
+		parallelFor(0, height, numThreads, [&](int rowBegin, int rowEnd) {
+			convolveRowsHorizontal(src, weights, &across, rowBegin, rowEnd);
+		});
+		parallelFor(0, height, numThreads, [&](int rowBegin, int rowEnd) {
+			convolveRowsVertical(across, weights, dst, rowBegin, rowEnd);
+		});
+	}
+
+	void boxBlur(const Array2D<float>& src, int radius, Array2D<float>* dst, int numThreads) {
+		convolveSeparable(src, boxWeights(radius), dst, numThreads);
+	}
+
+	void gaussianBlur(const Array2D<float>& src, float sigma, Array2D<float>* dst, int numThreads) {
+		convolveSeparable(src, gaussianWeights(sigma), dst, numThreads);
+	}
+
+	/// <summary>
+	/// Weighted sum of every sample's 3 x 3 neighbourhood
+	/// </summary>
+	/// <param name="dst">Same size as src afterwards. Not src</param>
+	void applyStencil(const Array2D<float>& src, const Stencil3x3& stencil, Array2D<float>* dst, int numThreads) {
+		int width = src.GetWidth();
+		int height = src.GetHeight();
+		dst->InitArray2D(width, height);
+		Lanes4 weights[3][3];
+		for (int dy = 0; dy < 3; dy++)
+		{
+			for (int dx = 0; dx < 3; dx++)
+			{
+				weights[dy][dx] = Lanes4(stencil.weights[dy][dx]);
+			}
+		}
+		parallelFor(0, height, numThreads, [&](int rowBegin, int rowEnd) {
+			for (int row = rowBegin; row < rowEnd; row++)
+			{
+				const float* rows[3];
+				for (int dy = 0; dy < 3; dy++)
+				{
+					rows[dy] = src.GetAddr(0, clampIndex(row + dy - 1, height));
+				}
+				float* out = dst->GetAddr(0, row);
+				int col = 0;
+				for (; col < std::min(1, width); col++)
+				{
+					out[col] = stencilTaps(rows, col, width, stencil);
+				}
+				for (; col + Lanes4::WIDTH <= width - 1; col += Lanes4::WIDTH)
+				{
+					Lanes4 sum = Lanes4(0.0f);
+					for (int dy = 0; dy < 3; dy++)
+					{
+						for (int dx = 0; dx < 3; dx++)
+						{
+							sum = sum + weights[dy][dx] * Lanes4::load(rows[dy] + col + dx - 1);
+						}
+					}
+					sum.store(out + col);
+				}
+				for (; col < width; col++)
+				{
+					out[col] = stencilTaps(rows, col, width, stencil);
+				}
+			}
+		});
+	}
+
+	std::vector<float> boxWeights(int radius) {
+		radius = std::max(radius, 0);
+		return std::vector<float>(2 * radius + 1, 1.0f / (2 * radius + 1));
+	}
+
+	/// <summary>
+	/// Gaussian taps out to 3 sigma, summing to 1
+	/// </summary>
+	std::vector<float> gaussianWeights(float sigma) {
+		int radius = std::max((int)ceilf(3.0f * sigma), 0);
+		std::vector<float> weights(2 * radius + 1, 1.0f);
+		if (sigma <= 0.0f) {
+			return weights;
+		}
+		float total = 0.0f;
+		for (int k = -radius; k <= radius; k++)
+		{
+			weights[k + radius] = expf(-0.5f * k * k / (sigma * sigma));
+			total += weights[k + radius];
+		}
+		for (float& weight : weights)
+		{
+			weight /= total;
+		}
+		return weights;
+	}
+
+	void scaleOffsetScalar(Array2D<float>* grid, float scale, float offset) {
+		for (int row = 0; row < grid->GetHeight(); row++)
+		{
+			for (int col = 0; col < grid->GetWidth(); col++)
+			{
+				grid->At(col, row) = grid->Get(col, row) * scale + offset;
+			}
+		}
+	}
+
+	void resampleBilinearScalar(const Array2D<float>& src, int width, int height, Array2D<float>* dst) {
+		dst->InitArray2D(width, height);
+		float stepX = axisStep(src.GetWidth(), width);
+		float stepY = axisStep(src.GetHeight(), height);
+		for (int row = 0; row < height; row++)
+		{
+			int y0, y1;
+			float ty;
+			axisSample(row, src.GetHeight(), stepY, &y0, &y1, &ty);
+			for (int col = 0; col < width; col++)
+			{
+				int x0, x1;
+				float tx;
+				axisSample(col, src.GetWidth(), stepX, &x0, &x1, &tx);
+				float top = src.Get(x0, y0) + (src.Get(x1, y0) - src.Get(x0, y0)) * tx;
+				float bottom = src.Get(x0, y1) + (src.Get(x1, y1) - src.Get(x0, y1)) * tx;
+				dst->At(col, row) = top + (bottom - top) * ty;
+			}
+		}
+	}
+
+	void convolveSeparableScalar(const Array2D<float>& src, const std::vector<float>& weights, Array2D<float>* dst) {
+		int width = src.GetWidth();
+		int height = src.GetHeight();
+		int radius = (int)weights.size() / 2;
+		Array2D<float> across(width, height);
+		dst->InitArray2D(width, height);
+		for (int row = 0; row < height; row++)
+		{
+			for (int col = 0; col < width; col++)
+			{
+				across.At(col, row) = horizontalTaps(src.GetAddr(0, row), col, width, weights.data(), radius);
+			}
+		}
+		for (int row = 0; row < height; row++)
+		{
+			for (int col = 0; col < width; col++)
+			{
+				float sum = 0.0f;
+				for (int k = 0; k <= 2 * radius; k++)
+				{
+					sum += weights[k] * across.Get(col, clampIndex(row - radius + k, height));
+				}
+				dst->At(col, row) = sum;
+			}
+		}
+	}
+
+	void applyStencilScalar(const Array2D<float>& src, const Stencil3x3& stencil, Array2D<float>* dst) {
+		int width = src.GetWidth();
+		int height = src.GetHeight();
+		dst->InitArray2D(width, height);
+		for (int row = 0; row < height; row++)
+		{
+			const float* rows[3];
+			for (int dy = 0; dy < 3; dy++)
+			{
+				rows[dy] = src.GetAddr(0, clampIndex(row + dy - 1, height));
+			}
+			for (int col = 0; col < width; col++)
+			{
+				dst->At(col, row) = stencilTaps(rows, col, width, stencil);
+			}
+		}
+	}
+}
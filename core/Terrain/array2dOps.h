@@ -0,0 +1,35 @@
+#ifndef ARRAY2D_OPS_H
+#define ARRAY2D_OPS_H
+#pragma once
+#include "array2d.h"
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// 3 x 3 weights, weights[dy + 1][dx + 1] for the sample at (col + dx, row + dy)
+	/// </summary>
+	struct Stencil3x3 {
+		float weights[3][3] = {};
+	};
+
+	//Bulk operations on float grids, four columns at a time and optionally split over threads by rows.
+	//Edges repeat the edge samples. The Scalar versions compute the same sums in the same order, as references
+	void getMinMax(const Array2D<float>& grid, float* low, float* high, int numThreads = 1);
+	void normalize(Array2D<float>* grid, float low, float high, int numThreads = 1);
+	void scaleOffset(Array2D<float>* grid, float scale, float offset, int numThreads = 1);
+	void resampleBilinear(const Array2D<float>& src, int width, int height, Array2D<float>* dst, int numThreads = 1);
+	void convolveSeparable(const Array2D<float>& src, const std::vector<float>& weights, Array2D<float>* dst, int numThreads = 1);
+	void boxBlur(const Array2D<float>& src, int radius, Array2D<float>* dst, int numThreads = 1);
+	void gaussianBlur(const Array2D<float>& src, float sigma, Array2D<float>* dst, int numThreads = 1);
+	void applyStencil(const Array2D<float>& src, const Stencil3x3& stencil, Array2D<float>* dst, int numThreads = 1);
+
+	std::vector<float> boxWeights(int radius);
+	std::vector<float> gaussianWeights(float sigma);
+
+	void scaleOffsetScalar(Array2D<float>* grid, float scale, float offset);
+	void resampleBilinearScalar(const Array2D<float>& src, int width, int height, Array2D<float>* dst);
+	void convolveSeparableScalar(const Array2D<float>& src, const std::vector<float>& weights, Array2D<float>* dst);
+	void applyStencilScalar(const Array2D<float>& src, const Stencil3x3& stencil, Array2D<float>* dst);
+}
+
+#endif // ARRAY2D_OPS_H
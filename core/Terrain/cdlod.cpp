@@ -0,0 +1,310 @@
+#include "cdlod.h"
+#include "heightTexture.h"
+#include "../ew/meshOptimizer.h"
+#include "../ew/external/glad.h"
+#include <algorithm>
+
+namespace ew {
+	/// <summary>
+	/// Creates the grid every CDLOD node draws, on [0, 1] in x and y.
+	/// Indices are grouped by quadrant so a node can draw any quadrant with a single index range, and ordered for the vertex cache within it
+	/// </summary>
+	/// <param name="gridResolution">Cells per side, even</param>
+	/// <param name="meshData">MeshData struct to fill. Will be cleared.</param>
+	void createCDLODGrid(int gridResolution, MeshData* meshData) {
+		meshData->vertices.clear();
+		meshData->indices.clear();
+		int verticesPerRow = gridResolution + 1;
+		meshData->vertices.reserve(verticesPerRow * verticesPerRow);
+		meshData->indices.reserve(gridResolution * gridResolution * 6);
+
+		for (int row = 0; row <= gridResolution; row++)
+		{
+			for (int col = 0; col <= gridResolution; col++)
+			{
+				glm::vec2 uv = glm::vec2((float)col / gridResolution, (float)row / gridResolution);
+				meshData->vertices.push_back(Vertex(glm::vec3(uv, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), uv, glm::vec3(1.0f, 0.0f, 0.0f)));
+			}
+		}
+
+		int half = gridResolution / 2;
+		for (int quadrant = 0; quadrant < 4; quadrant++)
+		{
+			int colBegin = (quadrant & 1) * half;
+			int rowBegin = (quadrant >> 1) * half;
+			for (int row = rowBegin; row < rowBegin + half; row++)
+			{
+				for (int col = colBegin; col < colBegin + half; col++)
+				{
+					//same winding as createTerrain, rows run towards -z
+					unsigned int bl = row * verticesPerRow + col;
+					unsigned int br = bl + 1;
+					unsigned int tl = bl + verticesPerRow;
+					unsigned int tr = tl + 1;
+					meshData->indices.push_back(bl);
+					meshData->indices.push_back(br);
+					meshData->indices.push_back(tr);
+					meshData->indices.push_back(tr);
+					meshData->indices.push_back(tl);
+					meshData->indices.push_back(bl);
+				}
+			}
+			//each quadrant on its own, so the ranges stay intact
+			int quadrantIndices = half * half * 6;
+			optimizeVertexCache(&meshData->indices[quadrant * quadrantIndices], quadrantIndices, verticesPerRow * verticesPerRow);
+		}
+	}
+
+	/// <summary>
+	/// Builds the min/max quadtree for a height field
+	/// </summary>
+	/// <param name="width">Total width</param>
+	/// <param name="height">Total height</param>
+	/// <param name="subDivisions">Cells per side. Best as gridResolution times a power of two</param>
+	/// <param name="heights">Height field with a one sample border, from createHeightField</param>
+	/// <param name="settings">Grid resolution and LOD ranges</param>
+	void CDLODQuadtree::init(float width, float height, int subDivisions, const Array2D<float>& heights, const CDLODSettings& settings) {
+		m_settings = settings;
+		m_subDivisions = subDivisions;
+		m_cellSize = glm::vec2(width / subDivisions, height / subDivisions);
+
+		int grid = m_settings.gridResolution;
+		m_levels = 1;
+		while ((grid << (m_levels - 1)) < subDivisions) {
+			m_levels++;
+		}
+
+		m_minMax.assign(m_levels, std::vector<glm::vec2>());
+
+		//finest level straight from the heights, including the shared edge vertices
+		int leaves = nodesPerSide(0);
+		m_minMax[0].resize(leaves * leaves);
+		for (int nodeZ = 0; nodeZ < leaves; nodeZ++)
+		{
+			for (int nodeX = 0; nodeX < leaves; nodeX++)
+			{
+				int colEnd = std::min((nodeX + 1) * grid, subDivisions);
+				int rowEnd = std::min((nodeZ + 1) * grid, subDivisions);
+				glm::vec2 minMax = glm::vec2(heights.Get(nodeX * grid + 1, nodeZ * grid + 1));
+				for (int row = nodeZ * grid; row <= rowEnd; row++)
+				{
+					const float* h = heights.GetAddr(1, row + 1);
+					for (int col = nodeX * grid; col <= colEnd; col++)
+					{
+						minMax.x = std::min(minMax.x, h[col]);
+						minMax.y = std::max(minMax.y, h[col]);
+					}
+				}
+				m_minMax[0][nodeZ * leaves + nodeX] = minMax;
+			}
+		}
+
+		for (int level = 1; level < m_levels; level++)
+		{
+			int count = nodesPerSide(level);
+			int childCount = nodesPerSide(level - 1);
+			m_minMax[level].resize(count * count);
+			for (int nodeZ = 0; nodeZ < count; nodeZ++)
+			{
+				for (int nodeX = 0; nodeX < count; nodeX++)
+				{
+					glm::vec2 minMax = m_minMax[level - 1][(nodeZ * 2) * childCount + nodeX * 2];
+					for (int child = 1; child < 4; child++)
+					{
+						int childX = nodeX * 2 + (child & 1);
+						int childZ = nodeZ * 2 + (child >> 1);
+						if (childX < childCount && childZ < childCount)
+						{
+							glm::vec2 childMinMax = m_minMax[level - 1][childZ * childCount + childX];
+							minMax.x = std::min(minMax.x, childMinMax.x);
+							minMax.y = std::max(minMax.y, childMinMax.y);
+						}
+					}
+					m_minMax[level][nodeZ * count + nodeX] = minMax;
+				}
+			}
+		}
+	}
+
+	int CDLODQuadtree::nodesPerSide(int level) const {
+		int nodeCells = m_settings.gridResolution << level;
+		return (m_subDivisions + nodeCells - 1) / nodeCells;
+	}
+
+	/// <summary>
+	/// Distance at which a level hands over to the next coarser one
+	/// </summary>
+	float CDLODQuadtree::getRange(int level) const {
+		float nodeSize = (float)(m_settings.gridResolution << level) * std::max(m_cellSize.x, m_cellSize.y);
+		return nodeSize * m_settings.lodDistanceScale;
+	}
+
+	/// <summary>
+	/// Camera distances where vertices of a level start and finish morphing into the next coarser level.
+	/// The coarsest level never morphs
+	/// </summary>
+	glm::vec2 CDLODQuadtree::getMorphRange(int level) const {
+		if (level >= m_levels - 1) {
+			return glm::vec2(1e30f, 2e30f);
+		}
+		float end = getRange(level);
+		float previous = level > 0 ? getRange(level - 1) : 0.0f;
+		return glm::vec2(previous + (end - previous) * m_settings.morphStartRatio, end);
+	}
+
+	bool CDLODQuadtree::inRange(int level, int nodeX, int nodeZ, float range, const glm::vec3& cameraPos) const {
+		int nodeCells = m_settings.gridResolution << level;
+		int count = nodesPerSide(level);
+		glm::vec2 minMax = m_minMax[level][nodeZ * count + nodeX];
+
+		glm::vec3 boxMin = glm::vec3(nodeX * nodeCells * m_cellSize.x, minMax.x, -std::min((nodeZ + 1) * nodeCells, m_subDivisions) * m_cellSize.y);
+		glm::vec3 boxMax = glm::vec3(std::min((nodeX + 1) * nodeCells, m_subDivisions) * m_cellSize.x, minMax.y, -nodeZ * nodeCells * m_cellSize.y);
+		glm::vec3 closest = glm::clamp(cameraPos, boxMin, boxMax);
+		glm::vec3 offset = cameraPos - closest;
+		return glm::dot(offset, offset) <= range * range;
+	}
+
+	/// <summary>
+	/// Adds a node, or the parts of it not covered by finer children, to the selection.
+	/// Returns false when the node is outside its own LOD range and its parent has to cover it
+	/// </summary>
+	bool CDLODQuadtree::selectNode(int level, int nodeX, int nodeZ, const glm::vec3& cameraPos, std::vector<CDLODNode>* nodes) const {
+		int count = nodesPerSide(level);
+		if (nodeX >= count || nodeZ >= count) {
+			//past the edge of the height field, nothing to draw
+			return true;
+		}
+		if (!inRange(level, nodeX, nodeZ, getRange(level), cameraPos)) {
+			return false;
+		}
+
+		CDLODNode node;
+		int nodeCells = m_settings.gridResolution << level;
+		node.cellX = nodeX * nodeCells;
+		node.cellZ = nodeZ * nodeCells;
+		node.sizeCells = nodeCells;
+		node.level = level;
+
+		if (level == 0 || !inRange(level, nodeX, nodeZ, getRange(level - 1), cameraPos)) {
+			nodes->push_back(node);
+			return true;
+		}
+
+		node.quadrantMask = 0;
+		for (int child = 0; child < 4; child++)
+		{
+			if (!selectNode(level - 1, nodeX * 2 + (child & 1), nodeZ * 2 + (child >> 1), cameraPos, nodes)) {
+				node.quadrantMask |= 1 << child;
+			}
+		}
+		if (node.quadrantMask != 0) {
+			nodes->push_back(node);
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Picks the nodes to draw for a camera position in terrain space
+	/// </summary>
+	/// <param name="cameraPos">Camera position relative to the terrain's (0, 0) corner</param>
+	/// <param name="nodes">Cleared and filled with the selection</param>
+	void CDLODQuadtree::select(const glm::vec3& cameraPos, std::vector<CDLODNode>* nodes) const {
+		nodes->clear();
+		int top = m_levels - 1;
+		int count = nodesPerSide(top);
+		for (int nodeZ = 0; nodeZ < count; nodeZ++)
+		{
+			for (int nodeX = 0; nodeX < count; nodeX++)
+			{
+				if (!selectNode(top, nodeX, nodeZ, cameraPos, nodes)) {
+					//beyond every range, the coarsest level still draws it
+					CDLODNode node;
+					node.sizeCells = m_settings.gridResolution << top;
+					node.cellX = nodeX * node.sizeCells;
+					node.cellZ = nodeZ * node.sizeCells;
+					node.level = top;
+					nodes->push_back(node);
+				}
+			}
+		}
+	}
+
+	CDLODTerrain::~CDLODTerrain() {
+		deleteHeightTexture(&m_heightTexture);
+	}
+
+	/// <summary>
+	/// Builds the quadtree, uploads the height field and the shared grid mesh
+	/// </summary>
+	/// <param name="width">Total width</param>
+	/// <param name="height">Total height</param>
+	/// <param name="subDivisions">Cells per side of the height field</param>
+	/// <param name="heights">Height field with a one sample border, from createHeightField</param>
+	/// <param name="settings">Grid resolution and LOD ranges</param>
+	void CDLODTerrain::init(float width, float height, int subDivisions, const Array2D<float>& heights, const CDLODSettings& settings) {
+		m_quadtree.init(width, height, subDivisions, heights, settings);
+
+		deleteHeightTexture(&m_heightTexture);
+		m_heightTexture = createHeightTexture(heights);
+
+		MeshData grid;
+		createCDLODGrid(settings.gridResolution, &grid);
+		m_gridMesh.load(grid);
+
+		m_stats = CDLODStats();
+		m_stats.levels = m_quadtree.getLevels();
+		m_stats.fullGridTriangles = subDivisions * subDivisions * 2;
+	}
+
+	/// <summary>
+	/// Selects nodes for the camera and draws them. The shader must be in use, with uModel, uView and uProjection set
+	/// </summary>
+	/// <param name="shader">cdlodVShader.vert based shader</param>
+	/// <param name="cameraPos">Camera position relative to the terrain's (0, 0) corner</param>
+	/// <param name="heightFieldSlot">Texture unit for the height field</param>
+	void CDLODTerrain::draw(const Shader& shader, const glm::vec3& cameraPos, unsigned int heightFieldSlot) {
+		m_quadtree.select(cameraPos, &m_selection);
+
+		int grid = m_quadtree.getSettings().gridResolution;
+		int subDivisions = m_quadtree.getSubDivisions();
+		glActiveTexture(GL_TEXTURE0 + heightFieldSlot);
+		glBindTexture(GL_TEXTURE_2D, m_heightTexture.id);
+		shader.setInt("uHeightField", heightFieldSlot);
+		shader.setVec2("uHeightRange", glm::vec2(m_heightTexture.scale, m_heightTexture.offset));
+		shader.setVec2("uHeightFieldSize", glm::vec2((float)(subDivisions + 3)));
+		shader.setVec2("uCellSize", m_quadtree.getCellSize());
+		shader.setFloat("uGridDim", (float)grid);
+		shader.setVec3("uCameraPos", cameraPos);
+
+		m_stats.nodes = 0;
+		m_stats.triangles = 0;
+		int quadrantIndices = grid * grid / 4 * 6;
+
+		//looked up once, not per node
+		UniformHandle nodeUniform = shader.getUniform("uNode");
+		UniformHandle morphRangeUniform = shader.getUniform("uMorphRange");
+		for (const CDLODNode& node : m_selection)
+		{
+			shader.setVec4(nodeUniform, glm::vec4((float)node.cellX, (float)node.cellZ, (float)node.sizeCells, 0.0f));
+			shader.setVec2(morphRangeUniform, m_quadtree.getMorphRange(node.level));
+			if (node.quadrantMask == 0xF)
+			{
+				m_gridMesh.drawRange(0, quadrantIndices * 4);
+				m_stats.triangles += quadrantIndices * 4 / 3;
+			}
+			else
+			{
+				for (int quadrant = 0; quadrant < 4; quadrant++)
+				{
+					if (node.quadrantMask & (1 << quadrant))
+					{
+						m_gridMesh.drawRange(quadrant * quadrantIndices, quadrantIndices);
+						m_stats.triangles += quadrantIndices / 3;
+					}
+				}
+			}
+			m_stats.nodes++;
+		}
+		glBindVertexArray(0);
+	}
+}
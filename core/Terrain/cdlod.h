@@ -0,0 +1,89 @@
+#ifndef CDLOD_H
+#define CDLOD_H
+#pragma once
+#include "../ew/mesh.h"
+#include "../Shader/Shader.h"
+#include "array2d.h"
+#include "heightTexture.h"
+#include <vector>
+
+namespace ew {
+	struct CDLODSettings {
+		int gridResolution = 32; //cells per side of the shared grid mesh, even
+		float lodDistanceScale = 3.0f; //LOD range as a multiple of the node size at that level
+		float morphStartRatio = 0.66f; //fraction of a LOD range where morphing to the next level starts
+	};
+
+	struct CDLODNode {
+		int cellX = 0; //corner of the node in height field cells
+		int cellZ = 0;
+		int sizeCells = 0;
+		int level = 0; //0 is the finest
+		int quadrantMask = 0xF; //quadrants of the grid to draw, bit (z * 2 + x)
+	};
+
+	struct CDLODStats {
+		int nodes = 0; //selected nodes
+		int triangles = 0;
+		int fullGridTriangles = 0; //what a single full resolution mesh would draw
+		int levels = 0;
+	};
+
+	/// <summary>
+	/// CPU side of the CDLOD terrain: a min/max quadtree over a height field and the distance based node selection.
+	/// Level 0 nodes are gridResolution cells wide, every level above doubles that.
+	/// A node is split while its children are inside the next finer LOD range, so neighbouring nodes never differ by more than one level
+	/// </summary>
+	class CDLODQuadtree {
+	public:
+		void init(float width, float height, int subDivisions, const Array2D<float>& heights, const CDLODSettings& settings = CDLODSettings());
+		void select(const glm::vec3& cameraPos, std::vector<CDLODNode>* nodes) const;
+		float getRange(int level) const;
+		glm::vec2 getMorphRange(int level) const;
+		inline int getLevels() const { return m_levels; }
+		inline int getSubDivisions() const { return m_subDivisions; }
+		inline glm::vec2 getCellSize() const { return m_cellSize; }
+		inline const CDLODSettings& getSettings() const { return m_settings; }
+		inline void setLodDistanceScale(float scale) { m_settings.lodDistanceScale = scale; }
+
+	private:
+		bool selectNode(int level, int nodeX, int nodeZ, const glm::vec3& cameraPos, std::vector<CDLODNode>* nodes) const;
+		bool inRange(int level, int nodeX, int nodeZ, float range, const glm::vec3& cameraPos) const;
+		int nodesPerSide(int level) const;
+
+		CDLODSettings m_settings;
+		int m_subDivisions = 0;
+		int m_levels = 0;
+		glm::vec2 m_cellSize = glm::vec2(1.0f);
+		std::vector<std::vector<glm::vec2>> m_minMax; //per level, per node (min, max) height
+	};
+
+	/// <summary>
+	/// Draws a height field with CDLOD. Every selected node draws the same small grid mesh,
+	/// the vertex shader (cdlodVShader.vert) places it, reads heights from a float texture and morphs
+	/// vertices into the next coarser level as they near the end of their LOD range
+	/// </summary>
+	class CDLODTerrain {
+	public:
+		CDLODTerrain() {}
+		~CDLODTerrain();
+		CDLODTerrain(const CDLODTerrain&) = delete;
+		CDLODTerrain& operator=(const CDLODTerrain&) = delete;
+
+		void init(float width, float height, int subDivisions, const Array2D<float>& heights, const CDLODSettings& settings = CDLODSettings());
+		void draw(const Shader& shader, const glm::vec3& cameraPos, unsigned int heightFieldSlot);
+		inline const CDLODStats& getStats() const { return m_stats; }
+		inline CDLODQuadtree& getQuadtree() { return m_quadtree; }
+
+	private:
+		CDLODQuadtree m_quadtree;
+		Mesh m_gridMesh;
+		HeightTexture m_heightTexture;
+		std::vector<CDLODNode> m_selection;
+		CDLODStats m_stats;
+	};
+
+	void createCDLODGrid(int gridResolution, MeshData* meshData);
+}
+
+#endif // CDLOD_H
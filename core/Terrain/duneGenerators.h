@@ -0,0 +1,291 @@
+#ifndef DUNE_GENERATORS_H
+#define DUNE_GENERATORS_H
+#pragma once
+#include "../ew/ewMath/ewMath.h"
+#include "duneKernel.h"
+#include <math.h>
+#include <stdlib.h>
+
+namespace ew {
+	//Dune shapes. Each one is a type with
+	//	name()                     label for UI and benchmarks
+	//	height(col, row)           exact scalar height, the reference for everything else
+	//	lanes<V>(col, row)         the same height for V::WIDTH consecutive columns, see duneKernelSimd.h.
+	//	                           lanesSin/lanesCos/... are found through V's namespace
+	//To add a shape, write such a type and append it to DuneGenerators below. Its dune type is its position in the list
+
+	struct RootDunes {
+		static const char* name() { return "root dunes"; }
+		static float height(int col, int row) {
+			return abs(sinf(sqrt(col))) + cosf(sqrt(row)) + cosf(sqrt(col)) * 3;
+		}
+		template<typename V>
+		static V lanes(V col, int row) {
+			//Terms that only depend on the row are computed once, in the same precision height uses
+			V sqrtCol = lanesSqrt(col);
+			return lanesAbs(lanesSin(sqrtCol)) + V(cosf((float)sqrt((double)row))) + lanesCos(sqrtCol) * V(3.0f);
+		}
+	};
+
+	struct TerracedDunes {
+		static const char* name() { return "terraced dunes"; }
+		static float height(int col, int row) {
+			return cosf(col/PI) + sinf(sqrt(col)/18) + floor(row/10)/8;
+		}
+		template<typename V>
+		static V lanes(V col, int row) {
+			return lanesCos(col / V(PI)) + lanesSin(lanesSqrt(col) / V(18.0f)) + V((float)((row / 10) / 8.0));
+		}
+	};
+
+	struct StraightRidges {
+		static const char* name() { return "straight ridges"; }
+		static float height(int col, int /*row*/) {
+			//double precision sin, which is what makeDune always resolved to
+			return sin((double)(col/(3*PI/2)));
+		}
+		template<typename V>
+		static V lanes(V col, int /*row*/) {
+			return lanesSin(col / V(3.0f * PI / 2.0f));
+		}
+	};
+
+	struct CrossedDunes {
+		static const char* name() { return "crossed dunes"; }
+		static float height(int col, int row) {
+			return cos(sqrt(row)) + abs(sin(sqrt(row+col)));
+		}
+		template<typename V>
+		static V lanes(V col, int row) {
+			return V((float)cos(sqrt((double)row))) + lanesAbs(lanesSin(lanesSqrt(col + V((float)row))));
+		}
+	};
+
+	struct DiagonalDunes {
+		static const char* name() { return "diagonal dunes"; }
+		static float height(int col, int row) {
+			return cos(sqrt(col)) + abs(sin(sqrt(row+col)));
+		}
+		template<typename V>
+		static V lanes(V col, int row) {
+			return lanesCos(lanesSqrt(col)) + lanesAbs(lanesSin(lanesSqrt(col + V((float)row))));
+		}
+	};
+
+	//Any type outside the list
+	struct SineGrid {
+		static const char* name() { return "sine grid"; }
+		static float height(int col, int row) {
+			return sin(col) + sin(row);
+		}
+		template<typename V>
+		static V lanes(V col, int row) {
+			return lanesSin(col) + V((float)sin((double)row));
+		}
+	};
+
+	template<typename... Dunes>
+	struct DuneList {};
+
+	using DuneGenerators = DuneList<RootDunes, TerracedDunes, StraightRidges, CrossedDunes, DiagonalDunes>;
+	using FallbackDune = SineGrid;
+
+	namespace duneRegistry {
+		template<typename F>
+		inline void visit(DuneList<>, int /*index*/, F& f) {
+			f(FallbackDune());
+		}
+		template<typename Dune, typename... Rest, typename F>
+		inline void visit(DuneList<Dune, Rest...>, int index, F& f) {
+			if (index == 0) {
+				f(Dune());
+			}
+			else {
+				visit(DuneList<Rest...>(), index - 1, f);
+			}
+		}
+		template<typename... Dunes>
+		constexpr int count(DuneList<Dunes...>) {
+			return sizeof...(Dunes);
+		}
+	}
+
+	/// <summary>
+	/// Calls f with a default constructed generator for the dune type. Meant to be called once, outside the sample loops,
+	/// so f's body is instantiated per generator and its loops run without a type check
+	/// </summary>
+	template<typename F>
+	inline void visitDune(int type, F&& f) {
+		duneRegistry::visit(DuneGenerators(), type, f);
+	}
+
+	inline int getDuneTypeCount() {
+		return duneRegistry::count(DuneGenerators());
+	}
+
+	inline const char* getDuneName(int type) {
+		const char* name = "";
+		visitDune(type, [&](auto dune) { name = decltype(dune)::name(); });
+		return name;
+	}
+
+	/// <summary>
+	/// edgeSmoother for one generator: the dune height with a falloff near the edges of the terrain
+	/// </summary>
+	template<typename Dune>
+	inline float smoothEdges(int col, int row, int subDivisions) {
+		const double K = (3.0 * PI) / 2.0;
+		float H = 0;
+		float x = col, y = row;
+		float lowerBound = (float)subDivisions / 5.0;
+		float upperBound = (float)subDivisions - ((float)subDivisions / 10.0);
+		//the dune itself is only evaluated where no edge falloff replaces it
+		if (x < lowerBound) {
+			if (y > lowerBound) {
+				float J = Dune::height((int)lowerBound, (int)y);
+				H = cos(x / K) * J - abs(J);
+			}
+			else if (y < lowerBound) {
+				float J = Dune::height((int)lowerBound, (int)lowerBound);
+				if (cos(y / K) * J - abs(J) > cos(x / K) * J - abs(J)) {
+					H = cos(x / K) * J - abs(J);
+				}
+				else {
+					H = cos(y / K) * J - abs(J);
+				}
+			}
+			else {
+				//the border column left of the grid repeats column 0, the dunes take roots of col
+				H = Dune::height(col < 0 ? 0 : col, row);
+			}
+		}
+		else if (y < lowerBound) {
+			float J = Dune::height((int)x, (int)lowerBound);
+			H = sin(y / K) * J;
+		}
+		else if (x > upperBound) {
+			if (y < upperBound) {
+				float J = Dune::height((int)upperBound, (int)y);
+				H = sin(x / K) * J;
+			}
+			else if (y > upperBound) {
+				float J = Dune::height((int)upperBound, (int)upperBound);
+				H = cos(x / K) * J - abs(J);
+			}
+			else {
+				H = Dune::height(col, row);
+			}
+		}
+		else if (y > upperBound) {
+			float J = Dune::height((int)x, (int)upperBound);
+			H = sin(y / K) * J;
+		}
+		else {
+			H = Dune::height(col, row);
+		}
+		return H;
+	}
+
+	/// <summary>
+	/// smoothEdges for count consecutive columns. The dune span runs through duneRow (from getDuneRowFunction),
+	/// the edge falloff mirrors smoothEdges exactly with the dune samples it needs computed once per row
+	/// </summary>
+	template<typename Dune>
+	void smoothEdgesRow(int colBegin, int row, int count, int subDivisions, DuneRowFunction duneRow, float* out) {
+		const double K = (3.0 * PI) / 2.0;
+		float y = row;
+		float lowerBound = (float)subDivisions / 5.0;
+		float upperBound = (float)subDivisions - ((float)subDivisions / 10.0);
+		int colEnd = colBegin + count;
+
+		//Columns that sample the dune at their own column: [spanBegin, spanEnd)
+		//Below the lower band they sample the lower bound row and above the upper band the upper bound row, scaled by sin(y)
+		int spanBegin = (int)ceilf(lowerBound);
+		int spanEnd = (y < lowerBound) ? colEnd : (int)floorf(upperBound) + 1;
+		int duneRowIndex = row;
+		bool scaled = y < lowerBound || y > upperBound;
+		if (y < lowerBound) {
+			duneRowIndex = (int)lowerBound;
+		}
+		else if (y > upperBound) {
+			duneRowIndex = (int)upperBound;
+		}
+		//On exactly the band rows the side columns fall through to the dune as well
+		if (y == lowerBound) {
+			spanBegin = colBegin;
+		}
+		if (y == upperBound) {
+			spanEnd = colEnd;
+		}
+		spanBegin = spanBegin < colBegin ? colBegin : spanBegin;
+		spanEnd = spanEnd > colEnd ? colEnd : spanEnd;
+
+		if (spanEnd > spanBegin) {
+			float* span = out + (spanBegin - colBegin);
+			//border columns left of the grid repeat column 0, like smoothEdges
+			int duneBegin = spanBegin < 0 ? 0 : spanBegin;
+			for (int col = spanBegin; col < duneBegin && col < spanEnd; col++)
+			{
+				out[col - colBegin] = Dune::height(0, duneRowIndex);
+			}
+			if (spanEnd > duneBegin) {
+				duneRow(duneBegin, duneRowIndex, spanEnd - duneBegin, out + (duneBegin - colBegin));
+			}
+			if (scaled) {
+				double scale = sin(y / K);
+				for (int i = 0; i < spanEnd - spanBegin; i++)
+				{
+					span[i] = scale * span[i];
+				}
+			}
+		}
+
+		//Left band
+		if (colBegin < spanBegin) {
+			if (y > lowerBound) {
+				float J = Dune::height((int)lowerBound, row);
+				for (int col = colBegin; col < spanBegin; col++)
+				{
+					float x = col;
+					out[col - colBegin] = cos(x / K) * J - abs(J);
+				}
+			}
+			else if (y < lowerBound) {
+				float J = Dune::height((int)lowerBound, (int)lowerBound);
+				double cornerY = cos(y / K) * J - abs(J);
+				for (int col = colBegin; col < spanBegin; col++)
+				{
+					float x = col;
+					if (cornerY > cos(x / K) * J - abs(J)) {
+						out[col - colBegin] = cos(x / K) * J - abs(J);
+					}
+					else {
+						out[col - colBegin] = cos(y / K) * J - abs(J);
+					}
+				}
+			}
+		}
+
+		//Right band
+		if (spanEnd < colEnd) {
+			if (y < upperBound) {
+				float J = Dune::height((int)upperBound, row);
+				for (int col = spanEnd; col < colEnd; col++)
+				{
+					float x = col;
+					out[col - colBegin] = sin(x / K) * J;
+				}
+			}
+			else if (y > upperBound) {
+				float J = Dune::height((int)upperBound, (int)upperBound);
+				for (int col = spanEnd; col < colEnd; col++)
+				{
+					float x = col;
+					out[col - colBegin] = cos(x / K) * J - abs(J);
+				}
+			}
+		}
+	}
+}
+
+#endif // DUNE_GENERATORS_H
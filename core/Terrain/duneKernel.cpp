@@ -0,0 +1,140 @@
+#include "duneKernel.h"
+#include "duneKernelSimd.h"
+#include "duneGenerators.h"
+#include <math.h>
+#include <stdlib.h>
+
+#if defined(EW_DUNE_KERNEL_AVX2)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
+namespace ew {
+	//duneKernelAVX2.cpp
+	DuneRowFunction getDuneRowFunctionAVX2(int type);
+
+	template<typename Dune>
+	static void scalarDuneRow(int colBegin, int row, int count, float* out) {
+		for (int i = 0; i < count; i++)
+		{
+			out[i] = Dune::height(colBegin + i, row);
+		}
+	}
+
+	static bool cpuHasAVX2() {
+#if defined(EW_DUNE_KERNEL_AVX2)
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		if (!fma || !osxsave || (_xgetbv(0) & 0x6) != 0x6) {
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#else
+		return false;
+#endif
+	}
+
+	/// <summary>
+	/// Widest kernel this CPU runs. Checked once
+	/// </summary>
+	DuneKernel getBestDuneKernel() {
+		static const DuneKernel best = cpuHasAVX2() ? DuneKernel::AVX2 : DuneKernel::SIMD4;
+		return best;
+	}
+
+	bool isDuneKernelSupported(DuneKernel kernel) {
+		return kernel != DuneKernel::AVX2 || getBestDuneKernel() == DuneKernel::AVX2;
+	}
+
+	const char* getDuneKernelName(DuneKernel kernel) {
+		switch (kernel) {
+		case DuneKernel::SCALAR: return "scalar";
+#if defined(EW_DUNE_SSE2)
+		case DuneKernel::SIMD4: return "sse2";
+#else
+		case DuneKernel::SIMD4: return "simd4";
+#endif
+		case DuneKernel::AVX2: return "avx2";
+		default: return getDuneKernelName(getBestDuneKernel());
+		}
+	}
+
+	/// <summary>
+	/// Row evaluator for one dune type, instantiated for that generator so its column loop has no type branch.
+	/// Look it up once and call it for every row.
+	/// The SIMD kernels approximate sin/cos with polynomials, SCALAR is exact
+	/// </summary>
+	/// <param name="type">Dune type, see DuneGenerators</param>
+	/// <param name="kernel">Instruction set. AUTO picks getBestDuneKernel()</param>
+	DuneRowFunction getDuneRowFunction(int type, DuneKernel kernel) {
+		if (kernel == DuneKernel::AUTO || !isDuneKernelSupported(kernel)) {
+			kernel = getBestDuneKernel();
+		}
+		DuneRowFunction duneRow = NULL;
+		switch (kernel) {
+		case DuneKernel::AVX2:
+			duneRow = getDuneRowFunctionAVX2(type);
+			break;
+		case DuneKernel::SIMD4:
+			visitDune(type, [&](auto dune) { duneRow = &duneSimd::duneRow<duneSimd::Lanes4, decltype(dune)>; });
+			break;
+		default:
+			visitDune(type, [&](auto dune) { duneRow = &scalarDuneRow<decltype(dune)>; });
+			break;
+		}
+		return duneRow;
+	}
+
+	/// <summary>
+	/// Evaluates makeDune(colBegin + i, row, type) for i in [0, count)
+	/// </summary>
+	/// <param name="colBegin">First column</param>
+	/// <param name="row">Row, the same for every sample</param>
+	/// <param name="count">Number of consecutive columns</param>
+	/// <param name="type">Dune type</param>
+	/// <param name="out">Receives count samples</param>
+	/// <param name="kernel">Instruction set. AUTO picks getBestDuneKernel()</param>
+	void makeDuneRow(int colBegin, int row, int count, int type, float* out, DuneKernel kernel) {
+		getDuneRowFunction(type, kernel)(colBegin, row, count, out);
+	}
+
+	/// <summary>
+	/// Evaluates edgeSmoother(colBegin + i, row, subDivisions, type) for i in [0, count), see smoothEdgesRow
+	/// </summary>
+	/// <param name="colBegin">First column</param>
+	/// <param name="row">Row, the same for every sample</param>
+	/// <param name="count">Number of consecutive columns</param>
+	/// <param name="subDivisions">Number of subdivisions of the terrain</param>
+	/// <param name="type">Dune type</param>
+	/// <param name="out">Receives count samples</param>
+	/// <param name="kernel">Instruction set. SCALAR runs smoothEdges per sample</param>
+	void edgeSmootherRow(int colBegin, int row, int count, int subDivisions, int type, float* out, DuneKernel kernel) {
+		DuneRowFunction duneRow = getDuneRowFunction(type, kernel);
+		visitDune(type, [&](auto dune) {
+			using Dune = decltype(dune);
+			if (kernel == DuneKernel::SCALAR) {
+				for (int i = 0; i < count; i++)
+				{
+					out[i] = smoothEdges<Dune>(colBegin + i, row, subDivisions);
+				}
+			}
+			else {
+				smoothEdgesRow<Dune>(colBegin, row, count, subDivisions, duneRow, out);
+			}
+		});
+	}
+}
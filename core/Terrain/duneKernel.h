@@ -0,0 +1,30 @@
+#ifndef DUNE_KERNEL_H
+#define DUNE_KERNEL_H
+#pragma once
+
+namespace ew {
+	/// <summary>
+	/// Instruction sets the row evaluators can use. SCALAR calls makeDune/edgeSmoother and is the reference and the default.
+	/// The vector kernels approximate sin/cos and land within a few 1e-6, so callers opt in to them
+	/// </summary>
+	enum class DuneKernel {
+		SCALAR = 0,
+		SIMD4 = 1, //SSE2 on x86, portable 4 lane code elsewhere
+		AVX2 = 2,
+		AUTO = 3
+	};
+
+	/// <summary>
+	/// Fills out[i] with the dune height at (colBegin + i, row) for i in [0, count), for one dune type and kernel
+	/// </summary>
+	typedef void (*DuneRowFunction)(int colBegin, int row, int count, float* out);
+
+	DuneKernel getBestDuneKernel();
+	bool isDuneKernelSupported(DuneKernel kernel);
+	const char* getDuneKernelName(DuneKernel kernel);
+	DuneRowFunction getDuneRowFunction(int type, DuneKernel kernel = DuneKernel::SCALAR);
+	void makeDuneRow(int colBegin, int row, int count, int type, float* out, DuneKernel kernel = DuneKernel::SCALAR);
+	void edgeSmootherRow(int colBegin, int row, int count, int subDivisions, int type, float* out, DuneKernel kernel = DuneKernel::SCALAR);
+}
+
+#endif // DUNE_KERNEL_H
@@ -0,0 +1,21 @@
+//Compiled with AVX2/FMA enabled (see core/CMakeLists.txt). Only reached through duneKernel.cpp after a CPU check,
+//so nothing in here may be called directly or share inline code with other translation units
+#define EW_DUNE_KERNEL_AVX2_TU
+#include "duneKernelSimd.h"
+#include "duneGenerators.h"
+
+namespace ew {
+	DuneRowFunction getDuneRowFunctionAVX2(int type);
+
+#if defined(EW_DUNE_KERNEL_AVX2) && defined(__AVX2__)
+	DuneRowFunction getDuneRowFunctionAVX2(int type) {
+		DuneRowFunction duneRow = NULL;
+		visitDune(type, [&](auto dune) { duneRow = &duneSimd::duneRow<duneSimd::Lanes8, decltype(dune)>; });
+		return duneRow;
+	}
+#else
+	DuneRowFunction getDuneRowFunctionAVX2(int type) {
+		return NULL;
+	}
+#endif
+}
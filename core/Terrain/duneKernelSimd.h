@@ -0,0 +1,171 @@
+#ifndef DUNE_KERNEL_SIMD_H
+#define DUNE_KERNEL_SIMD_H
+#pragma once
+//Internal to the core's SIMD loops: dune kernels, ripple textures, the RTIN mesher, culling and Array2D operations. Everything here is a template over a lane type,
+//so code built with AVX2 enabled is never shared with translation units that run without the CPU check
+
+#include <math.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EW_DUNE_SSE2 1
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace ew {
+	namespace duneSimd {
+#if !defined(EW_DUNE_KERNEL_AVX2_TU)
+#if defined(EW_DUNE_SSE2)
+		/// <summary>
+		/// 4 lanes of SSE2. Masks are all-ones/all-zero lanes
+		/// </summary>
+		struct Lanes4 {
+			static const int WIDTH = 4;
+			__m128 v;
+			Lanes4() {}
+			Lanes4(__m128 v) : v(v) {}
+			Lanes4(float s) : v(_mm_set1_ps(s)) {}
+			static Lanes4 iota(int start) { return _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(start), _mm_set_epi32(3, 2, 1, 0))); }
+			static Lanes4 load(const float* in) { return _mm_loadu_ps(in); }
+			void store(float* out) const { _mm_storeu_ps(out, v); }
+		};
+		inline Lanes4 operator+(Lanes4 a, Lanes4 b) { return _mm_add_ps(a.v, b.v); }
+		inline Lanes4 operator-(Lanes4 a, Lanes4 b) { return _mm_sub_ps(a.v, b.v); }
+		inline Lanes4 operator*(Lanes4 a, Lanes4 b) { return _mm_mul_ps(a.v, b.v); }
+		inline Lanes4 operator/(Lanes4 a, Lanes4 b) { return _mm_div_ps(a.v, b.v); }
+		inline Lanes4 lanesSqrt(Lanes4 a) { return _mm_sqrt_ps(a.v); }
+		inline Lanes4 lanesAbs(Lanes4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+		inline Lanes4 lanesGreaterEqual(Lanes4 a, Lanes4 b) { return _mm_cmpge_ps(a.v, b.v); }
+		inline Lanes4 lanesMin(Lanes4 a, Lanes4 b) { return _mm_min_ps(a.v, b.v); }
+		inline Lanes4 lanesMax(Lanes4 a, Lanes4 b) { return _mm_max_ps(a.v, b.v); }
+		inline Lanes4 lanesSelect(Lanes4 mask, Lanes4 a, Lanes4 b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+		inline Lanes4 lanesFloor(Lanes4 a) {
+			//SSE2 has no floor: truncate, then step down where truncation rounded up. Valid for |a| < 2^31
+			__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+			return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a.v), _mm_set1_ps(1.0f)));
+		}
+#else
+		/// <summary>
+		/// 4 lanes of plain floats for targets without SSE2. Written so the compiler can map it to NEON and friends.
+		/// Masks are 1/0 lanes
+		/// </summary>
+		struct Lanes4 {
+			static const int WIDTH = 4;
+			float v[4];
+			Lanes4() {}
+			Lanes4(float s) { for (int i = 0; i < 4; i++) v[i] = s; }
+			static Lanes4 iota(int start) { Lanes4 r; for (int i = 0; i < 4; i++) r.v[i] = (float)(start + i); return r; }
+			static Lanes4 load(const float* in) { Lanes4 r; for (int i = 0; i < 4; i++) r.v[i] = in[i]; return r; }
+			void store(float* out) const { for (int i = 0; i < 4; i++) out[i] = v[i]; }
+		};
+#define EW_DUNE_LANES4_OP(name, expr) inline Lanes4 name(Lanes4 a, Lanes4 b) { Lanes4 r; for (int i = 0; i < 4; i++) r.v[i] = (expr); return r; }
+		EW_DUNE_LANES4_OP(operator+, a.v[i] + b.v[i])
+		EW_DUNE_LANES4_OP(operator-, a.v[i] - b.v[i])
+		EW_DUNE_LANES4_OP(operator*, a.v[i] * b.v[i])
+		EW_DUNE_LANES4_OP(operator/, a.v[i] / b.v[i])
+		EW_DUNE_LANES4_OP(lanesGreaterEqual, a.v[i] >= b.v[i] ? 1.0f : 0.0f)
+		EW_DUNE_LANES4_OP(lanesMin, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+		EW_DUNE_LANES4_OP(lanesMax, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+#undef EW_DUNE_LANES4_OP
+		inline Lanes4 lanesSqrt(Lanes4 a) { Lanes4 r; for (int i = 0; i < 4; i++) r.v[i] = sqrtf(a.v[i]); return r; }
+		inline Lanes4 lanesAbs(Lanes4 a) { Lanes4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] < 0.0f ? -a.v[i] : a.v[i]; return r; }
+		inline Lanes4 lanesSelect(Lanes4 mask, Lanes4 a, Lanes4 b) { Lanes4 r; for (int i = 0; i < 4; i++) r.v[i] = mask.v[i] != 0.0f ? a.v[i] : b.v[i]; return r; }
+		inline Lanes4 lanesFloor(Lanes4 a) { Lanes4 r; for (int i = 0; i < 4; i++) { float t = (float)(long long)a.v[i]; r.v[i] = t > a.v[i] ? t - 1.0f : t; } return r; }
+#endif
+#endif // !EW_DUNE_KERNEL_AVX2_TU
+
+#if defined(__AVX2__)
+		/// <summary>
+		/// 8 lanes of AVX2/FMA. Only instantiated in duneKernelAVX2.cpp
+		/// </summary>
+		struct Lanes8 {
+			static const int WIDTH = 8;
+			__m256 v;
+			Lanes8() {}
+			Lanes8(__m256 v) : v(v) {}
+			Lanes8(float s) : v(_mm256_set1_ps(s)) {}
+			static Lanes8 iota(int start) { return _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(start), _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0))); }
+			static Lanes8 load(const float* in) { return _mm256_loadu_ps(in); }
+			void store(float* out) const { _mm256_storeu_ps(out, v); }
+		};
+		inline Lanes8 operator+(Lanes8 a, Lanes8 b) { return _mm256_add_ps(a.v, b.v); }
+		inline Lanes8 operator-(Lanes8 a, Lanes8 b) { return _mm256_sub_ps(a.v, b.v); }
+		inline Lanes8 operator*(Lanes8 a, Lanes8 b) { return _mm256_mul_ps(a.v, b.v); }
+		inline Lanes8 operator/(Lanes8 a, Lanes8 b) { return _mm256_div_ps(a.v, b.v); }
+		inline Lanes8 lanesSqrt(Lanes8 a) { return _mm256_sqrt_ps(a.v); }
+		inline Lanes8 lanesAbs(Lanes8 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+		inline Lanes8 lanesGreaterEqual(Lanes8 a, Lanes8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+		inline Lanes8 lanesSelect(Lanes8 mask, Lanes8 a, Lanes8 b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+		inline Lanes8 lanesFloor(Lanes8 a) { return _mm256_floor_ps(a.v); }
+#endif
+
+		/// <summary>
+		/// Shared range reduction for lanesSin/lanesCos: x = quadrant * PI/2 + r with |r| <= PI/4.
+		/// PI/2 is split in three parts (Cody-Waite) so large columns keep their precision
+		/// </summary>
+		template<typename V>
+		inline void reduceQuadrant(V x, V* r, V* quadrant) {
+			V q = lanesFloor(x * V(0.636619772f) + V(0.5f));
+			*r = x - q * V(1.5703125f) - q * V(4.837512969970703125e-4f) - q * V(7.54978995489188216e-8f);
+			*quadrant = q - lanesFloor(q * V(0.25f)) * V(4.0f);
+		}
+
+		//Minimax polynomials on [-PI/4, PI/4]
+		template<typename V>
+		inline V sinPoly(V r) {
+			V r2 = r * r;
+			return r + r * r2 * (V(-1.6666654611e-1f) + r2 * (V(8.3321608736e-3f) + r2 * V(-1.9515295891e-4f)));
+		}
+		template<typename V>
+		inline V cosPoly(V r) {
+			V r2 = r * r;
+			return V(1.0f) - r2 * V(0.5f) + r2 * r2 * (V(4.166664568298827e-2f) + r2 * (V(-1.388731625493765e-3f) + r2 * V(2.443315711809948e-5f)));
+		}
+		template<typename V>
+		inline V lanesSinQuadrant(V r, V quadrant) {
+			//quadrant 0: sin, 1: cos, 2: -sin, 3: -cos
+			V half = lanesFloor(quadrant * V(0.5f));
+			V odd = quadrant - half * V(2.0f);
+			V value = lanesSelect(lanesGreaterEqual(odd, V(0.5f)), cosPoly(r), sinPoly(r));
+			return value * (V(1.0f) - half * V(2.0f));
+		}
+		template<typename V>
+		inline V lanesSin(V x) {
+			V r, quadrant;
+			reduceQuadrant(x, &r, &quadrant);
+			return lanesSinQuadrant(r, quadrant);
+		}
+		template<typename V>
+		inline V lanesCos(V x) {
+			//cos(x) = sin(x + PI/2): same reduction, one quadrant further
+			V r, quadrant;
+			reduceQuadrant(x, &r, &quadrant);
+			quadrant = quadrant + V(1.0f);
+			quadrant = quadrant - lanesFloor(quadrant * V(0.25f)) * V(4.0f);
+			return lanesSinQuadrant(r, quadrant);
+		}
+
+		/// <summary>
+		/// Dune::height for count consecutive columns, V::WIDTH at a time through Dune::lanes
+		/// </summary>
+		template<typename V, typename Dune>
+		void duneRow(int colBegin, int row, int count, float* out) {
+			int col = 0;
+			for (; col + V::WIDTH <= count; col += V::WIDTH)
+			{
+				Dune::template lanes<V>(V::iota(colBegin + col), row).store(out + col);
+			}
+			if (col < count) {
+				float tail[V::WIDTH];
+				Dune::template lanes<V>(V::iota(colBegin + col), row).store(tail);
+				for (int i = 0; col + i < count; i++)
+				{
+					out[col + i] = tail[i];
+				}
+			}
+		}
+	}
+}
+
+#endif // DUNE_KERNEL_SIMD_H
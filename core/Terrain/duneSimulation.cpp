@@ -0,0 +1,295 @@
+#include "duneSimulation.h"
+#include "parallel.h"
+#include "array2dOps.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <float.h>
+#include <vector>
+
+namespace ew {
+	namespace {
+		//Edge length of the square tiles the avalanche sweeps are split into
+		const int AVALANCHE_TILE_SIZE = 64;
+		//A slab still in the air after this many hops lands wherever it is
+		const int MAX_HOPS = 64;
+
+		uint64_t mix(uint64_t z) {
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		//splitmix64, one stream per row and tick so rows can run on any thread
+		struct RowRandom {
+			uint64_t state;
+			RowRandom(uint64_t seed, uint64_t tick, int row) : state(mix(seed ^ mix(tick * 0x9E3779B97F4A7C15ull + (uint64_t)row))) {}
+			//uniform in [0, 1)
+			inline float next() {
+				state += 0x9E3779B97F4A7C15ull;
+				return (float)(mix(state) >> 40) * (1.0f / 16777216.0f);
+			}
+		};
+
+		//Sand c gains from neighbour n: positive if n is too steep above c, negative if c is too steep above n.
+		//Exactly the negative of what n gains from c, so sweeps keep the total
+		inline float slide(float n, float c, float repose) {
+			return std::max(0.0f, n - c - repose) - std::max(0.0f, c - n - repose);
+		}
+
+		inline float relax(float c, float left, float right, float up, float down, float repose, float rate) {
+			return c + rate * (slide(left, c, repose) + slide(right, c, repose) + slide(up, c, repose) + slide(down, c, repose));
+		}
+
+	}
+
+	/// <summary>
+	/// Starts a simulation from a height field. Everything below its lowest sample is bedrock that never erodes
+	/// </summary>
+	/// <param name="heights">Initial heights, at least 3 x 3. Copied</param>
+	/// <param name="settings">Transport parameters</param>
+	/// <param name="numThreads">Threads each tick is split over</param>
+	void DuneSimulation::init(const Array2D<float>& heights, const DuneSimulationSettings& settings, int numThreads) {
+		m_settings = settings;
+		m_settings.hopLength = std::max(1, std::min(settings.hopLength, heights.GetWidth() - 1));
+		setNumThreads(numThreads);
+		m_fields[0].CopyFrom(heights);
+		m_fields[1].CopyFrom(heights);
+		m_current = 0;
+		m_tick = 0;
+		m_lastSlabsMoved = 0;
+
+		float highest;
+		getMinMax(heights, &m_bedrock, &highest);
+	}
+
+	/// <summary>
+	/// Advances the simulation by whole ticks
+	/// </summary>
+	void DuneSimulation::step(int ticks) {
+		int width = m_fields[0].GetWidth();
+		int height = m_fields[0].GetHeight();
+		int tilesX = (width + AVALANCHE_TILE_SIZE - 1) / AVALANCHE_TILE_SIZE;
+		int tilesY = (height + AVALANCHE_TILE_SIZE - 1) / AVALANCHE_TILE_SIZE;
+
+		for (int tick = 0; tick < ticks; tick++)
+		{
+			//the wind blows along rows, so every row saltates on its own
+			std::atomic<int> slabsMoved(0);
+			parallelFor(0, height, m_numThreads, [&](int rowBegin, int rowEnd) {
+				slabsMoved += transportRows(rowBegin, rowEnd);
+			});
+
+			for (int sweep = 0; sweep < m_settings.avalancheSweeps; sweep++)
+			{
+				const Array2D<float>& source = m_fields[m_current];
+				Array2D<float>* destination = &m_fields[1 - m_current];
+				parallelFor(0, tilesX * tilesY, m_numThreads, [&](int tileBegin, int tileEnd) {
+					avalancheTiles(tileBegin, tileEnd, source, destination);
+				});
+				m_current = 1 - m_current;
+			}
+
+			m_tick++;
+			m_lastSlabsMoved = slabsMoved;
+		}
+	}
+
+	/// <summary>
+	/// Saltation for rows [rowBegin, rowEnd) of the current field: slabs are picked up outside the wind shadow
+	/// and hop downwind until they land
+	/// </summary>
+	/// <returns>Number of slabs moved</returns>
+	int DuneSimulation::transportRows(int rowBegin, int rowEnd) {
+		Array2D<float>& field = m_fields[m_current];
+		int width = field.GetWidth();
+		float slab = m_settings.slabHeight;
+		float shadowDrop = m_settings.shadowSlope * m_settings.cellSize;
+		//sand at least one slab deep
+		float sandLevel = m_bedrock + slab;
+		std::vector<unsigned char> shadow(width);
+		int slabsMoved = 0;
+
+		for (int row = rowBegin; row < rowEnd; row++)
+		{
+			float* heights = field.GetAddr(0, row);
+
+			//A cell is in shadow while it lies below the line falling from an upwind crest at the shadow slope.
+			//The first pass only carries crests from the end of the row around to its start
+			float shadowTop = -FLT_MAX;
+			for (int col = 0; col < width; col++)
+			{
+				shadowTop = std::max(shadowTop - shadowDrop, heights[col]);
+			}
+			for (int col = 0; col < width; col++)
+			{
+				shadowTop = std::max(shadowTop - shadowDrop, heights[col]);
+				shadow[col] = heights[col] < shadowTop;
+			}
+
+			RowRandom random(m_settings.seed, m_tick, row);
+			for (int col = 0; col < width; col++)
+			{
+				if (shadow[col] || heights[col] < sandLevel || random.next() >= m_settings.erodeChance) {
+					continue;
+				}
+				heights[col] -= slab;
+				int landing = col;
+				for (int hop = 0; ; hop++)
+				{
+					landing += m_settings.hopLength;
+					if (landing >= width) {
+						landing -= width;
+					}
+					if (shadow[landing] || hop == MAX_HOPS) {
+						break;
+					}
+					float depositChance = heights[landing] >= sandLevel ? m_settings.depositChanceSand : m_settings.depositChanceBare;
+					if (random.next() < depositChance) {
+						break;
+					}
+				}
+				heights[landing] += slab;
+				slabsMoved++;
+			}
+		}
+		return slabsMoved;
+	}
+
+	/// <summary>
+	/// One avalanche sweep over tiles [tileBegin, tileEnd), row major over the tile grid.
+	/// Reads only source, so tiles can run in any order
+	/// </summary>
+	void DuneSimulation::avalancheTiles(int tileBegin, int tileEnd, const Array2D<float>& source, Array2D<float>* destination) const {
+		int width = source.GetWidth();
+		int height = source.GetHeight();
+		int tilesX = (width + AVALANCHE_TILE_SIZE - 1) / AVALANCHE_TILE_SIZE;
+		float repose = m_settings.reposeSlope * m_settings.cellSize;
+		float rate = m_settings.avalancheRate;
+
+		for (int tile = tileBegin; tile < tileEnd; tile++)
+		{
+			int colBegin = (tile % tilesX) * AVALANCHE_TILE_SIZE;
+			int rowBegin = (tile / tilesX) * AVALANCHE_TILE_SIZE;
+			int colEnd = std::min(colBegin + AVALANCHE_TILE_SIZE, width);
+			int rowEnd = std::min(rowBegin + AVALANCHE_TILE_SIZE, height);
+
+			for (int row = rowBegin; row < rowEnd; row++)
+			{
+				const float* up = source.GetAddr(0, row == 0 ? height - 1 : row - 1);
+				const float* center = source.GetAddr(0, row);
+				const float* down = source.GetAddr(0, row == height - 1 ? 0 : row + 1);
+				float* out = destination->GetAddr(0, row);
+
+				//the wrapped columns, so the loop between them needs no checks
+				int begin = colBegin, end = colEnd;
+				if (begin == 0) {
+					out[0] = relax(center[0], center[width - 1], center[1], up[0], down[0], repose, rate);
+					begin = 1;
+				}
+				if (end == width) {
+					out[width - 1] = relax(center[width - 1], center[width - 2], center[0], up[width - 1], down[width - 1], repose, rate);
+					end = width - 1;
+				}
+				for (int col = begin; col < end; col++)
+				{
+					out[col] = relax(center[col], center[col - 1], center[col + 1], up[col], down[col], repose, rate);
+				}
+			}
+		}
+	}
+
+	DuneSimulationRunner::~DuneSimulationRunner() {
+		stop();
+	}
+
+	/// <summary>
+	/// Starts stepping a new simulation. A running one is stopped first
+	/// </summary>
+	/// <param name="heights">Initial heights, see DuneSimulation::init</param>
+	/// <param name="settings">Transport parameters</param>
+	/// <param name="ticksPerSecond">Fixed tick rate</param>
+	/// <param name="numThreads">Threads each tick is split over. 0 uses every hardware thread</param>
+	void DuneSimulationRunner::start(const Array2D<float>& heights, const DuneSimulationSettings& settings, float ticksPerSecond, int numThreads) {
+		stop();
+		m_simulation.init(heights, settings, numThreads > 0 ? numThreads : defaultThreadCount());
+		m_tickSeconds = 1.0f / ticksPerSecond;
+		m_published.CopyFrom(heights);
+		m_publishedTick = 0;
+		m_takenTick = 0;
+		m_stats = DuneSimulationStats();
+		m_quit = false;
+		m_worker = std::thread(&DuneSimulationRunner::workerLoop, this);
+	}
+
+	/// <summary>
+	/// Stops after the tick in progress. The last published heights can still be taken
+	/// </summary>
+	void DuneSimulationRunner::stop() {
+		if (!m_worker.joinable()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_wakeWorker.notify_all();
+		m_worker.join();
+	}
+
+	/// <summary>
+	/// Copies the newest finished tick into heights, if it is newer than the last one taken
+	/// </summary>
+	/// <returns>True if heights changed</returns>
+	bool DuneSimulationRunner::takeHeights(Array2D<float>* heights) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_publishedTick == m_takenTick) {
+			return false;
+		}
+		heights->CopyFrom(m_published);
+		m_takenTick = m_publishedTick;
+		return true;
+	}
+
+	DuneSimulationStats DuneSimulationRunner::getStats() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_stats;
+	}
+
+	void DuneSimulationRunner::workerLoop() {
+		typedef std::chrono::steady_clock Clock;
+		Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_tickSeconds));
+		Clock::time_point nextTick = Clock::now() + period;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				if (m_wakeWorker.wait_until(lock, nextTick, [this] { return m_quit; })) {
+					return;
+				}
+			}
+
+			Clock::time_point start = Clock::now();
+			m_simulation.step();
+			float tickMs = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				const Array2D<float>& heights = m_simulation.getHeights();
+				m_published.CopyFrom(heights);
+				m_publishedTick = m_simulation.getTick();
+				m_stats.ticks = m_publishedTick;
+				m_stats.lastTickMs = tickMs;
+				m_stats.lastSlabsMoved = m_simulation.getLastSlabsMoved();
+			}
+
+			//ticks stay the same length. A simulation that cannot keep up skips the backlog instead of never sleeping again
+			nextTick += period;
+			Clock::time_point now = Clock::now();
+			if (now - nextTick > period * 4) {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stats.droppedTicks += (int)((now - nextTick) / period);
+				nextTick = now;
+			}
+		}
+	}
+}
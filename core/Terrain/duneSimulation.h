@@ -0,0 +1,95 @@
+#ifndef DUNE_SIMULATION_H
+#define DUNE_SIMULATION_H
+#pragma once
+#include "array2d.h"
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+
+namespace ew {
+	/// <summary>
+	/// Werner style sand transport. Heights and cellSize are in the same unit, slopes are height per cell
+	/// </summary>
+	struct DuneSimulationSettings {
+		float cellSize = 1.0f; //horizontal size of a cell
+		float slabHeight = 0.05f; //sand moved per pick up
+		int hopLength = 4; //cells a slab travels downwind per hop
+		float erodeChance = 0.1f; //per cell and tick, for cells outside the shadow with sand left
+		float depositChanceSand = 0.6f; //per hop, landing on sand
+		float depositChanceBare = 0.4f; //per hop, landing on bedrock
+		float shadowSlope = 0.268f; //tan(15 deg), slabs always stop in the wind shadow behind a crest
+		float reposeSlope = 0.577f; //tan(30 deg), steeper neighbours avalanche
+		float avalancheRate = 0.2f; //fraction of the excess slope moved per sweep, at most 0.25
+		int avalancheSweeps = 4; //per tick
+		uint64_t seed = 1;
+	};
+
+	/// <summary>
+	/// Moves sand over a height field in fixed ticks. Wind blows towards +col and both directions wrap around.
+	/// A tick first saltates slabs along each row, then relaxes slopes steeper than the angle of repose in tiles.
+	/// Results only depend on the settings and the tick, never on the thread count
+	/// </summary>
+	class DuneSimulation {
+	public:
+		void init(const Array2D<float>& heights, const DuneSimulationSettings& settings, int numThreads = 1);
+		void step(int ticks = 1);
+		inline const Array2D<float>& getHeights() const { return m_fields[m_current]; }
+		inline uint64_t getTick() const { return m_tick; }
+		inline int getLastSlabsMoved() const { return m_lastSlabsMoved; }
+		inline void setNumThreads(int numThreads) { m_numThreads = numThreads > 0 ? numThreads : 1; }
+
+	private:
+		int transportRows(int rowBegin, int rowEnd);
+		void avalancheTiles(int tileBegin, int tileEnd, const Array2D<float>& source, Array2D<float>* destination) const;
+
+		DuneSimulationSettings m_settings;
+		Array2D<float> m_fields[2]; //the avalanche sweeps ping pong between them
+		int m_current = 0;
+		float m_bedrock = 0.0f;
+		uint64_t m_tick = 0;
+		int m_lastSlabsMoved = 0;
+		int m_numThreads = 1;
+	};
+
+	struct DuneSimulationStats {
+		uint64_t ticks = 0;
+		int droppedTicks = 0; //ticks skipped because the simulation fell behind
+		float lastTickMs = 0.0f;
+		int lastSlabsMoved = 0;
+	};
+
+	/// <summary>
+	/// Steps a DuneSimulation on a worker thread at a fixed tick rate, independent of the frame rate.
+	/// Every finished tick is published, takeHeights() hands the newest one to the render thread
+	/// </summary>
+	class DuneSimulationRunner {
+	public:
+		DuneSimulationRunner() {}
+		~DuneSimulationRunner();
+		DuneSimulationRunner(const DuneSimulationRunner&) = delete;
+		DuneSimulationRunner& operator=(const DuneSimulationRunner&) = delete;
+
+		void start(const Array2D<float>& heights, const DuneSimulationSettings& settings, float ticksPerSecond, int numThreads = 0);
+		void stop();
+		inline bool isRunning() const { return m_worker.joinable(); }
+		bool takeHeights(Array2D<float>* heights);
+		DuneSimulationStats getStats() const;
+
+	private:
+		void workerLoop();
+
+		DuneSimulation m_simulation;
+		float m_tickSeconds = 0.05f;
+		std::thread m_worker;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_wakeWorker;
+		bool m_quit = false;
+		Array2D<float> m_published;
+		uint64_t m_publishedTick = 0;
+		uint64_t m_takenTick = 0;
+		DuneSimulationStats m_stats;
+	};
+}
+
+#endif // DUNE_SIMULATION_H
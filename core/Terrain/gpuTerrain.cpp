@@ -0,0 +1,70 @@
+#include "gpuTerrain.h"
+#include "../ew/gridIndices.h"
+#include "../ew/external/glad.h"
+
+namespace ew {
+	GpuTerrain::~GpuTerrain() {
+		deleteHeightTexture(&m_heightTexture);
+		if (m_vao) {
+			glDeleteVertexArrays(1, &m_vao);
+		}
+	}
+
+	/// <summary>
+	/// Uploads the height field and binds the shared grid indices to an attribute-less VAO
+	/// </summary>
+	/// <param name="width">Total width</param>
+	/// <param name="height">Total height</param>
+	/// <param name="subDivisions">Number of subdivisions</param>
+	/// <param name="heights">Height field with a one sample border, from createHeightField</param>
+	/// <param name="format">R16 halves the texture, heights are quantized to 1/65535 of their range</param>
+	/// <param name="triangleStrips">Draw with the strip layout of the shared grid indices</param>
+	void GpuTerrain::init(float width, float height, int subDivisions, const Array2D<float>& heights, HeightTextureFormat format, bool triangleStrips) {
+		m_width = width;
+		m_height = height;
+		m_subDivisions = subDivisions;
+
+		deleteHeightTexture(&m_heightTexture);
+		m_heightTexture = createHeightTexture(heights, format);
+		m_indexBuffer = getGridIndexBuffer(subDivisions, triangleStrips);
+
+		if (!m_vao) {
+			glGenVertexArrays(1, &m_vao);
+		}
+		glBindVertexArray(m_vao);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer.ebo);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	/// <summary>
+	/// Replaces the heights, e.g. with a tick of a DuneSimulation. The size must match init
+	/// </summary>
+	void GpuTerrain::updateHeights(const Array2D<float>& heights) {
+		updateHeightTexture(&m_heightTexture, heights);
+	}
+
+	/// <summary>
+	/// Draws with a terrainPullVShader.vert based shader, which must be in use with uModel, uView and uProjection set
+	/// </summary>
+	/// <param name="shader">Shader to set the height field uniforms on</param>
+	/// <param name="heightFieldSlot">Texture unit for the height field</param>
+	/// <param name="drawMode">POINTS draws every vertex once, in grid order</param>
+	void GpuTerrain::draw(const Shader& shader, unsigned int heightFieldSlot, DrawMode drawMode) const {
+		glActiveTexture(GL_TEXTURE0 + heightFieldSlot);
+		glBindTexture(GL_TEXTURE_2D, m_heightTexture.id);
+		shader.setInt("uHeightField", heightFieldSlot);
+		shader.setVec2("uHeightRange", glm::vec2(m_heightTexture.scale, m_heightTexture.offset));
+		shader.setInt("uSubDivisions", m_subDivisions);
+		shader.setVec2("uTerrainSize", glm::vec2(m_width, m_height));
+
+		glBindVertexArray(m_vao);
+		if (drawMode == DrawMode::TRIANGLES) {
+			drawIndexBuffer(m_indexBuffer, 0, m_indexBuffer.numIndices);
+		}
+		else {
+			glDrawArrays(GL_POINTS, 0, getNumVertices());
+		}
+		glBindVertexArray(0);
+	}
+}
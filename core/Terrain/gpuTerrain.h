@@ -0,0 +1,39 @@
+#ifndef GPU_TERRAIN_H
+#define GPU_TERRAIN_H
+#pragma once
+#include "../ew/mesh.h"
+#include "../Shader/Shader.h"
+#include "array2d.h"
+#include "heightTexture.h"
+
+namespace ew {
+	/// <summary>
+	/// Terrain without a vertex buffer. The only per vertex data on the GPU is the height texture;
+	/// terrainPullVShader.vert turns gl_VertexID into a grid point and rebuilds position, normal, uv and tangent
+	/// the way createTerrain does. Indices come from the shared grid index buffer
+	/// </summary>
+	class GpuTerrain {
+	public:
+		GpuTerrain() {}
+		~GpuTerrain();
+		GpuTerrain(const GpuTerrain&) = delete;
+		GpuTerrain& operator=(const GpuTerrain&) = delete;
+
+		void init(float width, float height, int subDivisions, const Array2D<float>& heights, HeightTextureFormat format = HeightTextureFormat::R16, bool triangleStrips = false);
+		void updateHeights(const Array2D<float>& heights);
+		void draw(const Shader& shader, unsigned int heightFieldSlot, DrawMode drawMode = DrawMode::TRIANGLES) const;
+		inline int getNumVertices() const { return (m_subDivisions + 1) * (m_subDivisions + 1); }
+		inline size_t getGpuBytes() const { return m_heightTexture.getBytes(); }
+		inline const HeightTexture& getHeightTexture() const { return m_heightTexture; }
+
+	private:
+		unsigned int m_vao = 0;
+		HeightTexture m_heightTexture;
+		IndexBuffer m_indexBuffer;
+		float m_width = 0.0f;
+		float m_height = 0.0f;
+		int m_subDivisions = 0;
+	};
+}
+
+#endif // GPU_TERRAIN_H
@@ -0,0 +1,338 @@
+#include "heightFieldFile.h"
+#include <algorithm>
+#include <string.h>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ew {
+	namespace {
+		const char HEIGHT_FIELD_MAGIC[4] = { 'E', 'W', 'H', 'F' };
+		const uint32_t HEIGHT_FIELD_FORMAT_VERSION = 1;
+		const int TILE = HeightFieldLayout::TILE;
+		const size_t TILE_BYTES = TILE * TILE * sizeof(float);
+		//bands of tiles copyWindow asks for ahead of the one it is copying
+		const int PREFETCH_BANDS = 2;
+
+		size_t getDataBytes(int cols, int rows) {
+			return HeightFieldLayout::StorageSize(HeightFieldLayout::Pitch(cols, sizeof(float)), rows) * sizeof(float);
+		}
+
+		bool isValidHeader(const HeightFieldHeader& header, size_t fileSize) {
+			return memcmp(header.magic, HEIGHT_FIELD_MAGIC, sizeof(HEIGHT_FIELD_MAGIC)) == 0
+				&& header.formatVersion == HEIGHT_FIELD_FORMAT_VERSION
+				&& header.tileBits == (uint32_t)HeightFieldLayout::TILE_BITS
+				&& header.cols > 0 && header.rows > 0 && header.cols <= 0x7FFFFFFF && header.rows <= 0x7FFFFFFF
+				&& HEIGHT_FIELD_DATA_OFFSET + getDataBytes((int)header.cols, (int)header.rows) == fileSize;
+		}
+
+		size_t getPageSize() {
+#if defined(_WIN32)
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return info.dwPageSize;
+#else
+			return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+		}
+	}
+
+	HeightFieldWriter::~HeightFieldWriter() {
+		if (m_file != nullptr) {
+			fclose(m_file);
+			remove(m_tempPath.c_str());
+		}
+	}
+
+	/// <summary>
+	/// Starts a height field file. Rows go in with writeRow, first to last, and the file only appears under path once close() succeeds
+	/// </summary>
+	bool HeightFieldWriter::open(const std::string& path, int cols, int rows) {
+		if (m_file != nullptr || cols <= 0 || rows <= 0) {
+			return false;
+		}
+		m_path = path;
+		m_tempPath = path + ".tmp";
+		m_file = fopen(m_tempPath.c_str(), "wb");
+		if (m_file == nullptr) {
+			return false;
+		}
+		m_cols = cols;
+		m_rows = rows;
+		m_rowsWritten = 0;
+
+		HeightFieldHeader header;
+		memcpy(header.magic, HEIGHT_FIELD_MAGIC, sizeof(HEIGHT_FIELD_MAGIC));
+		header.formatVersion = HEIGHT_FIELD_FORMAT_VERSION;
+		header.cols = (uint32_t)cols;
+		header.rows = (uint32_t)rows;
+		header.tileBits = HeightFieldLayout::TILE_BITS;
+		char page[HEIGHT_FIELD_DATA_OFFSET] = {};
+		memcpy(page, &header, sizeof(header));
+		m_ok = fwrite(page, sizeof(page), 1, m_file) == 1;
+		m_band.InitArray2D(cols, TILE, 0.0f);
+		return m_ok;
+	}
+
+	/// <param name="heights">The next row, getWidth() of them</param>
+	bool HeightFieldWriter::writeRow(const float* heights) {
+		if (m_file == nullptr || m_rowsWritten >= m_rows) {
+			return false;
+		}
+		int rowInBand = m_rowsWritten % TILE;
+		for (int col = 0; col < m_cols; col++)
+		{
+			m_band.At(col, rowInBand) = heights[col];
+		}
+		m_rowsWritten++;
+		if (rowInBand == TILE - 1 || m_rowsWritten == m_rows) {
+			m_ok = m_ok && flushBand();
+		}
+		return m_ok;
+	}
+
+	//A band of tiles is a contiguous run of the file. The rows of a last partial band past the end are never read
+	bool HeightFieldWriter::flushBand() {
+		size_t count = m_band.GetStorageSize();
+		return fwrite(m_band.GetBaseAddr(), sizeof(float), count, m_file) == count;
+	}
+
+	/// <summary>
+	/// Syncs the file and renames it into place
+	/// </summary>
+	/// <returns>False if a write failed or rows are missing. path is left as it was</returns>
+	bool HeightFieldWriter::close() {
+		if (m_file == nullptr) {
+			return false;
+		}
+		bool ok = m_ok && m_rowsWritten == m_rows && fflush(m_file) == 0;
+#if defined(_WIN32)
+		ok = ok && _commit(_fileno(m_file)) == 0;
+#else
+		ok = ok && fsync(fileno(m_file)) == 0;
+#endif
+		ok = fclose(m_file) == 0 && ok;
+		m_file = nullptr;
+		m_band.Destroy();
+#if defined(_WIN32)
+		ok = ok && MoveFileExA(m_tempPath.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+		ok = ok && rename(m_tempPath.c_str(), m_path.c_str()) == 0;
+#endif
+		if (!ok) {
+			remove(m_tempPath.c_str());
+		}
+		return ok;
+	}
+
+	/// <summary>
+	/// Writes a height field that fits in memory
+	/// </summary>
+	bool writeHeightField(const std::string& path, const Array2D<float>& heights) {
+		HeightFieldWriter writer;
+		bool ok = writer.open(path, heights.GetWidth(), heights.GetHeight());
+		for (int row = 0; ok && row < heights.GetHeight(); row++)
+		{
+			ok = writer.writeRow(heights.GetAddr(0, row));
+		}
+		return writer.close() && ok;
+	}
+
+	HeightFieldFile::~HeightFieldFile() {
+		close();
+	}
+
+	HeightFieldFile::HeightFieldFile(HeightFieldFile&& other) noexcept {
+		*this = std::move(other);
+	}
+
+	HeightFieldFile& HeightFieldFile::operator=(HeightFieldFile&& other) noexcept {
+		if (this != &other) {
+			close();
+			m_view = other.m_view;
+			m_size = other.m_size;
+			m_access = other.m_access;
+			m_heights = std::move(other.m_heights);
+			other.m_view = nullptr;
+			other.m_size = 0;
+#if defined(_WIN32)
+			m_file = other.m_file;
+			m_mapping = other.m_mapping;
+			other.m_file = nullptr;
+			other.m_mapping = nullptr;
+#endif
+		}
+		return *this;
+	}
+
+	/// <summary>
+	/// Maps a file written by HeightFieldWriter. Nothing is read until heights are, apart from the header
+	/// </summary>
+	/// <param name="access">COPY_ON_WRITE allows getWritableHeights, e.g. for editing or simulating on top of the file</param>
+	/// <returns>False if the file is missing, truncated or not a height field</returns>
+	bool HeightFieldFile::open(const std::string& path, HeightFieldAccess access) {
+		close();
+		bool copyOnWrite = access == HeightFieldAccess::COPY_ON_WRITE;
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)HEIGHT_FIELD_DATA_OFFSET) {
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, NULL, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+		void* view = mapping ? MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0) : NULL;
+		if (view == NULL) {
+			if (mapping) {
+				CloseHandle(mapping);
+			}
+			CloseHandle(file);
+			return false;
+		}
+		m_file = file;
+		m_mapping = mapping;
+		m_size = (size_t)size.QuadPart;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size < (off_t)HEIGHT_FIELD_DATA_OFFSET) {
+			::close(fd);
+			return false;
+		}
+		void* view = mmap(NULL, (size_t)info.st_size, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (view == MAP_FAILED) {
+			return false;
+		}
+		//no read ahead on faults, prefetch says what is needed
+		madvise(view, (size_t)info.st_size, MADV_RANDOM);
+		m_size = (size_t)info.st_size;
+#endif
+		m_view = view;
+		m_access = access;
+		const HeightFieldHeader& header = *(const HeightFieldHeader*)view;
+		if (!isValidHeader(header, m_size)) {
+			close();
+			return false;
+		}
+		m_heights.InitArray2DView((int)header.cols, (int)header.rows, (float*)((char*)view + HEIGHT_FIELD_DATA_OFFSET));
+		return true;
+	}
+
+	void HeightFieldFile::close() {
+		if (m_view == nullptr) {
+			return;
+		}
+		m_heights.Destroy();
+#if defined(_WIN32)
+		UnmapViewOfFile(m_view);
+		CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		m_mapping = nullptr;
+		m_file = nullptr;
+#else
+		munmap(m_view, m_size);
+#endif
+		m_view = nullptr;
+		m_size = 0;
+	}
+
+	/// <summary>
+	/// Starts reading the tiles under a region in the background
+	/// </summary>
+	void HeightFieldFile::prefetch(int col, int row, int cols, int rows) const {
+		advise(col, row, cols, rows, Advice::WILL_NEED);
+	}
+
+	/// <summary>
+	/// Lets the OS drop the tiles under a region, they are read again if needed. Does nothing for COPY_ON_WRITE files,
+	/// where it would throw away the writes
+	/// </summary>
+	void HeightFieldFile::release(int col, int row, int cols, int rows) const {
+		if (m_access == HeightFieldAccess::READ_ONLY) {
+			advise(col, row, cols, rows, Advice::DONT_NEED);
+		}
+	}
+
+	//Every band of tiles a region crosses is one contiguous range of pages
+	void HeightFieldFile::advise(int col, int row, int cols, int rows, Advice advice) const {
+		int colEnd = std::min(col + cols, getWidth());
+		int rowEnd = std::min(row + rows, getHeight());
+		col = std::max(col, 0);
+		row = std::max(row, 0);
+		if (m_view == nullptr || col >= colEnd || row >= rowEnd) {
+			return;
+		}
+		size_t pageSize = getPageSize();
+		char* data = (char*)m_view + HEIGHT_FIELD_DATA_OFFSET;
+		int tilesPerRow = m_heights.GetPitch() / TILE;
+		for (int band = row / TILE; band <= (rowEnd - 1) / TILE; band++)
+		{
+			size_t begin = ((size_t)band * tilesPerRow + col / TILE) * TILE_BYTES;
+			size_t end = ((size_t)band * tilesPerRow + (colEnd - 1) / TILE + 1) * TILE_BYTES;
+			char* first = (char*)((size_t)(data + begin) / pageSize * pageSize);
+			char* last = (char*)(((size_t)(data + end) + pageSize - 1) / pageSize * pageSize);
+#if defined(_WIN32)
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+			if (advice == Advice::WILL_NEED) {
+				WIN32_MEMORY_RANGE_ENTRY range = { first, (SIZE_T)(last - first) };
+				PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+			}
+#endif
+#else
+			madvise(first, (size_t)(last - first), advice == Advice::WILL_NEED ? MADV_WILLNEED : MADV_DONTNEED);
+#endif
+		}
+	}
+
+	/// <summary>
+	/// Copies a region into a row major grid for the terrain builders. The tiles a couple of bands ahead are prefetched
+	/// while a band is copied, so reading from disk overlaps with copying
+	/// </summary>
+	/// <param name="window">Resized to cols x rows</param>
+	/// <param name="prefetchAhead">False reads tiles only as they are touched</param>
+	/// <returns>False if the region is not inside the field</returns>
+	bool HeightFieldFile::copyWindow(int col, int row, int cols, int rows, Array2D<float>* window, bool prefetchAhead) const {
+		if (m_view == nullptr || col < 0 || row < 0 || cols <= 0 || rows <= 0 || col + cols > getWidth() || row + rows > getHeight()) {
+			return false;
+		}
+		window->InitArray2D(cols, rows);
+		int firstBand = row / TILE;
+		int lastBand = (row + rows - 1) / TILE;
+		if (prefetchAhead) {
+			prefetch(col, firstBand * TILE, cols, PREFETCH_BANDS * TILE);
+		}
+		for (int band = firstBand; band <= lastBand; band++)
+		{
+			if (prefetchAhead) {
+				prefetch(col, (band + PREFETCH_BANDS) * TILE, cols, TILE);
+			}
+			int bandEnd = std::min((band + 1) * TILE, row + rows);
+			for (int r = std::max(band * TILE, row); r < bandEnd; r++)
+			{
+				float* out = window->GetAddr(0, r - row);
+				for (int c = 0; c < cols; c++)
+				{
+					out[c] = m_heights.Get(col + c, r);
+				}
+			}
+		}
+		return true;
+	}
+}
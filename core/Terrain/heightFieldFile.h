@@ -0,0 +1,104 @@
+#ifndef HEIGHT_FIELD_FILE_H
+#define HEIGHT_FIELD_FILE_H
+#pragma once
+#include "array2d.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+namespace ew {
+	//32 x 32 heights per tile, 4 KB, so every tile is one page and a window only touches the pages it covers
+	typedef MortonLayout<5> HeightFieldLayout;
+	typedef Array2D<float, HeightFieldLayout> TiledHeights;
+
+	/// <summary>
+	/// Start of a height field file. The tiles follow at HEIGHT_FIELD_DATA_OFFSET, in TiledHeights storage order.
+	/// Native endian, like the mesh cache
+	/// </summary>
+	struct HeightFieldHeader {
+		char magic[4]; //"EWHF"
+		uint32_t formatVersion;
+		uint32_t cols;
+		uint32_t rows;
+		uint32_t tileBits;
+	};
+
+	//the header gets a page of its own so the tiles stay page aligned
+	const size_t HEIGHT_FIELD_DATA_OFFSET = 4096;
+
+	enum class HeightFieldAccess {
+		READ_ONLY = 0,
+		COPY_ON_WRITE = 1 //writes stay in this process and never reach the file
+	};
+
+	/// <summary>
+	/// Writes a height field file row by row, holding one band of tiles at a time, so fields larger than memory can be written
+	/// </summary>
+	class HeightFieldWriter {
+	public:
+		HeightFieldWriter() {}
+		~HeightFieldWriter();
+		HeightFieldWriter(const HeightFieldWriter&) = delete;
+		HeightFieldWriter& operator=(const HeightFieldWriter&) = delete;
+
+		bool open(const std::string& path, int cols, int rows);
+		bool writeRow(const float* heights);
+		bool close();
+
+	private:
+		bool flushBand();
+
+		FILE* m_file = nullptr;
+		std::string m_path;
+		std::string m_tempPath;
+		int m_cols = 0;
+		int m_rows = 0;
+		int m_rowsWritten = 0;
+		bool m_ok = false;
+		TiledHeights m_band; //the tiles of the rows since the last full band
+	};
+
+	bool writeHeightField(const std::string& path, const Array2D<float>& heights);
+
+	/// <summary>
+	/// A height field file mapped into memory. Only the pages that are read take up memory, so fields far larger than RAM
+	/// can be meshed a window at a time. prefetch and release tell the OS which tiles are needed next and which are done
+	/// </summary>
+	class HeightFieldFile {
+	public:
+		HeightFieldFile() {}
+		~HeightFieldFile();
+		HeightFieldFile(HeightFieldFile&& other) noexcept;
+		HeightFieldFile& operator=(HeightFieldFile&& other) noexcept;
+		HeightFieldFile(const HeightFieldFile&) = delete;
+		HeightFieldFile& operator=(const HeightFieldFile&) = delete;
+
+		bool open(const std::string& path, HeightFieldAccess access = HeightFieldAccess::READ_ONLY);
+		void close();
+		inline bool isOpen() const { return m_view != nullptr; }
+		inline int getWidth() const { return m_heights.GetWidth(); }
+		inline int getHeight() const { return m_heights.GetHeight(); }
+		inline size_t getBytes() const { return m_size; }
+		inline const TiledHeights& getHeights() const { return m_heights; }
+		inline TiledHeights* getWritableHeights() { return m_access == HeightFieldAccess::COPY_ON_WRITE ? &m_heights : nullptr; }
+
+		void prefetch(int col, int row, int cols, int rows) const;
+		void release(int col, int row, int cols, int rows) const;
+		bool copyWindow(int col, int row, int cols, int rows, Array2D<float>* window, bool prefetchAhead = true) const;
+
+	private:
+		enum class Advice { WILL_NEED, DONT_NEED };
+		void advise(int col, int row, int cols, int rows, Advice advice) const;
+
+		void* m_view = nullptr;
+		size_t m_size = 0;
+		HeightFieldAccess m_access = HeightFieldAccess::READ_ONLY;
+		TiledHeights m_heights; //a view into the mapping
+#if defined(_WIN32)
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#endif
+	};
+}
+
+#endif // HEIGHT_FIELD_FILE_H
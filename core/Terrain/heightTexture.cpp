@@ -0,0 +1,90 @@
+#include "heightTexture.h"
+#include "array2dOps.h"
+#include "../ew/external/glad.h"
+#include <math.h>
+#include <vector>
+
+namespace ew {
+	namespace {
+		//R16 stores heights relative to their range, so the texture keeps the scale and offset to undo it
+		void uploadHeights(HeightTexture* texture, const Array2D<float>& heights, bool allocate) {
+			texture->width = heights.GetWidth();
+			texture->height = heights.GetHeight();
+			glBindTexture(GL_TEXTURE_2D, texture->id);
+			if (texture->format == HeightTextureFormat::R16) {
+				float minHeight, maxHeight;
+				getMinMax(heights, &minHeight, &maxHeight);
+				float range = maxHeight > minHeight ? maxHeight - minHeight : 1.0f;
+				texture->scale = range;
+				texture->offset = minHeight;
+
+				std::vector<unsigned short> texels(heights.GetSize());
+				for (int row = 0; row < texture->height; row++)
+				{
+					const float* src = heights.GetAddr(0, row);
+					unsigned short* dst = &texels[(size_t)row * texture->width];
+					for (int col = 0; col < texture->width; col++)
+					{
+						dst[col] = (unsigned short)lrintf((src[col] - minHeight) / range * 65535.0f);
+					}
+				}
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+				if (allocate) {
+					glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, texture->width, texture->height, 0, GL_RED, GL_UNSIGNED_SHORT, texels.data());
+				}
+				else {
+					glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texture->width, texture->height, GL_RED, GL_UNSIGNED_SHORT, texels.data());
+				}
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			}
+			else {
+				texture->scale = 1.0f;
+				texture->offset = 0.0f;
+				//rows are padded to whole cache lines
+				glPixelStorei(GL_UNPACK_ROW_LENGTH, heights.GetPitch());
+				if (allocate) {
+					glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, texture->width, texture->height, 0, GL_RED, GL_FLOAT, heights.GetBaseAddr());
+				}
+				else {
+					glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texture->width, texture->height, GL_RED, GL_FLOAT, heights.GetBaseAddr());
+				}
+				glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+			}
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+	}
+
+	/// <summary>
+	/// Uploads a height field as a single channel texture with linear filtering and clamped edges.
+	/// Texel (col, row) holds heights.Get(col, row), as texel * scale + offset for R16
+	/// </summary>
+	/// <param name="heights">Height field, e.g. from createHeightField</param>
+	/// <param name="format">R32F keeps heights exact, R16 halves the memory</param>
+	/// <returns>The texture. The caller owns it, see deleteHeightTexture</returns>
+	HeightTexture createHeightTexture(const Array2D<float>& heights, HeightTextureFormat format) {
+		HeightTexture texture;
+		texture.format = format;
+		glGenTextures(1, &texture.id);
+		glBindTexture(GL_TEXTURE_2D, texture.id);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		uploadHeights(&texture, heights, true);
+		return texture;
+	}
+
+	/// <summary>
+	/// Replaces the contents of a texture made by createHeightTexture. The size must not change
+	/// </summary>
+	void updateHeightTexture(HeightTexture* texture, const Array2D<float>& heights) {
+		uploadHeights(texture, heights, false);
+	}
+
+	void deleteHeightTexture(HeightTexture* texture) {
+		if (texture->id) {
+			glDeleteTextures(1, &texture->id);
+			texture->id = 0;
+		}
+	}
+}
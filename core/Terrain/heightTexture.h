@@ -0,0 +1,28 @@
+#ifndef HEIGHT_TEXTURE_H
+#define HEIGHT_TEXTURE_H
+#pragma once
+#include "array2d.h"
+#include <stddef.h>
+
+namespace ew {
+	enum class HeightTextureFormat {
+		R32F = 0,
+		R16 = 1 //normalized, heights = texel * scale + offset
+	};
+
+	struct HeightTexture {
+		unsigned int id = 0;
+		int width = 0;
+		int height = 0;
+		HeightTextureFormat format = HeightTextureFormat::R32F;
+		float scale = 1.0f;
+		float offset = 0.0f;
+		inline size_t getBytes() const { return (size_t)width * height * (format == HeightTextureFormat::R16 ? 2 : 4); }
+	};
+
+	HeightTexture createHeightTexture(const Array2D<float>& heights, HeightTextureFormat format = HeightTextureFormat::R32F);
+	void updateHeightTexture(HeightTexture* texture, const Array2D<float>& heights);
+	void deleteHeightTexture(HeightTexture* texture);
+}
+
+#endif // HEIGHT_TEXTURE_H
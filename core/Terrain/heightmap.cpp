@@ -0,0 +1,173 @@
+#include "heightmap.h"
+#include "terrain.h"
+#include "parallel.h"
+#include "../ew/external/stb_image.h"
+#include <algorithm>
+#include <string.h>
+
+namespace ew {
+	namespace {
+		//This stb_image (2.28) hands out 16 bit PNM samples in file order, which is big endian
+		bool isBigEndianPnm(const char* path) {
+			FILE* file = fopen(path, "rb");
+			if (file == NULL) {
+				return false;
+			}
+			char magic[2] = {};
+			size_t read = fread(magic, 1, 2, file);
+			fclose(file);
+			const unsigned short one = 1;
+			bool littleEndianHost = *(const unsigned char*)&one == 1;
+			return littleEndianHost && read == 2 && magic[0] == 'P' && (magic[1] == '5' || magic[1] == '6');
+		}
+	}
+
+	/// <summary>
+	/// Decodes an 8 or 16 bit image into heights. Color images are converted to gray, 16 bit PNG and PNM keep all 16 bits.
+	/// The first row of the image is the far edge (-z) of the terrain, like a map seen from above
+	/// </summary>
+	/// <param name="path">Image file, anything stb_image reads</param>
+	/// <param name="heights">Filled with one height per pixel</param>
+	/// <param name="minHeight">Height of black</param>
+	/// <param name="maxHeight">Height of white</param>
+	/// <param name="bitDepth">Receives 8 or 16 if not null</param>
+	/// <returns>False if the image could not be read</returns>
+	bool loadHeightmap(const char* path, Array2D<float>* heights, float minHeight, float maxHeight, int* bitDepth) {
+		//row 0 is the near edge of the terrain, so the last image row has to come first
+		stbi_set_flip_vertically_on_load_thread(true);
+		int width, height, channels;
+		bool sixteenBit = stbi_is_16_bit(path) != 0;
+		void* data = sixteenBit ? (void*)stbi_load_16(path, &width, &height, &channels, 1) : (void*)stbi_load(path, &width, &height, &channels, 1);
+		if (data == NULL) {
+			printf("Failed to load heightmap %s: %s\n", path, stbi_failure_reason());
+			return false;
+		}
+
+		heights->InitArray2D(width, height);
+		float range = maxHeight - minHeight;
+		if (sixteenBit) {
+			bool swapBytes = isBigEndianPnm(path);
+			for (int row = 0; row < height; row++)
+			{
+				const unsigned short* pixels = (const unsigned short*)data + (size_t)row * width;
+				float* out = heights->GetAddr(0, row);
+				for (int col = 0; col < width; col++)
+				{
+					unsigned short pixel = swapBytes ? (unsigned short)((pixels[col] >> 8) | (pixels[col] << 8)) : pixels[col];
+					out[col] = minHeight + pixel * (range / 65535.0f);
+				}
+			}
+		}
+		else {
+			for (int row = 0; row < height; row++)
+			{
+				const unsigned char* pixels = (const unsigned char*)data + (size_t)row * width;
+				float* out = heights->GetAddr(0, row);
+				for (int col = 0; col < width; col++)
+				{
+					out[col] = minHeight + pixels[col] * (range / 255.0f);
+				}
+			}
+		}
+		stbi_image_free(data);
+		if (bitDepth) {
+			*bitDepth = sixteenBit ? 16 : 8;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Surrounds a height field with the one sample border createHeightField produces, so imported heights can go
+	/// anywhere dune heights go (createTerrainVertices, CDLODTerrain, GpuTerrain). The border continues the edge slope
+	/// </summary>
+	/// <param name="heights">At least 2 x 2 samples</param>
+	/// <param name="bordered">Receives (width + 2) x (height + 2) samples, heights.Get(col, row) at (col + 1, row + 1)</param>
+	void addHeightFieldBorder(const Array2D<float>& heights, Array2D<float>* bordered) {
+		int width = heights.GetWidth();
+		int height = heights.GetHeight();
+		bordered->InitArray2D(width + 2, height + 2);
+		for (int row = 0; row < height; row++)
+		{
+			const float* src = heights.GetAddr(0, row);
+			float* dst = bordered->GetAddr(0, row + 1);
+			memcpy(dst + 1, src, sizeof(float) * width);
+			dst[0] = 2.0f * src[0] - src[1];
+			dst[width + 1] = 2.0f * src[width - 1] - src[width - 2];
+		}
+		float* first = bordered->GetAddr(0, 0);
+		float* last = bordered->GetAddr(0, height + 1);
+		for (int col = 0; col < width + 2; col++)
+		{
+			first[col] = 2.0f * bordered->Get(col, 1) - bordered->Get(col, 2);
+			last[col] = 2.0f * bordered->Get(col, height) - bordered->Get(col, height - 1);
+		}
+	}
+
+	/// <summary>
+	/// Builds a terrain mesh with one vertex per height sample, e.g. from a HeightPyramid level
+	/// </summary>
+	/// <param name="width">Total width</param>
+	/// <param name="height">Total height</param>
+	/// <param name="heights">Square height field of at least 2 x 2 samples, without border</param>
+	/// <param name="mesh">MeshData struct to fill. Will be cleared.</param>
+	/// <param name="numThreads">Worker threads, each building a band of rows</param>
+	/// <returns>False if heights is not square or too small</returns>
+	bool createTerrainFromHeightmap(float width, float height, const Array2D<float>& heights, MeshData* mesh, int numThreads) {
+		if (heights.GetWidth() != heights.GetHeight() || heights.GetWidth() < 2) {
+			return false;
+		}
+		Array2D<float> bordered;
+		addHeightFieldBorder(heights, &bordered);
+		createTerrainFromHeightField(width, height, heights.GetWidth() - 1, bordered, mesh, numThreads);
+		return true;
+	}
+
+	/// <summary>
+	/// Builds every level from the one above it. The rows of a level are split over numThreads
+	/// </summary>
+	/// <param name="heights">Level 0, copied</param>
+	/// <param name="numThreads">Worker threads per level</param>
+	void HeightPyramid::build(const Array2D<float>& heights, int numThreads) {
+		int width = heights.GetWidth();
+		int height = heights.GetHeight();
+		m_numLevels = 1;
+		for (int w = width, h = height; w > 1 || h > 1; w = (w + 1) / 2, h = (h + 1) / 2)
+		{
+			m_numLevels++;
+		}
+		m_levels.reset(new Level[m_numLevels]);
+		m_levels[0].average.CopyFrom(heights);
+
+		for (int level = 1; level < m_numLevels; level++)
+		{
+			const Array2D<float>& srcMin = getMin(level - 1);
+			const Array2D<float>& srcMax = getMax(level - 1);
+			const Array2D<float>& srcAverage = getAverage(level - 1);
+			int srcWidth = srcAverage.GetWidth();
+			int srcHeight = srcAverage.GetHeight();
+			int dstWidth = (srcWidth + 1) / 2;
+			int dstHeight = (srcHeight + 1) / 2;
+			Level& dst = m_levels[level];
+			dst.min.InitArray2D(dstWidth, dstHeight);
+			dst.max.InitArray2D(dstWidth, dstHeight);
+			dst.average.InitArray2D(dstWidth, dstHeight);
+
+			parallelFor(0, dstHeight, numThreads, [&](int rowBegin, int rowEnd) {
+				for (int row = rowBegin; row < rowEnd; row++)
+				{
+					//an odd last row or column stands in for its missing neighbour
+					int row0 = row * 2;
+					int row1 = std::min(row0 + 1, srcHeight - 1);
+					for (int col = 0; col < dstWidth; col++)
+					{
+						int col0 = col * 2;
+						int col1 = std::min(col0 + 1, srcWidth - 1);
+						dst.min.At(col, row) = std::min(std::min(srcMin.Get(col0, row0), srcMin.Get(col1, row0)), std::min(srcMin.Get(col0, row1), srcMin.Get(col1, row1)));
+						dst.max.At(col, row) = std::max(std::max(srcMax.Get(col0, row0), srcMax.Get(col1, row0)), std::max(srcMax.Get(col0, row1), srcMax.Get(col1, row1)));
+						dst.average.At(col, row) = (srcAverage.Get(col0, row0) + srcAverage.Get(col1, row0) + srcAverage.Get(col0, row1) + srcAverage.Get(col1, row1)) * 0.25f;
+					}
+				}
+			});
+		}
+	}
+}
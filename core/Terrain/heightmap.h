@@ -0,0 +1,38 @@
+#ifndef HEIGHTMAP_H
+#define HEIGHTMAP_H
+#pragma once
+#include "../ew/mesh.h"
+#include "array2d.h"
+#include <memory>
+
+namespace ew {
+	bool loadHeightmap(const char* path, Array2D<float>* heights, float minHeight = 0.0f, float maxHeight = 1.0f, int* bitDepth = nullptr);
+	void addHeightFieldBorder(const Array2D<float>& heights, Array2D<float>* bordered);
+	bool createTerrainFromHeightmap(float width, float height, const Array2D<float>& heights, MeshData* meshData, int numThreads = 1);
+
+	/// <summary>
+	/// Min, max and average mip pyramid of a height field. Level 0 is the height field itself,
+	/// every further level halves both sides (rounding up) until a single sample is left.
+	/// Sample (x, y) of level l covers samples [x * 2^l, (x + 1) * 2^l) of level 0 in each direction
+	/// </summary>
+	class HeightPyramid {
+	public:
+		void build(const Array2D<float>& heights, int numThreads = 1);
+		inline int getLevels() const { return m_numLevels; }
+		inline const Array2D<float>& getAverage(int level) const { return m_levels[level].average; }
+		//level 0 has no separate min and max, they are the heights themselves
+		inline const Array2D<float>& getMin(int level) const { return level == 0 ? m_levels[0].average : m_levels[level].min; }
+		inline const Array2D<float>& getMax(int level) const { return level == 0 ? m_levels[0].average : m_levels[level].max; }
+
+	private:
+		struct Level {
+			Array2D<float> min;
+			Array2D<float> max;
+			Array2D<float> average;
+		};
+		std::unique_ptr<Level[]> m_levels;
+		int m_numLevels = 0;
+	};
+}
+
+#endif // HEIGHTMAP_H
@@ -0,0 +1,55 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#pragma once
+#include <thread>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Number of worker threads to use when the caller does not care
+	/// </summary>
+	inline int defaultThreadCount() {
+		unsigned int count = std::thread::hardware_concurrency();
+		return count > 0 ? (int)count : 1;
+	}
+
+	/// <summary>
+	/// Splits [begin, end) into contiguous bands, one per thread, and calls fn(bandBegin, bandEnd) for each.
+	/// The first band runs on the calling thread. Returns once every band is done.
+	/// Band boundaries only depend on the range and thread count, never on timing
+	/// </summary>
+	/// <param name="begin">First index</param>
+	/// <param name="end">One past the last index</param>
+	/// <param name="numThreads">Number of bands. Values below 1 run everything on the calling thread</param>
+	/// <param name="fn">Callable taking (int bandBegin, int bandEnd)</param>
+	template<typename Fn>
+	void parallelFor(int begin, int end, int numThreads, Fn fn) {
+		int count = end - begin;
+		if (count <= 0) {
+			return;
+		}
+		if (numThreads > count) {
+			numThreads = count;
+		}
+		if (numThreads <= 1) {
+			fn(begin, end);
+			return;
+		}
+
+		std::vector<std::thread> workers;
+		workers.reserve(numThreads - 1);
+		for (int band = 1; band < numThreads; band++)
+		{
+			int bandBegin = begin + (int)((long long)count * band / numThreads);
+			int bandEnd = begin + (int)((long long)count * (band + 1) / numThreads);
+			workers.emplace_back(fn, bandBegin, bandEnd);
+		}
+		fn(begin, begin + (int)((long long)count / numThreads));
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+}
+
+#endif // PARALLEL_H
@@ -0,0 +1,188 @@
+#include "rtinMesher.h"
+#include "terrain.h"
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace ew {
+	/// <summary>
+	/// Bounds the error of every triangle of the hierarchy in one bottom up pass, each triangle costs the same whatever its size
+	/// </summary>
+	/// <param name="subDivisions">Cells per side, a power of two</param>
+	/// <param name="heights">Height field with a one sample border</param>
+	/// <returns>False if subDivisions is not a power of two</returns>
+	bool RtinMesher::init(int subDivisions, const Array2D<float>& heights) {
+		if (subDivisions < 2 || (subDivisions & (subDivisions - 1)) != 0) {
+			return false;
+		}
+		int n = subDivisions;
+		int size = n + 1;
+		m_subDivisions = n;
+		m_stride = n + 3;
+		m_heights.resize(m_stride * m_stride);
+		for (int row = 0; row < m_stride; row++)
+		{
+			memcpy(&m_heights[row * m_stride], heights.GetAddr(0, row), sizeof(float) * m_stride);
+		}
+		m_errors.assign(size * size, 0.0f);
+
+		//every level of triangles that still has children, coarsest first. Children follow their parents, so a level stays close in memory
+		int numLevels = 0;
+		while ((2 << numLevels) < n * n) {
+			numLevels++;
+		}
+		std::vector<RtinTriangle> triangles;
+		triangles.reserve(n * n);
+		std::vector<size_t> levelBegin(numLevels + 1, 0);
+		triangles.push_back({ n, n, 0, 0, 0, n });
+		triangles.push_back({ 0, 0, n, n, n, 0 });
+		for (int level = 1; level < numLevels; level++)
+		{
+			levelBegin[level] = triangles.size();
+			for (size_t i = levelBegin[level - 1]; i < levelBegin[level]; i++)
+			{
+				RtinTriangle t = triangles[i];
+				int mx = (t.ax + t.bx) >> 1;
+				int my = (t.ay + t.by) >> 1;
+				triangles.push_back({ t.cx, t.cy, t.ax, t.ay, mx, my });
+				triangles.push_back({ t.bx, t.by, t.cx, t.cy, mx, my });
+			}
+		}
+		levelBegin[numLevels] = triangles.size();
+
+		//the smallest triangles, children of the last level, only have their long edge's midpoint inside
+		auto midpointError = [&](int ax, int ay, int bx, int by) {
+			return sample((ax + bx) >> 1, (ay + by) >> 1) - (sample(ax, ay) + sample(bx, by)) * 0.5f;
+		};
+		auto storeError = [&](int mx, int my, float error) {
+			//shared by the triangle on the other side of the long edge, both split together
+			float& stored = m_errors[my * size + mx];
+			stored = std::max(stored, error);
+		};
+		for (size_t i = levelBegin[numLevels - 1]; i < levelBegin[numLevels]; i++)
+		{
+			const RtinTriangle& t = triangles[i];
+			storeError((t.ax + t.cx) >> 1, (t.ay + t.cy) >> 1, fabsf(midpointError(t.ax, t.ay, t.cx, t.cy)));
+			storeError((t.bx + t.cx) >> 1, (t.by + t.cy) >> 1, fabsf(midpointError(t.bx, t.by, t.cx, t.cy)));
+		}
+
+		//Lowest and highest height minus the plane over the grid points of each triangle. A child's plane differs from its parent's
+		//by a linear function that is 0 at the two corners they share and the parent's midpoint error at the third, so a parent's
+		//range is its children's widened by that error. No triangle is scanned, and the range still bounds every point under it
+		std::vector<float> low(triangles.size()), high(triangles.size());
+		//a level at a time from the bottom, so a parent always reads final errors for its children
+		for (int level = numLevels - 1; level >= 0; level--)
+		{
+			for (size_t i = levelBegin[level]; i < levelBegin[level + 1]; i++)
+			{
+				const RtinTriangle& t = triangles[i];
+				float error = midpointError(t.ax, t.ay, t.bx, t.by);
+				if (level == numLevels - 1) {
+					//every grid point of the smallest listed triangles is on an edge, where the plane is the average of the edge's ends
+					float first = midpointError(t.ax, t.ay, t.cx, t.cy);
+					float second = midpointError(t.bx, t.by, t.cx, t.cy);
+					low[i] = std::min(std::min(error, 0.0f), std::min(first, second));
+					high[i] = std::max(std::max(error, 0.0f), std::max(first, second));
+				}
+				else {
+					//children follow in the order their parents are listed
+					size_t child = levelBegin[level + 1] + 2 * (i - levelBegin[level]);
+					low[i] = std::min(low[child], low[child + 1]) + std::min(error, 0.0f);
+					high[i] = std::max(high[child], high[child + 1]) + std::max(error, 0.0f);
+				}
+
+				float left = m_errors[((t.ay + t.cy) >> 1) * size + ((t.ax + t.cx) >> 1)];
+				float right = m_errors[((t.by + t.cy) >> 1) * size + ((t.bx + t.cx) >> 1)];
+				storeError((t.ax + t.bx) >> 1, (t.ay + t.by) >> 1, std::max(std::max(-low[i], high[i]), std::max(left, right)));
+			}
+		}
+		return true;
+	}
+
+	float RtinMesher::getMaxError() const {
+		int half = m_subDivisions / 2;
+		return m_errors.empty() ? 0.0f : m_errors[half * (m_subDivisions + 1) + half];
+	}
+
+	/// <summary>
+	/// Builds the coarsest mesh whose vertical error at every grid point stays within maxError. Vertices match
+	/// createTerrainVertices, normals included, so lighting keeps the detail the triangles drop
+	/// </summary>
+	/// <param name="width">Total width</param>
+	/// <param name="height">Total height</param>
+	/// <param name="maxError">Largest vertical error allowed, in height units. 0 keeps every bump</param>
+	/// <param name="mesh">MeshData struct to fill. Will be cleared.</param>
+	void RtinMesher::createMesh(float width, float height, float maxError, MeshData* mesh) const {
+		int n = m_subDivisions;
+		int size = n + 1;
+		mesh->vertices.clear();
+		mesh->indices.clear();
+		std::vector<int> vertexIndex(size * size, -1);
+
+		//Triangles first, by grid point, with every grid point numbered on first use. Numbering by first use
+		//keeps neighbouring triangles on nearby vertices
+		std::vector<glm::ivec2> used;
+		auto addCorner = [&](int col, int row) {
+			int gridIndex = row * size + col;
+			if (vertexIndex[gridIndex] < 0) {
+				vertexIndex[gridIndex] = (int)used.size();
+				used.push_back(glm::ivec2(col, row));
+			}
+			mesh->indices.push_back(vertexIndex[gridIndex]);
+		};
+
+		//depth first, so triangles that share vertices come out close together
+		std::vector<RtinTriangle> stack;
+		stack.push_back({ n, n, 0, 0, 0, n });
+		stack.push_back({ 0, 0, n, n, n, 0 });
+		while (!stack.empty())
+		{
+			RtinTriangle t = stack.back();
+			stack.pop_back();
+			int mx = (t.ax + t.bx) >> 1;
+			int my = (t.ay + t.by) >> 1;
+			bool canSplit = abs(t.ax - t.cx) + abs(t.ay - t.cy) > 1;
+			if (canSplit && m_errors[my * size + mx] > maxError) {
+				stack.push_back({ t.bx, t.by, t.cx, t.cy, mx, my });
+				stack.push_back({ t.cx, t.cy, t.ax, t.ay, mx, my });
+			}
+			else {
+				//a, b, c winds clockwise in grid space, reversed to match the grid index buffer
+				addCorner(t.ax, t.ay);
+				addCorner(t.cx, t.cy);
+				addCorner(t.bx, t.by);
+			}
+		}
+
+		float dx = width / n;
+		float dz = height / n;
+		mesh->vertices.reserve(used.size());
+		for (const glm::ivec2& point : used)
+		{
+			int col = point.x;
+			int row = point.y;
+			glm::vec2 uv = glm::vec2((float)col / n, (float)row / n);
+			glm::vec3 pos = glm::vec3(uv.x * width, sample(col, row), uv.y * height * -1);
+			//same vectors createTerrainVertices builds
+			glm::vec3 vA = glm::vec3(dx, (sample(col + 1, row) - sample(col - 1, row)) * 0.5f, 0.0f);
+			glm::vec3 vB = glm::vec3(0.0f, (sample(col, row + 1) - sample(col, row - 1)) * 0.5f, -dz);
+			glm::vec3 normal = glm::cross(vA, vB);
+			mesh->vertices.push_back(Vertex(pos, normal, uv, glm::cross(vA, normal)));
+		}
+		mesh->updateBounds();
+	}
+
+	/// <summary>
+	/// createTerrainFromHeightField with as few triangles as maxError allows, see RtinMesher.
+	/// Falls back to the full grid if subDivisions is not a power of two
+	/// </summary>
+	void createAdaptiveTerrain(float width, float height, int subDivisions, const Array2D<float>& heights, float maxError, MeshData* mesh) {
+		RtinMesher mesher;
+		if (!mesher.init(subDivisions, heights)) {
+			createTerrainFromHeightField(width, height, subDivisions, heights, mesh);
+			return;
+		}
+		mesher.createMesh(width, height, maxError, mesh);
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef RTIN_MESHER_H
+#define RTIN_MESHER_H
+#pragma once
+#include "../ew/mesh.h"
+#include "array2d.h"
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Adaptive terrain mesher over a right-triangulated irregular network (RTIN): the grid is split into right triangles by
+	/// repeated longest-edge bisection, and a triangle is only split while the surface under it strays too far from its plane.
+	/// init bounds the error of every triangle once, after that meshes for any error threshold are cheap to extract.
+	/// Needs a power of two subDivisions
+	/// </summary>
+	class RtinMesher {
+	public:
+
+		bool init(int subDivisions, const Array2D<float>& heights);
+		void createMesh(float width, float height, float maxError, MeshData* mesh) const;
+
+		inline int getSubDivisions() const { return m_subDivisions; }
+		//largest error of the coarsest mesh, two triangles over the whole grid
+		float getMaxError() const;
+
+	private:
+		struct RtinTriangle {
+			//a and b end the long edge, c is the right angle
+			int ax, ay, bx, by, cx, cy;
+		};
+
+		//heights with the one sample border, grid point (col, row) at (col + 1) + (row + 1) * m_stride
+		inline float sample(int col, int row) const { return m_heights[(row + 1) * m_stride + col + 1]; }
+
+		int m_subDivisions = 0;
+		int m_stride = 0;
+		std::vector<float> m_heights;
+		//per grid point: a bound on the vertical error left if the triangles whose long edge ends there stay unsplit.
+		//Includes the errors of every smaller triangle under them, so splits never leave cracks
+		std::vector<float> m_errors;
+	};
+
+	void createAdaptiveTerrain(float width, float height, int subDivisions, const Array2D<float>& heights, float maxError, MeshData* mesh);
+}
+
+#endif // RTIN_MESHER_H
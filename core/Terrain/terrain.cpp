@@ -2,6 +2,9 @@
 	Author: William Bishop
 */
 #include "terrain.h"
+#include "../ew/gridIndices.h"
+#include "parallel.h"
+#include "duneGenerators.h"
 #include <stdlib.h>
 #include <functional>
 namespace ew {
@@ -11,56 +14,114 @@ namespace ew {
 		/// <param name="width">Total width</param>
 		/// <param name="height">Total height</param>
 		/// <param name="subDivisions">Number of subdivisions</param>
+		/// <param name="numThreads">Worker threads, each building a band of rows. Output does not depend on it</param>
 		/// <returns></returns>
-	void createTerrain(float width, float height, int subDivisions, MeshData* mesh, int type) {
+	void createTerrain(float width, float height, int subDivisions, MeshData* mesh, int type, int numThreads) {
+		Array2D<float> heights;
+		createHeightField(subDivisions, type, &heights, numThreads);
+		createTerrainFromHeightField(width, height, subDivisions, heights, mesh, numThreads);
+	}
+	/// <summary>
+	/// Samples edgeSmoother once for every grid point plus a one sample border on each side,
+	/// so normals and tangents can be derived without evaluating the dune functions again
+	/// </summary>
+	/// <param name="subDivisions">Number of subdivisions</param>
+	/// <param name="type">Dune type, see DuneGenerators</param>
+	/// <param name="heights">Filled with (subDivisions + 3) x (subDivisions + 3) samples. Grid point (col, row) lives at (col + 1, row + 1)</param>
+	/// <param name="numThreads">Worker threads, each filling a band of rows</param>
+	/// <param name="kernel">Instruction set for the dune samples. SCALAR matches edgeSmoother exactly</param>
+	void createHeightField(int subDivisions, int type, Array2D<float>* heights, int numThreads, DuneKernel kernel) {
+		int size = subDivisions + 3;
+		heights->InitArray2D(size, size);
+
+		//pick the generator once, every loop below is instantiated for it
+		DuneRowFunction duneRow = getDuneRowFunction(type, kernel);
+		visitDune(type, [&](auto dune) {
+			using Dune = decltype(dune);
+			parallelFor(-1, subDivisions + 2, numThreads, [&](int rowBegin, int rowEnd) {
+				for (int row = rowBegin; row < rowEnd; row++)
+				{
+					float* out = heights->GetAddr(0, row + 1);
+					if (kernel == DuneKernel::SCALAR) {
+						for (int col = -1; col <= subDivisions + 1; col++)
+						{
+							out[col + 1] = smoothEdges<Dune>(col, row, subDivisions);
+						}
+					}
+					else {
+						smoothEdgesRow<Dune>(-1, row, size, subDivisions, duneRow, out);
+					}
+				}
+			});
+		});
+	}
+	/// <summary>
+	/// Builds the terrain mesh from a height field made by createHeightField.
+	/// Vertices come from createTerrainVertices, indices from the shared grid index generator
+	/// </summary>
+	/// <param name="width">Total width</param>
+	/// <param name="height">Total height</param>
+	/// <param name="subDivisions">Number of subdivisions</param>
+	/// <param name="heights">Height field with a one sample border</param>
+	/// <param name="mesh">MeshData struct to fill. Will be cleared.</param>
+	/// <param name="numThreads">Worker threads, each building a band of rows</param>
+	void createTerrainFromHeightField(float width, float height, int subDivisions, const Array2D<float>& heights, MeshData* mesh, int numThreads) {
+		createTerrainVertices(width, height, subDivisions, heights, mesh, numThreads);
+		mesh->indices.resize(getGridIndexCount(subDivisions, false));
+
+		parallelFor(0, subDivisions, numThreads, [&](int rowBegin, int rowEnd) {
+			writeGridIndices(subDivisions, rowBegin, rowEnd, &mesh->indices[rowBegin * subDivisions * 6]);
+		});
+
+		return;
+	}
+	/// <summary>
+	/// Builds only the terrain vertices from a height field, for meshes drawn with a shared grid index buffer (getGridIndexBuffer).
+	/// Normals and tangents use central differences of the cached heights.
+	/// Vertices are sized up front and every band of rows writes its own slots
+	/// </summary>
+	/// <param name="width">Total width</param>
+	/// <param name="height">Total height</param>
+	/// <param name="subDivisions">Number of subdivisions</param>
+	/// <param name="heights">Height field with a one sample border</param>
+	/// <param name="mesh">MeshData struct to fill, bounds included. Will be cleared, indices are left empty.</param>
+	/// <param name="numThreads">Worker threads, each building a band of rows</param>
+	void createTerrainVertices(float width, float height, int subDivisions, const Array2D<float>& heights, MeshData* mesh, int numThreads) {
+		int verticesPerRow = subDivisions + 1;
 		mesh->vertices.clear();
 		mesh->indices.clear();
-		mesh->vertices.reserve((subDivisions + 1) * (subDivisions + 1));
-		mesh->indices.reserve(subDivisions * subDivisions * 6);
-
-		for (size_t row = 0; row <= subDivisions; row++)
-		{
-			for (size_t col = 0; col <= subDivisions; col++)
-			{
-				glm::vec2 uv;
-				uv.x = ((float)col / subDivisions);
-				uv.y = ((float)row / subDivisions);
-				glm::vec3 pos;
-				pos.x = uv.x * width;
-				pos.z = uv.y * height * -1;
-				pos.y = edgeSmoother(col, row,subDivisions, type);
-
+		mesh->vertices.resize(verticesPerRow * verticesPerRow);
 
+		float dx = width / subDivisions;
+		float dz = height / subDivisions;
 
-				glm::vec3 normal = getNormal(width, height, subDivisions, row, col, type);
-				glm::vec3 tangent = getTangent(width, height, subDivisions, row, col, normal, type);
-				mesh->vertices.emplace_back(pos, normal, uv, tangent);
-			}
-		}
-
-		//Indices and tangents/bitangents
-		for (size_t row = 0; row < subDivisions; row++)
-		{
-			for (size_t col = 0; col < subDivisions; col++)
+		parallelFor(0, verticesPerRow, numThreads, [&](int rowBegin, int rowEnd) {
+			for (int row = rowBegin; row < rowEnd; row++)
 			{
-				unsigned int bl = row * (subDivisions + 1) + col;
-				unsigned int br = bl + 1;
-				unsigned int tl = bl + subDivisions + 1;
-				unsigned int tr = tl + 1;
-
-				//Triangle 1
-				mesh->indices.emplace_back(bl);
-				mesh->indices.emplace_back(br);
-				mesh->indices.emplace_back(tr);
-
-				//Triangle 2
-				mesh->indices.emplace_back(tr);
-				mesh->indices.emplace_back(tl);
-				mesh->indices.emplace_back(bl);
+				const float* below = heights.GetAddr(1, row);
+				const float* center = heights.GetAddr(1, row + 1);
+				const float* above = heights.GetAddr(1, row + 2);
+				Vertex* vertex = &mesh->vertices[row * verticesPerRow];
+				for (int col = 0; col <= subDivisions; col++)
+				{
+					glm::vec2 uv;
+					uv.x = ((float)col / subDivisions);
+					uv.y = ((float)row / subDivisions);
+					glm::vec3 pos;
+					pos.x = uv.x * width;
+					pos.z = uv.y * height * -1;
+					pos.y = center[col];
+
+					//same vectors getNormal/getTangent build, with central differences
+					glm::vec3 vA = glm::vec3(dx, (center[col + 1] - center[col - 1]) * 0.5f, 0.0f);
+					glm::vec3 vB = glm::vec3(0.0f, (above[col] - below[col]) * 0.5f, -dz);
+					glm::vec3 normal = glm::cross(vA, vB);
+					glm::vec3 tangent = glm::cross(vA, normal);
+					vertex[col] = Vertex(pos, normal, uv, tangent);
+				}
 			}
-		}
-
-		return;
+		});
+		mesh->updateBounds();
 	}
 	glm::vec3 getNormal(float width, float height, int subDivisions, int row, int col, int type) {
 		
@@ -97,93 +158,20 @@ namespace ew {
 
 		return glm::cross(vA,normal);
 	}
+	/// <summary>
+	/// Height of one dune sample. Selects the generator on every call, loops should use visitDune and the generator directly
+	/// </summary>
 	float makeDune(int col, int row, int type = 0) {
-		if (type == 0) {
-			return abs(sinf(sqrt(col))) + cosf(sqrt(row)) + cosf(sqrt(col)) * 3;
-		}
-		else if (type == 1) {
-			return cosf(col/PI) + sinf(sqrt(col)/18) + floor(row/10)/8;
-
-		}
-		else if (type == 2) {
-			return sin(col/(3*PI/2));
-
-		}
-		else if (type == 3) {
-			return cos(sqrt(row)) + abs(sin(sqrt(row+col)));
-
-		}
-		else if (type == 4) {
-			return cos(sqrt(col)) + abs(sin(sqrt(row+col)));
-
-		}
-		return sin(col) + sin(row);
-		
-		
+		float H = 0;
+		visitDune(type, [&](auto dune) { H = decltype(dune)::height(col, row); });
+		return H;
 	}
+	/// <summary>
+	/// makeDune with a falloff near the edges of the terrain, see smoothEdges
+	/// </summary>
 	float edgeSmoother(int col, int row,int subDivisions, int type = 0) {
-		float H=0;
-		float J = PI;
-		float x = col, y = row;
-		float lowerBound = (float)subDivisions / 5.0;
-		float uppperBound = (float)subDivisions - ((float)subDivisions / 10.0);
-		int G = 6;
-		H = makeDune(col, row, type);
-		//if (x < 7 || y < 7 || x > 65 || y>65) {
-		//	if (sin((float)x/ ((float)subDivisions / J)) * G > sin((float)y / ((float)subDivisions / J)) * G) {
-		//		
-		//		H = sin((float)y / ((float)subDivisions/J)) * G - 6;
-		//	}
-		//	else {
-		//		H = sin((float)x / ((float)subDivisions / J)) * G - 6;
-		//	}
-		//}
-		if (x < lowerBound) {
-			if (y > lowerBound) {
-				float Joe = makeDune(lowerBound, y, type);
-				H = cos(x / ((3.0*PI)/2.0)) * Joe - abs(Joe);
-				
-				//H = Joe;
-			}
-			else if (y < lowerBound){
-				float Joe = makeDune(lowerBound, lowerBound, type);
-				if (cos(y / ((3.0 * PI) / 2.0)) * Joe - abs(Joe) > cos(x / ((3.0 * PI) / 2.0)) * Joe - abs(Joe)) {
-
-					H = cos(x / ((3.0 * PI) / 2.0)) * Joe - abs(Joe);
-				}
-				else {
-					H = cos(y / ((3.0 * PI) / 2.0)) * Joe - abs(Joe);
-				}
-			}
-		}
-		else if (y < lowerBound) {
-			float Joe = makeDune(x, lowerBound, type);
-			H = sin(y / ((3.0*PI)/2.0)) * Joe;
-		}
-		else if (x > uppperBound) {
-			if (y < uppperBound) {
-				float Joe = makeDune(uppperBound, y, type);
-				H = sin(x / ((3.0*PI)/2.0)) * Joe;
-				
-				//H = Joe;
-			}
-			else if (y > uppperBound){
-				float Joe = makeDune(uppperBound, uppperBound, type);
-				if (cos(y / ((3.0 * PI) / 2.0)) * Joe - abs(Joe) > cos(x / ((3.0 * PI) / 2.0)) * Joe - abs(Joe)) {
-
-					H = cos(x / ((3.0 * PI) / 2.0)) * Joe - abs(Joe);
-				}
-				else {
-					H = cos(x / ((3.0 * PI) / 2.0)) * Joe - abs(Joe);
-				}
-			}
-		}
-		else if (y > uppperBound) {
-			float Joe = makeDune(x, uppperBound, type);
-			H = sin(y / ((3.0*PI)/2.0)) * Joe;
-		}
-
-
+		float H = 0;
+		visitDune(type, [&](auto dune) { H = smoothEdges<decltype(dune)>(col, row, subDivisions); });
 		return H;
 	}
-}
\ No newline at end of file
+}
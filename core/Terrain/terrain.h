@@ -5,10 +5,15 @@
 #define TERRAIN_H
 #pragma once
 #include "..\ew\mesh.h"
+#include "array2d.h"
+#include "duneKernel.h"
 
 
 namespace ew {
-	void createTerrain(float width, float height, int subDivisions, MeshData* meshData, int type);
+	void createTerrain(float width, float height, int subDivisions, MeshData* meshData, int type, int numThreads = 1);
+	void createHeightField(int subDivisions, int type, Array2D<float>* heights, int numThreads = 1, DuneKernel kernel = DuneKernel::SCALAR);
+	void createTerrainFromHeightField(float width, float height, int subDivisions, const Array2D<float>& heights, MeshData* meshData, int numThreads = 1);
+	void createTerrainVertices(float width, float height, int subDivisions, const Array2D<float>& heights, MeshData* meshData, int numThreads = 1);
 	glm::vec3 getNormal(float width, float height, int subDivisions, int row, int col, int type);
 	glm::vec3 getTangent(float width, float height, int subDivisions, int row, int col, glm::vec3 normal, int type);
 	float makeDune(int col, int row, int type);
@@ -0,0 +1,69 @@
+#include "terrainCache.h"
+#include "terrain.h"
+#include "../ew/gridIndices.h"
+#include <stdio.h>
+
+namespace ew {
+	/// <summary>
+	/// Identifies a terrain mesh by everything its vertices depend on, including the generator, the Vertex struct and how they are packed
+	/// </summary>
+	uint64_t getTerrainCacheKey(float width, float height, int subDivisions, int type, VertexLayout layout) {
+		uint64_t hash = hashBytes(&TERRAIN_GENERATOR_VERSION, sizeof(TERRAIN_GENERATOR_VERSION));
+		uint32_t vertexSize = sizeof(Vertex);
+		hash = hashBytes(&vertexSize, sizeof(vertexSize), hash);
+		hash = hashBytes(&layout, sizeof(layout), hash);
+		hash = hashBytes(&width, sizeof(width), hash);
+		hash = hashBytes(&height, sizeof(height), hash);
+		hash = hashBytes(&subDivisions, sizeof(subDivisions), hash);
+		return hashBytes(&type, sizeof(type), hash);
+	}
+
+	std::string getTerrainCachePath(const std::string& directory, uint64_t key) {
+		char name[64];
+		snprintf(name, sizeof(name), "/terrain_%016llx.mesh", (unsigned long long)key);
+		return directory + name;
+	}
+
+	/// <summary>
+	/// Gets terrain vertices from the cache, or builds and packs them and adds them to it. Files hold the vertices packed,
+	/// so a hit needs no work before the upload. Cached files hold vertices only, terrains draw with getGridIndexBuffer(subDivisions)
+	/// </summary>
+	/// <param name="directory">Cache directory. Created if missing</param>
+	/// <param name="width">Total width</param>
+	/// <param name="height">Total height</param>
+	/// <param name="subDivisions">Number of subdivisions</param>
+	/// <param name="type">Dune type</param>
+	/// <param name="layout">How the vertices are stored, part of the key</param>
+	/// <param name="out">Mapped on a hit, built and packed on a miss</param>
+	/// <param name="numThreads">Threads to build with on a miss</param>
+	/// <param name="writeOnMiss">Write what was built to the cache</param>
+	/// <returns>True on a hit</returns>
+	bool loadTerrainVertices(const std::string& directory, float width, float height, int subDivisions, int type, VertexLayout layout, TerrainVertices* out, int numThreads, bool writeOnMiss) {
+		uint64_t key = getTerrainCacheKey(width, height, subDivisions, type, layout);
+		std::string path = getTerrainCachePath(directory, key);
+		if (out->cached.open(path, key)) {
+			out->vertices = out->cached.getVertices();
+			return true;
+		}
+
+		Array2D<float> heights;
+		createHeightField(subDivisions, type, &heights, numThreads);
+		createTerrainVertices(width, height, subDivisions, heights, &out->built, numThreads);
+		out->vertices = packMeshVertices(out->built.vertices.data(), (int)out->built.vertices.size(), out->built.bounds, layout, &out->packed);
+		if (writeOnMiss && createCacheDirectory(directory)) {
+			writeMeshCache(path, key, out->vertices, std::vector<unsigned int>());
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// Loads a terrain into mesh through the cache, see loadTerrainVertices. Call on the GL thread
+	/// </summary>
+	/// <returns>True on a hit</returns>
+	bool loadCachedTerrain(const std::string& directory, float width, float height, int subDivisions, int type, VertexLayout layout, Mesh* mesh, int numThreads) {
+		TerrainVertices terrain;
+		bool hit = loadTerrainVertices(directory, width, height, subDivisions, type, layout, &terrain, numThreads);
+		mesh->load(terrain.vertices, getGridIndexBuffer(subDivisions));
+		return hit;
+	}
+}
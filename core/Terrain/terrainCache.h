@@ -0,0 +1,31 @@
+#ifndef TERRAIN_CACHE_H
+#define TERRAIN_CACHE_H
+#pragma once
+#include "../ew/mesh.h"
+#include "../ew/meshCache.h"
+#include "../ew/vertexLayout.h"
+#include <stdint.h>
+#include <string>
+
+namespace ew {
+	//Bump whenever createHeightField or createTerrainVertices produce different vertices. Every cached terrain goes stale with it
+	const uint32_t TERRAIN_GENERATOR_VERSION = 2;
+
+	/// <summary>
+	/// Terrain vertices ready for Mesh::load, either mapped from the cache or built and packed. Owns whatever vertices points into,
+	/// moving it keeps the view valid
+	/// </summary>
+	struct TerrainVertices {
+		PackedVertices vertices;
+		MeshCacheFile cached; //open on a cache hit
+		MeshData built; //on a miss. Adaptive terrains keep their indices here
+		std::vector<PackedVertex> packed;
+	};
+
+	uint64_t getTerrainCacheKey(float width, float height, int subDivisions, int type, VertexLayout layout);
+	std::string getTerrainCachePath(const std::string& directory, uint64_t key);
+	bool loadTerrainVertices(const std::string& directory, float width, float height, int subDivisions, int type, VertexLayout layout, TerrainVertices* out, int numThreads = 1, bool writeOnMiss = true);
+	bool loadCachedTerrain(const std::string& directory, float width, float height, int subDivisions, int type, VertexLayout layout, Mesh* mesh, int numThreads = 1);
+}
+
+#endif // TERRAIN_CACHE_H
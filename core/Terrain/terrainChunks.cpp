@@ -0,0 +1,246 @@
+#include "terrainChunks.h"
+#include "terrain.h"
+#include "duneKernel.h"
+#include "../ew/gridIndices.h"
+#include "../ew/vertexLayout.h"
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
+namespace ew {
+	/// <summary>
+	/// makeDune over the whole integer plane. makeDune takes square roots of its coordinates,
+	/// so the world is mirrored at the origin, which keeps it continuous across the axes
+	/// </summary>
+	float makeDuneWorld(int col, int row, int type) {
+		return makeDune(abs(col), abs(row), type);
+	}
+
+	/// <summary>
+	/// Builds one chunk of the endless desert. Heights are sampled in world grid space, so the shared
+	/// edge of two neighbouring chunks gets the same positions and normals
+	/// </summary>
+	/// <param name="coord">Chunk coordinate. +z chunks extend towards -z in world space, like createTerrain rows</param>
+	/// <param name="settings">Chunk size, resolution and dune type</param>
+	/// <param name="mesh">MeshData struct to fill, relative to the chunk origin. Will be cleared.
+	/// Indices are left empty, every chunk draws with getGridIndexBuffer(settings.resolution)</param>
+	void createTerrainChunk(const ChunkCoord& coord, const TerrainChunkSettings& settings, MeshData* mesh) {
+		int resolution = settings.resolution;
+		int size = resolution + 3;
+		int colBegin = coord.x * resolution - 1;
+		int rowBegin = coord.z * resolution - 1;
+		int colLast = colBegin + size - 1;
+
+		//Columns are mirrored, so evaluate the absolute range the chunk touches once per row and gather from it
+		int absMin = (colBegin <= 0 && colLast >= 0) ? 0 : std::min(abs(colBegin), abs(colLast));
+		int absMax = std::max(abs(colBegin), abs(colLast));
+		std::vector<float> samples(absMax - absMin + 1);
+
+		Array2D<float> heights(size, size);
+		//chunks only need to match each other, so they take the fastest kernel
+		DuneRowFunction duneRow = getDuneRowFunction(settings.type, DuneKernel::AUTO);
+		for (int i = 0; i < size; i++)
+		{
+			duneRow(absMin, abs(rowBegin + i), (int)samples.size(), samples.data());
+			float* dst = heights.GetAddr(0, i);
+			for (int j = 0; j < size; j++)
+			{
+				dst[j] = samples[abs(colBegin + j) - absMin];
+			}
+		}
+
+		createTerrainVertices(settings.chunkSize, settings.chunkSize, resolution, heights, mesh);
+	}
+
+	TerrainChunkManager::TerrainChunkManager(const TerrainChunkSettings& settings)
+		: m_settings(settings)
+	{
+		int workers = std::max(1, m_settings.workerThreads);
+		for (int i = 0; i < workers; i++)
+		{
+			m_workers.emplace_back(&TerrainChunkManager::workerLoop, this);
+		}
+	}
+
+	TerrainChunkManager::~TerrainChunkManager()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_wakeWorkers.notify_all();
+		for (std::thread& worker : m_workers)
+		{
+			worker.join();
+		}
+		for (TerrainChunk* chunk : m_allChunks)
+		{
+			delete chunk;
+		}
+	}
+
+	ChunkCoord TerrainChunkManager::getChunkCoord(const glm::vec3& worldPos) const
+	{
+		return ChunkCoord((int)floorf(worldPos.x / m_settings.chunkSize), (int)floorf(-worldPos.z / m_settings.chunkSize));
+	}
+
+	bool TerrainChunkManager::isInRange(const ChunkCoord& coord, const ChunkCoord& center, int radius) const
+	{
+		return abs(coord.x - center.x) <= radius && abs(coord.z - center.z) <= radius;
+	}
+
+	/// <summary>
+	/// Call once per frame on the GL thread. Unloads chunks that fell out of range, queues missing ones
+	/// nearest first and uploads finished chunks until the frame's upload budget is spent
+	/// </summary>
+	/// <param name="cameraPos">World position to stream around</param>
+	void TerrainChunkManager::update(const glm::vec3& cameraPos)
+	{
+		ChunkCoord center = getChunkCoord(cameraPos);
+		int loadRadius = std::max(0, m_settings.loadRadius);
+		//One ring of hysteresis so chunks on the boundary do not thrash while the camera sits on it
+		int keepRadius = loadRadius + 1;
+		bool residentChanged = false;
+
+		for (auto it = m_resident.begin(); it != m_resident.end();)
+		{
+			if (!isInRange(it->first, center, keepRadius)) {
+				m_stats.residentBytes -= it->second->bytes;
+				m_freeChunks.push_back(it->second);
+				it = m_resident.erase(it);
+				residentChanged = true;
+			}
+			else {
+				++it;
+			}
+		}
+
+		std::vector<ChunkCoord> missing;
+		for (int dz = -loadRadius; dz <= loadRadius; dz++)
+		{
+			for (int dx = -loadRadius; dx <= loadRadius; dx++)
+			{
+				ChunkCoord coord(center.x + dx, center.z + dz);
+				if (m_resident.count(coord) == 0 && m_requested.count(coord) == 0) {
+					missing.push_back(coord);
+				}
+			}
+		}
+		std::sort(missing.begin(), missing.end(), [&](const ChunkCoord& a, const ChunkCoord& b) {
+			int da = std::max(abs(a.x - center.x), abs(a.z - center.z));
+			int db = std::max(abs(b.x - center.x), abs(b.z - center.z));
+			return da < db;
+		});
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			//Queued jobs that fell out of range are dropped before any work is spent on them
+			for (auto it = m_jobs.begin(); it != m_jobs.end();)
+			{
+				if (!isInRange(*it, center, keepRadius)) {
+					m_requested.erase(*it);
+					it = m_jobs.erase(it);
+				}
+				else {
+					++it;
+				}
+			}
+			for (const ChunkCoord& coord : missing)
+			{
+				m_jobs.push_back(coord);
+				m_requested.insert(coord);
+			}
+		}
+		if (!missing.empty()) {
+			m_wakeWorkers.notify_all();
+		}
+
+		m_stats.uploadedThisFrame = 0;
+		m_stats.uploadBytesThisFrame = 0;
+		while (true)
+		{
+			ChunkResult result;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_results.empty()) {
+					break;
+				}
+				const ChunkResult& front = m_results.front();
+				bool wanted = isInRange(front.coord, center, keepRadius) && m_resident.count(front.coord) == 0;
+				size_t bytes = (size_t)front.vertices.numVertices * getVertexSize(front.vertices.layout);
+				//Always upload at least one chunk per frame so a tiny budget still makes progress
+				if (wanted && m_stats.uploadedThisFrame > 0 && m_stats.uploadBytesThisFrame + bytes > m_settings.uploadBudgetBytes) {
+					break;
+				}
+				result = std::move(m_results.front());
+				m_results.pop_front();
+				m_requested.erase(result.coord);
+				if (!wanted) {
+					continue;
+				}
+			}
+
+			TerrainChunk* chunk;
+			if (!m_freeChunks.empty()) {
+				chunk = m_freeChunks.back();
+				m_freeChunks.pop_back();
+			}
+			else {
+				chunk = new TerrainChunk();
+				m_allChunks.push_back(chunk);
+			}
+			chunk->coord = result.coord;
+			chunk->origin = glm::vec3(result.coord.x * m_settings.chunkSize, 0.0f, -result.coord.z * m_settings.chunkSize);
+			chunk->bytes = (size_t)result.vertices.numVertices * getVertexSize(result.vertices.layout);
+			//pooled chunks are refilled at the same resolution, so their storage is reused
+			chunk->mesh.setBufferUsage(BufferUsage::DYNAMIC);
+			chunk->mesh.load(result.vertices, getGridIndexBuffer(m_settings.resolution, m_settings.triangleStrips));
+			m_resident[result.coord] = chunk;
+			m_stats.residentBytes += chunk->bytes;
+			m_stats.uploadedThisFrame++;
+			m_stats.uploadBytesThisFrame += chunk->bytes;
+			residentChanged = true;
+		}
+
+		if (residentChanged) {
+			m_residentList.clear();
+			for (auto& resident : m_resident)
+			{
+				m_residentList.push_back(resident.second);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.resident = (int)m_resident.size();
+		m_stats.pending = (int)m_jobs.size() + m_inFlight;
+		m_stats.ready = (int)m_results.size();
+		m_stats.allocated = (int)m_allChunks.size();
+	}
+
+	void TerrainChunkManager::workerLoop()
+	{
+		while (true)
+		{
+			ChunkResult result;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wakeWorkers.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+				if (m_stop) {
+					return;
+				}
+				result.coord = m_jobs.front();
+				m_jobs.pop_front();
+				m_inFlight++;
+			}
+
+			createTerrainChunk(result.coord, m_settings, &result.meshData);
+			//packed here, so update() only copies bytes
+			const std::vector<Vertex>& built = result.meshData.vertices;
+			result.vertices = packMeshVertices(built.data(), (int)built.size(), result.meshData.bounds, m_settings.vertexLayout, &result.packed);
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_results.push_back(std::move(result));
+			m_inFlight--;
+		}
+	}
+}
@@ -0,0 +1,112 @@
+#ifndef TERRAIN_CHUNKS_H
+#define TERRAIN_CHUNKS_H
+#pragma once
+#include "../ew/mesh.h"
+#include "../ew/vertexLayout.h"
+#include "array2d.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ew {
+	struct ChunkCoord {
+		int x = 0;
+		int z = 0;
+		ChunkCoord() {}
+		ChunkCoord(int x, int z) : x(x), z(z) {}
+		bool operator==(const ChunkCoord& other) const { return x == other.x && z == other.z; }
+	};
+
+	struct ChunkCoordHash {
+		size_t operator()(const ChunkCoord& coord) const {
+			return (size_t)(unsigned int)coord.x * 73856093u ^ (size_t)(unsigned int)coord.z * 19349663u;
+		}
+	};
+
+	struct TerrainChunkSettings {
+		float chunkSize = 32.0f; //world units per chunk side
+		int resolution = 64; //cells per chunk side
+		int type = 0; //dune type
+		int loadRadius = 4; //chunks kept around the camera chunk, in each direction
+		int workerThreads = 2;
+		size_t uploadBudgetBytes = 2 * 1024 * 1024; //GPU upload per update
+		bool triangleStrips = false; //layout of the index buffer all chunks share
+		VertexLayout vertexLayout = VertexLayout::QUANTIZED; //how chunk vertices are stored on the GPU
+	};
+
+	struct TerrainChunkStats {
+		int resident = 0; //chunks with a mesh on the GPU
+		int pending = 0; //requested, not generated yet
+		int ready = 0; //generated, waiting for upload budget
+		int uploadedThisFrame = 0;
+		size_t uploadBytesThisFrame = 0;
+		size_t residentBytes = 0; //vertex data, the shared index buffer is not included
+		int allocated = 0; //chunk objects ever created, bounded by the keep radius
+	};
+
+	struct TerrainChunk {
+		ChunkCoord coord;
+		glm::vec3 origin = glm::vec3(0); //world position of the chunk's (0, 0) vertex
+		Mesh mesh;
+		size_t bytes = 0;
+	};
+
+	float makeDuneWorld(int col, int row, int type);
+	void createTerrainChunk(const ChunkCoord& coord, const TerrainChunkSettings& settings, MeshData* meshData);
+
+	/// <summary>
+	/// Streams terrain chunks in and out around the camera. Chunks are generated on worker threads
+	/// and uploaded on the calling (GL) thread in update(), at most uploadBudgetBytes per call.
+	/// Resident chunks and their meshes are recycled, so memory stays bounded however far the camera moves
+	/// </summary>
+	class TerrainChunkManager {
+	public:
+		TerrainChunkManager(const TerrainChunkSettings& settings = TerrainChunkSettings());
+		~TerrainChunkManager();
+		TerrainChunkManager(const TerrainChunkManager&) = delete;
+		TerrainChunkManager& operator=(const TerrainChunkManager&) = delete;
+
+		void update(const glm::vec3& cameraPos);
+		inline const std::vector<TerrainChunk*>& getResidentChunks() const { return m_residentList; }
+		inline const TerrainChunkStats& getStats() const { return m_stats; }
+		inline const TerrainChunkSettings& getSettings() const { return m_settings; }
+		ChunkCoord getChunkCoord(const glm::vec3& worldPos) const;
+
+	private:
+		struct ChunkResult {
+			ChunkCoord coord;
+			MeshData meshData;
+			std::vector<PackedVertex> packed;
+			PackedVertices vertices; //packed by the worker, points into meshData or packed
+		};
+
+		void workerLoop();
+		bool isInRange(const ChunkCoord& coord, const ChunkCoord& center, int radius) const;
+
+		TerrainChunkSettings m_settings;
+
+		//render thread only
+		std::unordered_map<ChunkCoord, TerrainChunk*, ChunkCoordHash> m_resident;
+		std::unordered_set<ChunkCoord, ChunkCoordHash> m_requested; //queued, generating or waiting for upload
+		std::vector<TerrainChunk*> m_residentList;
+		std::vector<TerrainChunk*> m_freeChunks;
+		std::vector<TerrainChunk*> m_allChunks;
+		TerrainChunkStats m_stats;
+
+		//shared with the workers, guarded by m_mutex
+		std::mutex m_mutex;
+		std::condition_variable m_wakeWorkers;
+		std::deque<ChunkCoord> m_jobs;
+		std::deque<ChunkResult> m_results;
+		int m_inFlight = 0;
+		bool m_stop = false;
+
+		std::vector<std::thread> m_workers;
+	};
+}
+
+#endif // TERRAIN_CHUNKS_H
@@ -0,0 +1,541 @@
+#include "terrainQuery.h"
+#include "parallel.h"
+#include "duneKernelSimd.h"
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace ew {
+	namespace {
+		using duneSimd::Lanes4;
+
+		//16 x 16 cells
+		const int MAX_WALK_LEVEL = 4;
+		//levels at and below this read ahead of where the walk is
+		const int LOOK_AHEAD_LEVEL = 2;
+		//batched rays are ordered by where they enter, in blocks of 4 x 4 cells
+		const int SORT_SHIFT = 2;
+		const size_t SORT_MIN_BYTES = 4 << 20;
+		const int RADIX_BITS = 11;
+
+		//spreads the low 16 bits of v over the even bits
+		inline uint32_t spreadBits(uint32_t v) {
+			v &= 0xFFFF;
+			v = (v | (v << 8)) & 0x00FF00FF;
+			v = (v | (v << 4)) & 0x0F0F0F0F;
+			v = (v | (v << 2)) & 0x33333333;
+			return (v | (v << 1)) & 0x55555555;
+		}
+
+		//Nodes of a level are stored in Morton order, so the four children of a node share a cache line
+		inline size_t mortonIndex(int x, int y) {
+			return spreadBits((uint32_t)x) | (spreadBits((uint32_t)y) << 1);
+		}
+
+		/// <summary>
+		/// Sorts items by their key member, least significant digit first, with only as many passes as maxKey needs
+		/// </summary>
+		template<typename T>
+		void sortByKey(std::vector<T>* items, uint32_t maxKey) {
+			std::vector<T> scratch(items->size());
+			std::vector<int> counts(1 << RADIX_BITS);
+			const uint32_t digitMask = (1 << RADIX_BITS) - 1;
+			for (int shift = 0; shift < 32 && (maxKey >> shift) != 0; shift += RADIX_BITS)
+			{
+				std::fill(counts.begin(), counts.end(), 0);
+				for (const T& item : *items)
+				{
+					counts[(item.key >> shift) & digitMask]++;
+				}
+				int offset = 0;
+				for (int& count : counts)
+				{
+					int digits = count;
+					count = offset;
+					offset += digits;
+				}
+				for (const T& item : *items)
+				{
+					scratch[counts[(item.key >> shift) & digitMask]++] = item;
+				}
+				items->swap(scratch);
+			}
+		}
+
+		inline float lanesMin(float a, float b) { return std::min(a, b); }
+		inline float lanesMax(float a, float b) { return std::max(a, b); }
+
+		//1 / d, with directions parallel to an axis made tiny instead of zero so slab distances stay finite
+		inline float safeInverse(float d) { return 1.0f / (fabsf(d) < 1e-20f ? 1e-20f : d); }
+		inline Lanes4 safeInverse(Lanes4 d) { return Lanes4(1.0f) / lanesSelect(lanesGreaterEqual(lanesAbs(d), Lanes4(1e-20f)), d, Lanes4(1e-20f)); }
+
+		/// <summary>
+		/// Clips V::WIDTH rays (or one, with floats) to the box around the terrain
+		/// </summary>
+		/// <returns>Where the rays enter, valid where it is not past tEnd</returns>
+		template<typename V>
+		inline V clipRay(V ou, V oy, V ov, V invU, V invY, V invV, V size, V minY, V maxY, V maxDistance, V* tEnd) {
+			V u0 = (V(0.0f) - ou) * invU, u1 = (size - ou) * invU;
+			V v0 = (V(0.0f) - ov) * invV, v1 = (size - ov) * invV;
+			V y0 = (minY - oy) * invY, y1 = (maxY - oy) * invY;
+			V tBegin = lanesMax(lanesMax(lanesMin(u0, u1), lanesMin(v0, v1)), lanesMax(lanesMin(y0, y1), V(0.0f)));
+			*tEnd = lanesMin(lanesMin(lanesMax(u0, u1), lanesMax(v0, v1)), lanesMin(lanesMax(y0, y1), maxDistance));
+			return tBegin;
+		}
+	}
+
+	/// <summary>
+	/// Copies a height field made by createHeightField and builds the min-max pyramid over it
+	/// </summary>
+	/// <param name="width">Total width, as the terrain mesh was built with</param>
+	/// <param name="height">Total height</param>
+	/// <param name="subDivisions">Number of subdivisions</param>
+	/// <param name="heights">(subDivisions + 3) x (subDivisions + 3) samples, with the one sample border</param>
+	/// <param name="numThreads">Worker threads for the pyramid</param>
+	void TerrainQuery::init(float width, float height, int subDivisions, const Array2D<float>& heights, int numThreads) {
+		m_width = width;
+		m_height = height;
+		m_subDivisions = subDivisions;
+		m_stride = subDivisions + 3;
+		m_cellsPerX = subDivisions / width;
+		m_cellsPerZ = subDivisions / height;
+		updateHeights(heights, numThreads);
+	}
+
+	/// <summary>
+	/// Takes new heights of the same size, e.g. from a DuneSimulation, and rebuilds the pyramid
+	/// </summary>
+	void TerrainQuery::updateHeights(const Array2D<float>& heights, int numThreads) {
+		int width = heights.GetWidth();
+		m_heights.resize(heights.GetSize());
+		for (int row = 0; row < heights.GetHeight(); row++)
+		{
+			memcpy(&m_heights[(size_t)row * width], heights.GetAddr(0, row), sizeof(float) * width);
+		}
+		buildLevels(numThreads);
+	}
+
+	void TerrainQuery::buildLevels(int numThreads) {
+		int cells = m_subDivisions;
+		m_levels.clear();
+		for (int width = cells; ; width = (width + 1) / 2)
+		{
+			Level level;
+			level.width = width;
+			if (!m_levels.empty()) {
+				//Morton order needs a power of two square
+				int padded = 1;
+				while (padded < width)
+				{
+					padded *= 2;
+				}
+				level.min.resize((size_t)padded * padded);
+				level.max.resize((size_t)padded * padded);
+			}
+			m_levels.push_back(std::move(level));
+			if (width == 1) {
+				break;
+			}
+		}
+
+		//level 0 is read straight from the heights: a cell's bilinear patch stays between its lowest and highest corner
+		auto getNodeRange = [&](int level, int col, int row, float* low, float* high) {
+			if (level == 0) {
+				float h00 = sample(col, row), h10 = sample(col + 1, row);
+				float h01 = sample(col, row + 1), h11 = sample(col + 1, row + 1);
+				*low = std::min(std::min(h00, h10), std::min(h01, h11));
+				*high = std::max(std::max(h00, h10), std::max(h01, h11));
+			}
+			else {
+				size_t node = mortonIndex(col, row);
+				*low = m_levels[level].min[node];
+				*high = m_levels[level].max[node];
+			}
+		};
+		for (int l = 1; l < (int)m_levels.size(); l++)
+		{
+			int srcWidth = m_levels[l - 1].width;
+			Level& dst = m_levels[l];
+			parallelFor(0, dst.width, numThreads, [&](int rowBegin, int rowEnd) {
+				for (int row = rowBegin; row < rowEnd; row++)
+				{
+					//an odd last row or column has no neighbour to merge
+					int row0 = row * 2;
+					int row1 = std::min(row0 + 1, srcWidth - 1);
+					for (int col = 0; col < dst.width; col++)
+					{
+						int col0 = col * 2;
+						int col1 = std::min(col0 + 1, srcWidth - 1);
+						float low[4], high[4];
+						getNodeRange(l - 1, col0, row0, &low[0], &high[0]);
+						getNodeRange(l - 1, col1, row0, &low[1], &high[1]);
+						getNodeRange(l - 1, col0, row1, &low[2], &high[2]);
+						getNodeRange(l - 1, col1, row1, &low[3], &high[3]);
+						size_t node = mortonIndex(col, row);
+						dst.min[node] = std::min(std::min(low[0], low[1]), std::min(low[2], low[3]));
+						dst.max[node] = std::max(std::max(high[0], high[1]), std::max(high[2], high[3]));
+					}
+				}
+			});
+		}
+	}
+
+	bool TerrainQuery::contains(float x, float z) const {
+		return x >= 0.0f && x <= m_width && z <= 0.0f && z >= -m_height;
+	}
+
+	/// <summary>
+	/// Bilinear height between the four surrounding grid points. Outside the terrain the nearest edge is used
+	/// </summary>
+	float TerrainQuery::getHeight(float x, float z) const {
+		float u = std::min(std::max(x * m_cellsPerX, 0.0f), (float)m_subDivisions);
+		float v = std::min(std::max(-z * m_cellsPerZ, 0.0f), (float)m_subDivisions);
+		int col = std::min((int)u, m_subDivisions - 1);
+		int row = std::min((int)v, m_subDivisions - 1);
+		float a = u - col, b = v - row;
+		float bottom = sample(col, row) + (sample(col + 1, row) - sample(col, row)) * a;
+		float top = sample(col, row + 1) + (sample(col + 1, row + 1) - sample(col, row + 1)) * a;
+		return bottom + (top - bottom) * b;
+	}
+
+	/// <summary>
+	/// Unit normal blended bilinearly from the central difference normals of the four surrounding grid points,
+	/// the same normals the terrain mesh has at its vertices
+	/// </summary>
+	glm::vec3 TerrainQuery::getNormal(float x, float z) const {
+		float u = std::min(std::max(x * m_cellsPerX, 0.0f), (float)m_subDivisions);
+		float v = std::min(std::max(-z * m_cellsPerZ, 0.0f), (float)m_subDivisions);
+		int col = std::min((int)u, m_subDivisions - 1);
+		int row = std::min((int)v, m_subDivisions - 1);
+		float a = u - col, b = v - row;
+
+		//(-dh/dx, 1, -dh/dz), with rows running along -z. The border sample keeps every neighbour in range
+		const float* h = &m_heights[(row + 1) * m_stride + col + 1];
+		int up = m_stride;
+		float slopeX = (1.0f - b) * ((1.0f - a) * (h[1] - h[-1]) + a * (h[2] - h[0]))
+			+ b * ((1.0f - a) * (h[up + 1] - h[up - 1]) + a * (h[up + 2] - h[up]));
+		float slopeZ = (1.0f - a) * ((1.0f - b) * (h[up] - h[-up]) + b * (h[2 * up] - h[0]))
+			+ a * ((1.0f - b) * (h[up + 1] - h[1 - up]) + b * (h[2 * up + 1] - h[1]));
+		return glm::normalize(glm::vec3(-0.5f * slopeX * m_cellsPerX, 1.0f, 0.5f * slopeZ * m_cellsPerZ));
+	}
+
+	/// <summary>
+	/// First point where a ray meets the surface
+	/// </summary>
+	/// <param name="origin">Ray start in the terrain's model space</param>
+	/// <param name="direction">Ray direction, need not be unit length</param>
+	/// <param name="maxDistance">Farthest point to look at, in multiples of direction</param>
+	/// <param name="hit">Filled in. A ray starting below the surface hits where it starts</param>
+	/// <returns>True if the ray hit</returns>
+	bool TerrainQuery::rayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, TerrainHit* hit) const {
+		*hit = TerrainHit();
+		const Level& root = m_levels.back();
+		float du = direction.x * m_cellsPerX, dv = -direction.z * m_cellsPerZ;
+		GridRay ray = { origin.x * m_cellsPerX, origin.y, -origin.z * m_cellsPerZ, du, direction.y, dv, safeInverse(du), safeInverse(dv) };
+		float tEnd;
+		float tBegin = clipRay(ray.ou, ray.oy, ray.ov, ray.invU, safeInverse(ray.dy), ray.invV, (float)m_subDivisions, root.min[0], root.max[0], maxDistance, &tEnd);
+		if (tBegin > tEnd) {
+			return false;
+		}
+		return traverse(ray, tBegin, tEnd, hit);
+	}
+
+	/// <summary>
+	/// Walks the pyramid from its root: nodes the ray passes above are stepped over whole,
+	/// the others are split until single cells are left, where the ray meets the bilinear patch exactly
+	/// </summary>
+	bool TerrainQuery::traverse(const GridRay& ray, float t, float tEnd, TerrainHit* hit) const {
+		int cells = m_subDivisions;
+		//nodes far wider than a dune are hardly ever above a ray, so the walk neither starts nor climbs above this level
+		int top = std::min((int)m_levels.size() - 1, MAX_WALK_LEVEL);
+		int level = top;
+		int nodeX = std::max(0, std::min((int)((ray.ou + t * ray.du) / (1 << level)), m_levels[level].width - 1));
+		int nodeY = std::max(0, std::min((int)((ray.ov + t * ray.dv) / (1 << level)), m_levels[level].width - 1));
+		int stepX = ray.du >= 0.0f ? 1 : -1;
+		int stepY = ray.dv >= 0.0f ? 1 : -1;
+		//t per cell along the ray's longer axis
+		float lookAhead = std::min(fabsf(ray.invU), fabsf(ray.invV));
+
+		while (true)
+		{
+			const Level& nodes = m_levels[level];
+			int size = 1 << level;
+			//nodes on the last row or column are cut off by the grid's edge
+			float low = (float)(nodeX * size), high = (float)std::min((nodeX + 1) * size, cells);
+			float exitU = ((stepX > 0 ? high : low) - ray.ou) * ray.invU;
+			low = (float)(nodeY * size);
+			high = (float)std::min((nodeY + 1) * size, cells);
+			float exitV = ((stepY > 0 ? high : low) - ray.ov) * ray.invV;
+			float tExit = std::min(exitU, exitV);
+			float tNodeEnd = std::min(tExit, tEnd);
+
+			float nodeHigh;
+			if (level == 0) {
+				const float* corner = &m_heights[(nodeY + 1) * m_stride + nodeX + 1];
+				nodeHigh = std::max(std::max(corner[0], corner[1]), std::max(corner[m_stride], corner[m_stride + 1]));
+			}
+			else {
+				nodeHigh = nodes.max[mortonIndex(nodeX, nodeY)];
+			}
+#if defined(EW_DUNE_SSE2)
+			if (level <= LOOK_AHEAD_LEVEL && top > 0) {
+				//the walk is latency bound, so start loading the cell one past this node and the level 1 node over it.
+				//Rows above and below are what getNormal reads if the ray hits there
+				float ahead = tExit + lookAhead;
+				int col = std::max(0, std::min((int)(ray.ou + ahead * ray.du), cells - 1));
+				int row = std::max(0, std::min((int)(ray.ov + ahead * ray.dv), cells - 1));
+				const float* corner = &m_heights[(row + 1) * m_stride + col + 1];
+				_mm_prefetch((const char*)(corner - m_stride), _MM_HINT_T0);
+				_mm_prefetch((const char*)corner, _MM_HINT_T0);
+				_mm_prefetch((const char*)(corner + m_stride), _MM_HINT_T0);
+				_mm_prefetch((const char*)(corner + 2 * m_stride), _MM_HINT_T0);
+				_mm_prefetch((const char*)&m_levels[1].max[mortonIndex(col >> 1, row >> 1)], _MM_HINT_T0);
+			}
+#endif
+			float rayLow = std::min(ray.oy + t * ray.dy, ray.oy + tNodeEnd * ray.dy);
+			if (rayLow <= nodeHigh) {
+				if (level > 0) {
+					//into the child the ray is in at t
+					level--;
+					const Level& children = m_levels[level];
+					int half = size >> 1;
+					int childX = nodeX * 2, childY = nodeY * 2;
+					if (childX + 1 < children.width && ray.ou + t * ray.du >= (float)((childX + 1) * half)) {
+						childX++;
+					}
+					if (childY + 1 < children.width && ray.ov + t * ray.dv >= (float)((childY + 1) * half)) {
+						childY++;
+					}
+					nodeX = childX;
+					nodeY = childY;
+					continue;
+				}
+				if (intersectCell(ray, nodeX, nodeY, t, tNodeEnd, &t)) {
+					finishHit(ray, t, hit);
+					return true;
+				}
+			}
+			if (tExit >= tEnd) {
+				return false;
+			}
+
+			//to the neighbour the ray leaves into, then up to the largest node it has just entered
+			int nextX = nodeX, nextY = nodeY;
+			if (exitU <= exitV) {
+				nextX += stepX;
+			}
+			if (exitV <= exitU) {
+				nextY += stepY;
+			}
+			if (nextX < 0 || nextY < 0 || nextX >= nodes.width || nextY >= nodes.width) {
+				return false;
+			}
+			//a parent whose max is at or above the ray where it enters can not be skipped, so climbing into it only adds a visit
+			float rayEnter = ray.oy + tExit * ray.dy;
+			while (level < top && ((nextX >> 1) != (nodeX >> 1) || (nextY >> 1) != (nodeY >> 1)))
+			{
+				if (rayEnter <= m_levels[level + 1].max[mortonIndex(nextX >> 1, nextY >> 1)]) {
+					break;
+				}
+				nextX >>= 1;
+				nextY >>= 1;
+				nodeX >>= 1;
+				nodeY >>= 1;
+				level++;
+			}
+			nodeX = nextX;
+			nodeY = nextY;
+			t = tExit;
+		}
+	}
+
+	/// <summary>
+	/// Where the ray first reaches the bilinear patch of a cell between t and tEnd.
+	/// Along the ray the patch height minus the ray height is a quadratic in t
+	/// </summary>
+	bool TerrainQuery::intersectCell(const GridRay& ray, int col, int row, float t, float tEnd, float* tHit) const {
+		float h00 = sample(col, row), h10 = sample(col + 1, row);
+		float h01 = sample(col, row + 1), h11 = sample(col + 1, row + 1);
+		float k1 = h10 - h00, k2 = h01 - h00, k3 = h00 - h10 - h01 + h11;
+		float a = ray.ou + t * ray.du - col;
+		float b = ray.ov + t * ray.dv - row;
+
+		float qa = k3 * ray.du * ray.dv;
+		float qb = k1 * ray.du + k2 * ray.dv + k3 * (a * ray.dv + b * ray.du) - ray.dy;
+		float qc = h00 + k1 * a + k2 * b + k3 * a * b - (ray.oy + t * ray.dy);
+		if (qc >= 0.0f) {
+			*tHit = t;
+			return true;
+		}
+
+		float length = tEnd - t;
+		float s;
+		if (fabsf(qa) < 1e-12f) {
+			if (qb <= 0.0f) {
+				return false;
+			}
+			s = -qc / qb;
+		}
+		else {
+			float discriminant = qb * qb - 4.0f * qa * qc;
+			if (discriminant < 0.0f) {
+				return false;
+			}
+			//the stable pair of roots, smallest non-negative wins
+			float q = -0.5f * (qb + copysignf(sqrtf(discriminant), qb));
+			float s0 = q / qa, s1 = qc / q;
+			if (s0 > s1) {
+				std::swap(s0, s1);
+			}
+			s = s0 >= 0.0f ? s0 : s1;
+		}
+		if (s < 0.0f || s > length) {
+			return false;
+		}
+		*tHit = t + s;
+		return true;
+	}
+
+	void TerrainQuery::finishHit(const GridRay& ray, float t, TerrainHit* hit) const {
+		hit->hit = true;
+		hit->distance = t;
+		hit->position = glm::vec3((ray.ou + t * ray.du) / m_cellsPerX, ray.oy + t * ray.dy, -(ray.ov + t * ray.dv) / m_cellsPerZ);
+		hit->normal = getNormal(hit->position.x, hit->position.z);
+	}
+
+	/// <summary>
+	/// getHeight for many points, 4 at a time
+	/// </summary>
+	/// <param name="count">Number of points</param>
+	/// <param name="x">count x coordinates</param>
+	/// <param name="z">count z coordinates</param>
+	/// <param name="heights">Receives count heights</param>
+	/// <param name="numThreads">Worker threads, each taking a band of points</param>
+	void TerrainQuery::getHeights(int count, const float* x, const float* z, float* heights, int numThreads) const {
+		parallelFor(0, count, numThreads, [&](int begin, int end) {
+			Lanes4 cellsPerX(m_cellsPerX), cellsPerZ(-m_cellsPerZ), zero(0.0f), size((float)m_subDivisions), last((float)(m_subDivisions - 1));
+			int i = begin;
+			for (; i + Lanes4::WIDTH <= end; i += Lanes4::WIDTH)
+			{
+				Lanes4 u = lanesMin(lanesMax(Lanes4::load(x + i) * cellsPerX, zero), size);
+				Lanes4 v = lanesMin(lanesMax(Lanes4::load(z + i) * cellsPerZ, zero), size);
+				Lanes4 col = lanesMin(lanesFloor(u), last);
+				Lanes4 row = lanesMin(lanesFloor(v), last);
+				float cols[Lanes4::WIDTH], rows[Lanes4::WIDTH];
+				col.store(cols);
+				row.store(rows);
+
+				//SSE2 has no gather
+				float h00[Lanes4::WIDTH], h10[Lanes4::WIDTH], h01[Lanes4::WIDTH], h11[Lanes4::WIDTH];
+				for (int lane = 0; lane < Lanes4::WIDTH; lane++)
+				{
+					const float* corner = &m_heights[((int)rows[lane] + 1) * m_stride + (int)cols[lane] + 1];
+					h00[lane] = corner[0];
+					h10[lane] = corner[1];
+					h01[lane] = corner[m_stride];
+					h11[lane] = corner[m_stride + 1];
+				}
+				Lanes4 a = u - col, b = v - row;
+				Lanes4 bottom = Lanes4::load(h00) + (Lanes4::load(h10) - Lanes4::load(h00)) * a;
+				Lanes4 top = Lanes4::load(h01) + (Lanes4::load(h11) - Lanes4::load(h01)) * a;
+				(bottom + (top - bottom) * b).store(heights + i);
+			}
+			for (; i < end; i++)
+			{
+				heights[i] = getHeight(x[i], z[i]);
+			}
+		});
+	}
+
+	/// <summary>
+	/// rayCast for many rays. Rays are moved to grid space and clipped to the terrain 4 at a time.
+	/// The ones that reach it walk the pyramid one by one, since neighbouring rays soon part ways,
+	/// but in Morton order of where they enter so rays walking the same nodes follow each other
+	/// </summary>
+	/// <param name="count">Number of rays</param>
+	/// <param name="origins">count ray starts</param>
+	/// <param name="directions">count ray directions</param>
+	/// <param name="maxDistance">Farthest point to look at, in multiples of each direction</param>
+	/// <param name="hits">Receives count hits</param>
+	/// <param name="numThreads">Worker threads, each taking a band of rays</param>
+	/// <returns>Number of rays that hit</returns>
+	int TerrainQuery::rayCast(int count, const glm::vec3* origins, const glm::vec3* directions, float maxDistance, TerrainHit* hits, int numThreads) const {
+		std::atomic<int> hitCount(0);
+		const Level& root = m_levels.back();
+		parallelFor(0, count, numThreads, [&](int begin, int end) {
+			Lanes4 cellsPerX(m_cellsPerX), cellsPerZ(-m_cellsPerZ), size((float)m_subDivisions), minY(root.min[0]), maxY(root.max[0]), farthest(maxDistance);
+			//everything a ray needs to walk, sorted as a whole so the walk reads them in order
+			struct PendingRay {
+				GridRay ray;
+				float tBegin, tEnd;
+				int index;
+				uint32_t key;
+			};
+			std::vector<PendingRay> pending;
+			pending.reserve(end - begin);
+
+			for (int first = begin; first < end; first += Lanes4::WIDTH)
+			{
+				int lanes = std::min(Lanes4::WIDTH, end - first);
+				float component[6][Lanes4::WIDTH] = {};
+				for (int lane = 0; lane < lanes; lane++)
+				{
+					const glm::vec3& origin = origins[first + lane];
+					const glm::vec3& direction = directions[first + lane];
+					for (int c = 0; c < 3; c++)
+					{
+						component[c][lane] = origin[c];
+						component[c + 3][lane] = direction[c];
+					}
+				}
+				Lanes4 ou = Lanes4::load(component[0]) * cellsPerX, oy = Lanes4::load(component[1]), ov = Lanes4::load(component[2]) * cellsPerZ;
+				Lanes4 du = Lanes4::load(component[3]) * cellsPerX, dy = Lanes4::load(component[4]), dv = Lanes4::load(component[5]) * cellsPerZ;
+				Lanes4 invU = safeInverse(du), invV = safeInverse(dv);
+				Lanes4 tEnd;
+				Lanes4 tBegin = clipRay(ou, oy, ov, invU, safeInverse(dy), invV, size, minY, maxY, farthest, &tEnd);
+				//where the rays enter, in cells
+				Lanes4 entryU = lanesMax(ou + tBegin * du, Lanes4(0.0f)), entryV = lanesMax(ov + tBegin * dv, Lanes4(0.0f));
+
+				float grid[12][Lanes4::WIDTH];
+				ou.store(grid[0]);
+				oy.store(grid[1]);
+				ov.store(grid[2]);
+				du.store(grid[3]);
+				dy.store(grid[4]);
+				dv.store(grid[5]);
+				invU.store(grid[6]);
+				invV.store(grid[7]);
+				tBegin.store(grid[8]);
+				tEnd.store(grid[9]);
+				entryU.store(grid[10]);
+				entryV.store(grid[11]);
+				for (int lane = 0; lane < lanes; lane++)
+				{
+					hits[first + lane] = TerrainHit();
+					if (grid[8][lane] > grid[9][lane]) {
+						continue;
+					}
+					GridRay ray = { grid[0][lane], grid[1][lane], grid[2][lane], grid[3][lane], grid[4][lane], grid[5][lane], grid[6][lane], grid[7][lane] };
+					uint32_t key = (uint32_t)mortonIndex((int)grid[10][lane] >> SORT_SHIFT, (int)grid[11][lane] >> SORT_SHIFT);
+					pending.push_back({ ray, grid[8][lane], grid[9][lane], first + lane, key });
+				}
+			}
+
+			//rays from one eye, or over heights that stay in cache, gain nothing from sorting
+			bool sorted = std::is_sorted(pending.begin(), pending.end(), [](const PendingRay& a, const PendingRay& b) { return a.key < b.key; });
+			if (!sorted && m_heights.size() * sizeof(float) >= SORT_MIN_BYTES) {
+				int lastBlock = m_subDivisions >> SORT_SHIFT;
+				sortByKey(&pending, (uint32_t)mortonIndex(lastBlock, lastBlock));
+			}
+			int bandHits = 0;
+			for (const PendingRay& next : pending)
+			{
+				bandHits += traverse(next.ray, next.tBegin, next.tEnd, &hits[next.index]);
+			}
+			hitCount += bandHits;
+		});
+		return hitCount;
+	}
+}
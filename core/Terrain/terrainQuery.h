@@ -0,0 +1,70 @@
+#ifndef TERRAIN_QUERY_H
+#define TERRAIN_QUERY_H
+#pragma once
+#include "../ew/mesh.h"
+#include "array2d.h"
+#include <vector>
+
+namespace ew {
+	struct TerrainHit {
+		bool hit = false;
+		float distance = 0.0f; //along the ray, in multiples of its direction
+		glm::vec3 position = glm::vec3(0);
+		glm::vec3 normal = glm::vec3(0, 1, 0);
+	};
+
+	/// <summary>
+	/// Height, normal and ray queries against a terrain built by createTerrainFromHeightField, in the terrain's model space:
+	/// x runs over [0, width], z over [-height, 0]. Heights between grid points are bilinear, so rays hit the surface getHeight describes.
+	/// Rays skip empty space with a min-max pyramid over the grid cells
+	/// </summary>
+	class TerrainQuery {
+	public:
+		void init(float width, float height, int subDivisions, const Array2D<float>& heights, int numThreads = 1);
+		void updateHeights(const Array2D<float>& heights, int numThreads = 1);
+		float getHeight(float x, float z) const;
+		glm::vec3 getNormal(float x, float z) const;
+		bool contains(float x, float z) const;
+		bool rayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, TerrainHit* hit) const;
+
+		void getHeights(int count, const float* x, const float* z, float* heights, int numThreads = 1) const;
+		int rayCast(int count, const glm::vec3* origins, const glm::vec3* directions, float maxDistance, TerrainHit* hits, int numThreads = 1) const;
+
+		inline int getSubDivisions() const { return m_subDivisions; }
+		inline int getLevels() const { return (int)m_levels.size(); }
+
+	private:
+		//a ray in grid space: u and v count cells along x and -z, y stays a height
+		struct GridRay {
+			float ou, oy, ov;
+			float du, dy, dv;
+			float invU, invV;
+		};
+
+		struct Level {
+			int width = 0; //nodes per side
+			//lowest and highest height under each node, in Morton order. Empty on level 0, which reads the heights.
+			//Rays only test the maxima, so those are kept apart: a cache line holds a node's children and grandchildren
+			std::vector<float> min;
+			std::vector<float> max;
+		};
+
+		//heights with the one sample border, grid point (col, row) at (col + 1) + (row + 1) * m_stride
+		inline float sample(int col, int row) const { return m_heights[(row + 1) * m_stride + col + 1]; }
+		void buildLevels(int numThreads);
+		bool traverse(const GridRay& ray, float t, float tEnd, TerrainHit* hit) const;
+		bool intersectCell(const GridRay& ray, int col, int row, float t, float tEnd, float* tHit) const;
+		void finishHit(const GridRay& ray, float t, TerrainHit* hit) const;
+
+		float m_width = 0.0f;
+		float m_height = 0.0f;
+		int m_subDivisions = 0;
+		int m_stride = 0;
+		float m_cellsPerX = 0.0f; //grid cells per unit of x
+		float m_cellsPerZ = 0.0f;
+		std::vector<float> m_heights;
+		std::vector<Level> m_levels; //level 0 has one node per grid cell, the last a single node over everything
+	};
+}
+
+#endif // TERRAIN_QUERY_H
@@ -0,0 +1,254 @@
+#include "terrainRebuilder.h"
+#include "terrain.h"
+#include "terrainCache.h"
+#include "rtinMesher.h"
+#include "parallel.h"
+#include "../ew/gridIndices.h"
+#include <algorithm>
+#include <chrono>
+#include <stdint.h>
+#include <utility>
+
+namespace ew {
+	namespace {
+		float millisecondsSince(std::chrono::steady_clock::time_point start) {
+			return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	/// <param name="numThreads">Threads each build is split over. 0 uses every hardware thread</param>
+	TerrainRebuilder::TerrainRebuilder(int numThreads)
+		: m_numThreads(numThreads > 0 ? numThreads : defaultThreadCount())
+	{
+		m_worker = std::thread(&TerrainRebuilder::workerLoop, this);
+	}
+
+	TerrainRebuilder::~TerrainRebuilder() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_wakeWorker.notify_all();
+		m_worker.join();
+	}
+
+	/// <summary>
+	/// Looks up every build in a mesh cache directory first, see loadTerrainVertices. Empty turns the cache off
+	/// </summary>
+	void TerrainRebuilder::setCacheDirectory(const std::string& directory) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_cacheDirectory = directory;
+	}
+
+	/// <summary>
+	/// Caps how much of a build update() uploads per call. 0 uploads every build in one call
+	/// </summary>
+	void TerrainRebuilder::setUploadBudget(size_t bytesPerUpdate) {
+		m_uploadBudgetBytes = bytesPerUpdate;
+	}
+
+	/// <summary>
+	/// Asks for a terrain with new parameters. Replaces any request that has not finished yet
+	/// </summary>
+	/// <param name="params">Terrain to build</param>
+	/// <param name="writeCache">Add the terrain to the cache if it is missing. Worth it for terrains that come back,
+	/// like the one shown at startup, not for every step of a slider</param>
+	void TerrainRebuilder::request(const TerrainParams& params, bool writeCache) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_hasRequest) {
+				//never started
+				m_stats.dropped++;
+			}
+			m_request = params;
+			m_requestWriteCache = writeCache;
+			m_hasRequest = true;
+			m_stats.requested++;
+		}
+		m_wakeWorker.notify_one();
+	}
+
+	/// <summary>
+	/// Call once at the start of a frame on the GL thread. Uploads the next slice of a finished build into the back mesh,
+	/// see setUploadBudget, and makes it the front one once the last slice is in. A newer build waits for the upload to finish
+	/// </summary>
+	/// <returns>True if the terrain changed</returns>
+	bool TerrainRebuilder::update() {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		int back = 1 - m_front;
+		Mesh& mesh = m_meshes[back];
+		if (!m_uploading) {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_hasResult) {
+					return false;
+				}
+				m_upload = std::move(m_result);
+				m_uploadGridIndices = std::move(m_resultGridIndices);
+				m_uploadParams = m_resultParams;
+				m_hasResult = false;
+			}
+			m_uploading = true;
+			m_uploadedVertices = 0;
+			m_uploadedIndexBytes = 0;
+			m_uploadMs = 0.0f;
+			m_uploadFrames = 0;
+			//the two meshes take turns, so each keeps its storage across rebuilds of a similar size.
+			//Growing it is as slow as a large upload, so a frame that allocates uploads nothing
+			mesh.setBufferUsage(BufferUsage::DYNAMIC);
+			int reallocations = mesh.getBufferStats().reallocations;
+			mesh.allocateVertices(m_upload.vertices);
+			if (m_uploadBudgetBytes > 0 && mesh.getBufferStats().reallocations != reallocations) {
+				m_uploadMs += millisecondsSince(start);
+				m_uploadFrames++;
+				return false;
+			}
+		}
+
+		//vertices first, then the indices of a grid size not drawn before, which were built on the worker
+		size_t budget = m_uploadBudgetBytes > 0 ? m_uploadBudgetBytes : SIZE_MAX;
+		const PackedVertices& vertices = m_upload.vertices;
+		size_t vertexSize = getVertexSize(vertices.layout);
+		int remaining = vertices.numVertices - m_uploadedVertices;
+		if (remaining > 0) {
+			PackedVertices slice = vertices;
+			slice.data = (const char*)vertices.data + vertexSize * m_uploadedVertices;
+			slice.numVertices = (int)std::min((size_t)remaining, std::max((size_t)1, budget / vertexSize));
+			mesh.updateVertices(m_uploadedVertices, slice);
+			m_uploadedVertices += slice.numVertices;
+			//the indices start on a frame of their own
+			budget = m_uploadBudgetBytes > 0 ? 0 : budget;
+		}
+		bool finished = m_uploadedVertices >= vertices.numVertices;
+		if (finished && !m_uploadGridIndices.bytes.empty()) {
+			finished = budget > 0 && uploadGridIndexData(m_uploadGridIndices, &m_uploadedIndexBytes, budget);
+		}
+		if (finished) {
+			if (!m_upload.built.indices.empty()) {
+				//adaptive meshes keep only some vertices, numbered their own way, so they bring their own indices
+				mesh.loadIndices(m_upload.built.indices.data(), (int)m_upload.built.indices.size(), IndexType::UNSIGNED_INT);
+			}
+			else {
+				mesh.setIndexBuffer(getGridIndexBuffer(m_uploadParams.subDivisions));
+			}
+			m_front = back;
+			m_params = m_uploadParams;
+			m_hasMesh = true;
+			m_uploading = false;
+			//unmaps a cache file
+			m_upload = TerrainVertices();
+			m_uploadGridIndices = GridIndexData();
+		}
+		m_uploadMs += millisecondsSince(start);
+		m_uploadFrames++;
+		if (!finished) {
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.built++;
+		m_stats.lastUploadMs = m_uploadMs;
+		m_stats.lastUploadFrames = m_uploadFrames;
+		return true;
+	}
+
+	void TerrainRebuilder::draw(DrawMode drawMode) const {
+		if (m_hasMesh) {
+			m_meshes[m_front].draw(drawMode);
+		}
+	}
+
+	/// <summary>
+	/// True while a request is queued, building, waiting for update() or part way uploaded. GL thread only
+	/// </summary>
+	bool TerrainRebuilder::isBusy() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_hasRequest || m_building || m_hasResult || m_uploading;
+	}
+
+	TerrainRebuildStats TerrainRebuilder::getStats() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_stats;
+	}
+
+	void TerrainRebuilder::workerLoop() {
+		//indices of a grid size the GL thread has no shared buffer for yet, handed to every build of that size until it has
+		GridIndexData newGridIndices;
+		while (true)
+		{
+			TerrainParams params;
+			std::string cacheDirectory;
+			bool writeCache = false;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wakeWorker.wait(lock, [this] { return m_quit || m_hasRequest; });
+				if (m_quit) {
+					return;
+				}
+				params = m_request;
+				writeCache = m_requestWriteCache;
+				cacheDirectory = m_cacheDirectory;
+				m_hasRequest = false;
+				m_building = true;
+			}
+
+			//indices come from the shared grid buffer, only vertices are built here, unless the mesh is adaptive
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			//packed here, so the GL thread only copies bytes. Cache files are stored packed and need nothing
+			TerrainVertices result;
+			GridIndexData gridIndices;
+			MeshOptimizeStats vertexCache;
+			if (params.maxError > 0.0f) {
+				Array2D<float> heights;
+				createHeightField(params.subDivisions, params.type, &heights, m_numThreads);
+				createAdaptiveTerrain(params.width, params.height, params.subDivisions, heights, params.maxError, &result.built);
+				vertexCache = optimizeMesh(&result.built);
+			}
+			else if (!cacheDirectory.empty()) {
+				loadTerrainVertices(cacheDirectory, params.width, params.height, params.subDivisions, params.type, params.vertexLayout, &result, m_numThreads, writeCache);
+			}
+			else {
+				Array2D<float> heights;
+				createHeightField(params.subDivisions, params.type, &heights, m_numThreads);
+				createTerrainVertices(params.width, params.height, params.subDivisions, heights, &result.built, m_numThreads);
+			}
+			if (result.vertices.data == nullptr) {
+				//loadTerrainVertices hands them back mapped or packed already
+				MeshData& built = result.built;
+				result.vertices = packMeshVertices(built.vertices.data(), (int)built.vertices.size(), built.bounds, params.vertexLayout, &result.packed);
+				//freed here rather than by the GL thread once the upload is done
+				std::vector<Vertex>().swap(built.vertices);
+			}
+			if (result.built.indices.empty() && !hasGridIndexBuffer(params.subDivisions)) {
+				//reordering the indices of a big grid for the vertex cache takes longer than any frame
+				if (newGridIndices.subDivisions != params.subDivisions) {
+					createGridIndexData(params.subDivisions, false, &newGridIndices);
+				}
+				gridIndices = newGridIndices;
+			}
+			else if (hasGridIndexBuffer(newGridIndices.subDivisions)) {
+				newGridIndices = GridIndexData();
+			}
+			float buildMs = millisecondsSince(start);
+			int triangles = result.built.indices.empty() ? params.subDivisions * params.subDivisions * 2 : (int)result.built.indices.size() / 3;
+
+			//a finished build is always shown, even if newer parameters are queued, so the terrain follows a dragged slider
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_building = false;
+			if (m_hasResult) {
+				//an older build update() never picked up
+				m_stats.dropped++;
+			}
+			m_result = std::move(result);
+			m_resultGridIndices = std::move(gridIndices);
+			m_resultParams = params;
+			m_hasResult = true;
+			m_stats.lastBuildMs = buildMs;
+			m_stats.lastTriangles = triangles;
+			m_stats.lastVertexCache = vertexCache;
+			if (m_result.cached.isOpen()) {
+				m_stats.cacheHits++;
+			}
+		}
+	}
+}
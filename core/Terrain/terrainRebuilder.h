@@ -0,0 +1,103 @@
+#ifndef TERRAIN_REBUILDER_H
+#define TERRAIN_REBUILDER_H
+#pragma once
+#include "terrainCache.h"
+#include "../ew/mesh.h"
+#include "../ew/gridIndices.h"
+#include "../ew/meshOptimizer.h"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ew {
+	struct TerrainParams {
+		float width = 36.0f;
+		float height = 36.0f;
+		int subDivisions = 256;
+		int type = 0;
+		//above 0 the mesh is adaptive, see RtinMesher, with at most this vertical error. Needs a power of two subDivisions
+		float maxError = 0.0f;
+		VertexLayout vertexLayout = VertexLayout::QUANTIZED; //how the mesh is stored on the GPU
+		bool operator==(const TerrainParams& other) const {
+			return width == other.width && height == other.height && subDivisions == other.subDivisions && type == other.type && maxError == other.maxError
+				&& vertexLayout == other.vertexLayout;
+		}
+		bool operator!=(const TerrainParams& other) const { return !(*this == other); }
+	};
+
+	struct TerrainRebuildStats {
+		int requested = 0;
+		int built = 0; //made it to the GPU
+		int dropped = 0; //superseded by a newer request before they were built or shown
+		int cacheHits = 0; //builds mapped from the cache instead of generated
+		float lastBuildMs = 0.0f; //worker time for the last finished build
+		float lastUploadMs = 0.0f; //render thread time for the last upload, over all of its frames
+		int lastUploadFrames = 0; //update() calls the last upload was spread over
+		int lastTriangles = 0;
+		MeshOptimizeStats lastVertexCache; //adaptive meshes only, the grid uses the shared index buffer
+	};
+
+	/// <summary>
+	/// Rebuilds a terrain mesh on a worker thread whenever its parameters change.
+	/// request() never blocks. Only the newest request is built, requests replaced before the worker got to them are dropped.
+	/// update() uploads a finished build into the back mesh a slice per frame and swaps it to the front once all of it is there,
+	/// so draw() always shows a complete terrain and no frame pays for a whole upload
+	/// </summary>
+	class TerrainRebuilder {
+	public:
+		TerrainRebuilder(int numThreads = 0);
+		~TerrainRebuilder();
+		TerrainRebuilder(const TerrainRebuilder&) = delete;
+		TerrainRebuilder& operator=(const TerrainRebuilder&) = delete;
+
+		void setCacheDirectory(const std::string& directory);
+		void setUploadBudget(size_t bytesPerUpdate);
+		void request(const TerrainParams& params, bool writeCache = false);
+		bool update();
+		void draw(DrawMode drawMode = DrawMode::TRIANGLES) const;
+		inline bool hasMesh() const { return m_hasMesh; }
+		inline const TerrainParams& getParams() const { return m_params; }
+		inline const Bounds& getBounds() const { return m_meshes[m_front].getBounds(); } //of the mesh draw() shows, model space
+		inline const Mesh& getMesh() const { return m_meshes[m_front]; } //the one draw() shows
+		bool isBusy() const;
+		TerrainRebuildStats getStats() const;
+
+	private:
+		void workerLoop();
+
+		Mesh m_meshes[2];
+		int m_front = 0;
+		bool m_hasMesh = false;
+		TerrainParams m_params; //of the front mesh
+		int m_numThreads = 1;
+		std::string m_cacheDirectory;
+
+		//the build going up into the back mesh. GL thread only
+		size_t m_uploadBudgetBytes = 2 * 1024 * 1024;
+		bool m_uploading = false;
+		TerrainParams m_uploadParams;
+		TerrainVertices m_upload; //kept until the swap, cache files stay mapped until then
+		GridIndexData m_uploadGridIndices;
+		int m_uploadedVertices = 0;
+		size_t m_uploadedIndexBytes = 0;
+		float m_uploadMs = 0.0f;
+		int m_uploadFrames = 0;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_wakeWorker;
+		std::thread m_worker;
+		bool m_quit = false;
+		bool m_building = false;
+		bool m_hasRequest = false;
+		TerrainParams m_request;
+		bool m_requestWriteCache = false;
+		bool m_hasResult = false;
+		TerrainParams m_resultParams;
+		TerrainVertices m_result; //packed by the worker, or mapped from the cache as it is
+		GridIndexData m_resultGridIndices; //built by the worker if the grid has no shared index buffer yet
+		TerrainRebuildStats m_stats;
+	};
+}
+
+#endif // TERRAIN_REBUILDER_H
@@ -21,6 +21,7 @@ Texture2D::Texture2D(const char* filePath, int filterModeMin, int FliterModMag,
     {
         glTexImage2D(GL_TEXTURE_2D, 0, alpha, mWidth, mHeight, 0, alpha, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
+        mFormat = alpha;
     }
     else
     {
@@ -30,6 +31,44 @@ Texture2D::Texture2D(const char* filePath, int filterModeMin, int FliterModMag,
     stbi_image_free(data);
 }
 
+/// <summary>
+/// Uploads pixels made in memory. GL_RED textures read back as gray in all of rgb, like a grayscale image loaded as GL_RGB
+/// </summary>
+/// <param name="format">GL_RED or GL_RGB, 8 bits per channel, rows tightly packed</param>
+Texture2D::Texture2D(int width, int height, int format, const unsigned char* pixels, int filterModeMin, int filterModeMag, int wrapModeS, int wrapModeT)
+    : mWidth(width), mHeight(height), mNrChannels(format == GL_RED ? 1 : 3), mFormat(format)
+{
+    glGenTextures(1, &mId);
+    glBindTexture(GL_TEXTURE_2D, mId);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapModeS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapModeT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filterModeMin);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filterModeMag);
+    if (format == GL_RED)
+    {
+        GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, format == GL_RED ? GL_R8 : GL_RGB8, mWidth, mHeight, 0, format, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+/// <summary>
+/// Replaces the pixels of a texture made from memory and rebuilds its mipmaps. The size stays the same
+/// </summary>
+void Texture2D::update(const unsigned char* pixels)
+{
+    glBindTexture(GL_TEXTURE_2D, mId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mWidth, mHeight, mFormat, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+}
+
 Texture2D::~Texture2D()
 {
 }
@@ -16,13 +16,16 @@ class Texture2D
 {
 public:
 	Texture2D(const char* filePath, int filterModeMin, int FliterModMag, int wrapModeS, int wrapModeT, int alpha);
+	Texture2D(int width, int height, int format, const unsigned char* pixels, int filterModeMin, int filterModeMag, int wrapModeS, int wrapModeT);
 	~Texture2D();
 
 	void bind(unsigned int slot = 0);
+	void update(const unsigned char* pixels);
 
 private:
 	unsigned int mId;
 	int mWidth, mHeight, mNrChannels;
+	int mFormat = 0;
 };
 
 #endif
@@ -0,0 +1,301 @@
+#include "normalBaker.h"
+#include "../Terrain/parallel.h"
+#include "../Terrain/duneKernelSimd.h"
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace ew {
+	namespace {
+		using duneSimd::Lanes4;
+
+		//Every filter is (a, b, a) across the derivative over the three texels along it, normalized to height per texel
+		struct FilterWeights {
+			float side;
+			float center;
+			float scale;
+		};
+
+		FilterWeights getFilterWeights(NormalFilter filter) {
+			switch (filter) {
+			case NormalFilter::CENTRAL: return { 0.0f, 1.0f, 1.0f / 2.0f };
+			case NormalFilter::SCHARR: return { 3.0f, 10.0f, 1.0f / 32.0f };
+			default: return { 1.0f, 2.0f, 1.0f / 8.0f };
+			}
+		}
+
+		//n * 127.5 + 128 truncated is n * 0.5 + 0.5 rounded to a byte, without a clamp since |n| <= 1
+		inline void packNormal(float dx, float dy, float strength, unsigned char* out) {
+			float x = -strength * dx, y = -strength * dy;
+			float scale = 127.5f / sqrtf(x * x + y * y + 1.0f);
+			out[0] = (unsigned char)(x * scale + 128.0f);
+			out[1] = (unsigned char)(y * scale + 128.0f);
+			out[2] = (unsigned char)(scale + 128.0f);
+		}
+
+		inline void bakeTexel(const float* up, const float* center, const float* down, int left, int col, int right, const FilterWeights& w, float strength, unsigned char* out) {
+			float dx = w.side * (up[right] - up[left]) + w.center * (center[right] - center[left]) + w.side * (down[right] - down[left]);
+			float dy = w.side * (up[left] - down[left]) + w.center * (up[col] - down[col]) + w.side * (up[right] - down[right]);
+			packNormal(dx * w.scale, dy * w.scale, strength, out);
+		}
+
+		//BC4 block: two endpoints and 3 bit indices. Endpoints are max then min, which selects the 8 value palette
+		void encodeBC4Block(const unsigned char values[16], unsigned char* out) {
+			unsigned char high = values[0], low = values[0];
+			for (int i = 1; i < 16; i++)
+			{
+				high = std::max(high, values[i]);
+				low = std::min(low, values[i]);
+			}
+			out[0] = high;
+			out[1] = low;
+			uint64_t bits = 0;
+			if (high > low) {
+				int range = high - low;
+				for (int i = 0; i < 16; i++)
+				{
+					//nearest of the 8 steps from high to low, then the palette order: high, low, the six in between
+					int step = ((high - values[i]) * 7 + range / 2) / range;
+					uint64_t index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+					bits |= index << (3 * i);
+				}
+			}
+			for (int i = 0; i < 6; i++)
+			{
+				out[2 + i] = (unsigned char)(bits >> (8 * i));
+			}
+		}
+
+		void decodeBC4Block(const unsigned char* block, unsigned char values[16]) {
+			int e0 = block[0], e1 = block[1];
+			int palette[8] = { e0, e1 };
+			if (e0 > e1) {
+				for (int i = 2; i < 8; i++)
+				{
+					palette[i] = ((8 - i) * e0 + (i - 1) * e1 + 3) / 7;
+				}
+			}
+			else {
+				for (int i = 2; i < 6; i++)
+				{
+					palette[i] = ((6 - i) * e0 + (i - 1) * e1 + 2) / 5;
+				}
+				palette[6] = 0;
+				palette[7] = 255;
+			}
+			uint64_t bits = 0;
+			for (int i = 0; i < 6; i++)
+			{
+				bits |= (uint64_t)block[2 + i] << (8 * i);
+			}
+			for (int i = 0; i < 16; i++)
+			{
+				values[i] = (unsigned char)palette[(bits >> (3 * i)) & 7];
+			}
+		}
+
+		//rows last to first, image files list the top row first
+		void flipRows(const unsigned char* pixels, int width, int height, int channels, std::vector<unsigned char>* flipped) {
+			size_t rowBytes = (size_t)width * channels;
+			flipped->resize(rowBytes * height);
+			for (int row = 0; row < height; row++)
+			{
+				memcpy(flipped->data() + rowBytes * row, pixels + rowBytes * (height - 1 - row), rowBytes);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Tangent space normals (z up, rgb bytes) from a height map. Rows are spread over threads,
+	/// the columns between the edges run 4 at a time
+	/// </summary>
+	/// <param name="heights">Height map, at least 2 x 2</param>
+	/// <param name="settings">Filter, strength and edge handling</param>
+	/// <param name="normals">Receives width * height * 3 bytes in the row order of heights</param>
+	void bakeNormalMap(const Array2D<float>& heights, const NormalBakeSettings& settings, std::vector<unsigned char>* normals, int numThreads) {
+		int width = heights.GetWidth();
+		int height = heights.GetHeight();
+		normals->resize((size_t)width * height * 3);
+		FilterWeights w = getFilterWeights(settings.filter);
+		float strength = settings.strength;
+
+		parallelFor(0, height, numThreads, [&](int rowBegin, int rowEnd) {
+			Lanes4 side(w.side), center(w.center);
+			Lanes4 scaleX(-w.scale * strength), scaleY(-w.scale * strength);
+			for (int row = rowBegin; row < rowEnd; row++)
+			{
+				int upRow = row == height - 1 ? (settings.wrap ? 0 : row) : row + 1;
+				int downRow = row == 0 ? (settings.wrap ? height - 1 : row) : row - 1;
+				const float* u = heights.GetAddr(0, upRow);
+				const float* c = heights.GetAddr(0, row);
+				const float* d = heights.GetAddr(0, downRow);
+				unsigned char* out = normals->data() + (size_t)row * width * 3;
+
+				bakeTexel(u, c, d, settings.wrap ? width - 1 : 0, 0, 1, w, strength, out);
+				int col = 1;
+				for (; col + Lanes4::WIDTH <= width - 1; col += Lanes4::WIDTH)
+				{
+					Lanes4 upLeft = Lanes4::load(u + col - 1), upRight = Lanes4::load(u + col + 1);
+					Lanes4 downLeft = Lanes4::load(d + col - 1), downRight = Lanes4::load(d + col + 1);
+					Lanes4 dx = side * (upRight - upLeft + downRight - downLeft) + center * (Lanes4::load(c + col + 1) - Lanes4::load(c + col - 1));
+					Lanes4 dy = side * (upLeft - downLeft + upRight - downRight) + center * (Lanes4::load(u + col) - Lanes4::load(d + col));
+					dx = dx * scaleX;
+					dy = dy * scaleY;
+					Lanes4 scale = Lanes4(127.5f) / lanesSqrt(dx * dx + dy * dy + Lanes4(1.0f));
+					float x[Lanes4::WIDTH], y[Lanes4::WIDTH], z[Lanes4::WIDTH];
+					(dx * scale + Lanes4(128.0f)).store(x);
+					(dy * scale + Lanes4(128.0f)).store(y);
+					(scale + Lanes4(128.0f)).store(z);
+					for (int i = 0; i < Lanes4::WIDTH; i++)
+					{
+						unsigned char* texel = out + (col + i) * 3;
+						texel[0] = (unsigned char)x[i];
+						texel[1] = (unsigned char)y[i];
+						texel[2] = (unsigned char)z[i];
+					}
+				}
+				for (; col < width; col++)
+				{
+					int right = col == width - 1 ? (settings.wrap ? 0 : col) : col + 1;
+					bakeTexel(u, c, d, col - 1, col, right, w, strength, out + col * 3);
+				}
+			}
+		});
+	}
+
+	/// <summary>
+	/// 8 bit gray to heights in [0, 1], e.g. a height map loaded with stbi_load
+	/// </summary>
+	void heightsFromGray(const unsigned char* gray, int width, int height, Array2D<float>* heights) {
+		heights->InitArray2D(width, height);
+		for (int row = 0; row < height; row++)
+		{
+			const unsigned char* src = gray + (size_t)row * width;
+			float* out = heights->GetAddr(0, row);
+			for (int col = 0; col < width; col++)
+			{
+				out[col] = src[col] * (1.0f / 255.0f);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Compresses the x and y of a normal map to BC5: 16 bytes per 4 x 4 block, a quarter of rgb8 + alpha.
+	/// z is dropped, a shader reading BC5 rebuilds it as sqrt(1 - x^2 - y^2)
+	/// </summary>
+	/// <param name="normals">rgb bytes, rows in any order</param>
+	/// <param name="blocks">Receives the blocks row by row, in the row order of normals. Partial edge blocks repeat the edge texels</param>
+	void encodeBC5(const unsigned char* normals, int width, int height, std::vector<unsigned char>* blocks) {
+		int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		blocks->resize((size_t)blocksX * blocksY * 16);
+		unsigned char* out = blocks->data();
+		for (int blockY = 0; blockY < blocksY; blockY++)
+		{
+			for (int blockX = 0; blockX < blocksX; blockX++)
+			{
+				unsigned char x[16], y[16];
+				for (int i = 0; i < 16; i++)
+				{
+					int col = std::min(blockX * 4 + i % 4, width - 1);
+					int row = std::min(blockY * 4 + i / 4, height - 1);
+					const unsigned char* texel = normals + ((size_t)row * width + col) * 3;
+					x[i] = texel[0];
+					y[i] = texel[1];
+				}
+				encodeBC4Block(x, out);
+				encodeBC4Block(y, out + 8);
+				out += 16;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Expands BC5 blocks back to rgb normals, rebuilding z the way a shader would
+	/// </summary>
+	void decodeBC5(const unsigned char* blocks, int width, int height, std::vector<unsigned char>* normals) {
+		int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		normals->resize((size_t)width * height * 3);
+		for (int blockY = 0; blockY < blocksY; blockY++)
+		{
+			for (int blockX = 0; blockX < blocksX; blockX++)
+			{
+				const unsigned char* block = blocks + ((size_t)blockY * blocksX + blockX) * 16;
+				unsigned char x[16], y[16];
+				decodeBC4Block(block, x);
+				decodeBC4Block(block + 8, y);
+				for (int i = 0; i < 16; i++)
+				{
+					int col = blockX * 4 + i % 4, row = blockY * 4 + i / 4;
+					if (col >= width || row >= height) {
+						continue;
+					}
+					float nx = x[i] / 127.5f - 1.0f, ny = y[i] / 127.5f - 1.0f;
+					float nz = sqrtf(std::max(0.0f, 1.0f - nx * nx - ny * ny));
+					unsigned char* texel = normals->data() + ((size_t)row * width + col) * 3;
+					texel[0] = x[i];
+					texel[1] = y[i];
+					texel[2] = (unsigned char)(nz * 127.5f + 128.0f);
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Binary PGM (1 channel) or PPM (3 channels). Pixels are in GL row order, row 0 at v = 0, so the last row is written first
+	/// and stb_image's flip on load brings the file back the way it was
+	/// </summary>
+	/// <returns>False if the file could not be written</returns>
+	bool writeNetpbm(const std::string& path, const unsigned char* pixels, int width, int height, int channels) {
+		FILE* file = fopen(path.c_str(), "wb");
+		if (file == NULL) {
+			return false;
+		}
+		fprintf(file, "%s\n%d %d\n255\n", channels == 1 ? "P5" : "P6", width, height);
+		size_t rowBytes = (size_t)width * channels;
+		bool ok = true;
+		for (int row = height - 1; row >= 0 && ok; row--)
+		{
+			ok = fwrite(pixels + (size_t)row * rowBytes, 1, rowBytes, file) == rowBytes;
+		}
+		return fclose(file) == 0 && ok;
+	}
+
+	/// <summary>
+	/// BC5 compressed DDS with a DX10 header (DXGI_FORMAT_BC5_UNORM), one mip level. Like writeNetpbm the top row is stored first
+	/// </summary>
+	/// <param name="normals">rgb bytes in GL row order</param>
+	/// <returns>False if the file could not be written</returns>
+	bool writeNormalMapDds(const std::string& path, const unsigned char* normals, int width, int height) {
+		std::vector<unsigned char> topDown, blocks;
+		flipRows(normals, width, height, 3, &topDown);
+		encodeBC5(topDown.data(), width, height, &blocks);
+
+		const uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000, DDSD_LINEARSIZE = 0x80000;
+		const uint32_t DDPF_FOURCC = 0x4, DDSCAPS_TEXTURE = 0x1000;
+		const uint32_t DXGI_FORMAT_BC5_UNORM = 83, D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+		uint32_t header[31] = {};
+		header[0] = 124; //dwSize
+		header[1] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE;
+		header[2] = (uint32_t)height;
+		header[3] = (uint32_t)width;
+		header[4] = (uint32_t)blocks.size(); //dwPitchOrLinearSize
+		header[6] = 1; //dwMipMapCount
+		header[18] = 32; //ddspf.dwSize
+		header[19] = DDPF_FOURCC;
+		memcpy(&header[20], "DX10", 4);
+		header[26] = DDSCAPS_TEXTURE;
+		uint32_t dx10[5] = { DXGI_FORMAT_BC5_UNORM, D3D10_RESOURCE_DIMENSION_TEXTURE2D, 0, 1, 0 };
+
+		FILE* file = fopen(path.c_str(), "wb");
+		if (file == NULL) {
+			return false;
+		}
+		bool ok = fwrite("DDS ", 1, 4, file) == 4
+			&& fwrite(header, sizeof(header), 1, file) == 1
+			&& fwrite(dx10, sizeof(dx10), 1, file) == 1
+			&& fwrite(blocks.data(), 1, blocks.size(), file) == blocks.size();
+		return fclose(file) == 0 && ok;
+	}
+}
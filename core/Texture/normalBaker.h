@@ -0,0 +1,29 @@
+#ifndef NORMAL_BAKER_H
+#define NORMAL_BAKER_H
+#pragma once
+#include "../Terrain/array2d.h"
+#include <string>
+#include <vector>
+
+namespace ew {
+	enum class NormalFilter {
+		CENTRAL = 0, //one texel either side, sharpest
+		SOBEL = 1, //3 x 3, [1 2 1] across the derivative
+		SCHARR = 2 //3 x 3, [3 10 3] across the derivative, the most rotation invariant
+	};
+
+	struct NormalBakeSettings {
+		float strength = 24.0f; //scales height differences per texel before they become normals
+		NormalFilter filter = NormalFilter::SOBEL;
+		bool wrap = true; //tiling maps sample across the opposite edge, others repeat their edge texels
+	};
+
+	void bakeNormalMap(const Array2D<float>& heights, const NormalBakeSettings& settings, std::vector<unsigned char>* normals, int numThreads = 1);
+	void heightsFromGray(const unsigned char* gray, int width, int height, Array2D<float>* heights);
+	void encodeBC5(const unsigned char* normals, int width, int height, std::vector<unsigned char>* blocks);
+	void decodeBC5(const unsigned char* blocks, int width, int height, std::vector<unsigned char>* normals);
+	bool writeNetpbm(const std::string& path, const unsigned char* pixels, int width, int height, int channels);
+	bool writeNormalMapDds(const std::string& path, const unsigned char* normals, int width, int height);
+}
+
+#endif // NORMAL_BAKER_H
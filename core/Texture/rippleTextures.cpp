@@ -0,0 +1,294 @@
+#include "rippleTextures.h"
+#include "normalBaker.h"
+#include "../Terrain/parallel.h"
+#include "../Terrain/array2dOps.h"
+#include "../Terrain/duneKernelSimd.h"
+#include "../ew/ewMath/ewMath.h"
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+
+namespace ew {
+	namespace {
+		using duneSimd::Lanes4;
+		using duneSimd::lanesCos;
+
+		//Crests wander along a few sinusoids with whole periods per tile, so the wander tiles too
+		const int WANDER_TERMS = 3;
+
+		uint32_t hash(uint32_t x) {
+			x ^= x >> 16;
+			x *= 0x7FEB352Du;
+			x ^= x >> 15;
+			x *= 0x846CA68Bu;
+			x ^= x >> 16;
+			return x;
+		}
+
+		//uniform in [0, 1)
+		float hashFloat(uint32_t x) {
+			return (hash(x) >> 8) * (1.0f / 16777216.0f);
+		}
+
+		struct WanderTerm {
+			float weight;
+			float frequencyU; //radians per texel
+			float frequencyV;
+			float phase;
+		};
+
+		struct RippleShape {
+			float ripplesU; //ripples per texel
+			float ripplesV;
+			float rise; //fraction of a wavelength spent on the stoss side
+			float noise;
+			float contrast;
+			WanderTerm wander[WANDER_TERMS];
+			//crests fade in and out along (fadeU * u + fadePhaseU) x (fadeV * v + fadePhaseV)
+			float fadeU, fadeV, fadePhaseU, fadePhaseV;
+		};
+
+		RippleShape getRippleShape(const RippleSettings& settings) {
+			RippleShape shape;
+			int size = settings.size;
+			float ripples = std::max(1.0f, roundf(size / std::max(settings.wavelength, 1.0f))) / size;
+			shape.ripplesU = settings.axis == RippleAxis::Z ? ripples : 0.0f;
+			shape.ripplesV = settings.axis == RippleAxis::X ? ripples : 0.0f;
+			shape.rise = 0.5f + 0.4f * std::min(std::max(settings.asymmetry, 0.0f), 1.0f);
+			shape.noise = settings.noise;
+			shape.contrast = settings.contrast;
+
+			float totalWeight = 0.0f;
+			for (int k = 0; k < WANDER_TERMS; k++)
+			{
+				uint32_t seed = settings.seed * 0x9E3779B9u + k * 4;
+				//a few periods across the crests, at most one along them
+				float across = (float)(1 + hash(seed) % 5);
+				float along = (float)((int)(hash(seed + 1) % 3) - 1);
+				float radiansPerPeriod = 2.0f * PI / size;
+				WanderTerm& term = shape.wander[k];
+				term.weight = 1.0f / (1 << k);
+				term.frequencyU = radiansPerPeriod * (settings.axis == RippleAxis::X ? across : along);
+				term.frequencyV = radiansPerPeriod * (settings.axis == RippleAxis::X ? along : across);
+				term.phase = 2.0f * PI * hashFloat(seed + 2);
+				totalWeight += term.weight;
+			}
+			for (int k = 0; k < WANDER_TERMS; k++)
+			{
+				shape.wander[k].weight /= totalWeight;
+			}
+
+			uint32_t fadeSeed = settings.seed * 0x9E3779B9u + WANDER_TERMS * 4;
+			shape.fadeU = 2.0f * PI / size * (float)(2 + hash(fadeSeed) % 3);
+			shape.fadeV = 2.0f * PI / size * (float)(2 + hash(fadeSeed + 1) % 3);
+			shape.fadePhaseU = 2.0f * PI * hashFloat(fadeSeed + 2);
+			shape.fadePhaseV = 2.0f * PI * hashFloat(fadeSeed + 3);
+			return shape;
+		}
+
+		/// <summary>
+		/// Ripple heights for V::WIDTH texels from their phase: half a cosine up the stoss side, half a cosine down the lee side
+		/// </summary>
+		template<typename V>
+		inline V rippleProfile(const RippleShape& shape, V t, V amplitude) {
+			V f = t - lanesFloor(t);
+			V lee = lanesGreaterEqual(f, V(shape.rise));
+			V angle = lanesSelect(lee, (f - V(shape.rise)) * V(PI / (1.0f - shape.rise)), f * V(PI / shape.rise));
+			V c = lanesCos(angle);
+			V profile = V(0.5f) + V(0.5f) * lanesSelect(lee, c, V(0.0f) - c);
+			return V(0.5f) + V(shape.contrast) * amplitude * (profile - V(0.5f));
+		}
+
+		unsigned char toByte(float value) {
+			return (unsigned char)lrintf(std::min(std::max(value, 0.0f), 1.0f) * 255.0f);
+		}
+
+		void quantizeHeights(const Array2D<float>& heights, std::vector<unsigned char>* bytes) {
+			int width = heights.GetWidth();
+			bytes->resize(heights.GetSize());
+			for (int row = 0; row < heights.GetHeight(); row++)
+			{
+				const float* src = heights.GetAddr(0, row);
+				for (int col = 0; col < width; col++)
+				{
+					(*bytes)[(size_t)row * width + col] = toByte(src[col]);
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Settings close to the ripple maps the sand shader was authored with
+	/// </summary>
+	/// <param name="steep">Short, sharp ripples for steep slopes instead of long, low ones for flat sand</param>
+	RippleSettings getRippleSettings(bool steep, RippleAxis axis) {
+		RippleSettings settings;
+		settings.axis = axis;
+		if (steep) {
+			settings.size = 512;
+			settings.wavelength = 40.0f;
+			settings.asymmetry = 0.7f;
+			settings.noise = 0.6f;
+			settings.contrast = 0.25f;
+			settings.normalStrength = 36.0f;
+			settings.seed = axis == RippleAxis::X ? 3 : 4;
+		}
+		else {
+			settings.size = 256;
+			settings.wavelength = 12.0f;
+			settings.asymmetry = 0.4f;
+			settings.noise = 0.5f;
+			settings.contrast = 0.15f;
+			settings.normalStrength = 20.0f;
+			settings.seed = axis == RippleAxis::X ? 1 : 2;
+		}
+		return settings;
+	}
+
+	/// <summary>
+	/// Ripple heights in [0, 1], tileable in both directions. Rows are spread over threads and evaluated 4 texels at a time
+	/// </summary>
+	void generateRippleHeights(const RippleSettings& settings, Array2D<float>* heights, int numThreads) {
+		int size = settings.size;
+		heights->InitArray2D(size, size);
+		RippleShape shape = getRippleShape(settings);
+
+		//sin(a + b) = sin(a)cos(b) + cos(a)sin(b): the column part of every wander term is tabulated once,
+		//so the only sine left per texel is the profile's. Padded to whole lanes
+		int paddedSize = (size + Lanes4::WIDTH - 1) / Lanes4::WIDTH * Lanes4::WIDTH;
+		std::vector<float> sinU[WANDER_TERMS], cosU[WANDER_TERMS], fadeU(paddedSize);
+		for (int col = 0; col < paddedSize; col++)
+		{
+			fadeU[col] = sinf(shape.fadeU * col + shape.fadePhaseU);
+		}
+		for (int k = 0; k < WANDER_TERMS; k++)
+		{
+			sinU[k].resize(paddedSize);
+			cosU[k].resize(paddedSize);
+			for (int col = 0; col < paddedSize; col++)
+			{
+				sinU[k][col] = sinf(shape.wander[k].frequencyU * col);
+				cosU[k][col] = cosf(shape.wander[k].frequencyU * col);
+			}
+		}
+
+		parallelFor(0, size, numThreads, [&](int rowBegin, int rowEnd) {
+			for (int row = rowBegin; row < rowEnd; row++)
+			{
+				float rowSin[WANDER_TERMS], rowCos[WANDER_TERMS];
+				for (int k = 0; k < WANDER_TERMS; k++)
+				{
+					const WanderTerm& term = shape.wander[k];
+					float angle = term.frequencyV * row + term.phase;
+					rowSin[k] = shape.noise * term.weight * sinf(angle);
+					rowCos[k] = shape.noise * term.weight * cosf(angle);
+				}
+				Lanes4 rowPhase((float)row * shape.ripplesV);
+				//as much fading as wander, never flattening a crest completely
+				float fadeV = 0.5f * std::min(shape.noise, 1.0f) * sinf(shape.fadeV * row + shape.fadePhaseV);
+
+				float* out = heights->GetAddr(0, row);
+				for (int col = 0; col < size; col += Lanes4::WIDTH)
+				{
+					Lanes4 t = Lanes4::iota(col) * Lanes4(shape.ripplesU) + rowPhase;
+					for (int k = 0; k < WANDER_TERMS; k++)
+					{
+						t = t + Lanes4::load(&sinU[k][col]) * Lanes4(rowCos[k]) + Lanes4::load(&cosU[k][col]) * Lanes4(rowSin[k]);
+					}
+					Lanes4 amplitude = Lanes4(1.0f - 0.5f * std::min(shape.noise, 1.0f)) + Lanes4::load(&fadeU[col]) * Lanes4(fadeV);
+					Lanes4 height = rippleProfile(shape, t, amplitude);
+					if (col + Lanes4::WIDTH <= size) {
+						height.store(out + col);
+					}
+					else {
+						float tail[Lanes4::WIDTH];
+						height.store(tail);
+						for (int i = 0; col + i < size; i++)
+						{
+							out[col + i] = tail[i];
+						}
+					}
+				}
+			}
+		});
+	}
+
+	/// <summary>
+	/// Ripple height and normal maps, ready to upload
+	/// </summary>
+	void generateRipples(const RippleSettings& settings, SandTexture* texture, int numThreads) {
+		Array2D<float> heights;
+		generateRippleHeights(settings, &heights, numThreads);
+		//normals from the float heights, before they are quantized
+		NormalBakeSettings bake;
+		bake.strength = settings.normalStrength;
+		bake.filter = NormalFilter::CENTRAL;
+		bakeNormalMap(heights, bake, &texture->normals, numThreads);
+		quantizeHeights(heights, &texture->heights);
+		texture->size = settings.size;
+	}
+
+	/// <summary>
+	/// Sand grain height and normal maps: white noise softened by a wrapping [1 2 1] blur
+	/// </summary>
+	void generateGrain(const GrainSettings& settings, SandTexture* texture, int numThreads) {
+		int size = settings.size;
+		Array2D<float> noise(size, size), blurred(size, size);
+		parallelFor(0, size, numThreads, [&](int rowBegin, int rowEnd) {
+			for (int row = rowBegin; row < rowEnd; row++)
+			{
+				for (int col = 0; col < size; col++)
+				{
+					noise.At(col, row) = hashFloat(settings.seed * 0x9E3779B9u + (uint32_t)(row * size + col));
+				}
+			}
+		});
+		parallelFor(0, size, numThreads, [&](int rowBegin, int rowEnd) {
+			for (int row = rowBegin; row < rowEnd; row++)
+			{
+				const float* rows[3] = { noise.GetAddr(0, (row + size - 1) % size), noise.GetAddr(0, row), noise.GetAddr(0, (row + 1) % size) };
+				for (int col = 0; col < size; col++)
+				{
+					int left = (col + size - 1) % size, right = (col + 1) % size;
+					float sum = 0.0f;
+					for (int i = 0; i < 3; i++)
+					{
+						float weight = i == 1 ? 2.0f : 1.0f;
+						sum += weight * (rows[i][left] + 2.0f * rows[i][col] + rows[i][right]);
+					}
+					blurred.At(col, row) = sum / 16.0f;
+				}
+			}
+		});
+
+		//stretch to the contrast around mid gray
+		float minHeight, maxHeight;
+		getMinMax(blurred, &minHeight, &maxHeight, numThreads);
+		float scale = maxHeight > minHeight ? settings.contrast / (maxHeight - minHeight) : 0.0f;
+		for (int row = 0; row < size; row++)
+		{
+			float* heights = blurred.GetAddr(0, row);
+			for (int col = 0; col < size; col++)
+			{
+				heights[col] = 0.5f + (heights[col] - 0.5f * (minHeight + maxHeight)) * scale;
+			}
+		}
+
+		NormalBakeSettings bake;
+		bake.strength = settings.normalStrength;
+		bake.filter = NormalFilter::CENTRAL;
+		bakeNormalMap(blurred, bake, &texture->normals, numThreads);
+		quantizeHeights(blurred, &texture->heights);
+		texture->size = size;
+	}
+
+	/// <summary>
+	/// Writes the height map as a binary PGM and the normal map as a binary PPM. Both load with Texture2D like the JPGs they replace
+	/// </summary>
+	/// <returns>False if either file could not be written</returns>
+	bool writeSandTexture(const SandTexture& texture, const std::string& heightPath, const std::string& normalPath) {
+		bool heightsWritten = writeNetpbm(heightPath, texture.heights.data(), texture.size, texture.size, 1);
+		bool normalsWritten = writeNetpbm(normalPath, texture.normals.data(), texture.size, texture.size, 3);
+		return heightsWritten && normalsWritten;
+	}
+}
@@ -0,0 +1,48 @@
+#ifndef RIPPLE_TEXTURES_H
+#define RIPPLE_TEXTURES_H
+#pragma once
+#include "../Terrain/array2d.h"
+#include <string>
+#include <vector>
+
+namespace ew {
+	enum class RippleAxis {
+		X = 0, //crests run along u, the height changes along v, like sandShallowX/sandSteepX
+		Z = 1 //crests run along v
+	};
+
+	struct RippleSettings {
+		int size = 256; //texels per side
+		float wavelength = 24.0f; //texels, rounded so a whole number of ripples fits the tile
+		float asymmetry = 0.5f; //0 is a symmetric profile, towards 1 the stoss side gets longer and the lee side steeper
+		float noise = 0.3f; //how far crests wander, in wavelengths
+		float contrast = 0.2f; //height range around mid gray
+		float normalStrength = 24.0f; //scales height differences per texel before they become normals
+		RippleAxis axis = RippleAxis::X;
+		unsigned int seed = 1;
+	};
+
+	struct GrainSettings {
+		int size = 256;
+		float contrast = 0.8f;
+		float normalStrength = 2.0f;
+		unsigned int seed = 7;
+	};
+
+	/// <summary>
+	/// A tileable height map and the normal map derived from it, 8 bits per channel, row 0 at v = 0
+	/// </summary>
+	struct SandTexture {
+		int size = 0;
+		std::vector<unsigned char> heights; //one gray byte per texel
+		std::vector<unsigned char> normals; //tangent space rgb, z up
+	};
+
+	RippleSettings getRippleSettings(bool steep, RippleAxis axis);
+	void generateRipples(const RippleSettings& settings, SandTexture* texture, int numThreads = 1);
+	void generateGrain(const GrainSettings& settings, SandTexture* texture, int numThreads = 1);
+	void generateRippleHeights(const RippleSettings& settings, Array2D<float>* heights, int numThreads = 1);
+	bool writeSandTexture(const SandTexture& texture, const std::string& heightPath, const std::string& normalPath);
+}
+
+#endif // RIPPLE_TEXTURES_H
@@ -0,0 +1,171 @@
+#include "culling.h"
+#include "../Terrain/duneKernelSimd.h"
+#include <math.h>
+
+namespace ew {
+	namespace {
+		using duneSimd::Lanes4;
+
+		//how far a box reaches inside a plane at its deepest corner. Below 0 it is entirely outside
+		inline float boxDistance(const glm::vec4& plane, float cx, float cy, float cz, float ex, float ey, float ez) {
+			return plane.x * cx + plane.y * cy + plane.z * cz + plane.w + fabsf(plane.x) * ex + fabsf(plane.y) * ey + fabsf(plane.z) * ez;
+		}
+	}
+
+	/// <summary>
+	/// Frustum planes from a projection times view matrix (Gribb and Hartmann), in the space the matrix maps from.
+	/// Pass projection * view for world space planes
+	/// </summary>
+	Frustum extractFrustum(const glm::mat4& viewProjection) {
+		const glm::mat4& m = viewProjection;
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+		{
+			rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+		}
+		Frustum frustum;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			frustum.planes[axis * 2] = rows[3] + rows[axis];
+			frustum.planes[axis * 2 + 1] = rows[3] - rows[axis];
+		}
+		for (glm::vec4& plane : frustum.planes)
+		{
+			plane = plane / glm::length(glm::vec3(plane));
+		}
+		return frustum;
+	}
+
+	/// <summary>
+	/// False only if the box is entirely outside one of the planes. Boxes near a corner of the frustum can pass without being in view
+	/// </summary>
+	bool isBoxVisible(const Frustum& frustum, const Bounds& worldBounds) {
+		glm::vec3 center = (worldBounds.min + worldBounds.max) * 0.5f;
+		glm::vec3 extent = (worldBounds.max - worldBounds.min) * 0.5f;
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			if (boxDistance(plane, center.x, center.y, center.z, extent.x, extent.y, extent.z) < 0.0f) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool isSphereVisible(const Frustum& frustum, const glm::vec3& center, float radius) {
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// <returns>Index of the box, which cull() writes its result to</returns>
+	int CullList::add(const Bounds& worldBounds) {
+		glm::vec3 center = (worldBounds.min + worldBounds.max) * 0.5f;
+		glm::vec3 extent = (worldBounds.max - worldBounds.min) * 0.5f;
+		m_centerX.push_back(center.x);
+		m_centerY.push_back(center.y);
+		m_centerZ.push_back(center.z);
+		m_extentX.push_back(extent.x);
+		m_extentY.push_back(extent.y);
+		m_extentZ.push_back(extent.z);
+		return (int)m_centerX.size() - 1;
+	}
+
+	void CullList::clear() {
+		m_centerX.clear();
+		m_centerY.clear();
+		m_centerZ.clear();
+		m_extentX.clear();
+		m_extentY.clear();
+		m_extentZ.clear();
+	}
+
+	/// <summary>
+	/// Tests every box against the frustum, four at a time. Same answers as isBoxVisible
+	/// </summary>
+	/// <param name="visible">Resized to size(), 1 for boxes to draw</param>
+	CullStats CullList::cull(const Frustum& frustum, std::vector<unsigned char>* visible) const {
+		int numBoxes = size();
+		visible->resize(numBoxes);
+		CullStats stats;
+
+		//the plane terms, splatted once
+		Lanes4 normal[6][3];
+		Lanes4 absNormal[6][3];
+		Lanes4 offset[6];
+		for (int p = 0; p < 6; p++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				normal[p][axis] = Lanes4(frustum.planes[p][axis]);
+				absNormal[p][axis] = Lanes4(fabsf(frustum.planes[p][axis]));
+			}
+			offset[p] = Lanes4(frustum.planes[p].w);
+		}
+
+		int i = 0;
+		for (; i + Lanes4::WIDTH <= numBoxes; i += Lanes4::WIDTH)
+		{
+			Lanes4 cx = Lanes4::load(&m_centerX[i]);
+			Lanes4 cy = Lanes4::load(&m_centerY[i]);
+			Lanes4 cz = Lanes4::load(&m_centerZ[i]);
+			Lanes4 ex = Lanes4::load(&m_extentX[i]);
+			Lanes4 ey = Lanes4::load(&m_extentY[i]);
+			Lanes4 ez = Lanes4::load(&m_extentZ[i]);
+			//a box is outside if it is outside any plane, so keep the smallest distance
+			Lanes4 nearest = Lanes4(FLT_MAX);
+			for (int p = 0; p < 6; p++)
+			{
+				Lanes4 distance = cx * normal[p][0] + cy * normal[p][1] + cz * normal[p][2] + offset[p]
+					+ ex * absNormal[p][0] + ey * absNormal[p][1] + ez * absNormal[p][2];
+				nearest = lanesMin(nearest, distance);
+			}
+			float lanes[Lanes4::WIDTH];
+			nearest.store(lanes);
+			for (int k = 0; k < Lanes4::WIDTH; k++)
+			{
+				(*visible)[i + k] = lanes[k] >= 0.0f;
+				stats.visible += lanes[k] >= 0.0f;
+			}
+		}
+		for (; i < numBoxes; i++)
+		{
+			float nearest = FLT_MAX;
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				nearest = fminf(nearest, boxDistance(plane, m_centerX[i], m_centerY[i], m_centerZ[i], m_extentX[i], m_extentY[i], m_extentZ[i]));
+			}
+			(*visible)[i] = nearest >= 0.0f;
+			stats.visible += nearest >= 0.0f;
+		}
+		stats.culled = numBoxes - stats.visible;
+		return stats;
+	}
+
+	/// <summary>
+	/// One box at a time, stopping at the first plane it is outside of. Reference for cull()
+	/// </summary>
+	CullStats CullList::cullScalar(const Frustum& frustum, std::vector<unsigned char>* visible) const {
+		int numBoxes = size();
+		visible->resize(numBoxes);
+		CullStats stats;
+		for (int i = 0; i < numBoxes; i++)
+		{
+			bool inside = true;
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				if (boxDistance(plane, m_centerX[i], m_centerY[i], m_centerZ[i], m_extentX[i], m_extentY[i], m_extentZ[i]) < 0.0f) {
+					inside = false;
+					break;
+				}
+			}
+			(*visible)[i] = inside;
+			stats.visible += inside;
+		}
+		stats.culled = numBoxes - stats.visible;
+		return stats;
+	}
+}
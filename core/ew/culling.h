@@ -0,0 +1,37 @@
+#pragma once
+#include "mesh.h"
+
+namespace ew {
+	/// <summary>
+	/// Six planes facing into the view volume: left, right, bottom, top, near, far. xyz is unit length, so
+	/// dot(plane.xyz, p) + plane.w is the distance of p inside the plane
+	/// </summary>
+	struct Frustum {
+		glm::vec4 planes[6];
+	};
+
+	struct CullStats {
+		int visible = 0;
+		int culled = 0;
+	};
+
+	Frustum extractFrustum(const glm::mat4& viewProjection);
+	bool isBoxVisible(const Frustum& frustum, const Bounds& worldBounds);
+	bool isSphereVisible(const Frustum& frustum, const glm::vec3& center, float radius);
+
+	/// <summary>
+	/// Flat list of world space boxes for culling a whole frame at once. Boxes are kept as centers and half extents
+	/// in structure of arrays form, so cull() tests four at a time
+	/// </summary>
+	class CullList {
+	public:
+		int add(const Bounds& worldBounds);
+		void clear();
+		inline int size() const { return (int)m_centerX.size(); }
+		CullStats cull(const Frustum& frustum, std::vector<unsigned char>* visible) const;
+		CullStats cullScalar(const Frustum& frustum, std::vector<unsigned char>* visible) const;
+	private:
+		std::vector<float> m_centerX, m_centerY, m_centerZ;
+		std::vector<float> m_extentX, m_extentY, m_extentZ;
+	};
+}
@@ -0,0 +1,197 @@
+#include "gridIndices.h"
+#include "meshOptimizer.h"
+#include "external/glad.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <utility>
+
+namespace ew {
+	/// <summary>
+	/// Fills indices with the triangle list of a (subDivisions + 1)^2 vertex grid
+	/// </summary>
+	/// <param name="subDivisions">Cells per side</param>
+	/// <param name="indices">Will be cleared</param>
+	void createGridIndices(int subDivisions, std::vector<unsigned int>* indices) {
+		indices->resize(getGridIndexCount(subDivisions, false));
+		writeGridIndices(subDivisions, 0, subDivisions, indices->data());
+	}
+
+	namespace {
+		//keyed by (subDivisions, triangleStrip). std::map keeps references stable as entries are added
+		std::map<std::pair<int, bool>, IndexBuffer>& gridIndexCache() {
+			static std::map<std::pair<int, bool>, IndexBuffer> cache;
+			return cache;
+		}
+
+		//buffers uploadGridIndexData has not finished yet, kept apart so nobody draws with them
+		std::map<std::pair<int, bool>, IndexBuffer>& pendingGridIndexBuffers() {
+			static std::map<std::pair<int, bool>, IndexBuffer> pending;
+			return pending;
+		}
+
+		//workers ask hasGridIndexBuffer while the GL thread adds buffers
+		std::mutex& gridIndexMutex() {
+			static std::mutex mutex;
+			return mutex;
+		}
+
+		template<typename Index>
+		void writeGridIndexData(int subDivisions, bool triangleStrip, Index* out) {
+			if (triangleStrip) {
+				writeGridStripIndices(subDivisions, 0, subDivisions, out);
+			}
+			else {
+				//row by row, every vertex goes through the vertex shader twice. The buffer is built once, so it is worth reordering
+				std::vector<unsigned int> list;
+				createGridIndices(subDivisions, &list);
+				optimizeVertexCache(list.data(), (int)list.size(), (subDivisions + 1) * (subDivisions + 1));
+				std::copy(list.begin(), list.end(), out);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Builds what getGridIndexBuffer uploads for a grid: 16 bit indices whenever the vertex count allows, triangle lists ordered
+	/// for the vertex cache. Needs no GL context, so the slow part of a new grid can run on a worker
+	/// </summary>
+	/// <param name="subDivisions">Cells per side</param>
+	/// <param name="triangleStrip">One strip per row with primitive restart instead of a triangle list</param>
+	/// <param name="data">Will be overwritten</param>
+	void createGridIndexData(int subDivisions, bool triangleStrip, GridIndexData* data) {
+		int numVertices = (subDivisions + 1) * (subDivisions + 1);
+		//strips reserve the max value for restarts
+		int maxVertices = triangleStrip ? 0xFFFF : 0x10000;
+		size_t numIndices = getGridIndexCount(subDivisions, triangleStrip);
+		data->subDivisions = subDivisions;
+		data->triangleStrip = triangleStrip;
+		data->indexType = numVertices <= maxVertices ? IndexType::UNSIGNED_SHORT : IndexType::UNSIGNED_INT;
+		if (data->indexType == IndexType::UNSIGNED_SHORT) {
+			data->bytes.resize(sizeof(unsigned short) * numIndices);
+			writeGridIndexData(subDivisions, triangleStrip, (unsigned short*)data->bytes.data());
+		}
+		else {
+			data->bytes.resize(sizeof(unsigned int) * numIndices);
+			writeGridIndexData(subDivisions, triangleStrip, (unsigned int*)data->bytes.data());
+		}
+	}
+
+	/// <summary>
+	/// True if getGridIndexBuffer already has the buffer and would return it straight away. Safe to call from any thread
+	/// </summary>
+	bool hasGridIndexBuffer(int subDivisions, bool triangleStrip) {
+		std::lock_guard<std::mutex> lock(gridIndexMutex());
+		auto found = gridIndexCache().find(std::make_pair(subDivisions, triangleStrip));
+		return found != gridIndexCache().end() && found->second.ebo != 0;
+	}
+
+	/// <summary>
+	/// Index buffer for a (subDivisions + 1)^2 vertex grid, created on first use and shared by every caller after that.
+	/// Needs a current GL context
+	/// </summary>
+	/// <param name="subDivisions">Cells per side</param>
+	/// <param name="triangleStrip">One strip per row with primitive restart instead of a triangle list</param>
+	const IndexBuffer& getGridIndexBuffer(int subDivisions, bool triangleStrip) {
+		if (!hasGridIndexBuffer(subDivisions, triangleStrip)) {
+			GridIndexData data;
+			createGridIndexData(subDivisions, triangleStrip, &data);
+			return getGridIndexBuffer(data);
+		}
+		std::lock_guard<std::mutex> lock(gridIndexMutex());
+		return gridIndexCache()[std::make_pair(subDivisions, triangleStrip)];
+	}
+
+	/// <summary>
+	/// The shared buffer for the grid data was made for, uploaded from data if it does not exist yet. Needs a current GL context
+	/// </summary>
+	const IndexBuffer& getGridIndexBuffer(const GridIndexData& data) {
+		size_t uploadedBytes = 0;
+		uploadGridIndexData(data, &uploadedBytes, SIZE_MAX);
+		std::lock_guard<std::mutex> lock(gridIndexMutex());
+		return gridIndexCache()[std::make_pair(data.subDivisions, data.triangleStrip)];
+	}
+
+	/// <summary>
+	/// Uploads the next part of data into the shared buffer for its grid, so a new grid's indices can go up over several frames.
+	/// The buffer is only shared once all of data is in. Needs a current GL context
+	/// </summary>
+	/// <param name="uploadedBytes">How much of data is in so far, 0 on the first call. Moved on by the call</param>
+	/// <param name="maxBytes">Most to upload in this call</param>
+	/// <returns>True once the buffer is complete, getGridIndexBuffer and hasGridIndexBuffer see it from then on</returns>
+	bool uploadGridIndexData(const GridIndexData& data, size_t* uploadedBytes, size_t maxBytes) {
+		std::lock_guard<std::mutex> lock(gridIndexMutex());
+		std::pair<int, bool> key = std::make_pair(data.subDivisions, data.triangleStrip);
+		auto found = gridIndexCache().find(key);
+		if (found != gridIndexCache().end() && found->second.ebo != 0) {
+			*uploadedBytes = data.bytes.size();
+			return true;
+		}
+
+		IndexBuffer& indexBuffer = pendingGridIndexBuffers()[key];
+		//no VAO bound, so the binding does not leak into a mesh
+		glBindVertexArray(0);
+		if (indexBuffer.ebo == 0) {
+			indexBuffer.numIndices = getGridIndexCount(data.subDivisions, data.triangleStrip);
+			indexBuffer.indexType = data.indexType;
+			indexBuffer.triangleStrip = data.triangleStrip;
+			glGenBuffers(1, &indexBuffer.ebo);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.ebo);
+			if (maxBytes >= data.bytes.size() && *uploadedBytes == 0) {
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.bytes.size(), data.bytes.data(), GL_STATIC_DRAW);
+				*uploadedBytes = data.bytes.size();
+			}
+			else {
+				//allocating costs about as much as a large upload, so the first part goes up on the next call
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.bytes.size(), NULL, GL_STATIC_DRAW);
+				maxBytes = 0;
+			}
+		}
+		else {
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.ebo);
+		}
+		size_t bytes = std::min(maxBytes, data.bytes.size() - *uploadedBytes);
+		if (bytes > 0) {
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, *uploadedBytes, bytes, data.bytes.data() + *uploadedBytes);
+			*uploadedBytes += bytes;
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		if (*uploadedBytes < data.bytes.size()) {
+			return false;
+		}
+		gridIndexCache()[key] = indexBuffer;
+		pendingGridIndexBuffers().erase(key);
+		return true;
+	}
+
+	/// <summary>
+	/// GPU memory held by the shared grid index buffers
+	/// </summary>
+	size_t getGridIndexCacheBytes() {
+		std::lock_guard<std::mutex> lock(gridIndexMutex());
+		size_t bytes = 0;
+		for (const auto& entry : gridIndexCache())
+		{
+			const IndexBuffer& indexBuffer = entry.second;
+			bytes += (size_t)indexBuffer.numIndices * (indexBuffer.indexType == IndexType::UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int));
+		}
+		return bytes;
+	}
+
+	/// <summary>
+	/// Deletes every shared grid index buffer. Meshes still using one must not be drawn afterwards
+	/// </summary>
+	void clearGridIndexCache() {
+		std::lock_guard<std::mutex> lock(gridIndexMutex());
+		for (auto& entry : gridIndexCache())
+		{
+			glDeleteBuffers(1, &entry.second.ebo);
+		}
+		for (auto& entry : pendingGridIndexBuffers())
+		{
+			glDeleteBuffers(1, &entry.second.ebo);
+		}
+		gridIndexCache().clear();
+		pendingGridIndexBuffers().clear();
+	}
+}
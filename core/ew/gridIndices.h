@@ -0,0 +1,75 @@
+#pragma once
+#include "mesh.h"
+
+namespace ew {
+	/// <summary>
+	/// Writes the triangle list for rows [rowBegin, rowEnd) of a (subDivisions + 1)^2 vertex grid,
+	/// 6 indices per cell as (bl, br, tr), (tr, tl, bl). Every row is subDivisions * 6 indices, so bands can be written in parallel
+	/// </summary>
+	template<typename Index>
+	void writeGridIndices(int subDivisions, int rowBegin, int rowEnd, Index* out) {
+		unsigned int verticesPerRow = subDivisions + 1;
+		for (int row = rowBegin; row < rowEnd; row++)
+		{
+			for (int col = 0; col < subDivisions; col++)
+			{
+				unsigned int bl = row * verticesPerRow + col;
+				unsigned int br = bl + 1;
+				unsigned int tl = bl + verticesPerRow;
+				unsigned int tr = tl + 1;
+
+				//Triangle 1
+				*out++ = (Index)bl;
+				*out++ = (Index)br;
+				*out++ = (Index)tr;
+
+				//Triangle 2
+				*out++ = (Index)tr;
+				*out++ = (Index)tl;
+				*out++ = (Index)bl;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Writes one triangle strip per row for rows [rowBegin, rowEnd), each followed by the restart index (the max value of Index).
+	/// Produces the same triangles and winding as writeGridIndices with (subDivisions + 1) * 2 + 1 indices per row
+	/// </summary>
+	template<typename Index>
+	void writeGridStripIndices(int subDivisions, int rowBegin, int rowEnd, Index* out) {
+		unsigned int verticesPerRow = subDivisions + 1;
+		for (int row = rowBegin; row < rowEnd; row++)
+		{
+			for (int col = 0; col <= subDivisions; col++)
+			{
+				unsigned int bl = row * verticesPerRow + col;
+				*out++ = (Index)(bl + verticesPerRow);
+				*out++ = (Index)bl;
+			}
+			*out++ = (Index)~0u;
+		}
+	}
+
+	inline int getGridIndexCount(int subDivisions, bool triangleStrip) {
+		return triangleStrip ? subDivisions * ((subDivisions + 1) * 2 + 1) : subDivisions * subDivisions * 6;
+	}
+
+	/// <summary>
+	/// What getGridIndexBuffer uploads for one grid, built ahead of time so the GL thread only has to copy it, see createGridIndexData
+	/// </summary>
+	struct GridIndexData {
+		int subDivisions = 0;
+		bool triangleStrip = false;
+		IndexType indexType = IndexType::UNSIGNED_INT;
+		std::vector<unsigned char> bytes; //empty until created
+	};
+
+	void createGridIndices(int subDivisions, std::vector<unsigned int>* indices);
+	void createGridIndexData(int subDivisions, bool triangleStrip, GridIndexData* data);
+	bool hasGridIndexBuffer(int subDivisions, bool triangleStrip = false);
+	const IndexBuffer& getGridIndexBuffer(int subDivisions, bool triangleStrip = false);
+	const IndexBuffer& getGridIndexBuffer(const GridIndexData& data);
+	bool uploadGridIndexData(const GridIndexData& data, size_t* uploadedBytes, size_t maxBytes);
+	size_t getGridIndexCacheBytes();
+	void clearGridIndexCache();
+}
@@ -3,84 +3,581 @@
 */
 
 #include "mesh.h"
+#include "vertexLayout.h"
 #include "ewMath/ewMath.h"
 #include "external/glad.h"
+#include <algorithm>
 #include <iostream>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
 
 namespace ew {
 	Mesh::Mesh(const MeshData& meshData)
 	{
 		load(meshData);
 	}
+	/// <summary>
+	/// Needs the context the mesh was loaded in to still be current
+	/// </summary>
+	Mesh::~Mesh()
+	{
+		release();
+	}
+	Mesh::Mesh(Mesh&& other) noexcept
+	{
+		swap(other);
+	}
+	Mesh& Mesh::operator=(Mesh&& other) noexcept
+	{
+		if (this != &other) {
+			release();
+			swap(other);
+		}
+		return *this;
+	}
+	/// <summary>
+	/// Deletes the VAO, the vertex buffer with its ring fences and mapping, and the owned index buffer.
+	/// A shared index buffer passed to load or setIndexBuffer stays with its owner
+	/// </summary>
+	void Mesh::release()
+	{
+		if (!m_initialized) {
+			return;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		releaseRing();
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glDeleteVertexArrays(1, &m_vao);
+		glDeleteBuffers(1, &m_vbo);
+		glDeleteBuffers(1, &m_ebo);
+		//back to a mesh that was never loaded, the empty one takes the deleted names with it
+		m_initialized = false;
+		Mesh empty;
+		swap(empty);
+	}
+	void Mesh::swap(Mesh& other) noexcept
+	{
+		std::swap(m_initialized, other.m_initialized);
+		std::swap(m_vao, other.m_vao);
+		std::swap(m_vbo, other.m_vbo);
+		std::swap(m_ebo, other.m_ebo);
+		std::swap(m_numVertices, other.m_numVertices);
+		std::swap(m_indexBuffer, other.m_indexBuffer);
+		std::swap(m_layout, other.m_layout);
+		std::swap(m_attributeLayout, other.m_attributeLayout);
+		std::swap(m_decode, other.m_decode);
+		std::swap(m_bounds, other.m_bounds);
+		std::swap(m_usage, other.m_usage);
+		std::swap(m_bufferStats, other.m_bufferStats);
+		std::swap(m_vertexCapacity, other.m_vertexCapacity);
+		std::swap(m_indexCapacity, other.m_indexCapacity);
+		std::swap(m_vertexOffset, other.m_vertexOffset);
+		std::swap(m_attributeOffset, other.m_attributeOffset);
+		std::swap(m_ringSegment, other.m_ringSegment);
+		std::swap(m_ringFences, other.m_ringFences);
+		std::swap(m_ringMapping, other.m_ringMapping);
+		std::swap(m_immutableVbo, other.m_immutableVbo);
+	}
 	void Mesh::load(const MeshData& meshData)
 	{
+		//owned indices go 16 bit whenever every vertex can be addressed with them
+		loadVertices(meshData.vertices.data(), meshData.vertices.size(), meshData.bounds);
+		if (meshData.vertices.size() <= 0x10000) {
+			std::vector<unsigned short> indices(meshData.indices.begin(), meshData.indices.end());
+			loadIndices(indices.data(), indices.size(), IndexType::UNSIGNED_SHORT);
+		}
+		else {
+			loadIndices(meshData.indices.data(), meshData.indices.size(), IndexType::UNSIGNED_INT);
+		}
+	}
+	/// <summary>
+	/// Uploads vertices and indices straight from memory the caller owns, e.g. a mapped MeshCacheFile. Nothing is copied on the CPU
+	/// </summary>
+	void Mesh::load(const Vertex* vertices, int numVertices, const void* indices, int numIndices, IndexType indexType)
+	{
+		loadVertices(vertices, numVertices, Bounds());
+		loadIndices(indices, numIndices, indexType);
+	}
+	/// <summary>
+	/// Uploads indices the mesh owns and draws with them. The vertices stay as they are
+	/// </summary>
+	void Mesh::loadIndices(const void* indices, int numIndices, IndexType indexType)
+	{
+		glBindVertexArray(m_vao);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+		if (numIndices > 0) {
+			size_t indexSize = indexType == IndexType::UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+			size_t bytes = indexSize * numIndices;
+			if (m_usage == BufferUsage::STATIC) {
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, bytes, indices, GL_STATIC_DRAW);
+				m_indexCapacity = bytes;
+				m_bufferStats.reallocations++;
+			}
+			else {
+				//indices rarely change between frames, so every non static usage keeps them like DYNAMIC
+				if (bytes > m_indexCapacity) {
+					m_indexCapacity = std::max(bytes, m_indexCapacity * 2);
+					glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexCapacity, NULL, GL_DYNAMIC_DRAW);
+					m_bufferStats.reallocations++;
+				}
+				glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, bytes, indices);
+			}
+			m_bufferStats.uploadedBytes += bytes;
+		}
+		m_indexBuffer.ebo = m_ebo;
+		m_indexBuffer.numIndices = numIndices;
+		m_indexBuffer.indexType = indexType;
+		m_indexBuffer.triangleStrip = false;
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	/// <summary>
+	/// Uploads the vertices of meshData and draws them with an index buffer owned elsewhere. meshData.indices is ignored
+	/// </summary>
+	void Mesh::load(const MeshData& meshData, const IndexBuffer& indexBuffer)
+	{
+		loadVertices(meshData.vertices.data(), meshData.vertices.size(), meshData.bounds);
+		setIndexBuffer(indexBuffer);
+	}
+	void Mesh::load(const Vertex* vertices, int numVertices, const IndexBuffer& indexBuffer)
+	{
+		loadVertices(vertices, numVertices, Bounds());
+		setIndexBuffer(indexBuffer);
+	}
+	/// <summary>
+	/// Uploads vertices packed ahead of time with indices the mesh owns. The mesh takes on their layout, nothing is packed here
+	/// </summary>
+	void Mesh::load(const PackedVertices& vertices, const void* indices, int numIndices, IndexType indexType)
+	{
+		loadVertices(vertices);
+		loadIndices(indices, numIndices, indexType);
+	}
+	/// <summary>
+	/// Uploads vertices packed ahead of time and draws them with an index buffer owned elsewhere
+	/// </summary>
+	void Mesh::load(const PackedVertices& vertices, const IndexBuffer& indexBuffer)
+	{
+		loadVertices(vertices);
+		setIndexBuffer(indexBuffer);
+	}
+	/// <summary>
+	/// Sizes the vertex buffer for vertices and takes on their count, layout, decode and bounds without uploading any of them,
+	/// vertices.data is not read. Fill it with updateVertices, e.g. a slice per frame
+	/// </summary>
+	void Mesh::allocateVertices(const PackedVertices& vertices)
+	{
+		PackedVertices empty = vertices;
+		empty.data = nullptr;
+		loadVertices(empty);
+	}
+	/// <summary>
+	/// Switches to an index buffer owned elsewhere. It must outlive its use by this mesh
+	/// </summary>
+	void Mesh::setIndexBuffer(const IndexBuffer& indexBuffer)
+	{
+		glBindVertexArray(m_vao);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.ebo);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		m_indexBuffer = indexBuffer;
+	}
+	/// <summary>
+	/// Picks how vertices are stored on the GPU from the next load on. The shaders decode every layout, see VertexDecode
+	/// </summary>
+	void Mesh::setVertexLayout(VertexLayout layout)
+	{
+		m_layout = layout;
+	}
+	/// <summary>
+	/// Picks how the buffers are kept from the next load on
+	/// </summary>
+	void Mesh::setBufferUsage(BufferUsage usage)
+	{
+		if (usage == m_usage) {
+			return;
+		}
+		if (m_usage == BufferUsage::STREAM_RING && m_initialized) {
+			glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+			releaseRing();
+			if (m_immutableVbo) {
+				//storage from glBufferStorage cannot be given back, only the buffer
+				glDeleteBuffers(1, &m_vbo);
+				glGenBuffers(1, &m_vbo);
+				m_immutableVbo = false;
+				m_attributeOffset = SIZE_MAX;
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		m_usage = usage;
+		m_vertexCapacity = 0;
+		m_indexCapacity = 0;
+		m_vertexOffset = 0;
+	}
+	/// <param name="bounds">Bounds of the vertices if the caller has them, computed here if empty</param>
+	void Mesh::loadVertices(const Vertex* vertices, int numVertices, const Bounds& bounds)
+	{
+		std::vector<PackedVertex> packed;
+		loadVertices(packMeshVertices(vertices, numVertices, bounds, m_layout, &packed));
+	}
+	void Mesh::loadVertices(const PackedVertices& vertices)
+	{
+		m_bounds = vertices.bounds;
+		m_layout = vertices.layout;
+		m_decode = vertices.decode;
 		if (!m_initialized) {
 			glGenVertexArrays(1, &m_vao);
-			glBindVertexArray(m_vao);
+			glGenBuffers(1, &m_vbo);
+			glGenBuffers(1, &m_ebo);
+		}
+
+		glBindVertexArray(m_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+
+		int numVertices = vertices.numVertices;
+		if (numVertices > 0) {
+			writeVertices(vertices.data, (size_t)getVertexSize(m_layout) * numVertices);
+		}
+		//after the write, which may have moved the vertices to another ring segment or buffer
+		if (!m_initialized || m_attributeLayout != m_layout || m_attributeOffset != m_vertexOffset) {
+			setAttributes();
+			m_initialized = true;
+		}
+		m_numVertices = numVertices;
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	/// <summary>
+	/// Writes a whole load of vertices to the bound vertex buffer, the way m_usage keeps it. Null data only makes room for them
+	/// </summary>
+	void Mesh::writeVertices(const void* data, size_t bytes)
+	{
+		switch (m_usage)
+		{
+		case BufferUsage::STATIC:
+			glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_STATIC_DRAW);
+			m_vertexCapacity = bytes;
+			m_bufferStats.reallocations++;
+			break;
+		case BufferUsage::DYNAMIC:
+			if (bytes > m_vertexCapacity) {
+				m_vertexCapacity = std::max(bytes, m_vertexCapacity * 2);
+				glBufferData(GL_ARRAY_BUFFER, m_vertexCapacity, NULL, GL_DYNAMIC_DRAW);
+				m_bufferStats.reallocations++;
+			}
+			if (data) {
+				glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+			}
+			break;
+		case BufferUsage::STREAM:
+			if (bytes > m_vertexCapacity) {
+				m_vertexCapacity = std::max(bytes, m_vertexCapacity * 2);
+				m_bufferStats.reallocations++;
+			}
+			//orphaning: the driver hands out fresh storage of the same size and frees the old once draws are done with it
+			glBufferData(GL_ARRAY_BUFFER, m_vertexCapacity, NULL, GL_STREAM_DRAW);
+			if (data) {
+				glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+			}
+			break;
+		case BufferUsage::STREAM_RING:
+			writeRing(data, bytes);
+			break;
+		}
+		if (data) {
+			m_bufferStats.uploadedBytes += bytes;
+		}
+	}
+	/// <summary>
+	/// Writes into the next ring segment. The segment being left is fenced behind the draws issued since the last load,
+	/// so a segment only has to be waited on if the GPU is RING_SEGMENTS loads behind
+	/// </summary>
+	void Mesh::writeRing(const void* data, size_t bytes)
+	{
+		if (bytes > m_vertexCapacity) {
+			allocateRing(std::max(bytes, m_vertexCapacity * 2));
+		}
+		else {
+			GLsync& leaving = (GLsync&)m_ringFences[m_ringSegment];
+			if (leaving) {
+				glDeleteSync(leaving);
+			}
+			leaving = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			m_ringSegment = (m_ringSegment + 1) % RING_SEGMENTS;
+		}
 
+		GLsync& fence = (GLsync&)m_ringFences[m_ringSegment];
+		if (fence) {
+			if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+				m_bufferStats.fenceWaits++;
+				while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+			}
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+
+		m_vertexOffset = m_ringSegment * m_vertexCapacity;
+		if (!data) {
+			return;
+		}
+		if (m_ringMapping) {
+			memcpy((char*)m_ringMapping + m_vertexOffset, data, bytes);
+		}
+		else {
+			//the fence already says nothing reads this range, so the driver need not check again
+			void* mapped = glMapBufferRange(GL_ARRAY_BUFFER, m_vertexOffset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			memcpy(mapped, data, bytes);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+	}
+	/// <summary>
+	/// Gives the ring new storage of RING_SEGMENTS segments and starts it over at the first one
+	/// </summary>
+	void Mesh::allocateRing(size_t segmentBytes)
+	{
+		releaseRing();
+		m_vertexCapacity = segmentBytes;
+		m_ringSegment = 0;
+		m_bufferStats.reallocations++;
+		size_t ringBytes = segmentBytes * RING_SEGMENTS;
+		if (GLAD_GL_VERSION_4_4) {
+			//coherent, so writes through the mapping reach the GPU without a flush. DYNAMIC_STORAGE lets updateVertices use glBufferSubData
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glDeleteBuffers(1, &m_vbo);
 			glGenBuffers(1, &m_vbo);
 			glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+			glBufferStorage(GL_ARRAY_BUFFER, ringBytes, NULL, flags | GL_DYNAMIC_STORAGE_BIT);
+			m_ringMapping = glMapBufferRange(GL_ARRAY_BUFFER, 0, ringBytes, flags);
+			m_immutableVbo = true;
+			m_attributeOffset = SIZE_MAX;
+		}
+		else {
+			glBufferData(GL_ARRAY_BUFFER, ringBytes, NULL, GL_STREAM_DRAW);
+		}
+	}
+	/// <summary>
+	/// Drops the ring's fences and mapping. The ring's buffer must be bound
+	/// </summary>
+	void Mesh::releaseRing()
+	{
+		for (void*& fence : m_ringFences)
+		{
+			if (fence) {
+				glDeleteSync((GLsync)fence);
+				fence = nullptr;
+			}
+		}
+		if (m_ringMapping) {
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			m_ringMapping = nullptr;
+		}
+	}
+	/// <summary>
+	/// Overwrites numVertices vertices from firstVertex on, uploading only that range. Indices, vertex count and decode stay as
+	/// they are, so QUANTIZED positions are clamped to the bounds of the last load. The bounds grow to fit the new vertices
+	/// </summary>
+	void Mesh::updateVertices(int firstVertex, const Vertex* vertices, int numVertices)
+	{
+		if (numVertices <= 0 || firstVertex < 0 || firstVertex + numVertices > m_numVertices) {
+			return;
+		}
+		const void* data = vertices;
+		std::vector<PackedVertex> packed;
+		if (m_layout != VertexLayout::FLOAT) {
+			packed.resize(numVertices);
+			packVertices(vertices, numVertices, m_layout, m_decode, packed.data());
+			data = packed.data();
+		}
+		size_t vertexSize = getVertexSize(m_layout);
+		size_t bytes = vertexSize * numVertices;
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glBufferSubData(GL_ARRAY_BUFFER, m_vertexOffset + vertexSize * firstVertex, bytes, data);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		m_bufferStats.uploadedBytes += bytes;
 
-			glGenBuffers(1, &m_ebo);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+		Bounds updated = computeBounds(vertices, numVertices);
+		glm::vec3 low = glm::min(m_bounds.min, updated.min);
+		glm::vec3 high = glm::max(m_bounds.max, updated.max);
+		if (low != m_bounds.min || high != m_bounds.max) {
+			//the sphere around the box, which holds everything the box does
+			m_bounds.min = low;
+			m_bounds.max = high;
+			m_bounds.center = (low + high) * 0.5f;
+			m_bounds.radius = glm::length(high - low) * 0.5f;
+		}
+	}
+	/// <summary>
+	/// Overwrites vertices.numVertices vertices from firstVertex on with vertices packed in the mesh's layout, uploading only that
+	/// range. Decode and bounds stay those of the last load or allocateVertices, vertices.decode and vertices.bounds are not read
+	/// </summary>
+	void Mesh::updateVertices(int firstVertex, const PackedVertices& vertices)
+	{
+		int numVertices = vertices.numVertices;
+		if (numVertices <= 0 || firstVertex < 0 || firstVertex + numVertices > m_numVertices || vertices.layout != m_layout) {
+			return;
+		}
+		size_t vertexSize = getVertexSize(m_layout);
+		size_t bytes = vertexSize * numVertices;
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glBufferSubData(GL_ARRAY_BUFFER, m_vertexOffset + vertexSize * firstVertex, bytes, vertices.data);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		m_bufferStats.uploadedBytes += bytes;
+	}
+	/// <summary>
+	/// Points the attributes of the bound VAO at the bound vertex buffer, in m_layout from m_vertexOffset on
+	/// </summary>
+	void Mesh::setAttributes()
+	{
+		const char* base = (const char*)m_vertexOffset;
+		if (m_layout == VertexLayout::FLOAT) {
 			//Position attribute
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), base + offsetof(Vertex, pos));
 			glEnableVertexAttribArray(0);
 
 			//Normal attribute
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), base + offsetof(Vertex, normal));
 			glEnableVertexAttribArray(1);
 
 			//UV attribute
-			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), base + offsetof(Vertex, uv));
 			glEnableVertexAttribArray(2);
 
 			//tangent attribute
-			glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, tangent)));
+			glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), base + offsetof(Vertex, tangent));
 			glEnableVertexAttribArray(3);
-
-			m_initialized = true;
 		}
-
-		glBindVertexArray(m_vao);
-		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-
-		if (meshData.vertices.size() > 0) {
-			glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshData.vertices.size(), meshData.vertices.data(), GL_STATIC_DRAW);
-		}
-		if (meshData.indices.size() > 0) {
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+		else {
+			//raw integers, not normalized: the scales in VertexDecode do that
+			GLenum positionType = m_layout == VertexLayout::HALF ? GL_HALF_FLOAT : GL_UNSIGNED_SHORT;
+			glVertexAttribPointer(0, 4, positionType, GL_FALSE, sizeof(PackedVertex), base + offsetof(PackedVertex, pos));
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, sizeof(PackedVertex), base + offsetof(PackedVertex, normal));
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(PackedVertex), base + offsetof(PackedVertex, uv));
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(3, 2, GL_SHORT, GL_FALSE, sizeof(PackedVertex), base + offsetof(PackedVertex, tangent));
+			glEnableVertexAttribArray(3);
 		}
-		m_numVertices = meshData.vertices.size();
-		m_numIndices = meshData.indices.size();
-
-		glBindVertexArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		m_attributeLayout = m_layout;
+		m_attributeOffset = m_vertexOffset;
+	}
+	/// <summary>
+	/// Constant attributes are not part of the VAO, so every draw sets its own
+	/// </summary>
+	void Mesh::applyVertexDecode() const
+	{
+		glVertexAttrib4fv(4, &m_decode.scale.x);
+		glVertexAttrib4fv(5, &m_decode.offset.x);
+		glVertexAttrib4fv(6, &m_decode.texCoord.x);
 	}
 	void Mesh::draw(ew::DrawMode drawMode) const
 	{
 		glBindVertexArray(m_vao);
+		applyVertexDecode();
 		if (drawMode == DrawMode::TRIANGLES) {
-			glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL);
+			drawIndexBuffer(m_indexBuffer, 0, m_indexBuffer.numIndices);
 		}
 		else {
 			glDrawArrays(GL_POINTS, 0, m_numVertices);
 		}
 	}
+	/// <summary>
+	/// Draws numIndices indices starting at firstIndex, in the layout of the current index buffer
+	/// </summary>
+	void Mesh::drawRange(int firstIndex, int numIndices) const
+	{
+		glBindVertexArray(m_vao);
+		applyVertexDecode();
+		drawIndexBuffer(m_indexBuffer, firstIndex, numIndices);
+	}
 	void Mesh::drawInstanced(DrawMode drawMode, unsigned int instanceCount)const {
 		glBindVertexArray(m_vao);
+		applyVertexDecode();
 
 		if (drawMode == DrawMode::TRIANGLES) {
-			glDrawElementsInstanced(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL, instanceCount);
+			drawIndexBuffer(m_indexBuffer, 0, m_indexBuffer.numIndices, instanceCount);
 		}
 		else {
 			glDrawArraysInstanced(GL_POINTS, 0, m_numVertices,instanceCount);
 		}
 	}
+	/// <summary>
+	/// Draws part of an index buffer with whatever VAO is bound, handling its index type and strip restarts
+	/// </summary>
+	void drawIndexBuffer(const IndexBuffer& indexBuffer, int firstIndex, int numIndices, unsigned int instanceCount) {
+		bool shortIndices = indexBuffer.indexType == IndexType::UNSIGNED_SHORT;
+		GLenum type = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		GLenum primitive = indexBuffer.triangleStrip ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+		const void* offset = (const void*)((size_t)firstIndex * (shortIndices ? sizeof(unsigned short) : sizeof(unsigned int)));
+
+		if (indexBuffer.triangleStrip) {
+			glEnable(GL_PRIMITIVE_RESTART);
+			glPrimitiveRestartIndex(shortIndices ? 0xFFFF : 0xFFFFFFFF);
+		}
+		if (instanceCount == 1) {
+			glDrawElements(primitive, numIndices, type, offset);
+		}
+		else {
+			glDrawElementsInstanced(primitive, numIndices, type, offset, instanceCount);
+		}
+		if (indexBuffer.triangleStrip) {
+			glDisable(GL_PRIMITIVE_RESTART);
+		}
+	}
 
 	void Mesh::bind()const {
 		glBindVertexArray(m_vao);
+		applyVertexDecode();
+	}
+
+	/// <summary>
+	/// Box around the positions, and the smallest sphere around the box's middle that holds them all
+	/// </summary>
+	Bounds computeBounds(const Vertex* vertices, int numVertices) {
+		Bounds bounds;
+		for (int i = 0; i < numVertices; i++)
+		{
+			bounds.min = glm::min(bounds.min, vertices[i].pos);
+			bounds.max = glm::max(bounds.max, vertices[i].pos);
+		}
+		if (bounds.isEmpty()) {
+			return bounds;
+		}
+		bounds.center = (bounds.min + bounds.max) * 0.5f;
+		float radiusSquared = 0.0f;
+		for (int i = 0; i < numVertices; i++)
+		{
+			glm::vec3 offset = vertices[i].pos - bounds.center;
+			radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+		}
+		bounds.radius = sqrtf(radiusSquared);
+		return bounds;
+	}
+
+	/// <summary>
+	/// Bounds of a transformed mesh. The box is the one around the transformed box (Arvo 1990), so it grows under rotation,
+	/// the sphere scales by the largest axis scale
+	/// </summary>
+	Bounds transformBounds(const Bounds& bounds, const glm::mat4& transform) {
+		if (bounds.isEmpty()) {
+			return bounds;
+		}
+		Bounds result;
+		glm::vec3 boxCenter = glm::vec3(transform * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+		glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+		glm::vec3 transformedExtent = glm::vec3(0);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			glm::vec3 column = glm::vec3(transform[axis]);
+			transformedExtent += glm::abs(column) * extent[axis];
+		}
+		result.min = boxCenter - transformedExtent;
+		result.max = boxCenter + transformedExtent;
+		float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+		result.center = glm::vec3(transform * glm::vec4(bounds.center, 1.0f));
+		result.radius = bounds.radius * scale;
+		return result;
 	}
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #pragma once
 #include "ewMath/ewMath.h"
 #include <glm/glm.hpp>
+#include <float.h>
 
 namespace ew {
 	struct Vertex {
@@ -20,12 +21,28 @@ namespace ew {
 		}
 	};
 
+	/// <summary>
+	/// Axis aligned box and bounding sphere around a set of positions. Starts out empty
+	/// </summary>
+	struct Bounds {
+		glm::vec3 min = glm::vec3(FLT_MAX);
+		glm::vec3 max = glm::vec3(-FLT_MAX);
+		glm::vec3 center = glm::vec3(0); //sphere, around the middle of the box
+		float radius = 0.0f;
+		inline bool isEmpty() const { return min.x > max.x; }
+	};
+
+	Bounds computeBounds(const Vertex* vertices, int numVertices);
+	Bounds transformBounds(const Bounds& bounds, const glm::mat4& transform);
+
 	struct MeshData {
 		std::vector<Vertex> vertices;
 		std::vector<unsigned int> indices;
+		Bounds bounds; //filled by the generators. Mesh computes its own if this is empty
 		MeshData() {
 
 		}
+		inline void updateBounds() { bounds = computeBounds(vertices.data(), (int)vertices.size()); }
 	};
 
 	enum class DrawMode {
@@ -33,22 +50,140 @@ namespace ew {
 		POINTS = 1
 	};
 
+	enum class IndexType {
+		UNSIGNED_SHORT = 0,
+		UNSIGNED_INT = 1
+	};
+
+	/// <summary>
+	/// How a Mesh stores its vertices on the GPU. Both compressed layouts are 20 bytes per vertex, see packVertices
+	/// </summary>
+	enum class VertexLayout {
+		FLOAT = 0, //Vertex as is, 44 bytes
+		HALF = 1, //half float positions around the center of the bounds
+		QUANTIZED = 2 //16 bit positions across the bounds
+	};
+
+	/// <summary>
+	/// What a shader needs to decode a vertex layout. Mesh passes it as constant vertex attributes 4 to 6 on every draw,
+	/// so shaders read it as aDecodeScale, aDecodeOffset and aTexCoordDecode. The defaults leave FLOAT vertices as they are
+	/// </summary>
+	struct VertexDecode {
+		glm::vec4 scale = glm::vec4(1); //xyz position, w normal length
+		glm::vec4 offset = glm::vec4(0); //xyz position, w is 1 when normals and tangents are octahedral
+		glm::vec4 texCoord = glm::vec4(1, 1, 0, 0); //xy scale, zw offset
+	};
+
+	/// <summary>
+	/// Vertices already stored the way a layout wants them, getVertexSize(layout) bytes each, e.g. packed on the worker that
+	/// built them (see packMeshVertices) or mapped from a cache file. Mesh uploads them as they are. Does not own the memory
+	/// </summary>
+	struct PackedVertices {
+		const void* data = nullptr;
+		int numVertices = 0;
+		VertexLayout layout = VertexLayout::FLOAT;
+		VertexDecode decode;
+		Bounds bounds;
+	};
+
+	/// <summary>
+	/// Element buffer a Mesh draws with. Meshes own theirs unless one is passed in, e.g. a grid buffer shared by every chunk
+	/// </summary>
+	struct IndexBuffer {
+		unsigned int ebo = 0;
+		int numIndices = 0;
+		IndexType indexType = IndexType::UNSIGNED_INT;
+		bool triangleStrip = false; //strips separated by the restart index, the max value of indexType
+	};
+
+	/// <summary>
+	/// How a Mesh keeps its vertex and index buffers from one load to the next
+	/// </summary>
+	enum class BufferUsage {
+		STATIC = 0, //reallocated to fit every load, for meshes loaded once
+		DYNAMIC = 1, //capacity doubles when a load does not fit, so reloads of similar sizes never reallocate. See updateVertices
+		STREAM = 2, //rewritten every frame: each load orphans the old storage, so it never waits for draws still reading it
+		STREAM_RING = 3 //rewritten every frame: loads go round a ring of segments guarded by fences, persistently mapped with GL 4.4
+	};
+
+	/// <summary>
+	/// What the loads of one Mesh have cost so far
+	/// </summary>
+	struct MeshBufferStats {
+		int reallocations = 0; //vertex or index storage allocated again
+		int fenceWaits = 0; //ring segments the GPU was still reading when they came round again
+		size_t uploadedBytes = 0;
+	};
+
 	class Mesh {
 	public:
 		Mesh() {};
 		Mesh(const MeshData& meshData);
+		~Mesh();
+		//a Mesh owns GL names, so it can be moved but never copied
+		Mesh(const Mesh&) = delete;
+		Mesh& operator=(const Mesh&) = delete;
+		Mesh(Mesh&& other) noexcept;
+		Mesh& operator=(Mesh&& other) noexcept;
 		void load(const MeshData& meshData);
+		void load(const MeshData& meshData, const IndexBuffer& indexBuffer);
+		void load(const Vertex* vertices, int numVertices, const void* indices, int numIndices, IndexType indexType);
+		void load(const Vertex* vertices, int numVertices, const IndexBuffer& indexBuffer);
+		void load(const PackedVertices& vertices, const void* indices, int numIndices, IndexType indexType);
+		void load(const PackedVertices& vertices, const IndexBuffer& indexBuffer);
+		void allocateVertices(const PackedVertices& vertices);
+		void loadIndices(const void* indices, int numIndices, IndexType indexType);
+		void setIndexBuffer(const IndexBuffer& indexBuffer);
+		void setVertexLayout(VertexLayout layout);
+		void setBufferUsage(BufferUsage usage);
+		void updateVertices(int firstVertex, const Vertex* vertices, int numVertices);
+		void updateVertices(int firstVertex, const PackedVertices& vertices);
 		void draw(DrawMode drawMode = DrawMode::TRIANGLES)const;
+		void drawRange(int firstIndex, int numIndices)const;
 		void drawInstanced(DrawMode drawMode, unsigned int instanceCount)const;
 		inline int getNumVertices()const { return m_numVertices; }
-		inline int getNumIndices()const { return m_numIndices; }
+		inline int getNumIndices()const { return m_indexBuffer.numIndices; }
+		inline IndexType getIndexType()const { return m_indexBuffer.indexType; }
+		inline const IndexBuffer& getIndexBuffer()const { return m_indexBuffer; }
+		inline VertexLayout getVertexLayout()const { return m_layout; }
+		inline const VertexDecode& getVertexDecode()const { return m_decode; }
+		inline const Bounds& getBounds()const { return m_bounds; }
+		inline BufferUsage getBufferUsage()const { return m_usage; }
+		inline const MeshBufferStats& getBufferStats()const { return m_bufferStats; }
 		void bind() const;
 	private:
+		static const int RING_SEGMENTS = 3;
+		void loadVertices(const Vertex* vertices, int numVertices, const Bounds& bounds);
+		void loadVertices(const PackedVertices& vertices);
+		void writeVertices(const void* data, size_t bytes);
+		void writeRing(const void* data, size_t bytes);
+		void allocateRing(size_t segmentBytes);
+		void releaseRing();
+		void release();
+		void swap(Mesh& other) noexcept;
+		void setAttributes();
+		void applyVertexDecode() const;
 		bool m_initialized = false;
 		unsigned int m_vao = 0;
 		unsigned int m_vbo = 0;
 		unsigned int m_ebo = 0;
 		int m_numVertices = 0;
-		int m_numIndices = 0;
+		IndexBuffer m_indexBuffer;
+		VertexLayout m_layout = VertexLayout::FLOAT;
+		VertexLayout m_attributeLayout = VertexLayout::FLOAT; //what the VAO's attributes are set up for
+		VertexDecode m_decode;
+		Bounds m_bounds; //model space
+		BufferUsage m_usage = BufferUsage::STATIC;
+		MeshBufferStats m_bufferStats;
+		size_t m_vertexCapacity = 0; //bytes, per segment for STREAM_RING
+		size_t m_indexCapacity = 0;
+		size_t m_vertexOffset = 0; //where the current vertices start in m_vbo. Only STREAM_RING moves it
+		size_t m_attributeOffset = 0; //where the VAO's attributes point
+		int m_ringSegment = 0;
+		void* m_ringFences[RING_SEGMENTS] = {}; //GLsync, placed when the loads move off a segment
+		void* m_ringMapping = nullptr; //the whole ring when it is persistently mapped
+		bool m_immutableVbo = false; //made with glBufferStorage, which cannot be reallocated
 	};
+
+	void drawIndexBuffer(const IndexBuffer& indexBuffer, int firstIndex, int numIndices, unsigned int instanceCount = 1);
 }
\ No newline at end of file
@@ -0,0 +1,263 @@
+#include "meshCache.h"
+#include "vertexLayout.h"
+#include <atomic>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ew {
+	namespace {
+		const char MESH_CACHE_MAGIC[4] = { 'E', 'W', 'M', 'C' };
+		const uint32_t MESH_CACHE_FORMAT_VERSION = 2;
+
+		//Bytes a file with this header must have. Anything else is a truncated or foreign file
+		size_t getExpectedSize(const MeshCacheHeader& header) {
+			return sizeof(MeshCacheHeader) + (size_t)header.numVertices * header.vertexSize + (size_t)header.numIndices * header.indexSize;
+		}
+
+		bool isValidHeader(const MeshCacheHeader& header, uint64_t key, size_t fileSize) {
+			return memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) == 0
+				&& header.formatVersion == MESH_CACHE_FORMAT_VERSION
+				&& header.key == key
+				&& header.vertexLayout <= (uint32_t)VertexLayout::QUANTIZED
+				&& header.vertexSize == (uint32_t)getVertexSize((VertexLayout)header.vertexLayout)
+				&& (header.indexSize == 2 || header.indexSize == 4)
+				&& getExpectedSize(header) == fileSize;
+		}
+
+		int getProcessId() {
+#if defined(_WIN32)
+			return (int)GetCurrentProcessId();
+#else
+			return (int)getpid();
+#endif
+		}
+	}
+
+	MeshCacheFile::~MeshCacheFile() {
+		close();
+	}
+
+	MeshCacheFile::MeshCacheFile(MeshCacheFile&& other) noexcept {
+		*this = std::move(other);
+	}
+
+	MeshCacheFile& MeshCacheFile::operator=(MeshCacheFile&& other) noexcept {
+		if (this != &other) {
+			close();
+			m_header = other.m_header;
+			m_size = other.m_size;
+			other.m_header = nullptr;
+			other.m_size = 0;
+#if defined(_WIN32)
+			m_file = other.m_file;
+			m_mapping = other.m_mapping;
+			other.m_file = nullptr;
+			other.m_mapping = nullptr;
+#endif
+		}
+		return *this;
+	}
+
+	/// <summary>
+	/// Maps a file written by writeMeshCache. Fails without touching the file if it is missing, truncated,
+	/// from another format or Vertex struct, or was written for a different key
+	/// </summary>
+	/// <returns>True if the file is mapped and matches key</returns>
+	bool MeshCacheFile::open(const std::string& path, uint64_t key) {
+		close();
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(MeshCacheHeader)) {
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+		if (view == NULL) {
+			if (mapping) {
+				CloseHandle(mapping);
+			}
+			CloseHandle(file);
+			return false;
+		}
+		m_file = file;
+		m_mapping = mapping;
+		m_size = (size_t)size.QuadPart;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(MeshCacheHeader)) {
+			::close(fd);
+			return false;
+		}
+		void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		//the mapping keeps the file alive
+		::close(fd);
+		if (view == MAP_FAILED) {
+			return false;
+		}
+		//the whole file is about to be uploaded, start reading it in
+		madvise(view, (size_t)info.st_size, MADV_WILLNEED);
+		m_size = (size_t)info.st_size;
+#endif
+		m_header = (const MeshCacheHeader*)view;
+		if (!isValidHeader(*m_header, key, m_size)) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// The vertices as stored, ready for Mesh::load(const PackedVertices&, ...)
+	/// </summary>
+	PackedVertices MeshCacheFile::getVertices() const {
+		PackedVertices vertices;
+		vertices.data = m_header + 1;
+		vertices.numVertices = m_header->numVertices;
+		vertices.layout = (VertexLayout)m_header->vertexLayout;
+		vertices.decode = m_header->decode;
+		vertices.bounds = m_header->bounds;
+		return vertices;
+	}
+
+	void MeshCacheFile::close() {
+		if (m_header == nullptr) {
+			return;
+		}
+#if defined(_WIN32)
+		UnmapViewOfFile(m_header);
+		CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		m_mapping = nullptr;
+		m_file = nullptr;
+#else
+		munmap((void*)m_header, m_size);
+#endif
+		m_header = nullptr;
+		m_size = 0;
+	}
+
+	/// <summary>
+	/// Writes vertices as they are stored, so a mapped file uploads without packing, and indices after them.
+	/// Indices are stored 16 bit whenever Mesh::load would upload them that way.
+	/// The file is written under a temporary name and renamed over path, so readers only ever see a complete file
+	/// </summary>
+	/// <param name="path">Destination. Its directory must exist</param>
+	/// <param name="key">Stored in the header, open() only accepts the file for the same key</param>
+	/// <param name="vertices">Vertices in any layout, see packMeshVertices</param>
+	/// <param name="indices">Can be empty</param>
+	/// <returns>False if anything failed. path is left as it was</returns>
+	bool writeMeshCache(const std::string& path, uint64_t key, const PackedVertices& vertices, const std::vector<unsigned int>& indices) {
+		MeshCacheHeader header;
+		memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+		header.formatVersion = MESH_CACHE_FORMAT_VERSION;
+		header.key = key;
+		header.vertexSize = getVertexSize(vertices.layout);
+		header.numVertices = (uint32_t)vertices.numVertices;
+		header.numIndices = (uint32_t)indices.size();
+		header.indexSize = vertices.numVertices <= 0x10000 ? 2 : 4;
+		header.vertexLayout = (uint32_t)vertices.layout;
+		header.decode = vertices.decode;
+		header.bounds = vertices.bounds;
+
+		//unique per process and call, so concurrent writers never share a temporary file
+		static std::atomic<int> counter(0);
+		char suffix[64];
+		snprintf(suffix, sizeof(suffix), ".%d.%d.tmp", getProcessId(), counter++);
+		std::string tempPath = path + suffix;
+
+		FILE* file = fopen(tempPath.c_str(), "wb");
+		if (file == NULL) {
+			return false;
+		}
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+		if (ok && header.numVertices > 0) {
+			ok = fwrite(vertices.data, header.vertexSize, header.numVertices, file) == header.numVertices;
+		}
+		if (ok && header.numIndices > 0) {
+			if (header.indexSize == 2) {
+				std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+				ok = fwrite(shortIndices.data(), sizeof(unsigned short), shortIndices.size(), file) == shortIndices.size();
+			}
+			else {
+				ok = fwrite(indices.data(), sizeof(unsigned int), header.numIndices, file) == header.numIndices;
+			}
+		}
+		//on disk before it gets the real name, so a crash cannot leave a complete looking but empty file behind
+		ok = ok && fflush(file) == 0;
+#if defined(_WIN32)
+		ok = ok && _commit(_fileno(file)) == 0;
+#else
+		ok = ok && fsync(fileno(file)) == 0;
+#endif
+		ok = fclose(file) == 0 && ok;
+
+#if defined(_WIN32)
+		ok = ok && MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+		ok = ok && rename(tempPath.c_str(), path.c_str()) == 0;
+#endif
+		if (!ok) {
+			remove(tempPath.c_str());
+		}
+		return ok;
+	}
+
+	/// <summary>
+	/// Writes meshData with FLOAT vertices, see writeMeshCache above
+	/// </summary>
+	bool writeMeshCache(const std::string& path, uint64_t key, const MeshData& meshData) {
+		std::vector<PackedVertex> unused;
+		PackedVertices vertices = packMeshVertices(meshData.vertices.data(), (int)meshData.vertices.size(), meshData.bounds, VertexLayout::FLOAT, &unused);
+		return writeMeshCache(path, key, vertices, meshData.indices);
+	}
+
+	/// <summary>
+	/// Creates a single directory level
+	/// </summary>
+	/// <returns>True if the directory exists afterwards</returns>
+	bool createCacheDirectory(const std::string& directory) {
+#if defined(_WIN32)
+		return _mkdir(directory.c_str()) == 0 || errno == EEXIST;
+#else
+		return mkdir(directory.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+	}
+
+	/// <summary>
+	/// 64 bit FNV-1a. Chain calls by passing the previous result as hash
+	/// </summary>
+	uint64_t hashBytes(const void* data, size_t size, uint64_t hash) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+}
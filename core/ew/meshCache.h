@@ -0,0 +1,66 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+#pragma once
+#include "mesh.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Start of a mesh cache file. The vertices follow already stored in vertexLayout, then the indices in indexType.
+	/// Files are native endian, they are a local cache and not meant to be shared between machines
+	/// </summary>
+	struct MeshCacheHeader {
+		char magic[4]; //"EWMC"
+		uint32_t formatVersion;
+		uint64_t key; //whatever the writer derived the mesh from, see getTerrainCacheKey
+		uint32_t vertexSize; //getVertexSize(vertexLayout) of the writer
+		uint32_t numVertices;
+		uint32_t numIndices;
+		uint32_t indexSize; //2 or 4
+		uint32_t vertexLayout; //a VertexLayout
+		VertexDecode decode; //for packed layouts
+		Bounds bounds;
+	};
+
+	/// <summary>
+	/// A mesh cache file mapped read only. The vertices and indices point into the mapping, so they can be passed
+	/// to Mesh::load without parsing, packing or copying. They stay valid until close() or destruction
+	/// </summary>
+	class MeshCacheFile {
+	public:
+		MeshCacheFile() {}
+		~MeshCacheFile();
+		MeshCacheFile(MeshCacheFile&& other) noexcept;
+		MeshCacheFile& operator=(MeshCacheFile&& other) noexcept;
+		MeshCacheFile(const MeshCacheFile&) = delete;
+		MeshCacheFile& operator=(const MeshCacheFile&) = delete;
+
+		bool open(const std::string& path, uint64_t key);
+		void close();
+		inline bool isOpen() const { return m_header != nullptr; }
+		PackedVertices getVertices() const;
+		inline int getNumVertices() const { return m_header->numVertices; }
+		inline VertexLayout getVertexLayout() const { return (VertexLayout)m_header->vertexLayout; }
+		inline const void* getIndices() const { return (const char*)(m_header + 1) + (size_t)m_header->numVertices * m_header->vertexSize; }
+		inline int getNumIndices() const { return m_header->numIndices; }
+		inline IndexType getIndexType() const { return m_header->indexSize == 2 ? IndexType::UNSIGNED_SHORT : IndexType::UNSIGNED_INT; }
+		inline size_t getBytes() const { return m_size; }
+
+	private:
+		const MeshCacheHeader* m_header = nullptr;
+		size_t m_size = 0;
+#if defined(_WIN32)
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#endif
+	};
+
+	bool writeMeshCache(const std::string& path, uint64_t key, const PackedVertices& vertices, const std::vector<unsigned int>& indices);
+	bool writeMeshCache(const std::string& path, uint64_t key, const MeshData& meshData);
+	bool createCacheDirectory(const std::string& directory);
+	uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+}
+
+#endif // MESH_CACHE_H
@@ -0,0 +1,325 @@
+#include "meshOptimizer.h"
+#include <algorithm>
+
+namespace ew {
+	namespace {
+		//Simulated FIFO cache. A vertex is cached while fewer than cacheSize misses came after its own,
+		//so flushing is just moving the clock cacheSize misses ahead
+		struct FifoCache {
+			std::vector<int> stamps;
+			int time;
+			int cacheSize;
+
+			FifoCache(int numVertices, int cacheSize) : stamps(numVertices, 0), time(cacheSize + 1), cacheSize(cacheSize) {
+			}
+
+			//true on a miss
+			bool touch(unsigned int v) {
+				if (time - stamps[v] <= cacheSize) {
+					return false;
+				}
+				stamps[v] = time++;
+				return true;
+			}
+
+			void flush() {
+				time += cacheSize + 1;
+			}
+		};
+	}
+
+	/// <summary>
+	/// Runs a triangle list through a FIFO post-transform cache
+	/// </summary>
+	/// <param name="cacheSize">Vertices the cache holds. 16 to 32 is typical for current GPUs</param>
+	VertexCacheStats analyzeVertexCache(const unsigned int* indices, int numIndices, int numVertices, int cacheSize) {
+		VertexCacheStats stats;
+		if (numIndices < 3) {
+			return stats;
+		}
+		FifoCache cache(numVertices, cacheSize);
+		std::vector<char> referenced(numVertices, 0);
+		int misses = 0;
+		int numReferenced = 0;
+		for (int i = 0; i < numIndices; i++)
+		{
+			unsigned int v = indices[i];
+			misses += cache.touch(v);
+			if (!referenced[v]) {
+				referenced[v] = 1;
+				numReferenced++;
+			}
+		}
+		stats.acmr = (float)misses / (numIndices / 3);
+		stats.atvr = (float)misses / numReferenced;
+		return stats;
+	}
+
+	/// <summary>
+	/// Reorders triangles for the post-transform cache with Tipsify (Sander, Nehab and Barczak 2007). Triangles are emitted
+	/// as fans around one vertex at a time, moving to a neighbour that is still in the cache, in linear time
+	/// </summary>
+	/// <param name="cacheSize">Vertices the cache holds</param>
+	/// <param name="clusters">Optional. Gets the first triangle of every run that had to jump to a vertex out of the cache, for optimizeOverdraw</param>
+	void optimizeVertexCache(unsigned int* indices, int numIndices, int numVertices, int cacheSize, std::vector<int>* clusters) {
+		int numTriangles = numIndices / 3;
+		if (clusters != nullptr) {
+			clusters->clear();
+		}
+
+		//triangles around every vertex, and how many of them are left
+		std::vector<int> live(numVertices, 0);
+		for (int i = 0; i < numTriangles * 3; i++)
+		{
+			live[indices[i]]++;
+		}
+		std::vector<int> offsets(numVertices + 1, 0);
+		for (int v = 0; v < numVertices; v++)
+		{
+			offsets[v + 1] = offsets[v] + live[v];
+		}
+		std::vector<int> adjacency(numTriangles * 3);
+		std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+		for (int i = 0; i < numTriangles * 3; i++)
+		{
+			adjacency[fill[indices[i]]++] = i / 3;
+		}
+
+		std::vector<int> stamps(numVertices, 0);
+		int time = cacheSize + 1;
+		std::vector<char> emitted(numTriangles, 0);
+		std::vector<unsigned int> deadEnds;
+		std::vector<unsigned int> candidates;
+		std::vector<unsigned int> out;
+		out.reserve(numTriangles * 3);
+		deadEnds.reserve(numTriangles * 3);
+		int cursor = 0;
+
+		//the most recent vertex with triangles left, or the next one in input order
+		auto skipDeadEnd = [&]() {
+			while (!deadEnds.empty())
+			{
+				unsigned int v = deadEnds.back();
+				deadEnds.pop_back();
+				if (live[v] > 0) {
+					return (int)v;
+				}
+			}
+			for (; cursor < numVertices; cursor++)
+			{
+				if (live[cursor] > 0) {
+					return cursor;
+				}
+			}
+			return -1;
+		};
+
+		int fanning = skipDeadEnd();
+		while (fanning >= 0)
+		{
+			if (clusters != nullptr && (clusters->empty() || candidates.empty())) {
+				clusters->push_back((int)out.size() / 3);
+			}
+			candidates.clear();
+			for (int k = offsets[fanning]; k < offsets[fanning + 1]; k++)
+			{
+				int t = adjacency[k];
+				if (emitted[t]) {
+					continue;
+				}
+				emitted[t] = 1;
+				for (int c = 0; c < 3; c++)
+				{
+					unsigned int v = indices[t * 3 + c];
+					out.push_back(v);
+					deadEnds.push_back(v);
+					candidates.push_back(v);
+					live[v]--;
+					if (time - stamps[v] > cacheSize) {
+						stamps[v] = time++;
+					}
+				}
+			}
+
+			//the oldest neighbour whose remaining triangles would still find it in the cache
+			int next = -1;
+			int bestPriority = -1;
+			for (unsigned int v : candidates)
+			{
+				if (live[v] <= 0) {
+					continue;
+				}
+				int priority = 0;
+				if (time - stamps[v] + 2 * live[v] <= cacheSize) {
+					priority = time - stamps[v];
+				}
+				if (priority > bestPriority) {
+					bestPriority = priority;
+					next = v;
+				}
+			}
+			if (next < 0) {
+				next = skipDeadEnd();
+				//marks a new cluster on the next pass
+				candidates.clear();
+			}
+			fanning = next;
+		}
+		std::copy(out.begin(), out.end(), indices);
+	}
+
+	/// <summary>
+	/// Sorts clusters of triangles so the ones facing away from the middle of the mesh draw first, since those tend to cover
+	/// the rest from any side (Sander, Nehab and Barczak 2007). Clusters from optimizeVertexCache are split further wherever
+	/// the cache does well enough, so the cost in cache misses stays within threshold
+	/// </summary>
+	/// <param name="clusters">First triangle of every cluster, from optimizeVertexCache</param>
+	/// <param name="cacheSize">Same cache size optimizeVertexCache used</param>
+	/// <param name="threshold">How much worse than its whole cluster a split piece's cache misses per triangle may be. 1 keeps every cluster whole</param>
+	void optimizeOverdraw(const Vertex* vertices, unsigned int* indices, int numIndices, const std::vector<int>& clusters, int cacheSize, float threshold) {
+		int numTriangles = numIndices / 3;
+		if (numTriangles == 0) {
+			return;
+		}
+		int numVertices = 0;
+		for (int i = 0; i < numTriangles * 3; i++)
+		{
+			numVertices = std::max(numVertices, (int)indices[i] + 1);
+		}
+
+		//split every cluster as soon as its cache misses so far, from a cold cache, drop within threshold of the whole cluster's
+		FifoCache cache(numVertices, cacheSize);
+		std::vector<int> pieces;
+		for (size_t c = 0; c < std::max(clusters.size(), (size_t)1); c++)
+		{
+			int begin = clusters.empty() ? 0 : clusters[c];
+			int end = c + 1 < clusters.size() ? clusters[c + 1] : numTriangles;
+			cache.flush();
+			int clusterMisses = 0;
+			for (int i = begin * 3; i < end * 3; i++)
+			{
+				clusterMisses += cache.touch(indices[i]);
+			}
+			float clusterAcmr = (float)clusterMisses / std::max(end - begin, 1);
+
+			cache.flush();
+			pieces.push_back(begin);
+			int misses = 0;
+			int count = 0;
+			for (int t = begin; t < end - 1; t++)
+			{
+				for (int i = t * 3; i < t * 3 + 3; i++)
+				{
+					misses += cache.touch(indices[i]);
+				}
+				count++;
+				if (misses <= clusterAcmr * threshold * count) {
+					//pieces start with a cold cache, since sorting will move them apart
+					pieces.push_back(t + 1);
+					cache.flush();
+					misses = 0;
+					count = 0;
+				}
+			}
+		}
+
+		//area weighted centroid and normal of every piece
+		int numPieces = (int)pieces.size();
+		std::vector<glm::vec3> centroids(numPieces, glm::vec3(0));
+		std::vector<glm::vec3> normals(numPieces, glm::vec3(0));
+		glm::vec3 meshCentroid = glm::vec3(0);
+		float meshArea = 0.0f;
+		for (int p = 0; p < numPieces; p++)
+		{
+			int end = p + 1 < numPieces ? pieces[p + 1] : numTriangles;
+			float area = 0.0f;
+			for (int t = pieces[p]; t < end; t++)
+			{
+				const glm::vec3& a = vertices[indices[t * 3]].pos;
+				const glm::vec3& b = vertices[indices[t * 3 + 1]].pos;
+				const glm::vec3& c = vertices[indices[t * 3 + 2]].pos;
+				glm::vec3 normal = glm::cross(b - a, c - a);
+				float triangleArea = glm::length(normal);
+				centroids[p] += (a + b + c) * (triangleArea / 3.0f);
+				normals[p] += normal;
+				area += triangleArea;
+			}
+			meshCentroid += centroids[p];
+			meshArea += area;
+			centroids[p] = area > 0.0f ? centroids[p] / area : glm::vec3(0);
+		}
+		meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0);
+
+		std::vector<float> keys(numPieces);
+		for (int p = 0; p < numPieces; p++)
+		{
+			float length = glm::length(normals[p]);
+			keys[p] = length > 0.0f ? glm::dot(centroids[p] - meshCentroid, normals[p] / length) : 0.0f;
+		}
+		std::vector<int> order(numPieces);
+		for (int p = 0; p < numPieces; p++)
+		{
+			order[p] = p;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] > keys[b]; });
+
+		std::vector<unsigned int> sorted;
+		sorted.reserve(numTriangles * 3);
+		for (int p : order)
+		{
+			int end = p + 1 < numPieces ? pieces[p + 1] : numTriangles;
+			sorted.insert(sorted.end(), indices + pieces[p] * 3, indices + end * 3);
+		}
+		std::copy(sorted.begin(), sorted.end(), indices);
+	}
+
+	/// <summary>
+	/// Renumbers vertices in the order the indices first use them, so the vertex fetch walks memory forwards.
+	/// Unused vertices move to the end
+	/// </summary>
+	void optimizeVertexFetch(MeshData* mesh) {
+		int numVertices = (int)mesh->vertices.size();
+		std::vector<int> remap(numVertices, -1);
+		std::vector<Vertex> vertices;
+		vertices.reserve(numVertices);
+		for (unsigned int& index : mesh->indices)
+		{
+			if (remap[index] < 0) {
+				remap[index] = (int)vertices.size();
+				vertices.push_back(mesh->vertices[index]);
+			}
+			index = remap[index];
+		}
+		for (int v = 0; v < numVertices; v++)
+		{
+			if (remap[v] < 0) {
+				vertices.push_back(mesh->vertices[v]);
+			}
+		}
+		mesh->vertices.swap(vertices);
+	}
+
+	/// <summary>
+	/// Runs the vertex cache, overdraw and vertex fetch passes over a triangle list mesh. Draws the same triangles
+	/// </summary>
+	/// <param name="overdraw">Sort clusters for less overdraw, for a few percent more cache misses</param>
+	/// <returns>Cache efficiency before and after</returns>
+	MeshOptimizeStats optimizeMesh(MeshData* mesh, bool overdraw, int cacheSize) {
+		MeshOptimizeStats stats;
+		int numVertices = (int)mesh->vertices.size();
+		int numIndices = (int)mesh->indices.size();
+		stats.before = analyzeVertexCache(mesh->indices.data(), numIndices, numVertices, cacheSize);
+		if (numIndices < 3) {
+			stats.after = stats.before;
+			return stats;
+		}
+		std::vector<int> clusters;
+		optimizeVertexCache(mesh->indices.data(), numIndices, numVertices, cacheSize, overdraw ? &clusters : nullptr);
+		if (overdraw) {
+			optimizeOverdraw(mesh->vertices.data(), mesh->indices.data(), numIndices, clusters, cacheSize);
+		}
+		optimizeVertexFetch(mesh);
+		stats.after = analyzeVertexCache(mesh->indices.data(), numIndices, numVertices, cacheSize);
+		return stats;
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "mesh.h"
+
+namespace ew {
+	/// <summary>
+	/// Post-transform cache efficiency of an index order, from a simulated FIFO cache
+	/// </summary>
+	struct VertexCacheStats {
+		float acmr = 0.0f; //vertex shader runs per triangle, 0.5 at best for big meshes and 3 at worst
+		float atvr = 0.0f; //vertex shader runs per referenced vertex, 1 is ideal
+	};
+
+	struct MeshOptimizeStats {
+		VertexCacheStats before;
+		VertexCacheStats after;
+	};
+
+	VertexCacheStats analyzeVertexCache(const unsigned int* indices, int numIndices, int numVertices, int cacheSize = 16);
+	void optimizeVertexCache(unsigned int* indices, int numIndices, int numVertices, int cacheSize = 16, std::vector<int>* clusters = nullptr);
+	void optimizeOverdraw(const Vertex* vertices, unsigned int* indices, int numIndices, const std::vector<int>& clusters, int cacheSize = 16, float threshold = 1.05f);
+	void optimizeVertexFetch(MeshData* mesh);
+	MeshOptimizeStats optimizeMesh(MeshData* mesh, bool overdraw = true, int cacheSize = 16);
+}
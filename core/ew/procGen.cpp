@@ -4,6 +4,7 @@
 
 
 #include "procGen.h"
+#include "gridIndices.h"
 #include <stdlib.h>
 
 namespace ew {
@@ -50,6 +51,7 @@ namespace ew {
 		createCubeFace(glm::vec3{ -1.0f,+0.0f,+0.0f }, size, mesh); //Left
 		createCubeFace(glm::vec3{ +0.0f,-1.0f,+0.0f }, size, mesh); //Bottom
 		createCubeFace(glm::vec3{ +0.0f,+0.0f,-1.0f }, size, mesh); //Back
+		mesh->updateBounds();
 		return;
 	}
 
@@ -64,7 +66,6 @@ namespace ew {
 		mesh->vertices.clear();
 		mesh->indices.clear();
 		mesh->vertices.reserve((subDivisions + 1) * (subDivisions + 1));
-		mesh->indices.reserve(subDivisions * subDivisions * 6);
 
 		for (size_t row = 0; row <= subDivisions; row++)
 		{
@@ -83,27 +84,9 @@ namespace ew {
 			}
 		}	
 		
-		//Indices and tangents/bitangents
-		for (size_t row = 0; row < subDivisions; row++)
-		{
-			for (size_t col = 0; col < subDivisions; col++)
-			{
-				unsigned int bl = row * (subDivisions + 1) + col;
-				unsigned int br = bl + 1;
-				unsigned int tl = bl + subDivisions + 1;
-				unsigned int tr = tl + 1;
-
-				//Triangle 1
-				mesh->indices.emplace_back(bl);
-				mesh->indices.emplace_back(br);
-				mesh->indices.emplace_back(tr);
-
-				//Triangle 2
-				mesh->indices.emplace_back(tr);
-				mesh->indices.emplace_back(tl);
-				mesh->indices.emplace_back(bl);
-			}
-		}
+		//Indices
+		createGridIndices(subDivisions, &mesh->indices);
+		mesh->updateBounds();
 
 		return;
 	}
@@ -118,7 +101,6 @@ namespace ew {
 		mesh->vertices.clear();
 		mesh->indices.clear();
 		mesh->vertices.reserve((subDivisions + 1) * (subDivisions + 1));
-		mesh->indices.reserve(subDivisions * subDivisions * 6);
 
 		float thetaStep = 2 * PI / subDivisions;
 		float phiStep = PI / subDivisions;
@@ -143,25 +125,8 @@ namespace ew {
 		}
 
 		//Indices
-		for (size_t row = 0; row < subDivisions; row++)
-		{
-			for (size_t col = 0; col < subDivisions; col++)
-			{
-				unsigned int bl = row * (subDivisions + 1) + col;
-				unsigned int br = bl + 1;
-				unsigned int tl = bl + subDivisions + 1;
-				unsigned int tr = tl + 1;
-				//Triangle 1
-				mesh->indices.emplace_back(bl);
-				mesh->indices.emplace_back(br);
-				mesh->indices.emplace_back(tr);
-
-				//Triangle 2
-				mesh->indices.emplace_back(tr);
-				mesh->indices.emplace_back(tl);
-				mesh->indices.emplace_back(bl);
-			}
-		}
+		createGridIndices(subDivisions, &mesh->indices);
+		mesh->updateBounds();
 		return;
 	}
 
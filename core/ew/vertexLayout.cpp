@@ -0,0 +1,227 @@
+#include "vertexLayout.h"
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace ew {
+	namespace {
+		const float OCTAHEDRAL_MAX = 32767.0f;
+		const float QUANTIZED_MAX = 65535.0f;
+
+		static_assert(sizeof(PackedVertex) == 20, "compressed vertices are 20 bytes");
+
+		inline float signNotZero(float v) {
+			return v >= 0.0f ? 1.0f : -1.0f;
+		}
+
+		//same as decodeOctahedral in the vertex shaders
+		glm::vec3 decodeOctahedral(short x, short y) {
+			glm::vec2 e = glm::vec2(x / OCTAHEDRAL_MAX, y / OCTAHEDRAL_MAX);
+			glm::vec3 v = glm::vec3(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+			if (v.z < 0.0f) {
+				v.x = (1.0f - fabsf(e.y)) * signNotZero(e.x);
+				v.y = (1.0f - fabsf(e.x)) * signNotZero(e.y);
+			}
+			return glm::normalize(v);
+		}
+
+		/// <summary>
+		/// Folds the direction of v onto the octahedron and rounds it to 16 bits. A zero vector comes out as (0, 0), straight up
+		/// </summary>
+		void encodeOctahedral(const glm::vec3& v, short* out) {
+			float sum = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+			if (sum == 0.0f) {
+				out[0] = out[1] = 0;
+				return;
+			}
+			float x = v.x / sum;
+			float y = v.y / sum;
+			if (v.z < 0.0f) {
+				float folded = (1.0f - fabsf(y)) * signNotZero(x);
+				y = (1.0f - fabsf(x)) * signNotZero(y);
+				x = folded;
+			}
+			out[0] = (short)roundf(std::min(std::max(x, -1.0f), 1.0f) * OCTAHEDRAL_MAX);
+			out[1] = (short)roundf(std::min(std::max(y, -1.0f), 1.0f) * OCTAHEDRAL_MAX);
+		}
+
+		inline unsigned short quantize(float value, float offset, float inverseScale) {
+			float q = roundf((value - offset) * inverseScale);
+			return (unsigned short)std::min(std::max(q, 0.0f), QUANTIZED_MAX);
+		}
+
+		inline float inverse(float scale) {
+			return scale == 0.0f ? 0.0f : 1.0f / scale;
+		}
+	}
+	int getVertexSize(VertexLayout layout) {
+		return layout == VertexLayout::FLOAT ? (int)sizeof(Vertex) : (int)sizeof(PackedVertex);
+	}
+
+	/// <summary>
+	/// Packs vertices into a compressed layout. HALF keeps positions as half floats around the center of their bounds,
+	/// for meshes that are not too far across, QUANTIZED spreads 16 bits over the bounds on each axis
+	/// </summary>
+	/// <returns>Constants that decode the packed vertices, in the shaders or with unpackVertex</returns>
+	VertexDecode packVertices(const Vertex* vertices, int numVertices, VertexLayout layout, PackedVertex* out) {
+		VertexDecode decode;
+		if (numVertices <= 0) {
+			return decode;
+		}
+		glm::vec3 low = vertices[0].pos, high = vertices[0].pos;
+		glm::vec2 uvLow = vertices[0].uv, uvHigh = vertices[0].uv;
+		float longestNormal = 0.0f;
+		for (int i = 0; i < numVertices; i++)
+		{
+			const Vertex& v = vertices[i];
+			low = glm::vec3(std::min(low.x, v.pos.x), std::min(low.y, v.pos.y), std::min(low.z, v.pos.z));
+			high = glm::vec3(std::max(high.x, v.pos.x), std::max(high.y, v.pos.y), std::max(high.z, v.pos.z));
+			uvLow = glm::vec2(std::min(uvLow.x, v.uv.x), std::min(uvLow.y, v.uv.y));
+			uvHigh = glm::vec2(std::max(uvHigh.x, v.uv.x), std::max(uvHigh.y, v.uv.y));
+			longestNormal = std::max(longestNormal, glm::length(v.normal));
+		}
+
+		if (layout == VertexLayout::HALF) {
+			decode.scale = glm::vec4(1.0f);
+			decode.offset = glm::vec4((low + high) * 0.5f, 1.0f);
+		}
+		else {
+			decode.scale = glm::vec4((high - low) / QUANTIZED_MAX, longestNormal / QUANTIZED_MAX);
+			decode.offset = glm::vec4(low, 1.0f);
+		}
+		glm::vec2 uvScale = (uvHigh - uvLow) / QUANTIZED_MAX;
+		decode.texCoord = glm::vec4(uvScale.x, uvScale.y, uvLow.x, uvLow.y);
+		packVertices(vertices, numVertices, layout, decode, out);
+		return decode;
+	}
+
+	/// <summary>
+	/// Packs vertices with decode constants from an earlier packVertices, e.g. to update part of a mesh.
+	/// QUANTIZED positions and uvs outside the bounds the constants were made for are clamped to them
+	/// </summary>
+	void packVertices(const Vertex* vertices, int numVertices, VertexLayout layout, const VertexDecode& decode, PackedVertex* out) {
+		glm::vec2 uvLow = glm::vec2(decode.texCoord.z, decode.texCoord.w);
+		glm::vec2 uvScale = glm::vec2(decode.texCoord.x, decode.texCoord.y);
+		glm::vec4 inverseScale = glm::vec4(inverse(decode.scale.x), inverse(decode.scale.y), inverse(decode.scale.z), inverse(decode.scale.w));
+		glm::vec2 inverseUvScale = glm::vec2(inverse(uvScale.x), inverse(uvScale.y));
+
+		for (int i = 0; i < numVertices; i++)
+		{
+			const Vertex& v = vertices[i];
+			PackedVertex& p = out[i];
+			float normalLength = glm::length(v.normal);
+			if (layout == VertexLayout::HALF) {
+				p.pos[0] = floatToHalf(v.pos.x - decode.offset.x);
+				p.pos[1] = floatToHalf(v.pos.y - decode.offset.y);
+				p.pos[2] = floatToHalf(v.pos.z - decode.offset.z);
+				p.pos[3] = floatToHalf(normalLength);
+			}
+			else {
+				p.pos[0] = quantize(v.pos.x, decode.offset.x, inverseScale.x);
+				p.pos[1] = quantize(v.pos.y, decode.offset.y, inverseScale.y);
+				p.pos[2] = quantize(v.pos.z, decode.offset.z, inverseScale.z);
+				p.pos[3] = quantize(normalLength, 0.0f, inverseScale.w);
+			}
+			encodeOctahedral(v.normal, p.normal);
+			encodeOctahedral(v.tangent, p.tangent);
+			p.uv[0] = quantize(v.uv.x, uvLow.x, inverseUvScale.x);
+			p.uv[1] = quantize(v.uv.y, uvLow.y, inverseUvScale.y);
+		}
+	}
+
+	/// <summary>
+	/// Gets vertices ready for Mesh::load(const PackedVertices&, ...), so the thread that built them does the packing
+	/// and the GL thread only copies bytes
+	/// </summary>
+	/// <param name="bounds">Bounds of the vertices if the caller has them, computed here if empty</param>
+	/// <param name="packed">Receives the packed vertices. Left empty for FLOAT, which points at vertices instead</param>
+	/// <returns>A view of vertices or packed, valid as long as they are</returns>
+	PackedVertices packMeshVertices(const Vertex* vertices, int numVertices, const Bounds& bounds, VertexLayout layout, std::vector<PackedVertex>* packed) {
+		PackedVertices result;
+		result.numVertices = numVertices;
+		result.layout = layout;
+		result.bounds = bounds.isEmpty() ? computeBounds(vertices, numVertices) : bounds;
+		if (layout == VertexLayout::FLOAT) {
+			packed->clear();
+			result.data = vertices;
+		}
+		else {
+			packed->resize(numVertices);
+			result.decode = packVertices(vertices, numVertices, layout, packed->data());
+			result.data = packed->data();
+		}
+		return result;
+	}
+
+	/// <summary>
+	/// Decodes a packed vertex the way the vertex shaders do
+	/// </summary>
+	Vertex unpackVertex(const PackedVertex& packed, VertexLayout layout, const VertexDecode& decode) {
+		glm::vec4 raw;
+		for (int i = 0; i < 4; i++)
+		{
+			raw[i] = layout == VertexLayout::HALF ? halfToFloat(packed.pos[i]) : (float)packed.pos[i];
+		}
+		Vertex v;
+		v.pos = glm::vec3(decode.offset) + glm::vec3(raw) * glm::vec3(decode.scale);
+		v.normal = decodeOctahedral(packed.normal[0], packed.normal[1]) * (raw.w * decode.scale.w);
+		v.tangent = decodeOctahedral(packed.tangent[0], packed.tangent[1]);
+		v.uv = glm::vec2(decode.texCoord.z, decode.texCoord.w) + glm::vec2(packed.uv[0], packed.uv[1]) * glm::vec2(decode.texCoord.x, decode.texCoord.y);
+		return v;
+	}
+
+	/// <summary>
+	/// Rounds to the nearest half float, ties to even. Out of range values become infinity
+	/// </summary>
+	unsigned short floatToHalf(float value) {
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		uint32_t sign = (bits >> 16) & 0x8000;
+		int rawExponent = (bits >> 23) & 0xFF;
+		uint32_t mantissa = bits & 0x7FFFFF;
+		if (rawExponent == 0xFF) {
+			return (unsigned short)(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+		}
+		int exponent = rawExponent - 127 + 15;
+		if (exponent >= 31) {
+			return (unsigned short)(sign | 0x7C00);
+		}
+		if (exponent <= 0) {
+			//subnormal, or zero
+			if (exponent < -10) {
+				return (unsigned short)sign;
+			}
+			mantissa |= 0x800000;
+			int shift = 14 - exponent;
+			uint32_t half = mantissa >> shift;
+			uint32_t rest = mantissa & ((1u << shift) - 1);
+			uint32_t halfway = 1u << (shift - 1);
+			if (rest > halfway || (rest == halfway && (half & 1))) {
+				half++;
+			}
+			return (unsigned short)(sign | half);
+		}
+		uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+		uint32_t rest = mantissa & 0x1FFF;
+		//a carry out of the mantissa bumps the exponent, which is the right answer
+		if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+			half++;
+		}
+		return (unsigned short)half;
+	}
+
+	float halfToFloat(unsigned short half) {
+		uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+		int exponent = (half >> 10) & 0x1F;
+		uint32_t mantissa = half & 0x3FF;
+		if (exponent == 0) {
+			float value = mantissa * (1.0f / 16777216.0f);
+			return sign ? -value : value;
+		}
+		uint32_t bits = exponent == 31 ? sign | 0x7F800000 | (mantissa << 13) : sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+}
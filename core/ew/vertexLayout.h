@@ -0,0 +1,27 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+#pragma once
+#include "mesh.h"
+
+namespace ew {
+	/// <summary>
+	/// A vertex in one of the compressed layouts. Shaders get the raw integers (or halves) and decode them with VertexDecode.
+	/// Normals and tangents are octahedral, the normal's length rides along in the position's w, tangents come back unit length
+	/// </summary>
+	struct PackedVertex {
+		unsigned short pos[4]; //xyz and normal length: 16 bit across the bounds, or half floats
+		short normal[2]; //octahedral, -32767 to 32767
+		unsigned short uv[2]; //16 bit across the uv bounds
+		short tangent[2];
+	};
+
+	int getVertexSize(VertexLayout layout);
+	VertexDecode packVertices(const Vertex* vertices, int numVertices, VertexLayout layout, PackedVertex* out);
+	void packVertices(const Vertex* vertices, int numVertices, VertexLayout layout, const VertexDecode& decode, PackedVertex* out);
+	PackedVertices packMeshVertices(const Vertex* vertices, int numVertices, const Bounds& bounds, VertexLayout layout, std::vector<PackedVertex>* packed);
+	Vertex unpackVertex(const PackedVertex& packed, VertexLayout layout, const VertexDecode& decode);
+	unsigned short floatToHalf(float value);
+	float halfToFloat(unsigned short half);
+}
+
+#endif // VERTEX_LAYOUT_H
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Terrain/heightmap.h"
+#include "Terrain/parallel.h"
+#include "Texture/normalBaker.h"
+
+namespace {
+	void printUsage() {
+		printf("usage: normalBaker <heights> <normals.ppm|normals.dds> [options]\n");
+		printf("  heights              any 8 or 16 bit image stb_image reads\n");
+		printf("  normals.ppm          raw rgb8\n");
+		printf("  normals.dds          BC5 compressed, z is rebuilt in the shader\n");
+		printf("  --strength <s>       height difference scale per texel (default 24)\n");
+		printf("  --filter <f>         central, sobel or scharr (default sobel)\n");
+		printf("  --clamp              repeat edge texels instead of wrapping, for maps that do not tile\n");
+		printf("  --threads <n>        worker threads (default: all)\n");
+	}
+
+	bool endsWith(const std::string& text, const char* suffix) {
+		size_t length = strlen(suffix);
+		return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		printUsage();
+		return 1;
+	}
+	std::string input = argv[1];
+	std::string output = argv[2];
+	ew::NormalBakeSettings settings;
+	int numThreads = ew::defaultThreadCount();
+	for (int i = 3; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--strength") == 0 && hasValue) {
+			settings.strength = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--filter") == 0 && hasValue) {
+			const char* filter = argv[++i];
+			if (strcmp(filter, "central") == 0) {
+				settings.filter = ew::NormalFilter::CENTRAL;
+			}
+			else if (strcmp(filter, "scharr") == 0) {
+				settings.filter = ew::NormalFilter::SCHARR;
+			}
+			else if (strcmp(filter, "sobel") == 0) {
+				settings.filter = ew::NormalFilter::SOBEL;
+			}
+			else {
+				printf("Unknown filter %s\n", filter);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--clamp") == 0) {
+			settings.wrap = false;
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+			numThreads = atoi(argv[++i]);
+		}
+		else {
+			printUsage();
+			return 1;
+		}
+	}
+
+	Array2D<float> heights;
+	int bitDepth = 0;
+	if (!ew::loadHeightmap(input.c_str(), &heights, 0.0f, 1.0f, &bitDepth)) {
+		return 1;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<unsigned char> normals;
+	ew::bakeNormalMap(heights, settings, &normals, numThreads);
+	float bakeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	bool written = endsWith(output, ".dds") || endsWith(output, ".DDS")
+		? ew::writeNormalMapDds(output, normals.data(), heights.GetWidth(), heights.GetHeight())
+		: ew::writeNetpbm(output, normals.data(), heights.GetWidth(), heights.GetHeight(), 3);
+	if (!written) {
+		printf("Failed to write %s\n", output.c_str());
+		return 1;
+	}
+	printf("%s: %dx%d, %d bit, baked in %.2f ms -> %s\n", input.c_str(), heights.GetWidth(), heights.GetHeight(), bitDepth, bakeMs, output.c_str());
+	return 0;
+}